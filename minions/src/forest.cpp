@@ -85,9 +85,9 @@ GameForest::GameForest(const std::string &path, TiXmlElement *el)
     treeSprites->setIconTexture(*treeSpriteTexture);
     
     //Create a forest and place it into a quadtree for efficient rendering.
-    visibleTreeInstanceIndices.resize(std::max(maxNrHighDetailTrees, maxNrLowDetailTrees));
+    visibleTreeHighDetailIndices.resize(maxNrHighDetailTrees);
+    visibleTreeLowDetailIndices.resize(maxNrLowDetailTrees);
     visibleTreeHighDetailInstances.resize(maxNrHighDetailTrees);
-    visibleTreeLowDetailInstances.resize(maxNrLowDetailTrees);
     quadtree = new lod::Quadtree();
 }
 
@@ -108,46 +108,49 @@ int GameForest::plantTrees(const GameTerrain *terrain, const int &maxNrTrees)
     //Plan trees on terrain.
     const int nrTrees = terrain->createAttributeMapSamples(maxNrTrees, biomeIndex, allTreeHighDetailInstances, treeSpriteSize, allTreeLowDetailInstances, treePositions);
     
-    quadtree->buildQuadtree(treePositions.begin(), treePositions.end());
+    os::ThreadPool pool;
+    
+    quadtree->buildQuadtreeParallel(treePositions.begin(), treePositions.end(), pool);
     
     return nrTrees;
 }
 
-void GameForest::setCameraPosition(const vec3 &cameraPosition)
+void GameForest::setCameraPosition(const vec3 &cameraPosition, const mat4 &worldToScreen)
 {
     if (treePositions.empty())
     {
         return;
     }
     
-    //Update the forest with respect to the camera.
-    int nrInstances = quadtree->retrieveIndicesBetweenRadii(cameraPosition,
-                                                            0.0f, treeHighDetailRadius,
-                                                            visibleTreeInstanceIndices.begin(), maxNrHighDetailTrees)
-                      - visibleTreeInstanceIndices.begin();
+    //Update the forest with respect to the camera, retrieving both detail levels of all visible trees in a single traversal.
+    const std::pair<std::vector<int>::iterator, std::vector<int>::iterator> lastIndices =
+        quadtree->retrieveVisibleIndicesBetweenRadii(cameraPosition,
+                                                     0.0f, treeHighDetailRadius, treeLowDetailRadius,
+                                                     worldToScreen, std::max(treeSpriteSize.x, treeSpriteSize.y),
+                                                     visibleTreeHighDetailIndices.begin(), maxNrHighDetailTrees,
+                                                     visibleTreeLowDetailIndices.begin(), maxNrLowDetailTrees);
+    int nrInstances = lastIndices.first - visibleTreeHighDetailIndices.begin();
     
     //Copy high detail instances.
     for (int i = 0; i < nrInstances; ++i)
     {
-        visibleTreeHighDetailInstances[i] = allTreeHighDetailInstances[visibleTreeInstanceIndices[i]];
+        visibleTreeHighDetailInstances[i] = allTreeHighDetailInstances[visibleTreeHighDetailIndices[i]];
     }
     
     //Send them to the GPU.
     treeTrunkMeshes->setMeshes(visibleTreeHighDetailInstances.begin(), visibleTreeHighDetailInstances.begin() + nrInstances);
     treeLeavesMeshes->setMeshes(visibleTreeHighDetailInstances.begin(), visibleTreeHighDetailInstances.begin() + nrInstances);
     
-    nrInstances = quadtree->retrieveIndicesBetweenRadii(cameraPosition,
-                                                        treeHighDetailRadius, treeLowDetailRadius,
-                                                        visibleTreeInstanceIndices.begin(), maxNrLowDetailTrees)
-                  - visibleTreeInstanceIndices.begin();
+    nrInstances = lastIndices.second - visibleTreeLowDetailIndices.begin();
+    
+    //Copy low detail instances directly to the GPU.
+    draw::WorldIconInstance *lowDetailInstances = treeSprites->mapInstances();
     
-    //Copy low detail instances.
     for (int i = 0; i < nrInstances; ++i)
     {
-        visibleTreeLowDetailInstances[i] = allTreeLowDetailInstances[visibleTreeInstanceIndices[i]];
+        lowDetailInstances[i] = allTreeLowDetailInstances[visibleTreeLowDetailIndices[i]];
     }
     
-    //Send them to the GPU.
-    treeSprites->setIcons(visibleTreeLowDetailInstances.begin(), visibleTreeLowDetailInstances.begin() + nrInstances);
+    treeSprites->unmapInstances(nrInstances);
 }
 
@@ -40,7 +40,7 @@ class GameForest
         ~GameForest();
         
         int plantTrees(const GameTerrain *terrain, const int &nrTrees);
-        void setCameraPosition(const tiny::vec3 &);
+        void setCameraPosition(const tiny::vec3 &, const tiny::mat4 &);
         
         tiny::draw::StaticMeshHorde *treeTrunkMeshes;
         tiny::draw::StaticMeshHorde *treeLeavesMeshes;
@@ -64,9 +64,9 @@ class GameForest
         std::vector<tiny::draw::StaticMeshInstance> allTreeHighDetailInstances;
         std::vector<tiny::draw::WorldIconInstance> allTreeLowDetailInstances;
 
-        std::vector<int> visibleTreeInstanceIndices;
+        std::vector<int> visibleTreeHighDetailIndices;
+        std::vector<int> visibleTreeLowDetailIndices;
         std::vector<tiny::draw::StaticMeshInstance> visibleTreeHighDetailInstances;
-        std::vector<tiny::draw::WorldIconInstance> visibleTreeLowDetailInstances;
         
         std::vector<tiny::vec3> treePositions;
 };
@@ -127,13 +127,13 @@ void Game::update(os::Application *application, const float &dt)
     application->updateSimpleCamera(dt, cameraPosition, cameraOrientation);
     cameraPosition.y = std::max(cameraPosition.y, terrain->getHeight(vec2(cameraPosition.x, cameraPosition.z)) + 2.0f);
     
-    //Update the terrain with respect to the camera.
-    terrain->terrain->setCameraPosition(cameraPosition);
-    
-    forest->setCameraPosition(cameraPosition);
-    
     //Tell the world renderer that the camera has changed.
     renderer->setCamera(cameraPosition, cameraOrientation);
+    
+    //Update the terrain with respect to the camera, skipping the blocks outside the view.
+    terrain->terrain->setCameraPosition(cameraPosition, renderer->getWorldToScreenMatrix());
+    
+    forest->setCameraPosition(cameraPosition, renderer->getWorldToScreenMatrix());
     snd::WorldSounderer::setCamera(cameraPosition, cameraOrientation);
 }
 
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <tiny/os/application.h>
 #include <tiny/os/sdlapplication.h>
+#include <tiny/draw/computetexture.h>
 
 #include "game.h"
 
@@ -64,6 +65,7 @@ int main(int argc, char **argv)
     }
     
     delete game;
+    tiny::draw::ComputeTexture::clearKernels();
     delete application;
     
     std::cerr << "Goodbye." << std::endl;
@@ -24,16 +24,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/computetexture.h>
 #include <tiny/draw/heightmap/scale.h>
 #include <tiny/draw/heightmap/resize.h>
-#include <tiny/draw/heightmap/normalmap.h>
-#include <tiny/draw/heightmap/tangentmap.h>
 #include <tiny/draw/heightmap/diamondsquare.h>
+#include <tiny/draw/heightmap/surfacemaps.h>
 
 #include "terrain.h"
 
 using namespace minions;
 using namespace tiny;
 
-GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
+GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el) :
+    heightField(),
+    heightFieldIsValid(false)
 {
     std::cerr << "Reading terrain resources..." << std::endl;
     
@@ -101,30 +102,39 @@ GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
     
     //Create height maps.
     heightTexture = new draw::FloatTexture2D(img::io::readImage(path + heightMapFileName), draw::tf::filter);
-    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter);
+    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter | draw::tf::hostOnDemand);
     
     //Create normal maps for the far-away and zoomed-in heightmaps.
-    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
+    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
     
     //Create an attribute texture that determines the terrain type (forest/grass/mud/stone) based on the altitude and slope.
     attributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
-    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
+    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Create local diffuse textures.
-    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage());
-    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end());
+    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
-    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage());
-    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end());
+    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Scale vertical range of the far-away heightmap.
-    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f));
+    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f), false);
+    
+    //The far-away tangent, normal, and attribute maps do not depend on the offset, so they are computed only once.
+    draw::computeSurfaceMaps(*farHeightTexture, *farTangentTexture, *farNormalTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x, false);
     
     //Create the terrain.
     terrain = new draw::Terrain(6, 8);
+    
+    //Bound the heights of the far-away and refined zoomed-in height maps, such that blocks of the terrain can be culled.
+    const vec2 heightRange = draw::getDiamondSquareHeightRange(vec2(0.0f, heightScaleFactor), farScale.x, 1.0f);
+    
+    terrain->setHeightRange(heightRange.x, heightRange.y);
+    
     setOffset(vec2(0.5f));
 }
 
@@ -150,20 +160,19 @@ void GameTerrain::setOffset(const vec2 &offset)
     //Zoom into a small area of the far-away heightmap.
     draw::computeResizedTexture(*farHeightTexture, *heightTexture,
                                 vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
-                                farOffset);
+                                farOffset, false);
     
     //Apply the diamond-square fractal algorithm to make the zoomed-in heightmap a little less boring.
-    draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x);
+    draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x, 1.0f, false);
+    
+    //Tangent, normal, and attribute maps of the zoomed-in terrain in a single pass.
+    draw::computeSurfaceMaps(*heightTexture, *tangentTexture, *normalTexture, *attributeTexture, attributeShaderCode, scale.x, false);
     
-    //Tangent and normal maps.
-    draw::computeTangentMap(*farHeightTexture, *farTangentTexture, scale.x*farScale.x);
-    draw::computeTangentMap(*heightTexture, *tangentTexture, scale.x);
-    draw::computeNormalMap(*farHeightTexture, *farNormalTexture, scale.x*farScale.x);
-    draw::computeNormalMap(*heightTexture, *normalTexture, scale.x);
+    //Only the zoomed-in height and attribute maps are used on the CPU, start reading them back without waiting for the device.
+    heightTexture->beginReadback();
+    attributeTexture->beginReadback();
+    heightFieldIsValid = false;
     
-    //Calculate attribute maps for both the zoomed-in and far-away terrain.
-    calculateAttributes(*heightTexture, *attributeTexture, attributeShaderCode, scale.x);
-    calculateAttributes(*farHeightTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x);
     terrain->setFarDiffuseTextures(*attributeTexture, *farAttributeTexture, *localDiffuseTextures, *localNormalTextures, localTextureScale);
     //terrain->setDiffuseTextures(*attributeTexture, *localDiffuseTextures, *localNormalTextures, vec2(1.0f, 1.0f));
     
@@ -180,6 +189,8 @@ void GameTerrain::setOffset(const vec2 &offset)
 int GameTerrain::createAttributeMapSamples(const int &maxNrSamples, const int &index,
                                            std::vector<draw::StaticMeshInstance> &highDetailInstances, const vec2 &lowDetailInstanceSize, std::vector<draw::WorldIconInstance> &lowDetailInstances, std::vector<vec3> &positions) const
 {
+    finishReadbacks();
+    
     const float maxDistance = 0.5f*heightTexture->getWidth()*scale.x;
     int nrSamples = 0;
     
@@ -210,7 +221,7 @@ int GameTerrain::createAttributeMapSamples(const int &maxNrSamples, const int &i
         if (placeProbability <= 0.5f && placeProbability >= -0.5f)
         {
             //Determine height.
-            const vec3 samplePosition = vec3(samplePlanePosition.x, GameTerrain::sampleTextureBilinear(*heightTexture, scale, samplePlanePosition).x, samplePlanePosition.y);
+            const vec3 samplePosition = vec3(samplePlanePosition.x, heightField.getHeight(samplePlanePosition), samplePlanePosition.y);
             
             highDetailInstances.push_back(draw::StaticMeshInstance(vec4(samplePosition.x, samplePosition.y, samplePosition.z, 1.0f),
                                                                    vec4(0.0f, 0.0f, 0.0f, 1.0f)));
@@ -228,32 +239,37 @@ int GameTerrain::createAttributeMapSamples(const int &maxNrSamples, const int &i
     return nrSamples;
 }
 
-void GameTerrain::calculateAttributes(const tiny::draw::FloatTexture2D &heightMap, tiny::draw::RGBATexture2D &attributeMap, const std::string &shaderCode, const float &scale)
+float GameTerrain::getHeight(const vec2 &a_pos) const
 {
-    std::vector<std::string> inputTextures;
-    std::vector<std::string> outputTextures;
-    
-    inputTextures.push_back("source");
-    outputTextures.push_back("colour");
-
-    draw::ComputeTexture *computeTexture = new draw::ComputeTexture(inputTextures, outputTextures, shaderCode);
-    
-    computeTexture->uniformMap().setFloatUniform(2.0f*scale, "mapScale");
-    computeTexture->setInput(heightMap, "source");
-    computeTexture->setOutput(attributeMap, "colour");
-    computeTexture->compute();
-    attributeMap.getFromDevice();
+    finishReadbacks();
     
-    delete computeTexture;
+    return heightField.getHeight(a_pos);
 }
 
-float GameTerrain::getHeight(const vec2 &a_pos) const
+void GameTerrain::getHeights(const vec2 *positions, float *heights, const size_t &n) const
 {
-    return sampleTextureBilinear(*heightTexture, scale, a_pos).x;
+    finishReadbacks();
+    
+    heightField.getHeights(positions, heights, n);
 }
 
 float GameTerrain::getAttribute(const vec2 &a_pos) const
 {
+    finishReadbacks();
+    
     return sampleTextureBilinear(*attributeTexture, scale, a_pos).x;
 }
 
+void GameTerrain::finishReadbacks() const
+{
+    //Wait for the height and attribute maps, if they are still being read back from the device.
+    heightTexture->finishReadback();
+    attributeTexture->finishReadback();
+    
+    if (!heightFieldIsValid)
+    {
+        heightField.setHeights(*heightTexture, scale);
+        heightFieldIsValid = true;
+    }
+}
+
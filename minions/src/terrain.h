@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/terrain.h>
 #include <tiny/draw/texture2d.h>
 #include <tiny/draw/texture2darray.h>
+#include <tiny/draw/heightmap/heightfield.h>
 
 #include <tiny/draw/staticmeshhorde.h>
 #include <tiny/draw/iconhorde.h>
@@ -41,12 +42,13 @@ class GameTerrain
         int createAttributeMapSamples(const int &, const int &, std::vector<tiny::draw::StaticMeshInstance> &, const tiny::vec2 &, std::vector<tiny::draw::WorldIconInstance> &, std::vector<tiny::vec3> &) const;
         
         float getHeight(const tiny::vec2 &) const;
+        void getHeights(const tiny::vec2 *, float *, const size_t &) const;
         float getAttribute(const tiny::vec2 &) const;
         
         tiny::draw::Terrain *terrain;
         
     private:
-        static void calculateAttributes(const tiny::draw::FloatTexture2D &, tiny::draw::RGBATexture2D &, const std::string &, const float &);
+        void finishReadbacks() const;
         
         //A simple bilinear texture sampler, which converts world coordinates to the corresponding texture coordinates on the zoomed-in terrain.
         template<typename TextureType>
@@ -82,6 +84,10 @@ class GameTerrain
         tiny::draw::RGBATexture2D *farAttributeTexture;
         tiny::draw::RGBTexture2DArray *localDiffuseTextures;
         tiny::draw::RGBTexture2DArray *localNormalTextures;
+        
+        //Copy of the zoomed-in height map for sampling on the CPU, rebuilt after every readback.
+        mutable tiny::draw::HeightField heightField;
+        mutable bool heightFieldIsValid;
 };
 
 } //namespace minions
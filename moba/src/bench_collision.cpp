@@ -0,0 +1,229 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/os/threadpool.h>
+
+#include "collision.h"
+
+using namespace moba;
+using namespace tiny;
+
+//Compare the compressed sparse row collision buckets with the original linked list buckets, for a map full of trees and a few thousand moving minions.
+
+const int nrStaticCylinders = 50000;
+const int nrMinions = 5000;
+const float mapSize = 2048.0f;
+const int nrFrames = 32;
+
+/** The original collision buckets, which store a linked list per bucket. */
+class ListCollisionHashMap
+{
+    public:
+        ListCollisionHashMap(const size_t &a_nrBuckets, const size_t &a_p1, const size_t &a_p2, const float &a_size) :
+            nrBuckets(a_nrBuckets),
+            p1(a_p1),
+            p2(a_p2),
+            size(a_size),
+            cylinders(),
+            buckets()
+        {
+
+        }
+
+        void buildCollisionBuckets(const std::vector<vec4> &collisionCylinders, os::ThreadPool *)
+        {
+            buckets = std::vector<std::list<int> >(nrBuckets, std::list<int>());
+            cylinders = collisionCylinders;
+
+            for (std::vector<vec4>::const_iterator i = collisionCylinders.begin(); i != collisionCylinders.end(); ++i)
+            {
+                const int minX = static_cast<int>(floor((i->x - i->w)/size));
+                const int maxX = static_cast<int>(floor((i->x + i->w)/size));
+                const int minY = static_cast<int>(floor((i->z - i->w)/size));
+                const int maxY = static_cast<int>(floor((i->z + i->w)/size));
+
+                for (int j = minX; j <= maxX; ++j)
+                {
+                    for (int k = minY; k <= maxY; ++k)
+                    {
+                        buckets[(p1*static_cast<size_t>(j) + p2*static_cast<size_t>(k)) & (nrBuckets - 1)].push_back(i - collisionCylinders.begin());
+                    }
+                }
+            }
+        }
+
+        vec2 projectVelocity(const vec2 &pos, const float &radius, vec2 vel) const
+        {
+            const float r = length(vel) + radius;
+            const int minX = static_cast<int>(floor((pos.x - r)/size));
+            const int maxX = static_cast<int>(floor((pos.x + r)/size));
+            const int minY = static_cast<int>(floor((pos.y - r)/size));
+            const int maxY = static_cast<int>(floor((pos.y + r)/size));
+
+            for (int j = minX; j <= maxX; ++j)
+            {
+                for (int k = minY; k <= maxY; ++k)
+                {
+                    const std::list<int> &l = buckets[(p1*static_cast<size_t>(j) + p2*static_cast<size_t>(k)) & (nrBuckets - 1)];
+
+                    for (std::list<int>::const_iterator m = l.begin(); m != l.end(); ++m)
+                    {
+                        const vec4 &cyl = cylinders[*m];
+                        vec2 delta = vec2(cyl.x, cyl.z) - pos;
+                        const float r1 = length(delta);
+                        const float r2 = cyl.w + radius;
+
+                        if (r1 <= r2 && r1 >= 1.0e-6)
+                        {
+                            delta = delta/r1;
+                            vel = vel - std::max(dot(delta, vel), 0.0f)*delta;
+                        }
+                    }
+                }
+            }
+
+            return vel;
+        }
+
+    private:
+        const size_t nrBuckets;
+        const size_t p1, p2;
+        const float size;
+        std::vector<vec4> cylinders;
+        std::vector<std::list<int> > buckets;
+};
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+/** Simulate moving minions for a number of frames, rebuilding the buckets every frame, and return the resulting velocities. */
+template <typename HashMap>
+std::vector<vec2> simulate(HashMap &hashMap, const std::vector<vec4> &staticCylinders, const std::vector<vec2> &targets,
+                           double &buildTime, double &queryTime, os::ThreadPool *pool = 0)
+{
+    std::vector<vec2> positions(nrMinions, vec2(0.0f, 0.0f));
+    std::vector<vec2> velocities;
+    std::vector<vec4> cylinders;
+
+    buildTime = 0.0;
+    queryTime = 0.0;
+
+    for (int i = 0; i < nrMinions; ++i)
+    {
+        positions[i] = targets[(i + nrMinions/2) % nrMinions];
+    }
+
+    for (int frame = 0; frame < nrFrames; ++frame)
+    {
+        cylinders = staticCylinders;
+
+        for (int i = 0; i < nrMinions; ++i)
+        {
+            cylinders.push_back(vec4(positions[i].x, 0.0f, positions[i].y, 1.0f));
+        }
+
+        double t = getTime();
+
+        hashMap.buildCollisionBuckets(cylinders, pool);
+
+        buildTime += getTime() - t;
+
+        velocities.clear();
+        t = getTime();
+
+        for (int i = 0; i < nrMinions; ++i)
+        {
+            const vec2 d = normalize(targets[i] - positions[i]);
+
+            velocities.push_back(hashMap.projectVelocity(positions[i], 1.0f, vec2(4.0f*d.x, 4.0f*d.y)));
+        }
+
+        queryTime += getTime() - t;
+
+        for (int i = 0; i < nrMinions; ++i)
+        {
+            positions[i] = vec2(positions[i].x + velocities[i].x, positions[i].y + velocities[i].y);
+        }
+    }
+
+    buildTime /= nrFrames;
+    queryTime /= nrFrames;
+
+    return velocities;
+}
+
+bool identical(const std::vector<vec2> &a, const std::vector<vec2> &b)
+{
+    if (a.size() != b.size()) return false;
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    }
+
+    return true;
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    std::vector<vec4> staticCylinders;
+    std::vector<vec2> targets;
+
+    for (int i = 0; i < nrStaticCylinders; ++i)
+    {
+        const vec2 p = randomVec2(mapSize);
+
+        staticCylinders.push_back(vec4(p.x, 0.0f, p.y, 1.0f + 4.0f*static_cast<float>(rand())/static_cast<float>(RAND_MAX)));
+    }
+
+    for (int i = 0; i < nrMinions; ++i)
+    {
+        targets.push_back(randomVec2(mapSize));
+    }
+
+    ListCollisionHashMap listHashMap(1024, 3, 7, 16.0f);
+    CollisionHashMap hashMap(1024, 3, 7, 16.0f);
+    os::ThreadPool pool;
+    double listBuild = 0.0, listQuery = 0.0, serialBuild = 0.0, serialQuery = 0.0, parallelBuild = 0.0, parallelQuery = 0.0;
+
+    const std::vector<vec2> a = simulate(listHashMap, staticCylinders, targets, listBuild, listQuery);
+    const std::vector<vec2> b = simulate(hashMap, staticCylinders, targets, serialBuild, serialQuery);
+    const std::vector<vec2> c = simulate(hashMap, staticCylinders, targets, parallelBuild, parallelQuery, &pool);
+    const int nrMismatches = (identical(a, b) ? 0 : 1) + (identical(a, c) ? 0 : 1);
+
+    std::cout << "Collision detection for " << nrStaticCylinders << " static cylinders and " << nrMinions << " minions, per frame:" << std::endl
+              << "    std::list buckets  build " << 1.0e3*listBuild << " ms, query " << 1.0e3*listQuery << " ms" << std::endl
+              << "    CSR, 1 thread      build " << 1.0e3*serialBuild << " ms, query " << 1.0e3*serialQuery << " ms" << std::endl
+              << "    CSR, " << pool.getNrThreads() << " threads     build " << 1.0e3*parallelBuild << " ms, query " << 1.0e3*parallelQuery << " ms" << std::endl
+              << nrMismatches << " mismatching simulations" << std::endl;
+
+    return (nrMismatches == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,182 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+
+#include <cmath>
+
+#include "collision.h"
+
+using namespace moba;
+using namespace tiny;
+
+/** Processes a range of chunks of cylinders, either counting the number of cells they cover per bucket or writing their indices to the buckets. */
+class CollisionHashMap::BucketJob
+{
+    public:
+        BucketJob(CollisionHashMap *a_map, const bool &a_fill, const int &a_chunkSize) :
+            map(a_map),
+            fill(a_fill),
+            chunkSize(a_chunkSize)
+        {
+
+        }
+
+        void operator () (const int &first, const int &last)
+        {
+            const int nrCylinders = map->cylinders.size();
+
+            for (int c = first; c < last; ++c)
+            {
+                int *offsets = &map->chunkOffsets[c*map->nrBuckets];
+
+                for (int i = c*chunkSize; i < std::min(nrCylinders, (c + 1)*chunkSize); ++i)
+                {
+                    if (!fill)
+                    {
+                        //A single cylinder can cover multiple buckets.
+                        const vec4 &cyl = map->cylinders[i];
+
+                        map->cylinderCells[i] = ivec4(static_cast<int>(floor((cyl.x - cyl.w)/map->size)),
+                                                      static_cast<int>(floor((cyl.x + cyl.w)/map->size)),
+                                                      static_cast<int>(floor((cyl.z - cyl.w)/map->size)),
+                                                      static_cast<int>(floor((cyl.z + cyl.w)/map->size)));
+                    }
+
+                    const ivec4 cells = map->cylinderCells[i];
+
+                    for (int j = cells.x; j <= cells.y; ++j)
+                    {
+                        for (int k = cells.z; k <= cells.w; ++k)
+                        {
+                            if (fill) map->bucketIndices[offsets[map->getBucket(j, k)]++] = i;
+                            else offsets[map->getBucket(j, k)]++;
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        CollisionHashMap *map;
+        bool fill;
+        int chunkSize;
+};
+
+CollisionHashMap::CollisionHashMap(const size_t &a_nrBuckets, const size_t &a_p1, const size_t &a_p2, const float &a_size) :
+    nrBuckets(a_nrBuckets),
+    p1(a_p1),
+    p2(a_p2),
+    size(a_size),
+    cylinders(),
+    cylinderCells(),
+    bucketOffsets(a_nrBuckets + 1, 0),
+    bucketIndices(),
+    chunkOffsets()
+{
+
+}
+
+CollisionHashMap::~CollisionHashMap()
+{
+
+}
+
+void CollisionHashMap::buildCollisionBuckets(const std::vector<tiny::vec4> &collisionCylinders, os::ThreadPool *pool)
+{
+    //Split the cylinders into chunks that can be processed independently.
+    const int nrCylinders = collisionCylinders.size();
+    const int nrChunks = std::max(1, std::min(pool ? 4*pool->getNrThreads() : 1, nrCylinders/1024));
+    const int chunkSize = (nrCylinders + nrChunks - 1)/nrChunks;
+
+    cylinders = collisionCylinders;
+    cylinderCells.resize(nrCylinders);
+    chunkOffsets.assign(nrChunks*nrBuckets, 0);
+
+    //Count the number of cells covered by each chunk per bucket.
+    BucketJob countJob(this, false, chunkSize);
+
+    if (pool) pool->parallelFor(nrChunks, 1, countJob);
+    else countJob(0, nrChunks);
+
+    //Convert the counts to offsets, such that within each bucket the cylinders remain in their original order.
+    int total = 0;
+
+    for (size_t b = 0; b < nrBuckets; ++b)
+    {
+        bucketOffsets[b] = total;
+
+        for (int c = 0; c < nrChunks; ++c)
+        {
+            const int count = chunkOffsets[c*nrBuckets + b];
+
+            chunkOffsets[c*nrBuckets + b] = total;
+            total += count;
+        }
+    }
+
+    bucketOffsets[nrBuckets] = total;
+    bucketIndices.resize(total);
+
+    //Write the cylinder indices to their buckets.
+    BucketJob fillJob(this, true, chunkSize);
+
+    if (pool) pool->parallelFor(nrChunks, 1, fillJob);
+    else fillJob(0, nrChunks);
+}
+
+vec2 CollisionHashMap::projectVelocity(const vec2 &pos, const float &radius, vec2 vel) const
+{
+    //Project velocity away from cylinders with which we collide.
+    //A single cylinder can cover multiple buckets.
+    const float r = length(vel) + radius;
+    const int minX = static_cast<int>(floor((pos.x - r)/size));
+    const int maxX = static_cast<int>(floor((pos.x + r)/size));
+    const int minY = static_cast<int>(floor((pos.y - r)/size));
+    const int maxY = static_cast<int>(floor((pos.y + r)/size));
+
+    for (int j = minX; j <= maxX; ++j)
+    {
+        for (int k = minY; k <= maxY; ++k)
+        {
+            const size_t b = getBucket(j, k);
+
+            for (int m = bucketOffsets[b]; m < bucketOffsets[b + 1]; ++m)
+            {
+                vel = projectVelocityCylinder(cylinders[bucketIndices[m]], pos, radius, vel);
+            }
+        }
+    }
+
+    return vel;
+}
+
+vec2 CollisionHashMap::projectVelocityCylinder(const vec4 &cyl, const vec2 &pos, const float &radius, vec2 vel) const
+{
+    vec2 delta = vec2(cyl.x, cyl.z) - pos;
+    const float r1 = length(delta);
+    const float r2 = cyl.w + radius;
+
+    if (r1 <= r2 && r1 >= 1.0e-6)
+    {
+        //We are inside the cylinder, so we can only move away from its center.
+        delta = delta/r1;
+        vel = vel - std::max(dot(delta, vel), 0.0f)*delta;
+    }
+
+    return vel;
+}
+
@@ -0,0 +1,64 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+
+#include <tiny/math/vec.h>
+#include <tiny/os/threadpool.h>
+
+namespace moba
+{
+
+/** Hashes collision cylinders into a fixed number of buckets of grid cells.
+  * The buckets are stored in compressed sparse row format: all cylinder indices are stored contiguously, ordered by bucket, and bucketOffsets[b] gives the start of bucket b.
+  * All storage is reused between calls to buildCollisionBuckets(), such that rebuilding the buckets every frame does not allocate memory. */
+class CollisionHashMap
+{
+    public:
+        CollisionHashMap(const size_t &, const size_t &, const size_t &, const float &);
+        ~CollisionHashMap();
+
+        void buildCollisionBuckets(const std::vector<tiny::vec4> &, tiny::os::ThreadPool * = 0);
+        tiny::vec2 projectVelocity(const tiny::vec2 &, const float &, tiny::vec2) const;
+
+    private:
+        class BucketJob;
+
+        tiny::vec2 projectVelocityCylinder(const tiny::vec4 &, const tiny::vec2 &, const float &, tiny::vec2) const;
+
+        inline size_t getBucket(const int &x, const int &y) const
+        {
+            return (p1*static_cast<size_t>(x) + p2*static_cast<size_t>(y)) & (nrBuckets - 1);
+        }
+
+        const size_t nrBuckets;
+        const size_t p1, p2;
+        const float size;
+
+        //Collision detection.
+        std::vector<tiny::vec4> cylinders;
+        std::vector<tiny::ivec4> cylinderCells;
+        std::vector<int> bucketOffsets;
+        std::vector<int> bucketIndices;
+
+        //Per-bucket counts and offsets for each chunk of cylinders, used to build the buckets in parallel.
+        std::vector<int> chunkOffsets;
+};
+
+} //namespace moba
+
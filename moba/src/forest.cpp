@@ -76,9 +76,8 @@ GameForest::GameForest(const std::string &path, TiXmlElement *el)
     treeSprites->setIconTexture(*treeSpriteTexture);
     
     //Create a forest and place it into a quadtree for efficient rendering.
-    visibleTreeInstanceIndices.resize(std::max(maxNrHighDetailTrees, maxNrLowDetailTrees));
-    visibleTreeHighDetailInstances.resize(maxNrHighDetailTrees);
-    visibleTreeLowDetailInstances.resize(maxNrLowDetailTrees);
+    visibleTreeHighDetailIndices.resize(maxNrHighDetailTrees);
+    visibleTreeLowDetailIndices.resize(maxNrLowDetailTrees);
     quadtree = new lod::Quadtree();
 }
 
@@ -97,7 +96,9 @@ std::list<vec4> GameForest::plantTrees(const GameTerrain *terrain)
     const int maxNrTrees = nrPlantedTrees;
     
     terrain->createAttributeMapSamples(maxNrTrees, biomeIndex, allTreeHighDetailInstances, treeSpriteSize, allTreeLowDetailInstances, treePositions);
-    quadtree->buildQuadtree(treePositions.begin(), treePositions.end());
+    os::ThreadPool pool;
+    
+    quadtree->buildQuadtreeParallel(treePositions.begin(), treePositions.end(), pool);
     
     //Add collision cylinders.
     std::list<vec4> cylinders;
@@ -110,40 +111,42 @@ std::list<vec4> GameForest::plantTrees(const GameTerrain *terrain)
     return cylinders;
 }
 
-void GameForest::setCameraPosition(const vec3 &cameraPosition)
+void GameForest::setCameraPosition(const vec3 &cameraPosition, const mat4 &worldToScreen)
 {
     if (treePositions.empty())
     {
         return;
     }
     
-    //Update the forest with respect to the camera.
-    int nrInstances = quadtree->retrieveIndicesBetweenRadii(cameraPosition,
-                                                            0.0f, treeHighDetailRadius,
-                                                            visibleTreeInstanceIndices.begin(), maxNrHighDetailTrees)
-                      - visibleTreeInstanceIndices.begin();
+    //Update the forest with respect to the camera, retrieving both detail levels of all visible trees in a single traversal.
+    const std::pair<std::vector<int>::iterator, std::vector<int>::iterator> lastIndices =
+        quadtree->retrieveVisibleIndicesBetweenRadii(cameraPosition,
+                                                     0.0f, treeHighDetailRadius, treeLowDetailRadius,
+                                                     worldToScreen, std::max(treeSpriteSize.x, treeSpriteSize.y),
+                                                     visibleTreeHighDetailIndices.begin(), maxNrHighDetailTrees,
+                                                     visibleTreeLowDetailIndices.begin(), maxNrLowDetailTrees);
+    int nrInstances = lastIndices.first - visibleTreeHighDetailIndices.begin();
+    
+    //Copy high detail instances directly to the GPU.
+    draw::StaticMeshInstance *highDetailInstances = treeMeshes->mapInstances();
     
-    //Copy high detail instances.
     for (int i = 0; i < nrInstances; ++i)
     {
-        visibleTreeHighDetailInstances[i] = allTreeHighDetailInstances[visibleTreeInstanceIndices[i]];
+        highDetailInstances[i] = allTreeHighDetailInstances[visibleTreeHighDetailIndices[i]];
     }
     
-    //Send them to the GPU.
-    treeMeshes->setMeshes(visibleTreeHighDetailInstances.begin(), visibleTreeHighDetailInstances.begin() + nrInstances);
+    treeMeshes->unmapInstances(nrInstances);
+    
+    nrInstances = lastIndices.second - visibleTreeLowDetailIndices.begin();
     
-    nrInstances = quadtree->retrieveIndicesBetweenRadii(cameraPosition,
-                                                        treeHighDetailRadius, treeLowDetailRadius,
-                                                        visibleTreeInstanceIndices.begin(), maxNrLowDetailTrees)
-                  - visibleTreeInstanceIndices.begin();
+    //Copy low detail instances directly to the GPU.
+    draw::WorldIconInstance *lowDetailInstances = treeSprites->mapInstances();
     
-    //Copy low detail instances.
     for (int i = 0; i < nrInstances; ++i)
     {
-        visibleTreeLowDetailInstances[i] = allTreeLowDetailInstances[visibleTreeInstanceIndices[i]];
+        lowDetailInstances[i] = allTreeLowDetailInstances[visibleTreeLowDetailIndices[i]];
     }
     
-    //Send them to the GPU.
-    treeSprites->setIcons(visibleTreeLowDetailInstances.begin(), visibleTreeLowDetailInstances.begin() + nrInstances);
+    treeSprites->unmapInstances(nrInstances);
 }
 
@@ -41,7 +41,7 @@ class GameForest
         ~GameForest();
         
         std::list<tiny::vec4> plantTrees(const GameTerrain *terrain);
-        void setCameraPosition(const tiny::vec3 &);
+        void setCameraPosition(const tiny::vec3 &, const tiny::mat4 &);
         
         tiny::draw::StaticMeshHorde *treeMeshes;
         tiny::draw::WorldIconHorde *treeSprites;
@@ -64,9 +64,8 @@ class GameForest
         std::vector<tiny::draw::StaticMeshInstance> allTreeHighDetailInstances;
         std::vector<tiny::draw::WorldIconInstance> allTreeLowDetailInstances;
 
-        std::vector<int> visibleTreeInstanceIndices;
-        std::vector<tiny::draw::StaticMeshInstance> visibleTreeHighDetailInstances;
-        std::vector<tiny::draw::WorldIconInstance> visibleTreeLowDetailInstances;
+        std::vector<int> visibleTreeHighDetailIndices;
+        std::vector<int> visibleTreeLowDetailIndices;
         
         std::vector<tiny::vec3> treePositions;
 };
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <exception>
 
 #include <tiny/img/io/image.h>
@@ -30,107 +31,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace moba;
 using namespace tiny;
 
-CollisionHashMap::CollisionHashMap(const size_t &a_nrBuckets, const size_t &a_p1, const size_t &a_p2, const float &a_size) :
-    nrBuckets(a_nrBuckets),
-    p1(a_p1),
-    p2(a_p2),
-    size(a_size),
-    cylinders(),
-    buckets()
-{
-
-}
-
-CollisionHashMap::~CollisionHashMap()
-{
-
-}
-
-void CollisionHashMap::buildCollisionBuckets(const std::vector<tiny::vec4> &collisionCylinders)
-{
-    //Allocate collision detection buckets.
-    buckets = std::vector<std::list<int> >(nrBuckets, std::list<int>());
-    
-    //Assign all cylinders to their buckets.
-    cylinders = collisionCylinders;
-    
-    for (std::vector<tiny::vec4>::const_iterator i = collisionCylinders.begin(); i != collisionCylinders.end(); ++i)
-    {
-        //A single cylinder can cover multiple buckets.
-        const int minX = static_cast<int>(floor((i->x - i->w)/size));
-        const int maxX = static_cast<int>(floor((i->x + i->w)/size));
-        const int minY = static_cast<int>(floor((i->z - i->w)/size));
-        const int maxY = static_cast<int>(floor((i->z + i->w)/size));
-        
-        for (int j = minX; j <= maxX; ++j)
-        {
-            for (int k = minY; k <= maxY; ++k)
-            {
-                buckets[(p1*static_cast<size_t>(j) + p2*static_cast<size_t>(k)) & (nrBuckets - 1)].push_back(i - collisionCylinders.begin());
-            }
-        }
-    }
-    
-    /*
-    size_t nrEmpty = 0;
-    
-    for (std::vector<std::list<int> >::const_iterator i = buckets.begin(); i != buckets.end(); ++i)
-    {
-        if (i->empty())
-        {
-            ++nrEmpty;
-        }
-    }
-    
-    std::cerr << nrEmpty << "/" << buckets.size() << " empty buckets, " << cylinders.size()/buckets.size() << " cylinders per bucket." << std::endl;
-    */
-}
-
-vec2 CollisionHashMap::projectVelocity(const vec2 &pos, const float &radius, vec2 vel) const
-{
-    //Project velocity away from cylinders with which we collide.
-    //A single cylinder can cover multiple buckets.
-    const float r = length(vel) + radius;
-    const int minX = static_cast<int>(floor((pos.x - r)/size));
-    const int maxX = static_cast<int>(floor((pos.x + r)/size));
-    const int minY = static_cast<int>(floor((pos.y - r)/size));
-    const int maxY = static_cast<int>(floor((pos.y + r)/size));
-    
-    for (int j = minX; j <= maxX; ++j)
-    {
-        for (int k = minY; k <= maxY; ++k)
-        {
-            const std::list<int> &l = buckets[(p1*static_cast<size_t>(j) + p2*static_cast<size_t>(k)) & (nrBuckets - 1)];
-            
-            for (std::list<int>::const_iterator m = l.begin(); m != l.end(); ++m)
-            {
-                vel = projectVelocityCylinder(cylinders[*m], pos, radius, vel);
-            }
-        }
-    }
-    
-    return vel;
-}
-
-vec2 CollisionHashMap::projectVelocityCylinder(const vec4 &cyl, const vec2 &pos, const float &radius, vec2 vel) const
-{
-    vec2 delta = vec2(cyl.x, cyl.z) - pos;
-    const float r1 = length(delta);
-    const float r2 = cyl.w + radius;
-    
-    if (r1 <= r2 && r1 >= 1.0e-6)
-    {
-        //We are inside the cylinder, so we can only move away from its center.
-        delta = delta/r1;
-        vel = vel - std::max(dot(delta, vel), 0.0f)*delta;
-    }
-    
-    return vel;
-}
-
 Game::Game(const os::Application *application, const std::string &path) :
     aspectRatio(static_cast<double>(application->getScreenWidth())/static_cast<double>(application->getScreenHeight())),
-    collisionHandler(1024, 3, 7, 16.0f)
+    collisionHandler(1024, 3, 7, 16.0f),
+    workerPool()
 {
     menuCameraPosition = vec3(0.0f, 0.0f, 0.0f);
     menuCameraOrientation = vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -142,6 +46,9 @@ Game::Game(const os::Application *application, const std::string &path) :
     
     renderer = new draw::WorldRenderer(application->getScreenWidth(), application->getScreenHeight());
     
+    //Group the minion hordes and other meshes by shader program to reduce state changes.
+    renderer->setRenderOrder(draw::RenderStateSorted);
+    
     unsigned int index = 0;
     
     renderer->addWorldRenderable(index++, skyBoxMesh);
@@ -201,10 +108,19 @@ void Game::spawnMinionAtPath(const std::string &name, const std::string &minionT
     assert(minionTypes.find(minionType) != minionTypes.end());
     assert(minionPaths.find(path) != minionPaths.end());
     
-    Minion minion = Minion(name, minionType, minionPaths[path]->nodes[0] + randomVec2(radius));
+    //Resolve the handles of the type and path.
+    const int type = std::find(minionTypeHandles.begin(), minionTypeHandles.end(), minionTypes[minionType]) - minionTypeHandles.begin();
+    const int pathHandle = std::find(minionPathHandles.begin(), minionPathHandles.end(), minionPaths[path]) - minionPathHandles.begin();
+    const MinionType *mt = minionTypeHandles[type];
+    Minion minion = Minion(name, minionType, minionPathHandles[pathHandle]->nodes[0] + randomVec2(radius));
     
     minion.path = path;
-    minions.insert(std::make_pair(minionIndex++, minion));
+    
+    assert(mt->mesh.skeleton.animations.find(minion.action) != mt->mesh.skeleton.animations.end());
+    
+    const int nrAnimationFrames = mt->mesh.skeleton.animations.find(minion.action)->second.frames.size()/mt->mesh.skeleton.bones.size();
+    
+    minions.add(minion, type, pathHandle, nrAnimationFrames);
 
     std::cerr << "Spawned minion " << name << " of type " << minionType << " at path " << path << "." << std::endl;
 }
@@ -248,22 +164,96 @@ std::vector<vec4> Game::createCollisionCylinders() const
     //Create a list of all objects that can be collided with.
     std::vector<vec4> cylinders;
     
-    cylinders.reserve(staticCollisionCylinders.size() + minions.size());
+    cylinders.reserve(staticCollisionCylinders.size() + minions.size() + 1);
     cylinders.insert(cylinders.begin(), staticCollisionCylinders.begin(), staticCollisionCylinders.end());
     
-    for (std::map<unsigned int, Minion>::const_iterator i = minions.begin(); i != minions.end(); ++i)
+    //Sample the terrain height of all minions at once.
+    std::vector<float> heights(minions.size());
+    
+    if (!heights.empty()) terrain->getHeights(&minions.positions[0], &heights[0], heights.size());
+    
+    for (size_t i = 0; i < minions.size(); ++i)
     {
-        const Minion m = i->second;
-        std::map<std::string, MinionType *>::const_iterator j = minionTypes.find(m.type);
-        assert(j != minionTypes.end());
-        const MinionType *mt = j->second;
+        const vec2 pos = minions.positions[i];
         
-        cylinders.push_back(vec4(m.pos.x, terrain->getHeight(m.pos), m.pos.y, mt->radius));
+        cylinders.push_back(vec4(pos.x, heights[i], pos.y, minionTypeHandles[minions.types[i]]->radius));
     }
     
     return cylinders;
 }
 
+/** Advances a range of minions by a single time step, such that the simulation can be divided over the worker pool. */
+class Game::MinionJob
+{
+    public:
+        MinionJob(Game *a_game, const float &a_dt) :
+            game(a_game),
+            dt(a_dt)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last)
+        {
+            game->updateMinions(first, last, dt);
+        }
+        
+    private:
+        Game *game;
+        float dt;
+};
+
+void Game::updateMinions(const int &first, const int &last, const float &dt)
+{
+    //Every minion only reads shared data and writes its own entries of the minion store, so minions can be updated in any order.
+    //TODO: Store FPS in animation somehow.
+    const float fps = 20.0f;
+    
+    for (int i = first; i < last; ++i)
+    {
+        const MinionType *mt = minionTypeHandles[minions.types[i]];
+        vec2 &pos = minions.positions[i];
+        
+        //Increment action time.
+        minions.actionTimes[i] += dt;
+        minions.erased[i] = 0;
+        
+        //Follow the assigned path if any.
+        if (minions.paths[i] >= 0)
+        {
+            const MinionPath *p = minionPathHandles[minions.paths[i]];
+            unsigned int &pathIndex = minions.pathIndices[i];
+            
+            //Have we reached the current node?
+            if (length(pos - p->nodes[pathIndex]) < 16.0f)
+            {
+                pathIndex++;
+            }
+            
+            if (pathIndex >= p->nodes.size())
+            {
+                //We have reached the end of the path --> remove the minion.
+                minions.erased[i] = 1;
+            }
+            else
+            {
+                //Head for the next node.
+                const vec2 d = normalize(p->nodes[pathIndex] - pos);
+                vec2 vel = mt->maxSpeed*dt*d;
+                
+                vel = collisionHandler.projectVelocity(pos, mt->radius, vel);
+                pos += vel;
+                minions.angles[i] = atan2f(d.y, d.x) - M_PI/2.0;
+            }
+        }
+        
+        const int frame = static_cast<int>(floor(minions.actionTimes[i]*fps)) % minions.nrAnimationFrames[i];
+        
+        //The height is filled in after all minions have moved.
+        minions.instances[i] = draw::AnimatedMeshInstance(vec4(pos.x, 0.0f, pos.y, 1.0f), quatrot(minions.angles[i], vec3(0.0f, 1.0f, 0.0f)), ivec2(3*mt->mesh.skeleton.bones.size()*frame, 0));
+    }
+}
+
 void Game::update(os::Application *application, const float &dt)
 {
     //Update minions.
@@ -301,73 +291,35 @@ void Game::update(os::Application *application, const float &dt)
         
         cylinders.push_back(vec4(cameraPosition.x, cameraPosition.y, cameraPosition.z, 0.5f));
         
-        collisionHandler.buildCollisionBuckets(cylinders);
+        collisionHandler.buildCollisionBuckets(cylinders, &workerPool);
     }
     
-    //Update minions and fill instance lists.
-    for (std::map<unsigned int, Minion>::iterator i = minions.begin(); i != minions.end(); )
+    //Update minions in parallel.
+    if (minions.size() > 0)
     {
-        Minion m = i->second;
-        assert(minionTypes.find(m.type) != minionTypes.end());
-        MinionType *mt = minionTypes[m.type];
-        draw::AnimatedMeshInstance mi;
+        MinionJob job(this, dt);
         
-        //Increment action time.
-        bool isErased = false;
+        workerPool.parallelFor(minions.size(), 256, job);
         
-        m.actionTime += dt;
+        //Place the minions on the terrain on this thread, since a height lookup may have to finish a texture readback, sampling all heights at once.
+        std::vector<float> heights(minions.size());
         
-        //Follow the assigned path if any.
-        if (m.path != "")
-        {
-            const MinionPath *p = minionPaths[m.path];
-            
-            //Have we reached the current node?
-            if (length(m.pos - p->nodes[m.pathIndex]) < 16.0f)
-            {
-                m.pathIndex++;
-            }
-            
-            if (m.pathIndex >= p->nodes.size())
-            {
-                //We have reached the end of the path --> remove the minion.
-                isErased = true;
-                std::cerr << "Removed minion " << m.name << "." << std::endl;
-            }
-            else
-            {
-                //Head for the next node.
-                const vec2 d = normalize(p->nodes[m.pathIndex] - m.pos);
-                vec2 vel = mt->maxSpeed*dt*d;
-                
-                vel = collisionHandler.projectVelocity(m.pos, mt->radius, vel);
-                m.pos += vel;
-                m.angle = atan2f(d.y, d.x) - M_PI/2.0;
-            }
-        }
+        terrain->getHeights(&minions.positions[0], &heights[0], heights.size());
         
-        if (isErased)
+        for (size_t i = 0; i < minions.size(); ++i)
         {
-            minions.erase(i++);
+            minions.instances[i].positionAndSize.y = heights[i];
         }
-        else
-        {
-            i->second = m;
-            ++i;
-        }
-        
-        //TODO: Separate this into a separate update-minion stage and an update-horde stage.
-        //TODO: Store FPS in animation somehow.
-        const float fps = 20.0f;
-        
-        assert(mt->mesh.skeleton.animations.find(m.action) != mt->mesh.skeleton.animations.end());
-        
-        const int nrAnimationFrames = mt->mesh.skeleton.animations[m.action].frames.size()/mt->mesh.skeleton.bones.size();
-        const int frame = static_cast<int>(floor(m.actionTime*fps)) % nrAnimationFrames;
-        
-        mt->instances.push_back(draw::AnimatedMeshInstance(vec4(m.pos.x, terrain->getHeight(m.pos), m.pos.y, 1.0f), quatrot(m.angle, vec3(0.0f, 1.0f, 0.0f)), ivec2(3*mt->mesh.skeleton.bones.size()*frame, 0)));
     }
     
+    //Fill instance lists in the order of the minions, including those that have been removed during this frame, and remove finished minions.
+    for (size_t i = 0; i < minions.size(); ++i)
+    {
+        minionTypeHandles[minions.types[i]]->instances.push_back(minions.instances[i]);
+    }
+    
+    minions.removeErased();
+    
     //Send instances to the GPU.
     for (std::map<std::string, MinionType *>::iterator i = minionTypes.begin(); i != minionTypes.end(); ++i)
     {
@@ -449,13 +401,13 @@ void Game::update(os::Application *application, const float &dt)
     }
     */
     
-    //Update the terrain with respect to the camera.
-    terrain->terrain->setCameraPosition(cameraPosition);
-    
-    forest->setCameraPosition(cameraPosition);
-    
     //Tell the world renderer that the camera has changed.
     renderer->setCamera(cameraPosition, cameraOrientation);
+    
+    //Update the terrain with respect to the camera, skipping the blocks outside the view.
+    terrain->terrain->setCameraPosition(cameraPosition, renderer->getWorldToScreenMatrix());
+    
+    forest->setCameraPosition(cameraPosition, renderer->getWorldToScreenMatrix());
     snd::WorldSounderer::setCamera(cameraPosition, cameraOrientation);
 }
 
@@ -476,7 +428,6 @@ void Game::clear()
     currentSpawnTime = 0.0f;
     
     minions.clear();
-    minionIndex = 0;
 }
 
 void Game::readResources(const std::string &path)
@@ -567,6 +518,7 @@ void Game::readResources(const std::string &path)
             }
             
             minionTypes.insert(std::pair<std::string, MinionType *>(minionType->name, minionType));
+            minionTypeHandles.push_back(minionType);
         }
         else if (el->ValueStr() == "minion_path")
         {
@@ -579,6 +531,7 @@ void Game::readResources(const std::string &path)
             }
             
             minionPaths.insert(std::pair<std::string, MinionPath *>(minionPath->name, minionPath));
+            minionPathHandles.push_back(minionPath);
         }
         else if (el->ValueStr() == "faction")
         {
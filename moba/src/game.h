@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tinyxml.h>
 
 #include <tiny/os/application.h>
+#include <tiny/os/threadpool.h>
 
 #include <tiny/mesh/staticmesh.h>
 #include <tiny/draw/staticmeshhorde.h>
@@ -41,31 +42,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "forest.h"
 #include "faction.h"
 #include "minion_type.h"
+#include "collision.h"
 
 namespace moba
 {
 
-class CollisionHashMap
-{
-    public:
-        CollisionHashMap(const size_t &, const size_t &, const size_t &, const float &);
-        ~CollisionHashMap();
-        
-        void buildCollisionBuckets(const std::vector<tiny::vec4> &);
-        tiny::vec2 projectVelocity(const tiny::vec2 &, const float &, tiny::vec2) const;
-    
-    private:
-        tiny::vec2 projectVelocityCylinder(const tiny::vec4 &, const tiny::vec2 &, const float &, tiny::vec2) const;
-        
-        const size_t nrBuckets;
-        const size_t p1, p2;
-        const float size;
-        
-        //Collision detection.
-        std::vector<tiny::vec4> cylinders;
-        std::vector<std::list<int> > buckets;
-};
-
 class Game
 {
     public:
@@ -77,11 +58,14 @@ class Game
         void render();
         
     private:
+        class MinionJob;
+        
         void readResources(const std::string &);
         void readSkyResources(const std::string &, TiXmlElement *);
         
         void spawnMinionAtPath(const std::string &, const std::string &, const std::string &, const float & = 0.0f);
         std::vector<tiny::vec4> createCollisionCylinders() const;
+        void updateMinions(const int &, const int &, const float &);
         
         //Renderer.
         const double aspectRatio;
@@ -112,13 +96,17 @@ class Game
         GameForest *forest;
         std::map<std::string, MinionType *> minionTypes;
         std::map<std::string, MinionPath *> minionPaths;
-        std::map<unsigned int, Minion> minions;
-        unsigned int minionIndex;
+        std::vector<MinionType *> minionTypeHandles;
+        std::vector<MinionPath *> minionPathHandles;
+        MinionStore minions;
         std::map<std::string, Faction *> factions;
         
         std::list<tiny::vec4> staticCollisionCylinders;
         CollisionHashMap collisionHandler;
         
+        //Worker threads for the simulation.
+        tiny::os::ThreadPool workerPool;
+        
 };
 
 } //namespace moba
@@ -61,6 +61,7 @@ MinionType::MinionType(const std::string &path, TiXmlElement *el)
     horde->setNormalTexture(*normalTexture);
     horde->setAnimationTexture(*animationTexture);
     instances.clear();
+    instances.reserve(maxNrInstances);
 }
 
 MinionType::~MinionType()
@@ -143,3 +144,111 @@ Minion::~Minion()
 
 }
 
+MinionStore::MinionStore() :
+    names(),
+    types(),
+    paths(),
+    pathIndices(),
+    positions(),
+    angles(),
+    actionTimes(),
+    nrAnimationFrames(),
+    erased(),
+    instances()
+{
+
+}
+
+MinionStore::~MinionStore()
+{
+
+}
+
+void MinionStore::clear()
+{
+    names.clear();
+    types.clear();
+    paths.clear();
+    pathIndices.clear();
+    positions.clear();
+    angles.clear();
+    actionTimes.clear();
+    nrAnimationFrames.clear();
+    erased.clear();
+    instances.clear();
+}
+
+void MinionStore::reserve(const size_t &n)
+{
+    names.reserve(n);
+    types.reserve(n);
+    paths.reserve(n);
+    pathIndices.reserve(n);
+    positions.reserve(n);
+    angles.reserve(n);
+    actionTimes.reserve(n);
+    nrAnimationFrames.reserve(n);
+    erased.reserve(n);
+    instances.reserve(n);
+}
+
+size_t MinionStore::size() const
+{
+    return types.size();
+}
+
+void MinionStore::add(const Minion &minion, const int &type, const int &path, const int &nrFrames)
+{
+    names.push_back(minion.name);
+    types.push_back(type);
+    paths.push_back(path);
+    pathIndices.push_back(minion.pathIndex);
+    positions.push_back(minion.pos);
+    angles.push_back(minion.angle);
+    actionTimes.push_back(minion.actionTime);
+    nrAnimationFrames.push_back(nrFrames);
+    erased.push_back(0);
+    instances.push_back(draw::AnimatedMeshInstance());
+}
+
+void MinionStore::removeErased()
+{
+    //Remove all erased minions while preserving the order of the remaining ones.
+    size_t j = 0;
+    
+    for (size_t i = 0; i < size(); ++i)
+    {
+        if (erased[i])
+        {
+            std::cerr << "Removed minion " << names[i] << "." << std::endl;
+            continue;
+        }
+        
+        if (i != j)
+        {
+            names[j].swap(names[i]);
+            types[j] = types[i];
+            paths[j] = paths[i];
+            pathIndices[j] = pathIndices[i];
+            positions[j] = positions[i];
+            angles[j] = angles[i];
+            actionTimes[j] = actionTimes[i];
+            nrAnimationFrames[j] = nrAnimationFrames[i];
+            erased[j] = 0;
+            instances[j] = instances[i];
+        }
+        
+        ++j;
+    }
+    
+    names.resize(j);
+    types.resize(j);
+    paths.resize(j);
+    pathIndices.resize(j);
+    positions.resize(j);
+    angles.resize(j);
+    actionTimes.resize(j);
+    nrAnimationFrames.resize(j);
+    erased.resize(j);
+    instances.resize(j);
+}
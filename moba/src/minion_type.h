@@ -17,7 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <string>
-#include <list>
+#include <vector>
 
 #include <tinyxml.h>
 
@@ -50,7 +50,7 @@ class MinionType
         tiny::draw::AnimationTextureBuffer *animationTexture;
         tiny::draw::AnimatedMeshHorde *horde;
         
-        std::list<tiny::draw::AnimatedMeshInstance> instances;
+        std::vector<tiny::draw::AnimatedMeshInstance> instances;
 };
 
 class MinionPath
@@ -84,5 +84,38 @@ class Minion
         float actionTime;
 };
 
+/** Dense structure of arrays storage for all minions in the game, in order of spawning.
+  * Minion types and paths are referred to by integer handles instead of by name, and the animation of each minion is resolved when it is added.
+  * Minions with a negative path handle do not move. */
+class MinionStore
+{
+    public:
+        MinionStore();
+        ~MinionStore();
+        
+        void clear();
+        void reserve(const size_t &);
+        size_t size() const;
+        
+        void add(const Minion &, const int &, const int &, const int &);
+        void removeErased();
+        
+        //Rarely accessed data.
+        std::vector<std::string> names;
+        
+        //Data accessed every frame.
+        std::vector<int> types;
+        std::vector<int> paths;
+        std::vector<unsigned int> pathIndices;
+        std::vector<tiny::vec2> positions;
+        std::vector<float> angles;
+        std::vector<float> actionTimes;
+        std::vector<int> nrAnimationFrames;
+        
+        //Output of the simulation step.
+        std::vector<unsigned char> erased;
+        std::vector<tiny::draw::AnimatedMeshInstance> instances;
+};
+
 } //namespace moba
 
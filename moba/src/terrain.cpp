@@ -24,16 +24,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/computetexture.h>
 #include <tiny/draw/heightmap/scale.h>
 #include <tiny/draw/heightmap/resize.h>
-#include <tiny/draw/heightmap/normalmap.h>
-#include <tiny/draw/heightmap/tangentmap.h>
 #include <tiny/draw/heightmap/diamondsquare.h>
+#include <tiny/draw/heightmap/surfacemaps.h>
 
 #include "terrain.h"
 
 using namespace moba;
 using namespace tiny;
 
-GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
+GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el) :
+    heightField(),
+    heightFieldIsValid(false)
 {
     std::cerr << "Reading terrain resources..." << std::endl;
     
@@ -113,30 +114,47 @@ GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
     
     //Create height maps.
     heightTexture = new draw::FloatTexture2D(img::io::readImage(path + heightMapFileName), draw::tf::filter);
-    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter);
+    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter | draw::tf::hostOnDemand);
     
     //Create normal maps for the far-away and zoomed-in heightmaps.
-    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
+    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
     
     //Create an attribute texture that determines the terrain type (forest/grass/mud/stone) based on the altitude and slope.
     attributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
-    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
+    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Create local diffuse textures.
-    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage());
-    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end());
+    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
-    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage());
-    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end());
+    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Scale vertical range of the far-away heightmap.
-    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f));
+    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f), false);
+    
+    //The far-away tangent, normal, and attribute maps do not depend on the offset, so they are computed only once.
+    draw::computeSurfaceMaps(*farHeightTexture, *farTangentTexture, *farNormalTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x, false);
+    
+    for (std::list<std::pair<int, img::Image> >::const_iterator i = attributeMaps.begin(); i != attributeMaps.end(); ++i)
+    {
+        draw::RGBATexture2D *tex = new draw::RGBATexture2D(i->second);
+        
+        applyUserAttributeMap(*farAttributeTexture, i->first, *tex);
+        delete tex;
+    }
     
     //Create the terrain.
     terrain = new draw::Terrain(6, 8);
+    
+    //Bound the heights of the far-away and refined zoomed-in height maps, such that blocks of the terrain can be culled.
+    const vec2 heightRange = draw::getDiamondSquareHeightRange(vec2(0.0f, heightScaleFactor), farScale.x, 0.5f);
+    
+    terrain->setHeightRange(heightRange.x, heightRange.y);
+    
     setOffset(vec2(offset_x - 0.5f/static_cast<float>(farScale.x), offset_y - 0.5f/static_cast<float>(farScale.y)));
 }
 
@@ -162,20 +180,13 @@ void GameTerrain::setOffset(const vec2 &offset)
     //Zoom into a small area of the far-away heightmap.
     draw::computeResizedTexture(*farHeightTexture, *heightTexture,
                                 vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
-                                farOffset);
+                                farOffset, false);
     
     //Apply the diamond-square fractal algorithm to make the zoomed-in heightmap a little less boring.
-    draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x, 0.5f);
-    
-    //Tangent and normal maps.
-    draw::computeTangentMap(*farHeightTexture, *farTangentTexture, scale.x*farScale.x);
-    draw::computeTangentMap(*heightTexture, *tangentTexture, scale.x);
-    draw::computeNormalMap(*farHeightTexture, *farNormalTexture, scale.x*farScale.x);
-    draw::computeNormalMap(*heightTexture, *normalTexture, scale.x);
+    draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x, 0.5f, false);
     
-    //Calculate attribute maps for both the zoomed-in and far-away terrain.
-    calculateAttributes(*heightTexture, *attributeTexture, attributeShaderCode, scale.x);
-    calculateAttributes(*farHeightTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x);
+    //Tangent, normal, and attribute maps of the zoomed-in terrain in a single pass.
+    draw::computeSurfaceMaps(*heightTexture, *tangentTexture, *normalTexture, *attributeTexture, attributeShaderCode, scale.x, false);
     
     //Blend in user-supplied attribute maps.
     for (std::list<std::pair<int, img::Image> >::const_iterator i = attributeMaps.begin(); i != attributeMaps.end(); ++i)
@@ -186,14 +197,18 @@ void GameTerrain::setOffset(const vec2 &offset)
 
         draw::computeResizedTexture(*tex1, *tex2,
                                     vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
-                                    farOffset);
+                                    farOffset, false);
         applyUserAttributeMap(*attributeTexture, i->first, *tex2);
-        applyUserAttributeMap(*farAttributeTexture, i->first, *tex1);
         
         delete tex1;
         delete tex2;
     }
     
+    //Only the zoomed-in height and attribute maps are used on the CPU, start reading them back without waiting for the device.
+    heightTexture->beginReadback();
+    attributeTexture->beginReadback();
+    heightFieldIsValid = false;
+    
     terrain->setFarDiffuseTextures(*attributeTexture, *farAttributeTexture, *localDiffuseTextures, *localNormalTextures, localTextureScale);
     //terrain->setDiffuseTextures(*attributeTexture, *localDiffuseTextures, *localNormalTextures, vec2(1.0f, 1.0f));
     
@@ -208,19 +223,23 @@ void GameTerrain::setOffset(const vec2 &offset)
 
 vec3 GameTerrain::getWorldPosition(const vec2 &p) const
 {
+    finishReadbacks();
+    
     //Convert position within texture (in [0, 1] x [0, 1]) to XYZ world position.
     vec2 pos = vec2(p.x - (farOffset.x + 0.5f/static_cast<float>(farScale.x)), p.y - (farOffset.y + 0.5f/static_cast<float>(farScale.y)));
     
     pos.x *= static_cast<float>(heightTexture->getWidth()*farScale.x)*scale.x;
     pos.y *= static_cast<float>(heightTexture->getHeight()*farScale.y)*scale.y;
 
-    return vec3(pos.x, GameTerrain::sampleTextureBilinear(*heightTexture, scale, pos).x, pos.y);
+    return vec3(pos.x, heightField.getHeight(pos), pos.y);
 }
 
 //Function to generate position samples of a certain attribute map.
 int GameTerrain::createAttributeMapSamples(const int &maxNrSamples, const int &index,
                                            std::vector<draw::StaticMeshInstance> &highDetailInstances, const vec2 &lowDetailInstanceSize, std::vector<draw::WorldIconInstance> &lowDetailInstances, std::vector<vec3> &positions) const
 {
+    finishReadbacks();
+    
     const float maxDistance = 0.5f*heightTexture->getWidth()*scale.x;
     int nrSamples = 0;
     
@@ -251,7 +270,7 @@ int GameTerrain::createAttributeMapSamples(const int &maxNrSamples, const int &i
         if (placeProbability <= 0.5f && placeProbability >= -0.5f)
         {
             //Determine height.
-            const vec3 samplePosition = vec3(samplePlanePosition.x, GameTerrain::sampleTextureBilinear(*heightTexture, scale, samplePlanePosition).x, samplePlanePosition.y);
+            const vec3 samplePosition = vec3(samplePlanePosition.x, heightField.getHeight(samplePlanePosition), samplePlanePosition.y);
             
             highDetailInstances.push_back(draw::StaticMeshInstance(vec4(samplePosition.x, samplePosition.y, samplePosition.z, 1.0f),
                                                                    vec4(0.0f, 0.0f, 0.0f, 1.0f)));
@@ -280,7 +299,7 @@ void GameTerrain::applyUserAttributeMap(draw::RGBATexture2D &attributeMap, const
     inputTextures.push_back("source2");
     outputTextures.push_back("colour");
 
-    draw::ComputeTexture *computeTexture = new draw::ComputeTexture(inputTextures, outputTextures,
+    draw::ComputeTexture *computeTexture = draw::ComputeTexture::getKernel(inputTextures, outputTextures,
 "#version 150\n"
 "\n"
 "precision highp float;\n"
@@ -305,37 +324,40 @@ void GameTerrain::applyUserAttributeMap(draw::RGBATexture2D &attributeMap, const
     computeTexture->setInput(userMap, "source2");
     computeTexture->setOutput(attributeMap, "colour");
     computeTexture->compute();
-    attributeMap.getFromDevice();
-    
-    delete computeTexture;
 }
 
-void GameTerrain::calculateAttributes(const tiny::draw::FloatTexture2D &heightMap, tiny::draw::RGBATexture2D &attributeMap, const std::string &shaderCode, const float &scale)
+float GameTerrain::getHeight(const vec2 &a_pos) const
 {
-    std::vector<std::string> inputTextures;
-    std::vector<std::string> outputTextures;
-    
-    inputTextures.push_back("source");
-    outputTextures.push_back("colour");
-
-    draw::ComputeTexture *computeTexture = new draw::ComputeTexture(inputTextures, outputTextures, shaderCode);
+    finishReadbacks();
     
-    computeTexture->uniformMap().setFloatUniform(2.0f*scale, "mapScale");
-    computeTexture->setInput(heightMap, "source");
-    computeTexture->setOutput(attributeMap, "colour");
-    computeTexture->compute();
-    attributeMap.getFromDevice();
-    
-    delete computeTexture;
+    return heightField.getHeight(a_pos);
 }
 
-float GameTerrain::getHeight(const vec2 &a_pos) const
+void GameTerrain::getHeights(const vec2 *positions, float *heights, const size_t &n) const
 {
-    return sampleTextureBilinear(*heightTexture, scale, a_pos).x;
+    finishReadbacks();
+    
+    heightField.getHeights(positions, heights, n);
 }
 
 float GameTerrain::getAttribute(const vec2 &a_pos) const
 {
+    finishReadbacks();
+    
     return sampleTextureBilinear(*attributeTexture, scale, a_pos).x;
 }
 
+void GameTerrain::finishReadbacks() const
+{
+    //Wait for the height and attribute maps, if they are still being read back from the device.
+    //This issues OpenGL calls, so height lookups must not be made from the worker threads that update the minions.
+    heightTexture->finishReadback();
+    attributeTexture->finishReadback();
+    
+    if (!heightFieldIsValid)
+    {
+        heightField.setHeights(*heightTexture, scale);
+        heightFieldIsValid = true;
+    }
+}
+
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/terrain.h>
 #include <tiny/draw/texture2d.h>
 #include <tiny/draw/texture2darray.h>
+#include <tiny/draw/heightmap/heightfield.h>
 
 #include <tiny/draw/staticmeshhorde.h>
 #include <tiny/draw/iconhorde.h>
@@ -44,12 +45,13 @@ class GameTerrain
         tiny::vec3 getWorldPosition(const tiny::vec2 &) const;
         
         float getHeight(const tiny::vec2 &) const;
+        void getHeights(const tiny::vec2 *, float *, const size_t &) const;
         float getAttribute(const tiny::vec2 &) const;
         
         tiny::draw::Terrain *terrain;
         
     private:
-        static void calculateAttributes(const tiny::draw::FloatTexture2D &, tiny::draw::RGBATexture2D &, const std::string &, const float &);
+        void finishReadbacks() const;
         static void applyUserAttributeMap(tiny::draw::RGBATexture2D &, const int &, const tiny::draw::RGBATexture2D &);
         
         //A simple bilinear texture sampler, which converts world coordinates to the corresponding texture coordinates on the zoomed-in terrain.
@@ -87,6 +89,10 @@ class GameTerrain
         tiny::draw::RGBATexture2D *farAttributeTexture;
         tiny::draw::RGBTexture2DArray *localDiffuseTextures;
         tiny::draw::RGBTexture2DArray *localNormalTextures;
+        
+        //Copy of the zoomed-in height map for sampling on the CPU, rebuilt after every readback.
+        mutable tiny::draw::HeightField heightField;
+        mutable bool heightFieldIsValid;
 };
 
 } //namespace moba
@@ -0,0 +1,166 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstdlib>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/lod/quadtree.h>
+#include <tiny/lod/dynamicquadtree.h>
+
+using namespace std;
+using namespace tiny;
+
+//Compare rebuilding a static quadtree every frame with updating a dynamic quadtree for a set of moving units.
+
+const int nrUnits = 100000;
+const float mapSize = 2048.0f;
+const int nrFrames = 32;
+const int nrRespawnsPerFrame = 1000;
+const int nrQueriesPerFrame = 16;
+const int maxNrTruncatedIndices = 64;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+template <typename Tree>
+std::vector<int> query(const Tree &quadtree, const vec3 &position, const float &minRadius, const float &maxRadius, const int &maxNrIndices = nrUnits, const bool &sorted = true)
+{
+    std::vector<int> indices(maxNrIndices);
+
+    indices.resize(quadtree.retrieveIndicesBetweenRadii(position, minRadius, maxRadius, indices.begin(), maxNrIndices) - indices.begin());
+    if (sorted) std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+/** Checks that a query truncated to maxNrIndices returns the first maxNrIndices indices of the untruncated query, and returns the truncated indices in sorted order. */
+template <typename Tree>
+std::vector<int> truncatedQuery(const Tree &quadtree, const vec3 &position, const float &minRadius, const float &maxRadius, const int &maxNrIndices, int &nrMismatches)
+{
+    const std::vector<int> all = query(quadtree, position, minRadius, maxRadius, nrUnits, false);
+    std::vector<int> indices = query(quadtree, position, minRadius, maxRadius, maxNrIndices, false);
+
+    if (indices.size() != std::min(all.size(), static_cast<size_t>(maxNrIndices)) || !std::equal(indices.begin(), indices.end(), all.begin())) ++nrMismatches;
+
+    std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    std::vector<vec3> positions(nrUnits);
+    std::vector<vec3> velocities(nrUnits);
+    lod::DynamicQuadtree dynamicTree(vec2(0.0f, 0.0f), mapSize);
+    lod::Quadtree staticTree;
+
+    for (int i = 0; i < nrUnits; ++i)
+    {
+        const vec2 p = randomVec2(mapSize);
+        const vec2 v = randomVec2(2.0f);
+
+        positions[i] = vec3(p.x, 0.0f, p.y);
+        velocities[i] = vec3(v.x, 0.0f, v.y);
+        dynamicTree.insert(i, positions[i]);
+    }
+
+    double staticTime = 0.0, dynamicTime = 0.0;
+    int nrMismatches = 0;
+    int nrTruncatedQueries = 0, nrTruncatedDifferences = 0;
+
+    for (int frame = 0; frame < nrFrames; ++frame)
+    {
+        //Move all units, letting them bounce off the edges of the map and respawning some of them at random locations.
+        for (int i = 0; i < nrUnits; ++i)
+        {
+            vec3 p = vec3(positions[i].x + velocities[i].x, positions[i].y, positions[i].z + velocities[i].z);
+
+            if (fabsf(p.x) > mapSize) velocities[i].x = -velocities[i].x, p.x = positions[i].x;
+            if (fabsf(p.z) > mapSize) velocities[i].z = -velocities[i].z, p.z = positions[i].z;
+
+            positions[i] = p;
+        }
+
+        std::vector<int> respawned(nrRespawnsPerFrame);
+
+        for (int i = 0; i < nrRespawnsPerFrame; ++i)
+        {
+            const vec2 p = randomVec2(mapSize);
+
+            respawned[i] = rand() % nrUnits;
+            positions[respawned[i]] = vec3(p.x, 0.0f, p.y);
+        }
+
+        //Rebuild the static quadtree.
+        double t = getTime();
+
+        staticTree.buildQuadtree(positions.begin(), positions.end());
+        staticTime += getTime() - t;
+
+        //Update the dynamic quadtree.
+        t = getTime();
+
+        for (int i = 0; i < nrRespawnsPerFrame; ++i)
+        {
+            if (dynamicTree.contains(respawned[i])) dynamicTree.remove(respawned[i]);
+        }
+
+        for (int i = 0; i < nrUnits; ++i)
+        {
+            dynamicTree.move(i, positions[i]);
+        }
+
+        dynamicTime += getTime() - t;
+
+        //Verify that both trees give the same results.
+        for (int i = 0; i < nrQueriesPerFrame; ++i)
+        {
+            const vec2 p = randomVec2(mapSize);
+            const vec3 position(p.x, 0.0f, p.y);
+
+            if (query(staticTree, position, 16.0f, 128.0f) != query(dynamicTree, position, 16.0f, 128.0f)) ++nrMismatches;
+            if (query(staticTree, position, 0.0f, 8.0f) != query(dynamicTree, position, 0.0f, 8.0f)) ++nrMismatches;
+
+            //Truncated queries return a prefix of the full query for each tree, but the trees may select different indices.
+            const std::vector<int> staticIndices = truncatedQuery(staticTree, position, 16.0f, 128.0f, maxNrTruncatedIndices, nrMismatches);
+            const std::vector<int> dynamicIndices = truncatedQuery(dynamicTree, position, 16.0f, 128.0f, maxNrTruncatedIndices, nrMismatches);
+            std::vector<int> difference;
+
+            std::set_symmetric_difference(staticIndices.begin(), staticIndices.end(), dynamicIndices.begin(), dynamicIndices.end(), std::back_inserter(difference));
+            ++nrTruncatedQueries;
+            nrTruncatedDifferences += difference.size()/2;
+        }
+    }
+
+    std::cout << "Updating " << nrUnits << " moving units per frame:" << std::endl
+              << "    static rebuild     " << 1.0e3*staticTime/nrFrames << " ms" << std::endl
+              << "    dynamic update     " << 1.0e3*dynamicTime/nrFrames << " ms (" << dynamicTree.getNrNodes() << " nodes)" << std::endl
+              << "    queries truncated to " << maxNrTruncatedIndices << " indices select " << static_cast<double>(nrTruncatedDifferences)/nrTruncatedQueries << " different indices on average" << std::endl
+              << nrMismatches << " mismatching queries" << std::endl;
+
+    return (nrMismatches == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,165 @@
+/*
+Copyright 2015, Matthijs van Dorp.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/algo/gridmap.h>
+
+using namespace std;
+using namespace tiny;
+
+//Compare the default std::map tile index of the GridMap with the flat hash map index.
+
+const float tileSize = 32.0f;
+const int gridSize = 128; //Number of tiles along each side of the map, giving gridSize^2 tiles in total.
+const int nrLookups = 4000000;
+const int nrRangeScans = 20000;
+const float scanRange = 8.0f*tileSize;
+
+template <class I> class BenchTile : public algo::GridTile<BenchTile<I>, I>
+{
+    public:
+        BenchTile(const vec3 &origin, algo::GridMap<BenchTile<I>, I> *map) :
+            algo::GridTile<BenchTile<I>, I>(origin, this, map),
+            value(1)
+        {
+
+        }
+
+        int value;
+};
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+template <class I>
+void benchmark(const std::string &name, const std::vector<vec3> &positions, const std::vector<vec3> &queries)
+{
+    algo::GridMap<BenchTile<I>, I> *map = new algo::GridMap<BenchTile<I>, I>(tileSize, name);
+
+    //Insert tiles in random order.
+    double t = getTime();
+
+    for (std::vector<vec3>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+    {
+        map->safeGetTile(*i);
+    }
+
+    const double insertTime = getTime() - t;
+
+    //Look up random tiles, half of which do not exist.
+    int nrFound = 0;
+
+    t = getTime();
+
+    for (int i = 0; i < nrLookups; ++i)
+    {
+        BenchTile<I> *tile = map->getTile(queries[i % queries.size()]);
+
+        if (tile) nrFound += tile->value;
+    }
+
+    const double lookupTime = getTime() - t;
+
+    //Retrieve all tiles in a square around random positions.
+    std::deque<BenchTile<I> *> tiles;
+    int nrScanned = 0;
+
+    t = getTime();
+
+    for (int i = 0; i < nrRangeScans; ++i)
+    {
+        tiles.clear();
+        map->getMultipleTiles(tiles, queries[i % queries.size()], scanRange);
+        nrScanned += tiles.size();
+    }
+
+    const double scanTime = getTime() - t;
+
+    //Iterate over all tiles.
+    int nrIterated = 0;
+
+    t = getTime();
+
+    for (typename algo::GridMap<BenchTile<I>, I>::iterator i = map->begin(); i != map->end(); ++i)
+    {
+        nrIterated += i->second->value;
+    }
+
+    const double iterateTime = getTime() - t;
+
+    //Remove all tiles.
+    t = getTime();
+
+    for (std::vector<vec3>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+    {
+        map->deleteTile(*i);
+    }
+
+    const double eraseTime = getTime() - t;
+
+    std::cout << name << ":" << std::endl
+              << "    insert  " << 1.0e9*insertTime/positions.size() << " ns/tile" << std::endl
+              << "    lookup  " << 1.0e9*lookupTime/nrLookups << " ns/lookup (" << nrFound << " hits)" << std::endl
+              << "    scan    " << 1.0e6*scanTime/nrRangeScans << " us/range scan (" << nrScanned << " tiles)" << std::endl
+              << "    iterate " << 1.0e9*iterateTime/nrIterated << " ns/tile" << std::endl
+              << "    erase   " << 1.0e9*eraseTime/positions.size() << " ns/tile (" << map->numTiles() << " left)" << std::endl;
+
+    delete map;
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    //Fill a checkerboard pattern of tiles, such that half of all lookups miss.
+    std::vector<vec3> positions;
+    std::vector<vec3> queries;
+
+    for (int i = -gridSize/2; i < gridSize/2; ++i)
+    {
+        for (int j = -gridSize/2; j < gridSize/2; ++j)
+        {
+            if (((i + j) & 1) == 0) positions.push_back(vec3((i + 0.5f)*tileSize, 0.0f, (j + 0.5f)*tileSize));
+        }
+    }
+
+    for (int i = 0; i < 65536; ++i)
+    {
+        const vec2 v = randomVec2(0.5f*gridSize*tileSize);
+
+        queries.push_back(vec3(v.x, 0.0f, v.y));
+    }
+
+    std::random_shuffle(positions.begin(), positions.end());
+
+    std::cout << "Benchmarking GridMap with " << positions.size() << " tiles..." << std::endl;
+
+    benchmark<algo::OrderedGridIndex>("std::map", positions, queries);
+    benchmark<algo::FlatGridIndex>("FlatHashMap", positions, queries);
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/draw/heightmap/heightfield.h>
+
+using namespace std;
+using namespace tiny;
+
+//Compare sampling a height field one position at a time through the texture accessor with the tiled and batched HeightField, and verify that they give bit-identical results.
+
+const int mapSize = 1024;
+const int nrQueries = 1000000;
+const int nrFrames = 16;
+const int groupSize = 256;
+const float groupRadius = 32.0f;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+/** Height map on the host with the same accessor as FloatTexture2D. */
+class HostHeightMap
+{
+    public:
+        HostHeightMap(const size_t &a_width, const size_t &a_height) :
+            width(a_width),
+            height(a_height),
+            data(a_width*a_height, 0.0f)
+        {
+
+        }
+
+        size_t getWidth() const {return width;}
+        size_t getHeight() const {return height;}
+
+        vec4 operator () (const size_t &a_x, const size_t &a_y) const
+        {
+            if (a_x >= width || a_y >= height)
+            {
+                return vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+
+            return vec4(data[a_x + width*a_y], 0.0f, 0.0f, 1.0f);
+        }
+
+        const size_t width;
+        const size_t height;
+        std::vector<float> data;
+};
+
+/** The bilinear sampler of the games' terrain. */
+template<typename TextureType>
+vec4 sampleTextureBilinear(const TextureType &texture, const vec2 &scale, const vec2 &a_pos)
+{
+    const vec2 pos = vec2(a_pos.x/scale.x + 0.5f*static_cast<float>(texture.getWidth()), a_pos.y/scale.y + 0.5f*static_cast<float>(texture.getHeight()));
+    const ivec2 intPos = ivec2(floor(pos.x), floor(pos.y));
+    const vec4 h00 = texture(intPos.x + 0, intPos.y + 0);
+    const vec4 h01 = texture(intPos.x + 0, intPos.y + 1);
+    const vec4 h10 = texture(intPos.x + 1, intPos.y + 0);
+    const vec4 h11 = texture(intPos.x + 1, intPos.y + 1);
+    const vec2 delta = vec2(pos.x - floor(pos.x), pos.y - floor(pos.y));
+
+    return delta.y*(delta.x*h11 + (1.0f - delta.x)*h01) + (1.0f - delta.y)*(delta.x*h10 + (1.0f - delta.x)*h00);
+}
+
+float randomFloat(const float &a)
+{
+    return a*(2.0f*static_cast<float>(rand())/static_cast<float>(RAND_MAX) - 1.0f);
+}
+
+void reportTime(const std::string &name, const double &time, const bool &identical)
+{
+    std::cout << "    " << name << std::string(24 - name.size(), ' ')
+              << 1.0e3*time/nrFrames << " ms per frame, "
+              << 1.0e9*time/(static_cast<double>(nrFrames)*nrQueries) << " ns per query"
+              << (identical ? "" : " (MISMATCH)") << std::endl;
+}
+
+int compareSamplers(const HostHeightMap &heightMap, const draw::HeightField &heightField, const vec2 &scale, const std::vector<vec2> &positions)
+{
+    std::vector<float> referenceHeights(nrQueries), scalarHeights(nrQueries), batchHeights(nrQueries);
+    double t = 0.0, time = 0.0;
+
+    t = getTime();
+    for (int f = 0; f < nrFrames; ++f) for (int i = 0; i < nrQueries; ++i) referenceHeights[i] = sampleTextureBilinear(heightMap, scale, positions[i]).x;
+    time = getTime() - t;
+    reportTime("texture accessor", time, true);
+
+    t = getTime();
+    for (int f = 0; f < nrFrames; ++f) for (int i = 0; i < nrQueries; ++i) scalarHeights[i] = heightField.getHeight(positions[i]);
+    time = getTime() - t;
+    const bool scalarIdentical = (memcmp(&referenceHeights[0], &scalarHeights[0], nrQueries*sizeof(float)) == 0);
+    reportTime("HeightField::getHeight", time, scalarIdentical);
+
+    t = getTime();
+    for (int f = 0; f < nrFrames; ++f) heightField.getHeights(&positions[0], &batchHeights[0], nrQueries);
+    time = getTime() - t;
+    const bool batchIdentical = (memcmp(&referenceHeights[0], &batchHeights[0], nrQueries*sizeof(float)) == 0);
+    reportTime("HeightField::getHeights", time, batchIdentical);
+
+    return (scalarIdentical ? 0 : 1) + (batchIdentical ? 0 : 1);
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    //Create a rough height map, with some negative and zero heights.
+    HostHeightMap heightMap(mapSize, mapSize);
+    const vec2 scale(2.0f, 2.0f);
+
+    for (int y = 0; y < mapSize; ++y)
+    {
+        for (int x = 0; x < mapSize; ++x)
+        {
+            heightMap.data[x + mapSize*y] = 64.0f*sin(0.01f*x)*cos(0.013f*y) + randomFloat(4.0f);
+        }
+    }
+
+    draw::HeightField heightField;
+
+    heightField.setHeights(&heightMap.data[0], mapSize, mapSize, scale);
+
+    //Query positions in groups of units that are close together, and positions scattered across the map.
+    //Some lie outside the map, or exactly on texels.
+    const float extent = 0.55f*mapSize*scale.x;
+    std::vector<vec2> groupedPositions(nrQueries), scatteredPositions(nrQueries);
+
+    for (int i = 0; i < nrQueries; i += groupSize)
+    {
+        const vec2 centre = vec2(randomFloat(extent), randomFloat(extent));
+
+        for (int j = i; j < i + groupSize && j < nrQueries; ++j)
+        {
+            groupedPositions[j] = centre + vec2(randomFloat(groupRadius), randomFloat(groupRadius));
+        }
+    }
+
+    for (int i = 0; i < nrQueries; ++i)
+    {
+        scatteredPositions[i] = vec2(randomFloat(extent), randomFloat(extent));
+        if (i % 16 == 0) scatteredPositions[i] = vec2(floor(scatteredPositions[i].x), floor(scatteredPositions[i].y));
+    }
+
+    scatteredPositions[0] = vec2(-0.0f, 0.0f);
+    scatteredPositions[1] = vec2(-0.5f*mapSize*scale.x, -0.5f*mapSize*scale.y);
+    scatteredPositions[2] = vec2(0.5f*mapSize*scale.x, 0.5f*mapSize*scale.y);
+
+    int nrMismatches = 0;
+
+#ifdef TINY_SIMD_SSE
+    std::cout << "Sampling " << nrQueries << " heights per frame using SSE." << std::endl;
+#else
+    std::cout << "Sampling " << nrQueries << " heights per frame using scalar code." << std::endl;
+#endif
+
+    std::cout << "Grouped positions:" << std::endl;
+    nrMismatches += compareSamplers(heightMap, heightField, scale, groupedPositions);
+    std::cout << "Scattered positions:" << std::endl;
+    nrMismatches += compareSamplers(heightMap, heightField, scale, scatteredPositions);
+
+    if (nrMismatches > 0)
+    {
+        std::cerr << "Height field samples differ from the texture accessor!" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,370 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/os/threadpool.h>
+#include <tiny/os/headlessapplication.h>
+#include <tiny/draw/texture2d.h>
+#include <tiny/draw/heightmap/cpuheightmap.h>
+#include <tiny/draw/heightmap/heightfield.h>
+#include <tiny/draw/heightmap/scale.h>
+#include <tiny/draw/heightmap/resize.h>
+#include <tiny/draw/heightmap/diamondsquare.h>
+#include <tiny/draw/heightmap/surfacemaps.h>
+#include <tiny/draw/heightmap/heighttocolour.h>
+
+using namespace std;
+using namespace tiny;
+
+//Generate the zoomed-in terrain of the games (scale, resize, diamond-square refinement, tangent and normal maps, slope colours, and the height field for gameplay queries) for a large map.
+//Compare the wall time of the host kernels on one thread and on all threads, and of the device kernels including the readback, when an OpenGL context is available.
+
+const int mapSize = 4096;
+const int farScale = 8;
+const float heightScale = 64.0f;
+const float mapScale = 2.0f;
+const unsigned int seed = 1234567890;
+const int nrRuns = 4;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+/** Wall time of every stage of the pipeline, summed over all runs. */
+struct PipelineTimes
+{
+    PipelineTimes() :
+        scale(0.0),
+        resize(0.0),
+        refine(0.0),
+        surface(0.0),
+        colour(0.0),
+        heightField(0.0)
+    {
+
+    }
+
+    double getTotal() const
+    {
+        return scale + resize + refine + surface + colour + heightField;
+    }
+
+    double scale;
+    double resize;
+    double refine;
+    double surface;
+    double colour;
+    double heightField;
+};
+
+/** All maps produced by the host pipeline. */
+struct HostMaps
+{
+    HostMaps() :
+        farHeights(mapSize, mapSize),
+        heights(mapSize, mapSize),
+        tangents(mapSize, mapSize),
+        normals(mapSize, mapSize),
+        colours(mapSize, mapSize),
+        heightField()
+    {
+
+    }
+
+    draw::cpu::FloatImage farHeights;
+    draw::cpu::FloatImage heights;
+    draw::cpu::RGBImage tangents;
+    draw::cpu::RGBImage normals;
+    draw::cpu::RGBAImage colours;
+    draw::HeightField heightField;
+};
+
+vec2 getOffset()
+{
+    return vec2(0.5f - 0.5f/static_cast<float>(farScale), 0.5f - 0.5f/static_cast<float>(farScale));
+}
+
+void reportTime(const std::string &name, const double &time)
+{
+    std::cout << "    " << name << std::string(24 - name.size(), ' ') << 1.0e3*time/nrRuns << " ms" << std::endl;
+}
+
+void reportTimes(const PipelineTimes &times)
+{
+    reportTime("scale", times.scale);
+    reportTime("resize", times.resize);
+    reportTime("diamond-square", times.refine);
+    reportTime("tangent and normal maps", times.surface);
+    reportTime("slope colours", times.colour);
+    reportTime("height field", times.heightField);
+    reportTime("total", times.getTotal());
+}
+
+void runHostPipeline(os::ThreadPool &pool, const draw::cpu::FloatImage &source, HostMaps &maps, PipelineTimes &times)
+{
+    double t = getTime();
+
+    draw::cpu::computeScaledTexture(pool, source, maps.farHeights, vec4(heightScale/255.0f), vec4(0.0f));
+    times.scale += getTime() - t;
+    t = getTime();
+    draw::cpu::computeResizedTexture(pool, maps.farHeights, maps.heights, vec2(1.0f/static_cast<float>(farScale)), getOffset());
+    times.resize += getTime() - t;
+    t = getTime();
+    draw::cpu::computeDiamondSquareRefinement(pool, maps.heights, maps.heights, farScale, 0.5f, seed);
+    times.refine += getTime() - t;
+    t = getTime();
+    draw::cpu::computeTangentAndNormalMaps(pool, maps.heights, maps.tangents, maps.normals, mapScale);
+    times.surface += getTime() - t;
+    t = getTime();
+    draw::cpu::computeColourFromHeight(pool, maps.heights, maps.colours, mapScale);
+    times.colour += getTime() - t;
+    t = getTime();
+    maps.heightField.setHeights(maps.heights, vec2(mapScale));
+    times.heightField += getTime() - t;
+}
+
+/** FNV-1a hash of the contents of an image. */
+template <typename T, size_t Channels>
+unsigned int getChecksum(const draw::cpu::Image<T, Channels> &image, unsigned int hash)
+{
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(&image[0]);
+
+    for (size_t i = 0; i < image.size()*sizeof(T); ++i)
+    {
+        hash = (hash ^ data[i])*16777619u;
+    }
+
+    return hash;
+}
+
+unsigned int getChecksum(const HostMaps &maps)
+{
+    unsigned int hash = 2166136261u;
+
+    hash = getChecksum(maps.farHeights, hash);
+    hash = getChecksum(maps.heights, hash);
+    hash = getChecksum(maps.tangents, hash);
+    hash = getChecksum(maps.normals, hash);
+    hash = getChecksum(maps.colours, hash);
+
+    return hash;
+}
+
+/** Largest difference between the channels of a texture and an image over all texels that do not lie on the edge, where the device may sample the border. */
+template <typename TextureType, typename T, size_t Channels>
+float getMaximumInteriorDifference(const TextureType &texture, const draw::cpu::Image<T, Channels> &image)
+{
+    float maxDifference = 0.0f;
+
+    for (int y = 1; y < mapSize - 1; ++y)
+    {
+        for (int x = 1; x < mapSize - 1; ++x)
+        {
+            for (size_t i = 0; i < Channels; ++i)
+            {
+                const size_t index = Channels*(x + mapSize*y) + i;
+
+                maxDifference = std::max(maxDifference, std::fabs(static_cast<float>(texture[index]) - static_cast<float>(image[index])));
+            }
+        }
+    }
+
+    return maxDifference;
+}
+
+void reportDifference(const std::string &name, const float &difference, const float &tolerance, int &nrFailures)
+{
+    std::cout << "    " << name << std::string(24 - name.size(), ' ') << "maximum difference " << difference << ", tolerance " << tolerance << (difference <= tolerance ? "" : " (MISMATCH)") << std::endl;
+    if (difference > tolerance) ++nrFailures;
+}
+
+/** Runs the device kernels, which require an OpenGL context, on the same input and compares them with the host kernels, as documented in tiny/draw/heightmap/cpuheightmap.h. */
+int runDevicePipeline(os::ThreadPool &pool, const draw::cpu::FloatImage &source, HostMaps &maps)
+{
+    draw::FloatTexture2D sourceTexture(mapSize, mapSize, draw::tf::filter);
+    draw::FloatTexture2D farHeightTexture(mapSize, mapSize, draw::tf::filter);
+    draw::FloatTexture2D heightTexture(mapSize, mapSize, draw::tf::filter);
+    draw::RGBTexture2D tangentTexture(mapSize, mapSize, draw::tf::filter);
+    draw::RGBTexture2D normalTexture(mapSize, mapSize, draw::tf::filter);
+    draw::RGBATexture2D colourTexture(mapSize, mapSize, draw::tf::filter);
+    draw::HeightField heightField;
+    PipelineTimes times;
+
+    source.sendToTexture(sourceTexture);
+
+    //The first run compiles all kernels.
+    for (int run = -1; run < nrRuns; ++run)
+    {
+        PipelineTimes runTimes;
+        double t = getTime();
+
+        draw::computeScaledTexture(sourceTexture, farHeightTexture, vec4(heightScale/255.0f), vec4(0.0f), false);
+        glFinish();
+        runTimes.scale += getTime() - t;
+        t = getTime();
+        draw::computeResizedTexture(farHeightTexture, heightTexture, vec2(1.0f/static_cast<float>(farScale)), getOffset(), false);
+        glFinish();
+        runTimes.resize += getTime() - t;
+        t = getTime();
+        draw::computeDiamondSquareRefinement(heightTexture, heightTexture, farScale, 0.5f, true);
+        runTimes.refine += getTime() - t;
+        t = getTime();
+        draw::computeTangentAndNormalMaps(heightTexture, tangentTexture, normalTexture, mapScale, true);
+        runTimes.surface += getTime() - t;
+        t = getTime();
+        draw::computeColourFromHeight(heightTexture, colourTexture, mapScale, true);
+        runTimes.colour += getTime() - t;
+        t = getTime();
+        heightField.setHeights(heightTexture, vec2(mapScale));
+        runTimes.heightField += getTime() - t;
+
+        if (run >= 0)
+        {
+            times.scale += runTimes.scale;
+            times.resize += runTimes.resize;
+            times.refine += runTimes.refine;
+            times.surface += runTimes.surface;
+            times.colour += runTimes.colour;
+            times.heightField += runTimes.heightField;
+        }
+    }
+
+    std::cout << "Device kernels, including the readback of the height, tangent, normal, and colour maps:" << std::endl;
+    reportTimes(times);
+
+    //The diamond-square refinement uses different random numbers, so compare the other kernels given the same input.
+    draw::cpu::FloatImage deviceHeights(mapSize, mapSize);
+    draw::FloatTexture2D resizedTexture(mapSize, mapSize, draw::tf::filter);
+    float maxNeighbourDifference = 0.0f;
+    int nrFailures = 0;
+
+    farHeightTexture.getFromDevice();
+    draw::computeResizedTexture(farHeightTexture, resizedTexture, vec2(1.0f/static_cast<float>(farScale)), getOffset(), true);
+    std::copy(heightTexture.begin(), heightTexture.end(), &deviceHeights[0]);
+
+    draw::cpu::computeScaledTexture(pool, source, maps.farHeights, vec4(heightScale/255.0f), vec4(0.0f));
+    draw::cpu::computeResizedTexture(pool, maps.farHeights, maps.heights, vec2(1.0f/static_cast<float>(farScale)), getOffset());
+    draw::cpu::computeTangentAndNormalMaps(pool, deviceHeights, maps.tangents, maps.normals, mapScale);
+    draw::cpu::computeColourFromHeight(pool, deviceHeights, maps.colours, mapScale);
+
+    for (int i = 0; i + 1 < mapSize*mapSize; ++i)
+    {
+        maxNeighbourDifference = std::max(maxNeighbourDifference, std::fabs(maps.farHeights[i + 1] - maps.farHeights[i]));
+    }
+
+    for (int i = 0; i + mapSize < mapSize*mapSize; ++i)
+    {
+        maxNeighbourDifference = std::max(maxNeighbourDifference, std::fabs(maps.farHeights[i + mapSize] - maps.farHeights[i]));
+    }
+
+    std::cout << "Device and host kernels given the same input, excluding the edges:" << std::endl;
+    reportDifference("scale", getMaximumInteriorDifference(farHeightTexture, maps.farHeights), 1.0e-6f*heightScale, nrFailures);
+    reportDifference("resize", getMaximumInteriorDifference(resizedTexture, maps.heights), 1.0e-5f*heightScale + maxNeighbourDifference/256.0f, nrFailures);
+    reportDifference("tangent map", getMaximumInteriorDifference(tangentTexture, maps.tangents), 1.0f, nrFailures);
+    reportDifference("normal map", getMaximumInteriorDifference(normalTexture, maps.normals), 1.0f, nrFailures);
+
+    //Colours may differ where the slope lies exactly on a threshold, so only count those texels.
+    int nrDifferentColours = 0;
+
+    for (int i = 0; i < mapSize*mapSize; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            if (std::abs(static_cast<int>(colourTexture[4*i + j]) - static_cast<int>(maps.colours[4*i + j])) > 1)
+            {
+                ++nrDifferentColours;
+                break;
+            }
+        }
+    }
+
+    std::cout << "    slope colours           " << nrDifferentColours << " texels classified differently" << std::endl;
+
+    return nrFailures;
+}
+
+int main(int, char **)
+{
+    //Height map with values in [0, 255] like an image.
+    draw::cpu::FloatImage source(mapSize, mapSize);
+
+    for (int y = 0; y < mapSize; ++y)
+    {
+        for (int x = 0; x < mapSize; ++x)
+        {
+            const float h = 127.5f + 100.0f*sin(0.003f*x)*cos(0.0037f*y) + 20.0f*sin(0.05f*x + 0.02f*y) + 5.0f*sin(0.7f*x)*sin(0.9f*y);
+
+            source[x + mapSize*y] = floor(std::min(std::max(h, 0.0f), 255.0f));
+        }
+    }
+
+    os::ThreadPool serialPool(1);
+    os::ThreadPool pool;
+    HostMaps maps;
+    PipelineTimes serialTimes, parallelTimes;
+
+    //Warm up.
+    runHostPipeline(pool, source, maps, parallelTimes);
+    parallelTimes = PipelineTimes();
+
+    for (int run = 0; run < nrRuns; ++run) runHostPipeline(serialPool, source, maps, serialTimes);
+
+    const unsigned int serialChecksum = getChecksum(maps);
+
+    for (int run = 0; run < nrRuns; ++run) runHostPipeline(pool, source, maps, parallelTimes);
+
+    const bool identical = (getChecksum(maps) == serialChecksum);
+
+    std::cout << "Generating a " << mapSize << "x" << mapSize << " terrain, average over " << nrRuns << " runs." << std::endl;
+    std::cout << "Host kernels on 1 thread:" << std::endl;
+    reportTimes(serialTimes);
+    std::cout << "Host kernels on " << pool.getNrThreads() << " threads:" << std::endl;
+    reportTimes(parallelTimes);
+    std::cout << "Results on 1 and " << pool.getNrThreads() << " threads are " << (identical ? "identical." : "DIFFERENT!") << std::endl;
+
+    int nrFailures = (identical ? 0 : 1);
+
+    //Only a missing OpenGL context skips the device kernels, any exception thrown while comparing them fails the benchmark.
+    os::HeadlessApplication *application = 0;
+
+    try
+    {
+        application = new os::HeadlessApplication(64, 64, 1);
+    }
+    catch (std::exception &)
+    {
+        std::cout << "Unable to create an OpenGL context, skipping the device kernels." << std::endl;
+    }
+
+    if (application)
+    {
+        nrFailures += runDevicePipeline(pool, source, maps);
+        delete application;
+    }
+
+    return nrFailures;
+}
+
@@ -0,0 +1,198 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/draw/heightmap/heightfield.h>
+#include <tiny/draw/heightmap/heightpyramid.h>
+
+using namespace std;
+using namespace tiny;
+
+//Compare intersecting segments with the terrain by marching along them with descending the min/max height pyramid.
+
+const int mapSize = 1024;
+const float mapScale = 2.0f;
+const int nrShots = 200000;
+const int nrSightLines = 20000;
+const float marchStep = 0.25f;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+float randomFloat(const float &a)
+{
+    return a*(2.0f*static_cast<float>(rand())/static_cast<float>(RAND_MAX) - 1.0f);
+}
+
+/** Finds the first point at or below the terrain by sampling the segment every marchStep texels. */
+bool marchSegment(const draw::HeightField &heightField, const vec3 &a, const vec3 &b, float &t)
+{
+    const float l = length(vec2(b.x - a.x, b.z - a.z))/mapScale;
+    const int nrSteps = std::max(1, static_cast<int>(ceil(l/marchStep)));
+
+    for (int i = 0; i <= nrSteps; ++i)
+    {
+        const float s = static_cast<float>(i)/static_cast<float>(nrSteps);
+        const vec3 p = a + s*(b - a);
+
+        if (p.y <= heightField.getHeight(vec2(p.x, p.z)))
+        {
+            t = s;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Places a point at a random height above the terrain. */
+vec3 randomPointAbove(const draw::HeightField &heightField, const float &extent, const float &maxHeight)
+{
+    const vec2 p = vec2(randomFloat(extent), randomFloat(extent));
+
+    return vec3(p.x, heightField.getHeight(p) + 1.0f + maxHeight*0.5f*(1.0f + randomFloat(1.0f)), p.y);
+}
+
+int compareQueries(const std::string &name, const draw::HeightField &heightField, const draw::HeightPyramid &pyramid, const std::vector<vec3> &a, const std::vector<vec3> &b)
+{
+    const size_t n = a.size();
+    std::vector<float> marchT(n, -1.0f), pyramidT(n, -1.0f);
+    double t = 0.0, marchTime = 0.0, pyramidTime = 0.0;
+
+    t = getTime();
+    for (size_t i = 0; i < n; ++i) if (!marchSegment(heightField, a[i], b[i], marchT[i])) marchT[i] = -1.0f;
+    marchTime = getTime() - t;
+
+    t = getTime();
+    for (size_t i = 0; i < n; ++i) if (!pyramid.intersectSegment(a[i], b[i], pyramidT[i])) pyramidT[i] = -1.0f;
+    pyramidTime = getTime() - t;
+
+    //Marching can step over ridges and only finds hits up to its step size, so only require the pyramid to find every hit that marching finds, no later than marching does.
+    //Each hit of the pyramid should lie on the terrain surface.
+    int nrHits = 0, nrMissed = 0, nrExtraHits = 0;
+    double maxError = 0.0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (pyramidT[i] >= 0.0f)
+        {
+            const vec3 p = a[i] + pyramidT[i]*(b[i] - a[i]);
+
+            maxError = std::max(maxError, static_cast<double>(fabs(p.y - heightField.getHeight(vec2(p.x, p.z)))));
+            ++nrHits;
+        }
+
+        if (marchT[i] >= 0.0f && (pyramidT[i] < 0.0f || pyramidT[i] > marchT[i] + 1.0e-4f)) ++nrMissed;
+        else if (marchT[i] < 0.0f && pyramidT[i] >= 0.0f) ++nrExtraHits;
+    }
+
+    std::cout << "    " << name << std::string(16 - name.size(), ' ')
+              << "marching " << 1.0e6*marchTime/n << " us, pyramid " << 1.0e6*pyramidTime/n << " us per query, "
+              << nrHits << "/" << n << " hits, " << nrExtraHits << " found only by the pyramid, largest height error " << maxError << std::endl;
+
+    if (nrMissed > 0) std::cout << "    " << nrMissed << " hits found by marching were missed or found later by the pyramid (MISMATCH)" << std::endl;
+
+    return nrMissed;
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    //Create a height map with sharp ridges that fast projectiles can tunnel through.
+    std::vector<float> heights(mapSize*mapSize);
+
+    for (int y = 0; y < mapSize; ++y)
+    {
+        for (int x = 0; x < mapSize; ++x)
+        {
+            const float ridge = 48.0f*pow(fabs(sin(0.05f*x + 0.02f*y)), 16.0f);
+
+            heights[x + mapSize*y] = 32.0f*sin(0.01f*x)*cos(0.013f*y) + ridge + randomFloat(1.0f);
+        }
+    }
+
+    draw::HeightField heightField;
+
+    heightField.setHeights(&heights[0], mapSize, mapSize, vec2(mapScale, mapScale));
+
+    double t = getTime();
+    const draw::HeightPyramid pyramid(heightField);
+
+    std::cout << "Built a pyramid of " << pyramid.getNrLevels() << " levels for a " << mapSize << "x" << mapSize << " height map in " << 1.0e3*(getTime() - t) << " ms." << std::endl;
+
+    const float extent = 0.5f*mapSize*mapScale;
+    int nrMismatches = 0;
+
+    //Fast projectiles moving for a single frame, some of them starting outside the map.
+    std::vector<vec3> a(nrShots), b(nrShots);
+
+    for (int i = 0; i < nrShots; ++i)
+    {
+        a[i] = randomPointAbove(heightField, 1.1f*extent, 64.0f);
+        b[i] = a[i] + vec3(randomFloat(32.0f), randomFloat(32.0f) - 16.0f, randomFloat(32.0f));
+    }
+
+    nrMismatches += compareQueries("projectiles", heightField, pyramid, a, b);
+
+    //Lines of sight between units across the map.
+    a.resize(nrSightLines);
+    b.resize(nrSightLines);
+
+    for (int i = 0; i < nrSightLines; ++i)
+    {
+        a[i] = randomPointAbove(heightField, extent, 8.0f);
+        b[i] = randomPointAbove(heightField, extent, 8.0f);
+    }
+
+    nrMismatches += compareQueries("line of sight", heightField, pyramid, a, b);
+
+    //Lines of sight between aircraft, which are mostly unobstructed.
+    for (int i = 0; i < nrSightLines; ++i)
+    {
+        a[i] = randomPointAbove(heightField, extent, 128.0f) + vec3(0.0f, 32.0f, 0.0f);
+        b[i] = randomPointAbove(heightField, extent, 128.0f) + vec3(0.0f, 32.0f, 0.0f);
+    }
+
+    nrMismatches += compareQueries("aerial sight", heightField, pyramid, a, b);
+
+    bool *batchVisible = new bool [nrSightLines];
+
+    t = getTime();
+    pyramid.areVisible(&a[0], &b[0], batchVisible, nrSightLines);
+    std::cout << "    " << "batch visibility of " << nrSightLines << " pairs in " << 1.0e3*(getTime() - t) << " ms." << std::endl;
+
+    delete [] batchVisible;
+
+    if (nrMismatches > 0)
+    {
+        std::cerr << "The pyramid missed intersections with the terrain!" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
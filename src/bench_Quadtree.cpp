@@ -0,0 +1,200 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/os/threadpool.h>
+#include <tiny/lod/quadtree.h>
+
+using namespace std;
+using namespace tiny;
+
+const int nrPoints = 1000000;
+const float mapSize = 4096.0f;
+const int nrQueries = 64;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+//Retrieve the sorted indices of all points between two radii.
+std::vector<int> query(const lod::Quadtree &quadtree, const vec3 &position, const float &minRadius, const float &maxRadius)
+{
+    std::vector<int> indices(nrPoints);
+
+    indices.resize(quadtree.retrieveIndicesBetweenRadii(position, minRadius, maxRadius, indices.begin(), nrPoints) - indices.begin());
+    std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+//Retrieve the sorted indices of all points between two radii within the view frustum.
+std::vector<int> queryVisible(const lod::Quadtree &quadtree, const vec3 &position, const float &minRadius, const float &maxRadius, const mat4 &worldToScreen, const float &objectRadius)
+{
+    std::vector<int> indices(nrPoints);
+
+    indices.resize(quadtree.retrieveVisibleIndicesBetweenRadii(position, minRadius, maxRadius, worldToScreen, objectRadius, indices.begin(), nrPoints) - indices.begin());
+    std::sort(indices.begin(), indices.end());
+
+    return indices;
+}
+
+//Check the culled indices against every point, transformed to clip space independently of the Frustum class.
+//Points whose centre lies inside the clip volume must be returned, and returned points must lie within the clip volume widened by the object radius.
+bool checkVisibleBruteForce(const std::vector<int> &visible, const std::vector<vec3> &points, const vec3 &position, const float &minRadius, const float &maxRadius, const mat4 &worldToScreen, const float &objectRadius)
+{
+    const mat4 &m = worldToScreen;
+    //Moving a point by objectRadius changes clip coordinate i by at most objectRadius*|row i|, and the bound w +- i by at most the sum with |row 3|.
+    const float rowLength[4] = {length(vec3(m.v00, m.v01, m.v02)), length(vec3(m.v10, m.v11, m.v12)), length(vec3(m.v20, m.v21, m.v22)), length(vec3(m.v30, m.v31, m.v32))};
+    std::vector<int>::const_iterator next = visible.begin();
+
+    for (int i = 0; i < nrPoints; ++i)
+    {
+        const vec3 &p = points[i];
+        const float distance = length(p - position);
+        const bool isReturned = (next != visible.end() && *next == i);
+
+        if (isReturned) ++next;
+
+        if (distance < minRadius || distance >= maxRadius)
+        {
+            if (isReturned) return false;
+            continue;
+        }
+
+        const float clip[4] = {m.v00*p.x + m.v01*p.y + m.v02*p.z + m.v03,
+                               m.v10*p.x + m.v11*p.y + m.v12*p.z + m.v13,
+                               m.v20*p.x + m.v21*p.y + m.v22*p.z + m.v23,
+                               m.v30*p.x + m.v31*p.y + m.v32*p.z + m.v33};
+        bool isInside = true, isNear = true;
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const float margin = objectRadius*(rowLength[j] + rowLength[3]);
+
+            if (clip[j] < -clip[3] || clip[j] > clip[3]) isInside = false;
+            if (clip[j] < -clip[3] - margin || clip[j] > clip[3] + margin) isNear = false;
+        }
+
+        if ((isInside && !isReturned) || (!isNear && isReturned)) return false;
+    }
+
+    return next == visible.end();
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    std::vector<vec3> points(nrPoints);
+    std::vector<vec3> queries(nrQueries);
+
+    for (int i = 0; i < nrPoints; ++i)
+    {
+        const vec3 p = randomVec3(mapSize);
+
+        points[i] = vec3(p.x, 0.01f*p.y, p.z);
+    }
+
+    for (int i = 0; i < nrQueries; ++i)
+    {
+        const vec2 p = randomVec2(mapSize);
+
+        queries[i] = vec3(p.x, 0.0f, p.y);
+    }
+
+    //Build the quadtree using the recursive single-threaded path.
+    lod::Quadtree referenceTree;
+    double t = getTime();
+
+    referenceTree.buildQuadtree(points.begin(), points.end());
+
+    const double referenceTime = getTime() - t;
+
+    //Build the quadtree using the parallel path, with a single thread and with all available threads.
+    os::ThreadPool serialPool(1);
+    os::ThreadPool pool;
+    lod::Quadtree serialTree, parallelTree;
+
+    t = getTime();
+    serialTree.buildQuadtreeParallel(points.begin(), points.end(), serialPool);
+
+    const double serialTime = getTime() - t;
+
+    t = getTime();
+    parallelTree.buildQuadtreeParallel(points.begin(), points.end(), pool);
+
+    const double parallelTime = getTime() - t;
+
+    //Verify that all trees give the same results.
+    int nrMismatches = 0;
+
+    for (int i = 0; i < nrQueries; ++i)
+    {
+        const std::vector<int> a = query(referenceTree, queries[i], 128.0f, 512.0f);
+
+        if (a != query(serialTree, queries[i], 128.0f, 512.0f)) ++nrMismatches;
+        if (a != query(parallelTree, queries[i], 128.0f, 512.0f)) ++nrMismatches;
+    }
+
+    //Compare frustum-culled queries with brute force culling, for cameras looking in random directions.
+    const mat4 cameraToScreen = mat4::frustumMatrix(vec3(-0.07f*16.0f/9.0f, -0.07f, 1.0e-1f), vec3(0.07f*16.0f/9.0f, 0.07f, 1.0e8f));
+    double allTime = 0.0, visibleTime = 0.0;
+    int nrAll = 0, nrVisible = 0;
+
+    for (int i = 0; i < nrQueries; ++i)
+    {
+        const vec3 position = queries[i] + vec3(0.0f, 10.0f, 0.0f);
+        const vec4 orientation = quatmul(quatrot(6.2831853f*rand()/static_cast<float>(RAND_MAX), vec3(0.0f, 1.0f, 0.0f)),
+                                         quatrot(-0.5f*rand()/static_cast<float>(RAND_MAX), vec3(1.0f, 0.0f, 0.0f)));
+        mat4 worldToScreen = cameraToScreen;
+
+        worldToScreen *= mat4(orientation, position).inverted();
+
+        t = getTime();
+        nrAll += query(parallelTree, position, 0.0f, 1024.0f).size();
+        allTime += getTime() - t;
+
+        t = getTime();
+
+        const std::vector<int> a = queryVisible(parallelTree, position, 0.0f, 1024.0f, worldToScreen, 2.0f);
+
+        visibleTime += getTime() - t;
+        nrVisible += a.size();
+
+        if (!checkVisibleBruteForce(a, points, position, 0.0f, 1024.0f, worldToScreen, 2.0f)) ++nrMismatches;
+    }
+
+    std::cout << "Quadtree build of " << nrPoints << " points:" << std::endl
+              << "    recursive          " << 1.0e3*referenceTime << " ms" << std::endl
+              << "    SoA, 1 thread      " << 1.0e3*serialTime << " ms" << std::endl
+              << "    SoA, " << pool.getNrThreads() << " threads     " << 1.0e3*parallelTime << " ms" << std::endl
+              << "Quadtree queries within 1024 units:" << std::endl
+              << "    all                " << 1.0e3*allTime/nrQueries << " ms (" << nrAll/nrQueries << " points)" << std::endl
+              << "    frustum culled     " << 1.0e3*visibleTime/nrQueries << " ms (" << nrVisible/nrQueries << " points)" << std::endl
+              << nrMismatches << " mismatching queries" << std::endl;
+
+    return (nrMismatches == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,233 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+#include <tiny/os/headlessapplication.h>
+#include <tiny/draw/texture2d.h>
+#include <tiny/draw/heightmap/resize.h>
+#include <tiny/draw/heightmap/diamondsquare.h>
+#include <tiny/draw/heightmap/toroidal.h>
+
+using namespace std;
+using namespace tiny;
+
+//Move the zoomed-in terrain of the games by a run of random whole-texel shifts, updating only the newly exposed strips of a toroidally stored height map as tanks::GameTerrain does.
+//Verify that splitToroidalArea() covers every texel of an area exactly once and, when an OpenGL context is available, that the incremental updates and their region readbacks match a full recompute away from the margins.
+
+const int mapSize = 1024;
+const int farScale = 16;
+const float heightScale = 64.0f;
+const int nrShifts = 64;
+const int maxShift = mapSize/4;
+const int nrAreas = 1024;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+int randomInt(const int &a, const int &b)
+{
+    return a + rand() % (b - a + 1);
+}
+
+/** Splits random areas, which may be larger than the texture or lie anywhere in the plane, and counts how often every texel of the texture is covered. */
+int checkToroidalSplit()
+{
+    const ivec2 size = ivec2(96, 64);
+    int nrFailures = 0;
+
+    for (int i = 0; i < nrAreas; ++i)
+    {
+        const ivec4 area = ivec4(randomInt(-300, 300), randomInt(-300, 300), randomInt(0, 150), randomInt(0, 100));
+        const int border = randomInt(0, 4);
+        std::vector<ivec4> regions;
+        std::vector<ivec2> offsets;
+        std::vector<int> counts(size.x*size.y, 0);
+        bool isValid = true;
+
+        draw::splitToroidalArea(size, area, regions, offsets, border);
+
+        for (size_t j = 0; j < regions.size(); ++j)
+        {
+            for (int y = regions[j].y; y < regions[j].y + regions[j].w; ++y)
+            {
+                for (int x = regions[j].x; x < regions[j].x + regions[j].z; ++x)
+                {
+                    //Every texel should belong to the grown area in the plane and should be covered once.
+                    const ivec2 p = ivec2(x, y) + offsets[j];
+
+                    if (x < 0 || x >= size.x || y < 0 || y >= size.y ||
+                        p.x < area.x - border || p.x >= area.x + area.z + border || p.y < area.y - border || p.y >= area.y + area.w + border ||
+                        ++counts[x + size.x*y] > 1) isValid = false;
+                }
+            }
+        }
+
+        //The area is grown before it is clipped to the size of the texture.
+        const int nrTexels = std::count(counts.begin(), counts.end(), 1);
+        const int nrExpected = std::min(area.z + 2*border, size.x)*std::min(area.w + 2*border, size.y);
+
+        if (!isValid || nrTexels != nrExpected) ++nrFailures;
+    }
+
+    std::cout << "Split " << nrAreas << " random areas of the plane, " << nrFailures << " incorrectly." << std::endl;
+
+    return nrFailures;
+}
+
+/** Recomputes the given areas of the plane as GameTerrain::updateOffsetIncrementally() does. */
+void computeAreas(const draw::FloatTexture2D &farHeightTexture, draw::FloatTexture2D &heightTexture, draw::FloatTexture2D &scratchTexture, const vec2 &baseOffset, const std::vector<ivec4> &areas)
+{
+    draw::computeToroidalResizedTexture(farHeightTexture, heightTexture, vec2(1.0f/static_cast<float>(farScale)), baseOffset, areas);
+    draw::computeToroidalDiamondSquareRefinement(heightTexture, scratchTexture, farScale, 1.0f, areas);
+}
+
+/** Runs a sequence of incremental shifts on the device, which requires an OpenGL context, and compares the result with recomputing the whole window at the final position. */
+int runDeviceCheck()
+{
+    const ivec2 size = ivec2(mapSize, mapSize);
+    const vec2 baseOffset = vec2(0.5f, 0.5f);
+    draw::FloatTexture2D farHeightTexture(mapSize, mapSize, draw::tf::filter);
+    draw::FloatTexture2D heightTexture(mapSize, mapSize, draw::tf::repeat | draw::tf::filter);
+    draw::FloatTexture2D scratchTexture(mapSize, mapSize, draw::tf::repeat | draw::tf::hostOnDemand);
+    draw::FloatTexture2D referenceTexture(mapSize, mapSize, draw::tf::repeat | draw::tf::filter);
+    float maxNeighbourDifference = 0.0f;
+
+    for (int y = 0; y < mapSize; ++y)
+    {
+        for (int x = 0; x < mapSize; ++x)
+        {
+            farHeightTexture[x + mapSize*y] = heightScale*(0.5f + 0.4f*sin(0.003f*x)*cos(0.0037f*y) + 0.1f*sin(0.05f*x + 0.02f*y));
+        }
+    }
+
+    for (int y = 1; y < mapSize; ++y)
+    {
+        for (int x = 1; x < mapSize; ++x)
+        {
+            maxNeighbourDifference = std::max(maxNeighbourDifference, std::fabs(farHeightTexture[x + mapSize*y] - farHeightTexture[x - 1 + mapSize*y]));
+            maxNeighbourDifference = std::max(maxNeighbourDifference, std::fabs(farHeightTexture[x + mapSize*(y - 1)] - farHeightTexture[x + mapSize*y]));
+        }
+    }
+
+    farHeightTexture.sendToDevice();
+
+    //Compute the whole window once, which also compiles the kernels.
+    ivec2 origin = ivec2(0, 0);
+    double incrementalTime = 0.0, fullTime = 0.0;
+    int nrTexels = 0;
+
+    computeAreas(farHeightTexture, heightTexture, scratchTexture, baseOffset, std::vector<ivec4>(1, ivec4(origin.x, origin.y, size.x, size.y)));
+    heightTexture.getFromDevice();
+
+    for (int i = 0; i < nrShifts; ++i)
+    {
+        //Keep the window within the far-away height map.
+        const ivec2 newOrigin = ivec2(std::max(-2*mapSize, std::min(2*mapSize, origin.x + randomInt(-maxShift, maxShift))),
+                                      std::max(-2*mapSize, std::min(2*mapSize, origin.y + randomInt(-maxShift, maxShift))));
+        const std::vector<ivec4> areas = draw::getToroidalShiftAreas(size, origin, newOrigin, farScale);
+        const std::vector<ivec4> regions = draw::getToroidalRegions(size, areas);
+        double t = getTime();
+
+        computeAreas(farHeightTexture, heightTexture, scratchTexture, baseOffset, areas);
+        heightTexture.beginReadback(regions);
+        heightTexture.finishReadback();
+        incrementalTime += getTime() - t;
+        origin = newOrigin;
+
+        for (std::vector<ivec4>::const_iterator j = regions.begin(); j != regions.end(); ++j) nrTexels += j->z*j->w;
+
+        t = getTime();
+        computeAreas(farHeightTexture, referenceTexture, scratchTexture, baseOffset, std::vector<ivec4>(1, ivec4(origin.x, origin.y, size.x, size.y)));
+        referenceTexture.getFromDevice();
+        fullTime += getTime() - t;
+    }
+
+    //The region readbacks should have kept the host copy equal to the device texture.
+    const std::vector<float> hostHeights(heightTexture.begin(), heightTexture.end());
+    int nrReadbackMismatches = 0;
+
+    heightTexture.getFromDevice();
+
+    for (int i = 0; i < mapSize*mapSize; ++i)
+    {
+        if (hostHeights[i] != heightTexture[i]) ++nrReadbackMismatches;
+    }
+
+    //Away from the margins, the window should not depend on how it got there.
+    //Both paths sample the far-away map at rounded coordinates, which may change the 8-bit bilinear weights, and each refinement step can amplify a difference by at most 1.5.
+    float amplification = 1.0f;
+
+    for (int step = farScale/2; step >= 1; step /= 2) amplification *= 1.5f;
+
+    const float tolerance = 1.0e-5f*heightScale + amplification*maxNeighbourDifference/256.0f;
+    float maxDifference = 0.0f;
+
+    for (int y = origin.y + farScale; y < origin.y + mapSize - farScale; ++y)
+    {
+        for (int x = origin.x + farScale; x < origin.x + mapSize - farScale; ++x)
+        {
+            const int index = ((x % mapSize) + mapSize) % mapSize + mapSize*(((y % mapSize) + mapSize) % mapSize);
+
+            maxDifference = std::max(maxDifference, std::fabs(heightTexture[index] - referenceTexture[index]));
+        }
+    }
+
+    std::cout << "Moved a " << mapSize << "x" << mapSize << " height map " << nrShifts << " times by up to " << maxShift << " texels, refined with step size " << farScale << ":" << std::endl
+              << "    incremental update and readback  " << 1.0e3*incrementalTime/nrShifts << " ms (" << nrTexels/nrShifts << " texels)" << std::endl
+              << "    full recompute and readback      " << 1.0e3*fullTime/nrShifts << " ms (" << mapSize*mapSize << " texels)" << std::endl
+              << "    " << nrReadbackMismatches << " texels differ between the region readbacks and a full readback" << std::endl
+              << "    maximum difference with the full recompute " << maxDifference << ", tolerance " << tolerance << (maxDifference <= tolerance ? "" : " (MISMATCH)") << std::endl;
+
+    return (nrReadbackMismatches == 0 ? 0 : 1) + (maxDifference <= tolerance ? 0 : 1);
+}
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    int nrFailures = checkToroidalSplit();
+
+    //Only a missing OpenGL context skips the device check, any exception thrown by the check itself fails the benchmark.
+    os::HeadlessApplication *application = 0;
+
+    try
+    {
+        application = new os::HeadlessApplication(64, 64, 1);
+    }
+    catch (std::exception &)
+    {
+        std::cout << "Unable to create an OpenGL context, skipping the device kernels." << std::endl;
+    }
+
+    if (application)
+    {
+        nrFailures += runDeviceCheck();
+        delete application;
+    }
+
+    return nrFailures;
+}
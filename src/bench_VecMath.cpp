@@ -0,0 +1,238 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+#include <SDL.h>
+
+#include <tiny/math/vec.h>
+
+using namespace std;
+using namespace tiny;
+
+//Compare the vector and matrix kernels of tiny/math/vec.h with plain scalar implementations and verify that they give bit-identical results.
+
+const int nrElements = 1 << 16;
+const int nrRepetitions = 64;
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+//Scalar reference implementations.
+mat4 referenceMultiply(const mat4 &a, const mat4 &b)
+{
+    return mat4(a.v00*b.v00 + a.v01*b.v10 + a.v02*b.v20 + a.v03*b.v30,
+                a.v10*b.v00 + a.v11*b.v10 + a.v12*b.v20 + a.v13*b.v30,
+                a.v20*b.v00 + a.v21*b.v10 + a.v22*b.v20 + a.v23*b.v30,
+                a.v30*b.v00 + a.v31*b.v10 + a.v32*b.v20 + a.v33*b.v30,
+                a.v00*b.v01 + a.v01*b.v11 + a.v02*b.v21 + a.v03*b.v31,
+                a.v10*b.v01 + a.v11*b.v11 + a.v12*b.v21 + a.v13*b.v31,
+                a.v20*b.v01 + a.v21*b.v11 + a.v22*b.v21 + a.v23*b.v31,
+                a.v30*b.v01 + a.v31*b.v11 + a.v32*b.v21 + a.v33*b.v31,
+                a.v00*b.v02 + a.v01*b.v12 + a.v02*b.v22 + a.v03*b.v32,
+                a.v10*b.v02 + a.v11*b.v12 + a.v12*b.v22 + a.v13*b.v32,
+                a.v20*b.v02 + a.v21*b.v12 + a.v22*b.v22 + a.v23*b.v32,
+                a.v30*b.v02 + a.v31*b.v12 + a.v32*b.v22 + a.v33*b.v32,
+                a.v00*b.v03 + a.v01*b.v13 + a.v02*b.v23 + a.v03*b.v33,
+                a.v10*b.v03 + a.v11*b.v13 + a.v12*b.v23 + a.v13*b.v33,
+                a.v20*b.v03 + a.v21*b.v13 + a.v22*b.v23 + a.v23*b.v33,
+                a.v30*b.v03 + a.v31*b.v13 + a.v32*b.v23 + a.v33*b.v33);
+}
+
+mat4 referenceInverse(const mat4 &a)
+{
+    return mat4(a.v00, a.v01, a.v02, 0.0f,
+                a.v10, a.v11, a.v12, 0.0f,
+                a.v20, a.v21, a.v22, 0.0f,
+                -(a.v00*a.v03 + a.v10*a.v13 + a.v20*a.v23),
+                -(a.v01*a.v03 + a.v11*a.v13 + a.v21*a.v23),
+                -(a.v02*a.v03 + a.v12*a.v13 + a.v22*a.v23),
+                1.0f);
+}
+
+vec3 referenceTransform(const mat4 &m, const vec3 &a)
+{
+    return vec3(m.v00*a.x + m.v01*a.y + m.v02*a.z + m.v03,
+                m.v10*a.x + m.v11*a.y + m.v12*a.z + m.v13,
+                m.v20*a.x + m.v21*a.y + m.v22*a.z + m.v23);
+}
+
+vec4 referenceQuatmul(const vec4 &a, const vec4 &b)
+{
+    return vec4(a.w*b.x + b.w*a.x + a.y*b.z - a.z*b.y,
+                a.w*b.y + b.w*a.y + a.z*b.x - a.x*b.z,
+                a.w*b.z + b.w*a.z + a.x*b.y - a.y*b.x,
+                a.w*b.w - (a.x*b.x + a.y*b.y + a.z*b.z));
+}
+
+vec4 referenceNormalize(const vec4 &a)
+{
+    float l = a.x*a.x + a.y*a.y + a.z*a.z + a.w*a.w;
+
+    l = (l > 1.0e-8 ? 1.0/sqrt(static_cast<double>(l)) : 1.0);
+
+    return vec4(a.x*l, a.y*l, a.z*l, a.w*l);
+}
+
+vec4 referenceMultiplyAdd(const vec4 &a, const vec4 &b, const float &c)
+{
+    return vec4(a.x*c + b.x, a.y*c + b.y, a.z*c + b.z, a.w*c + b.w);
+}
+
+/** Keeps track of the timings and correctness of all kernels. */
+class Report
+{
+    public:
+        Report() : nrMismatches(0) {}
+
+        template <typename T>
+        void add(const std::string &name, const double &referenceTime, const double &time, const std::vector<T> &a, const std::vector<T> &b)
+        {
+            const bool identical = (a.size() == b.size() && memcmp(&a[0], &b[0], a.size()*sizeof(T)) == 0);
+
+            if (!identical) ++nrMismatches;
+
+            std::cout << "    " << name << std::string(24 - name.size(), ' ')
+                      << 1.0e9*referenceTime/(nrRepetitions*nrElements) << " ns -> "
+                      << 1.0e9*time/(nrRepetitions*nrElements) << " ns per element"
+                      << (identical ? "" : " (MISMATCH)") << std::endl;
+        }
+
+        int nrMismatches;
+};
+
+int main(int, char **)
+{
+    srand(1234567890);
+
+    std::vector<mat4> matrices(nrElements, mat4::identityMatrix());
+    std::vector<vec4> quaternions(nrElements), quaternions2(nrElements);
+    std::vector<vec3> points(nrElements), points2(nrElements);
+
+    for (int i = 0; i < nrElements; ++i)
+    {
+        quaternions[i] = randomVec4(2.0f);
+        quaternions2[i] = normalize(randomVec4(1.0f));
+        points[i] = randomVec3(1000.0f);
+        points2[i] = randomVec3(1.0f);
+        matrices[i] = mat4(quaternions2[i], points[i]);
+    }
+
+    Report report;
+    double t = 0.0, referenceTime = 0.0, time = 0.0;
+
+#ifdef TINY_SIMD_SSE
+    std::cout << "Vector kernels using SSE:" << std::endl;
+#else
+    std::cout << "Vector kernels using scalar code:" << std::endl;
+#endif
+
+    //Matrix multiplication.
+    std::vector<mat4> referenceMatrices(nrElements, mat4::identityMatrix()), resultMatrices(nrElements, mat4::identityMatrix());
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceMatrices[i] = referenceMultiply(matrices[i], matrices[(i + r) % nrElements]);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) resultMatrices[i] = matrices[i]*matrices[(i + r) % nrElements];
+    time = getTime() - t;
+    report.add("mat4 * mat4", referenceTime, time, referenceMatrices, resultMatrices);
+
+    //Matrix inversion.
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceMatrices[i] = referenceInverse(matrices[(i + r) % nrElements]);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) resultMatrices[i] = matrices[(i + r) % nrElements].inverted();
+    time = getTime() - t;
+    report.add("mat4::inverted", referenceTime, time, referenceMatrices, resultMatrices);
+
+    //Point transformation.
+    std::vector<vec3> referencePoints(nrElements), resultPoints(nrElements);
+    const mat4 transform = matrices[0];
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referencePoints[i] = referenceTransform(transform, points[i]);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) transformPoints(transform, &points[0], &resultPoints[0], nrElements);
+    time = getTime() - t;
+    report.add("transformPoints", referenceTime, time, referencePoints, resultPoints);
+
+    //Quaternion multiplication.
+    std::vector<vec4> referenceQuaternions(nrElements), resultQuaternions(nrElements);
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceQuaternions[i] = referenceQuatmul(quaternions[i], quaternions2[(i + r) % nrElements]);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) resultQuaternions[i] = quatmul(quaternions[i], quaternions2[(i + r) % nrElements]);
+    time = getTime() - t;
+    report.add("quatmul", referenceTime, time, referenceQuaternions, resultQuaternions);
+
+    //Quaternion normalisation.
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceQuaternions[i] = referenceNormalize(quaternions[i]);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) {resultQuaternions = quaternions; normalizeQuaternions(&resultQuaternions[0], nrElements);}
+    time = getTime() - t;
+    report.add("normalizeQuaternions", referenceTime, time, referenceQuaternions, resultQuaternions);
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) resultQuaternions[i] = normalize(quaternions[i]);
+    time = getTime() - t;
+    report.add("normalize (vec4)", referenceTime, time, referenceQuaternions, resultQuaternions);
+
+    //Dot products.
+    std::vector<float> referenceDots(nrElements), resultDots(nrElements);
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceDots[i] = points[i].x*points2[i].x + points[i].y*points2[i].y + points[i].z*points2[i].z;
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) dotProducts(&points[0], &points2[0], &resultDots[0], nrElements);
+    time = getTime() - t;
+    report.add("dotProducts (vec3)", referenceTime, time, referenceDots, resultDots);
+
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceDots[i] = quaternions[i].x*quaternions2[i].x + quaternions[i].y*quaternions2[i].y + quaternions[i].z*quaternions2[i].z + quaternions[i].w*quaternions2[i].w;
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) dotProducts(&quaternions[0], &quaternions2[0], &resultDots[0], nrElements);
+    time = getTime() - t;
+    report.add("dotProducts (vec4)", referenceTime, time, referenceDots, resultDots);
+
+    //Vector arithmetic.
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) referenceQuaternions[i] = referenceMultiplyAdd(quaternions[i], quaternions2[(i + r) % nrElements], 0.5f);
+    referenceTime = getTime() - t;
+    t = getTime();
+    for (int r = 0; r < nrRepetitions; ++r) for (int i = 0; i < nrElements; ++i) resultQuaternions[i] = quaternions[i]*0.5f + quaternions2[(i + r) % nrElements];
+    time = getTime() - t;
+    report.add("vec4 * float + vec4", referenceTime, time, referenceQuaternions, resultQuaternions);
+
+    std::cout << report.nrMismatches << " mismatching kernels" << std::endl;
+
+    return (report.nrMismatches == 0 ? 0 : 1);
+}
+
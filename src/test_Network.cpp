@@ -92,16 +92,16 @@ class SimpleClient : public tiny::net::Client
         {
             if (message.id == 1)
             {
-                std::cout << "Received integer printing request: " << message.data[0].iv1 << "." << std::endl;
+                std::cout << "Received integer printing request: " << message.data[0].iv1() << "." << std::endl;
             }
             else if (message.id == 2)
             {
                 std::cout << "Received integer squaring request, which is silly, that is the host's job!" << std::endl;
-                std::cout << "Received integer squaring request for " << message.data[0].iv1 << "." << std::endl;
+                std::cout << "Received integer squaring request for " << message.data[0].iv1() << "." << std::endl;
                 
                 tiny::net::Message returnMessage(1);
                 
-                returnMessage << message.data[0].iv1*message.data[0].iv1;
+                returnMessage << message.data[0].iv1()*message.data[0].iv1();
                 sendMessage(returnMessage);
             }
             else
@@ -137,15 +137,15 @@ class SimpleHost : public tiny::net::Host
         {
             if (message.id == 1)
             {
-                std::cout << "Received integer printing request, which the host will perform reluctantly, " << message.data[0].iv1 << "." << std::endl;
+                std::cout << "Received integer printing request, which the host will perform reluctantly, " << message.data[0].iv1() << "." << std::endl;
             }
             else if (message.id == 2)
             {
-                std::cout << "Received integer squaring request for " << message.data[0].iv1 << "." << std::endl;
+                std::cout << "Received integer squaring request for " << message.data[0].iv1() << "." << std::endl;
                 
                 tiny::net::Message returnMessage(1);
                 
-                returnMessage << message.data[0].iv1*message.data[0].iv1;
+                returnMessage << message.data[0].iv1()*message.data[0].iv1();
                 sendPrivateMessage(returnMessage, clientIndex);
             }
             else
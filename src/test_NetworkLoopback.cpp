@@ -0,0 +1,328 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <exception>
+
+#include <SDL.h>
+#include <SDL_net.h>
+
+#include <tiny/net/message.h>
+#include <tiny/net/host.h>
+#include <tiny/net/client.h>
+
+using namespace tiny;
+
+//Connect many clients to a host over the loopback interface and verify that all messages arrive in order, while clients come and go.
+
+const unsigned int port = 1235;
+const int nrClients = 32;
+const int nrFrames = 64;
+const int nrMessagesPerFrame = 4;
+
+class UpdateMessageType : public net::MessageType
+{
+    public:
+        UpdateMessageType() :
+            net::MessageType(1, "update", "Sends the state of a unit.")
+        {
+            addVariableType("sender", net::vt::Integer);
+            addVariableType("sequence", net::vt::Integer);
+            addVariableType("position", net::vt::Vec3);
+            addVariableType("rotation", net::vt::Vec4);
+        }
+        
+        ~UpdateMessageType()
+        {
+
+        }
+};
+
+class AcknowledgeMessageType : public net::MessageType
+{
+    public:
+        AcknowledgeMessageType() :
+            net::MessageType(2, "acknowledge", "Confirms that an update has been received.")
+        {
+            addVariableType("sequence", net::vt::Integer);
+        }
+        
+        ~AcknowledgeMessageType()
+        {
+
+        }
+};
+
+class LoopbackTranslator : public net::MessageTranslator
+{
+    public:
+        LoopbackTranslator() :
+            net::MessageTranslator()
+        {
+            addMessageType(new UpdateMessageType());
+            addMessageType(new AcknowledgeMessageType());
+        }
+        
+        ~LoopbackTranslator()
+        {
+
+        }
+};
+
+net::Message createUpdate(const int &sender, const int &sequence)
+{
+    net::Message message(1);
+    
+    message << sender << sequence << vec3(sender, sequence, -0.5f*sequence) << vec4(1.0f/(sequence + 1), 0.0f, 0.0f, 1.0f);
+    
+    return message;
+}
+
+bool isValidUpdate(const net::Message &message, const int &sender, const int &sequence)
+{
+    const net::Message reference = createUpdate(sender, sequence);
+    
+    if (message.id != reference.id || message.data.size() != reference.data.size()) return false;
+    
+    for (size_t i = 0; i < message.data.size(); ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            if (message.data[i].ints[j] != reference.data[i].ints[j]) return false;
+        }
+    }
+    
+    return true;
+}
+
+class LoopbackClient : public net::Client
+{
+    public:
+        LoopbackClient(const int &a_number, net::MessageTranslator *a_translator) :
+            net::Client("localhost", port, a_translator),
+            number(a_number),
+            nrAcknowledged(0),
+            nrBroadcasts(0),
+            nrErrors(0)
+        {
+
+        }
+        
+        ~LoopbackClient()
+        {
+
+        }
+        
+        void receiveMessage(const net::Message &message)
+        {
+            if (message.id == 1)
+            {
+                //Broadcasts from other clients, only check our own.
+                if (message.data[0].iv1() == number && !isValidUpdate(message, number, message.data[1].iv1())) ++nrErrors;
+                
+                ++nrBroadcasts;
+            }
+            else if (message.id == 2)
+            {
+                //Acknowledgements should arrive in order.
+                if (message.data[0].iv1() != nrAcknowledged) ++nrErrors;
+                
+                ++nrAcknowledged;
+            }
+            else
+            {
+                ++nrErrors;
+            }
+        }
+        
+        const int number;
+        int nrAcknowledged;
+        int nrBroadcasts;
+        int nrErrors;
+};
+
+class LoopbackHost : public net::Host
+{
+    public:
+        LoopbackHost(net::MessageTranslator *a_translator) :
+            net::Host(port, a_translator, 4),
+            nrReceived(0),
+            nrErrors(0),
+            nextSequences()
+        {
+
+        }
+        
+        ~LoopbackHost()
+        {
+
+        }
+        
+        void receiveMessage(const unsigned int &clientIndex, const net::Message &message)
+        {
+            const int sender = message.data[0].iv1();
+            
+            if (message.id != 1 || sender < 0 || sender >= nrClients)
+            {
+                ++nrErrors;
+                return;
+            }
+            
+            //Updates from each client should arrive in order.
+            if (!isValidUpdate(message, sender, nextSequences[sender]++)) ++nrErrors;
+            
+            ++nrReceived;
+            
+            net::Message acknowledgement(2);
+            
+            acknowledgement << message.data[1].iv1();
+            sendPrivateMessage(acknowledgement, clientIndex);
+            sendMessage(message);
+        }
+        
+        void addClient(const unsigned int &)
+        {
+            nextSequences.resize(nrClients, 0);
+        }
+        
+        void kick(const unsigned int &clientIndex)
+        {
+            kickClient(clientIndex);
+        }
+        
+        int nrReceived;
+        int nrErrors;
+        std::vector<int> nextSequences;
+};
+
+int main(int, char **)
+{
+    if (SDLNet_Init() < 0)
+    {
+        std::cerr << "Unable to initialise SDL_net: " << SDLNet_GetError() << "!" << std::endl;
+        return -1;
+    }
+    
+    int nrErrors = 0;
+    
+    try
+    {
+        LoopbackTranslator translator;
+        LoopbackHost host(&translator);
+        std::vector<LoopbackClient *> clients;
+        
+        //Connect more clients than the host initially expects, such that its socket set has to grow.
+        //The host accepts them as they arrive, since the backlog of pending connections is small.
+        for (int i = 0; i < nrClients; ++i)
+        {
+            clients.push_back(new LoopbackClient(i, &translator));
+            host.listen(0.01);
+        }
+        
+        if (static_cast<int>(host.getNrClients()) != nrClients)
+        {
+            std::cerr << "Only " << host.getNrClients() << " of " << nrClients << " clients have connected!" << std::endl;
+            ++nrErrors;
+        }
+        
+        //Let all clients send updates every frame.
+        const Uint64 start = SDL_GetPerformanceCounter();
+        
+        for (int frame = 0; frame < nrFrames; ++frame)
+        {
+            for (int i = 0; i < nrClients; ++i)
+            {
+                for (int j = 0; j < nrMessagesPerFrame; ++j)
+                {
+                    clients[i]->sendMessage(createUpdate(i, frame*nrMessagesPerFrame + j));
+                }
+                
+                clients[i]->listen(0.0);
+            }
+            
+            host.listen(0.001);
+        }
+        
+        //Receive all remaining messages.
+        for (int frame = 0; frame < 16; ++frame)
+        {
+            host.listen(0.01);
+            
+            for (int i = 0; i < nrClients; ++i)
+            {
+                clients[i]->listen(0.001);
+            }
+        }
+        
+        const double time = static_cast<double>(SDL_GetPerformanceCounter() - start)/static_cast<double>(SDL_GetPerformanceFrequency());
+        
+        for (int i = 0; i < nrClients; ++i)
+        {
+            if (clients[i]->nrAcknowledged != nrFrames*nrMessagesPerFrame || clients[i]->nrBroadcasts != nrClients*nrFrames*nrMessagesPerFrame || clients[i]->nrErrors != 0)
+            {
+                std::cerr << "Client " << i << " received " << clients[i]->nrAcknowledged << " acknowledgements and " << clients[i]->nrBroadcasts << " broadcasts with " << clients[i]->nrErrors << " errors!" << std::endl;
+                ++nrErrors;
+            }
+        }
+        
+        if (host.nrReceived != nrClients*nrFrames*nrMessagesPerFrame || host.nrErrors != 0)
+        {
+            std::cerr << "The host received " << host.nrReceived << " updates with " << host.nrErrors << " errors!" << std::endl;
+            ++nrErrors;
+        }
+        
+        //Disconnect half of the clients and kick one, the remaining clients should still be reachable.
+        for (int i = 0; i < nrClients/2; ++i)
+        {
+            delete clients[i];
+            clients[i] = 0;
+        }
+        
+        host.kick(nrClients);
+        
+        for (int i = 0; i < 4; ++i)
+        {
+            host.listen(0.01);
+        }
+        
+        if (static_cast<int>(host.getNrClients()) != nrClients/2 - 1)
+        {
+            std::cerr << "The host still has " << host.getNrClients() << " clients instead of " << nrClients/2 - 1 << "!" << std::endl;
+            ++nrErrors;
+        }
+        
+        for (int i = nrClients/2; i < nrClients; ++i)
+        {
+            delete clients[i];
+        }
+        
+        std::cout << "Exchanged " << 2*host.nrReceived + nrClients*host.nrReceived << " messages between a host and " << nrClients << " clients in " << 1.0e3*time << " ms." << std::endl;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Unable to set up loopback connections!" << std::endl;
+        ++nrErrors;
+    }
+    
+    SDLNet_Quit();
+    
+    std::cout << nrErrors << " errors" << std::endl;
+    
+    return (nrErrors == 0 ? 0 : 1);
+}
+
@@ -23,12 +23,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <tiny/os/application.h>
 #include <tiny/os/sdlapplication.h>
+#include <tiny/os/headlessapplication.h>
 
 #include <tiny/img/image.h>
+#include <tiny/img/io/image.h>
 #include <tiny/mesh/staticmesh.h>
 
 #include <tiny/draw/staticmeshhorde.h>
 #include <tiny/draw/effects/diffuse.h>
+#include <tiny/draw/icontexture2d.h>
+#include <tiny/draw/iconhorde.h>
+#include <tiny/draw/profiler.h>
 #include <tiny/draw/worldrenderer.h>
 
 using namespace std;
@@ -44,6 +49,11 @@ draw::RGBATexture2D *cubeDiffuseTexture = 0;
 
 draw::Renderable *screenEffect = 0;
 
+draw::FrameProfiler *profiler = 0;
+draw::ScreenIconHorde *profilerOverlay = 0;
+draw::IconTexture2D *fontTexture = 0;
+double profilerOverlayTime = 0.0;
+
 vec3 cameraPosition = vec3(0.0f, 0.0f, 10.0f);
 vec4 cameraOrientation = vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -75,14 +85,35 @@ void setup()
     
     //Create a renderer and add the cube and the diffuse rendering effect to it.
     worldRenderer = new draw::WorldRenderer(application->getScreenWidth(), application->getScreenHeight());
+    //Share the camera uniforms through a uniform buffer, which has to be enabled before adding renderables.
+    worldRenderer->enableCameraUniformBuffer();
     worldRenderer->addWorldRenderable(0, cubeMeshHorde);
     worldRenderer->addScreenRenderable(0, screenEffect, false, false);
+    
+#ifdef HEADLESS_BENCHMARK
+    //Break the benchmark report down per pass and renderable.
+    worldRenderer->setProfiler(&static_cast<os::HeadlessApplication *>(application)->getProfiler());
+#else
+    //Show the time spent on each pass and renderable on top of the scene.
+    profiler = new draw::FrameProfiler();
+    worldRenderer->setProfiler(profiler);
+    
+    fontTexture = new draw::IconTexture2D(512, 512);
+    fontTexture->packIcons(img::io::readFont(DATA_DIRECTORY + "font/OpenBaskerville-0.0.75.ttf", 48));
+    profilerOverlay = new draw::ScreenIconHorde(1024);
+    profilerOverlay->setIconTexture(*fontTexture);
+    worldRenderer->addScreenRenderable(1, profilerOverlay, false, false, draw::BlendMix);
+#endif
 }
 
 void cleanup()
 {
     delete worldRenderer;
     
+    if (profiler) delete profiler;
+    if (profilerOverlay) delete profilerOverlay;
+    if (fontTexture) delete fontTexture;
+    
     delete screenEffect;
     
     delete cubeMeshHorde;
@@ -96,6 +127,22 @@ void update(const double &dt)
     
     //Tell the world renderer that the camera has changed.
     worldRenderer->setCamera(cameraPosition, cameraOrientation);
+    
+    //Refresh the profiler overlay with the average timings of the last second.
+    if (profiler)
+    {
+        profiler->beginFrame();
+        profilerOverlayTime += dt;
+        
+        if (profilerOverlayTime >= 1.0)
+        {
+            const float aspectRatio = static_cast<float>(application->getScreenWidth())/static_cast<float>(application->getScreenHeight());
+            
+            profiler->updateOverlay(*profilerOverlay, *fontTexture, -0.98f, -0.98f, 0.05f, aspectRatio);
+            profiler->reset();
+            profilerOverlayTime = 0.0;
+        }
+    }
 }
 
 void render()
@@ -108,7 +155,11 @@ int main(int, char **)
 {
     try
     {
+#ifdef HEADLESS_BENCHMARK
+        application = new os::HeadlessApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+#else
         application = new os::SDLApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+#endif
         setup();
     }
     catch (std::exception &e)
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <tiny/os/application.h>
 #include <tiny/os/sdlapplication.h>
+#include <tiny/os/headlessapplication.h>
 
 #include <tiny/img/io/image.h>
 
@@ -81,6 +82,11 @@ void setup()
     worldRenderer = new draw::WorldRenderer(application->getScreenWidth(), application->getScreenHeight());
     worldRenderer->addWorldRenderable(0, terrain);
     worldRenderer->addScreenRenderable(0, screenEffect, false, false);
+    
+#ifdef HEADLESS_BENCHMARK
+    //Break the benchmark report down per pass and renderable.
+    worldRenderer->setProfiler(&static_cast<os::HeadlessApplication *>(application)->getProfiler());
+#endif
 }
 
 void cleanup()
@@ -133,7 +139,11 @@ int main(int, char **)
 {
     try
     {
+#ifdef HEADLESS_BENCHMARK
+        application = new os::HeadlessApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+#else
         application = new os::SDLApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+#endif
         setup();
     }
     catch (std::exception &e)
@@ -17,12 +17,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <exception>
 
 #include <config.h>
 
 #include <tiny/os/application.h>
 #include <tiny/os/sdlapplication.h>
+#include <tiny/os/headlessapplication.h>
 
 #include <tiny/img/io/image.h>
 
@@ -60,6 +62,9 @@ draw::RGBTexture2D *terrainFarTangentTexture = 0;
 draw::RGBTexture2D *terrainFarNormalTexture = 0;
 
 bool terrainFollowsCamera = true;
+bool terrainIsCulled = true;
+size_t nrTerrainBlocks = 0;
+size_t nrCulledTerrainBlocks = 0;
 
 draw::Renderable *screenEffect = 0;
 
@@ -111,6 +116,10 @@ void setup()
                                   terrainScale, terrainFarScale, terrainFarOffset);
     terrain->setDiffuseTextures(*terrainAttributeTexture, *terrainLocalDiffuseTextures, *terrainLocalNormalTextures, vec2(1.0f, 1.0f));
     
+    //Bound the blocks of the terrain by the heights of both height maps, which have been read back, when culling them.
+    terrain->setHeightRange(std::min(*std::min_element(terrainHeightTexture->begin(), terrainHeightTexture->end()), *std::min_element(terrainFarHeightTexture->begin(), terrainFarHeightTexture->end())),
+                            std::max(*std::max_element(terrainHeightTexture->begin(), terrainHeightTexture->end()), *std::max_element(terrainFarHeightTexture->begin(), terrainFarHeightTexture->end())));
+    
     //Render using Lambertian shading.
     screenEffect = new draw::effects::Lambert();
     
@@ -118,10 +127,19 @@ void setup()
     worldRenderer = new draw::WorldRenderer(application->getScreenWidth(), application->getScreenHeight());
     worldRenderer->addWorldRenderable(0, terrain);
     worldRenderer->addScreenRenderable(0, screenEffect, false, false);
+    
+#ifdef HEADLESS_BENCHMARK
+    //Break the benchmark report down per pass and renderable.
+    worldRenderer->setProfiler(&static_cast<os::HeadlessApplication *>(application)->getProfiler());
+#endif
 }
 
 void cleanup()
 {
+#ifdef HEADLESS_BENCHMARK
+    if (terrainIsCulled) cerr << "Culled " << nrCulledTerrainBlocks << " of " << nrTerrainBlocks << " terrain blocks over all frames." << endl;
+#endif
+    
     delete worldRenderer;
     
     delete screenEffect;
@@ -143,6 +161,11 @@ void update(const double &dt)
     //Move the camera around.
     application->updateSimpleCamera(dt, cameraPosition, cameraOrientation);
     
+#ifdef HEADLESS_BENCHMARK
+    //Fly over the terrain at a constant speed, such that it is re-centred regularly.
+    cameraPosition.x += 256.0f*dt;
+#endif
+    
     //Test whether we want the terrain to follow the camera.
     if (application->isKeyPressed('1'))
     {
@@ -153,14 +176,28 @@ void update(const double &dt)
         terrainFollowsCamera = false;
     }
     
-    //Update the terrain with respect to the camera.
-    if (terrainFollowsCamera)
+    //Test whether we want to cull terrain blocks outside the view.
+    if (application->isKeyPressed('3'))
     {
-        terrain->setCameraPosition(cameraPosition);
+        terrainIsCulled = true;
+    }
+    else if (application->isKeyPressed('4'))
+    {
+        terrainIsCulled = false;
     }
     
     //Tell the world renderer that the camera has changed.
     worldRenderer->setCamera(cameraPosition, cameraOrientation);
+    
+    //Update the terrain with respect to the camera.
+    if (terrainFollowsCamera)
+    {
+        if (terrainIsCulled) terrain->setCameraPosition(cameraPosition, worldRenderer->getWorldToScreenMatrix());
+        else terrain->setCameraPosition(cameraPosition);
+        
+        nrTerrainBlocks += terrain->getNrBlocks();
+        nrCulledTerrainBlocks += terrain->getNrCulledBlocks();
+    }
 }
 
 void render()
@@ -169,11 +206,20 @@ void render()
     worldRenderer->render();
 }
 
-int main(int, char **)
+int main(int argc, char **argv)
 {
     try
     {
+#ifdef HEADLESS_BENCHMARK
+        //Look down on the terrain from above, as in a typical top-down view.
+        application = new os::HeadlessApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+        cameraPosition = vec3(0.0f, 512.0f, 0.0f);
+        cameraOrientation = quatrot(1.1f, vec3(1.0f, 0.0f, 0.0f));
+#else
         application = new os::SDLApplication(SCREEN_WIDTH, SCREEN_HEIGHT);
+#endif
+        //Pass 'nocull' to compare with drawing all terrain blocks.
+        terrainIsCulled = (argc < 2 || std::string(argv[1]) != "nocull");
         setup();
     }
     catch (std::exception &e)
@@ -267,11 +267,20 @@ void Game::update(os::Application *application, const float &dt)
     for (std::map<unsigned int, BulletInstance>::iterator i = bullets.begin(); i != bullets.end(); ++i)
     {
         BulletInstance &t = i->second;
+        const vec3 previousPosition = t.x;
+        float hit = 0.0f;
         
         t.lifetime -= dt;
         t.v += dt*t.a;
         t.x += dt*t.v;
         
+        //Explode where the bullet hit the terrain during this time step, such that fast bullets cannot pass through ridges.
+        if (terrain->intersectSegment(previousPosition, t.x, hit))
+        {
+            t.x = previousPosition + hit*(t.x - previousPosition);
+            t.lifetime = 0.0f;
+        }
+        
         if (soundSources.find(t.sound) != soundSources.end())
         {
             soundSources[t.sound]->setPosition(t.x, t.v);
@@ -480,12 +489,12 @@ void Game::update(os::Application *application, const float &dt)
             cameraOrientation = soldierType->getCameraOrientation(soldier);
         }
         
-        //Update the terrain with respect to the camera.
-        terrain->terrain->setCameraPosition(cameraPosition);
-        
         //Tell the world renderer that the camera has changed.
         renderer->setCamera(cameraPosition, cameraOrientation);
         snd::WorldSounderer::setCamera(cameraPosition, cameraOrientation);
+        
+        //Update the terrain with respect to the camera, skipping the blocks outside the view.
+        terrain->terrain->setCameraPosition(cameraPosition, renderer->getWorldToScreenMatrix());
     }
 }
 
@@ -478,30 +478,30 @@ bool Game::applyMessage(const unsigned int &senderIndex, const Message &message)
     if (senderIndex == 0)
     {
              if (message.id == msg::mt::help) ok = msgHelp(senderIndex, out, broadcast);
-        else if (message.id == msg::mt::host) ok = msgHost(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::join) ok = msgJoin(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].iv1);
+        else if (message.id == msg::mt::host) ok = msgHost(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::join) ok = msgJoin(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].iv1());
         else if (message.id == msg::mt::disconnect) ok = msgDisconnect(senderIndex, out, broadcast);
-        else if (message.id == msg::mt::addPlayer) ok = msgAddPlayer(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::removePlayer) ok = msgRemovePlayer(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::welcomePlayer) ok = msgWelcomePlayer(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::terrainOffset) ok = msgTerrainOffset(senderIndex, out, broadcast, message.data[0].v2);
-        else if (message.id == msg::mt::addSoldier) ok = msgAddSoldier(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].v2);
-        else if (message.id == msg::mt::removeSoldier) ok = msgRemoveSoldier(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::updateSoldier) ok = msgUpdateSoldier(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].v2, message.data[3].v3, message.data[4].v4, message.data[5].v3);
-        else if (message.id == msg::mt::setPlayerSoldier) ok = msgSetPlayerSoldier(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1);
-        else if (message.id == msg::mt::playerSpawnRequest) ok = msgPlayerSpawnRequest(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::playerShootRequest) ok = msgPlayerShootRequest(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::addBullet) ok = msgAddBullet(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].iv1, message.data[3].v3, message.data[4].v3, message.data[5].v3);
-        else if (message.id == msg::mt::addExplosion) ok = msgAddExplosion(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].v3);
+        else if (message.id == msg::mt::addPlayer) ok = msgAddPlayer(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::removePlayer) ok = msgRemovePlayer(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::welcomePlayer) ok = msgWelcomePlayer(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::terrainOffset) ok = msgTerrainOffset(senderIndex, out, broadcast, message.data[0].v2());
+        else if (message.id == msg::mt::addSoldier) ok = msgAddSoldier(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].v2());
+        else if (message.id == msg::mt::removeSoldier) ok = msgRemoveSoldier(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::updateSoldier) ok = msgUpdateSoldier(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].v2(), message.data[3].v3(), message.data[4].v4(), message.data[5].v3());
+        else if (message.id == msg::mt::setPlayerSoldier) ok = msgSetPlayerSoldier(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1());
+        else if (message.id == msg::mt::playerSpawnRequest) ok = msgPlayerSpawnRequest(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::playerShootRequest) ok = msgPlayerShootRequest(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::addBullet) ok = msgAddBullet(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].iv1(), message.data[3].v3(), message.data[4].v3(), message.data[5].v3());
+        else if (message.id == msg::mt::addExplosion) ok = msgAddExplosion(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].v3());
     }
     else
     {
         //Host messages received from clients.
         assert(host && !client);
         
-             if (message.id == msg::mt::updateSoldier) ok = msgUpdateSoldier(senderIndex, out, broadcast, message.data[0].iv1, message.data[1].iv1, message.data[2].v2, message.data[3].v3, message.data[4].v4, message.data[5].v3);
-        else if (message.id == msg::mt::playerSpawnRequest) ok = msgPlayerSpawnRequest(senderIndex, out, broadcast, message.data[0].iv1);
-        else if (message.id == msg::mt::playerShootRequest) ok = msgPlayerShootRequest(senderIndex, out, broadcast, message.data[0].iv1);
+             if (message.id == msg::mt::updateSoldier) ok = msgUpdateSoldier(senderIndex, out, broadcast, message.data[0].iv1(), message.data[1].iv1(), message.data[2].v2(), message.data[3].v3(), message.data[4].v4(), message.data[5].v3());
+        else if (message.id == msg::mt::playerSpawnRequest) ok = msgPlayerSpawnRequest(senderIndex, out, broadcast, message.data[0].iv1());
+        else if (message.id == msg::mt::playerShootRequest) ok = msgPlayerShootRequest(senderIndex, out, broadcast, message.data[0].iv1());
     }
     
     //Add message output to the console.
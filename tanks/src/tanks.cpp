@@ -22,6 +22,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <tiny/os/application.h>
 #include <tiny/os/sdlapplication.h>
+#include <tiny/draw/computetexture.h>
+#include <tiny/draw/shaderprogramcache.h>
 
 #include "messages.h"
 #include "network.h"
@@ -50,7 +52,11 @@ int main(int argc, char **argv)
         }
         
         application = new tiny::os::SDLApplication(screenWidth, screenHeight);
+        
+        //Reuse shader programs that were linked during a previous run.
+        tiny::draw::ShaderProgramCache::setDirectory("shadercache");
         game = new tanks::Game(application, argv[1]);
+        tiny::draw::ShaderProgramCache::printStatistics();
     }
     catch (std::exception &e)
     {
@@ -66,6 +72,7 @@ int main(int argc, char **argv)
     }
     
     delete game;
+    tiny::draw::ComputeTexture::clearKernels();
     delete application;
     
     std::cerr << "Goodbye." << std::endl;
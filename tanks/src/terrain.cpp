@@ -17,23 +17,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <exception>
 
+#include <cmath>
+#include <cstdlib>
+
 #include <tiny/img/io/image.h>
 
 #include <tiny/draw/computetexture.h>
 #include <tiny/draw/heightmap/scale.h>
 #include <tiny/draw/heightmap/resize.h>
-#include <tiny/draw/heightmap/normalmap.h>
-#include <tiny/draw/heightmap/tangentmap.h>
 #include <tiny/draw/heightmap/diamondsquare.h>
+#include <tiny/draw/heightmap/surfacemaps.h>
+#include <tiny/draw/heightmap/toroidal.h>
 
 #include "terrain.h"
 
 using namespace tanks;
 using namespace tiny;
 
-GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
+GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el) :
+    incrementalOffset(false),
+    planeIsValid(false),
+    baseOffset(0.0f, 0.0f),
+    planeOrigin(0, 0),
+    scratchHeightTexture(0),
+    heightField(),
+    heightPyramid(),
+    heightFieldIsValid(false)
 {
     std::cerr << "Reading terrain resources..." << std::endl;
     
@@ -46,6 +58,7 @@ GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
     float widthScaleFactor = 1.0f;
     float heightScaleFactor = 1.0f;
     int farScaleFactor = 2; 
+    int incrementalOffsetFlag = 0;
     float detailScaleFactor = 1.0f;
     vec2 startingOffset(0.5f);
     
@@ -55,6 +68,7 @@ GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
     el->QueryFloatAttribute("scale_height", &heightScaleFactor);
     el->QueryIntAttribute("scale_far", &farScaleFactor);
     el->QueryFloatAttribute("scale_detail", &detailScaleFactor);
+    el->QueryIntAttribute("incremental_offset", &incrementalOffsetFlag);
     el->QueryStringAttribute("attribute_shader", &attributeShaderFileName);
     el->QueryStringAttribute("heightmap", &heightMapFileName);
     el->QueryFloatAttribute("offset_x", &startingOffset.x);
@@ -101,33 +115,44 @@ GameTerrain::GameTerrain(const std::string &path, TiXmlElement *el)
     farScale = ivec2(farScaleFactor);
     farOffset = vec2(0.5f);
     localTextureScale = vec2(detailScaleFactor);
+    incrementalOffset = (incrementalOffsetFlag != 0);
     
-    //Create height maps.
-    heightTexture = new draw::FloatTexture2D(img::io::readImage(path + heightMapFileName), draw::tf::filter);
-    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter);
+    //Create height maps, the zoomed-in height map repeats when it is updated incrementally.
+    heightTexture = new draw::FloatTexture2D(img::io::readImage(path + heightMapFileName), incrementalOffset ? draw::tf::repeat | draw::tf::filter : draw::tf::filter);
+    if (incrementalOffset) scratchHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::hostOnDemand);
+    farHeightTexture = new draw::FloatTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::filter | draw::tf::hostOnDemand);
     
     //Create normal maps for the far-away and zoomed-in heightmaps.
-    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
-    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight());
+    farTangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    tangentTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    farNormalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
+    normalTexture = new draw::RGBTexture2D(heightTexture->getWidth(), heightTexture->getHeight(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::hostOnDemand);
     
     //Create an attribute texture that determines the terrain type (forest/grass/mud/stone) based on the altitude and slope.
     attributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
-    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()));
+    farAttributeTexture = new draw::RGBATexture2D(img::Image::createSolidImage(heightTexture->getWidth()), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Create local diffuse textures.
-    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage());
-    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end());
+    if (diffuseImages.empty()) localDiffuseTextures = new draw::RGBTexture2DArray(img::Image::createSolidImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localDiffuseTextures = new draw::RGBTexture2DArray(diffuseImages.begin(), diffuseImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
-    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage());
-    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end());
+    if (normalImages.empty()) localNormalTextures = new draw::RGBTexture2DArray(img::Image::createUpNormalImage(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
+    else localNormalTextures = new draw::RGBTexture2DArray(normalImages.begin(), normalImages.end(), draw::tf::repeat | draw::tf::filter | draw::tf::mipmap | draw::tf::dropHostData);
     
     //Scale vertical range of the far-away heightmap.
-    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f));
+    draw::computeScaledTexture(*heightTexture, *farHeightTexture, vec4(heightScaleFactor/255.0f), vec4(0.0f), false);
+    
+    //The far-away tangent, normal, and attribute maps do not depend on the offset, so they are computed only once.
+    draw::computeSurfaceMaps(*farHeightTexture, *farTangentTexture, *farNormalTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x, false);
     
     //Create the terrain.
     terrain = new draw::Terrain(6, 8);
+    
+    //Bound the heights of the far-away and refined zoomed-in height maps, such that blocks of the terrain can be culled.
+    const vec2 heightRange = draw::getDiamondSquareHeightRange(vec2(0.0f, heightScaleFactor), farScale.x, 1.0f);
+    
+    terrain->setHeightRange(heightRange.x, heightRange.y);
+    
     setOffset(startingOffset);
 }
 
@@ -135,6 +160,7 @@ GameTerrain::~GameTerrain()
 {
     delete terrain;
     delete heightTexture;
+    delete scratchHeightTexture;
     delete farHeightTexture;
     delete tangentTexture;
     delete farTangentTexture;
@@ -148,25 +174,31 @@ GameTerrain::~GameTerrain()
 
 void GameTerrain::setOffset(const vec2 &offset)
 {
-    farOffset = offset;
-    
-    //Zoom into a small area of the far-away heightmap.
-    draw::computeResizedTexture(*farHeightTexture, *heightTexture,
-                                vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
-                                farOffset);
-    
-    //Apply the diamond-square fractal algorithm to make the zoomed-in heightmap a little less boring.
-    draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x);
-    
-    //Tangent and normal maps.
-    draw::computeTangentMap(*farHeightTexture, *farTangentTexture, scale.x*farScale.x);
-    draw::computeTangentMap(*heightTexture, *tangentTexture, scale.x);
-    draw::computeNormalMap(*farHeightTexture, *farNormalTexture, scale.x*farScale.x);
-    draw::computeNormalMap(*heightTexture, *normalTexture, scale.x);
+    if (incrementalOffset)
+    {
+        updateOffsetIncrementally(offset);
+    }
+    else
+    {
+        farOffset = offset;
+        
+        //Zoom into a small area of the far-away heightmap.
+        draw::computeResizedTexture(*farHeightTexture, *heightTexture,
+                                    vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
+                                    farOffset, false);
+        
+        //Apply the diamond-square fractal algorithm to make the zoomed-in heightmap a little less boring.
+        draw::computeDiamondSquareRefinement(*heightTexture, *heightTexture, farScale.x, 1.0f, false);
+        
+        //Tangent, normal, and attribute maps of the zoomed-in terrain in a single pass.
+        draw::computeSurfaceMaps(*heightTexture, *tangentTexture, *normalTexture, *attributeTexture, attributeShaderCode, scale.x, false);
+        
+        //Only the zoomed-in height and attribute maps are used on the CPU, start reading them back without waiting for the device.
+        heightTexture->beginReadback();
+        attributeTexture->beginReadback();
+        heightFieldIsValid = false;
+    }
     
-    //Calculate attribute maps for both the zoomed-in and far-away terrain.
-    calculateAttributes(*heightTexture, *attributeTexture, attributeShaderCode, scale.x);
-    calculateAttributes(*farHeightTexture, *farAttributeTexture, attributeShaderCode, scale.x*farScale.x);
     terrain->setFarDiffuseTextures(*attributeTexture, *farAttributeTexture, *localDiffuseTextures, *localNormalTextures, localTextureScale);
     //terrain->setDiffuseTextures(*attributeTexture, *localDiffuseTextures, *localNormalTextures, vec2(1.0f, 1.0f));
     
@@ -179,32 +211,97 @@ void GameTerrain::setOffset(const vec2 &offset)
     //terrain->setHeightTextures(*heightTexture, *tangentTexture, *normalTexture, scale);
 }
 
-void GameTerrain::calculateAttributes(const tiny::draw::FloatTexture2D &heightMap, tiny::draw::RGBATexture2D &attributeMap, const std::string &shaderCode, const float &scale)
+void GameTerrain::updateOffsetIncrementally(const vec2 &offset)
 {
-    std::vector<std::string> inputTextures;
-    std::vector<std::string> outputTextures;
+    const ivec2 size = ivec2(heightTexture->getWidth(), heightTexture->getHeight());
+    //Round the offset to whole zoomed-in texels relative to the plane, the difference of less than a texel is invisible.
+    const vec2 texelShift = vec2((offset.x - baseOffset.x)*static_cast<float>(size.x*farScale.x), (offset.y - baseOffset.y)*static_cast<float>(size.y*farScale.y));
+    const ivec2 newOrigin = ivec2(static_cast<int>(floor(texelShift.x + 0.5f)), static_cast<int>(floor(texelShift.y + 0.5f)));
+    const ivec2 shift = newOrigin - planeOrigin;
     
-    inputTextures.push_back("source");
-    outputTextures.push_back("colour");
-
-    draw::ComputeTexture *computeTexture = new draw::ComputeTexture(inputTextures, outputTextures, shaderCode);
+    //Texels within this distance of the old edge depended on texels at the other side of the window, which are replaced.
+    const int margin = std::max(farScale.x, farScale.y);
+    std::vector<ivec4> areas;
+    
+    if (!planeIsValid || abs(shift.x) + margin >= size.x || abs(shift.y) + margin >= size.y)
+    {
+        //Start a new plane at this offset if it moves too far to reuse any texels.
+        baseOffset = offset;
+        planeOrigin = ivec2(0, 0);
+        planeIsValid = true;
+        areas.push_back(ivec4(0, 0, size.x, size.y));
+    }
+    else
+    {
+        //Recompute the newly exposed strips of the window, together with the margin along the old edge.
+        areas = draw::getToroidalShiftAreas(size, planeOrigin, newOrigin, margin);
+        planeOrigin = newOrigin;
+    }
+    
+    farOffset = vec2(baseOffset.x + static_cast<float>(planeOrigin.x)/static_cast<float>(size.x*farScale.x),
+                     baseOffset.y + static_cast<float>(planeOrigin.y)/static_cast<float>(size.y*farScale.y));
+    terrain->setTextureWrapOffset(vec2(static_cast<float>(((planeOrigin.x % size.x) + size.x) % size.x)/static_cast<float>(size.x),
+                                       static_cast<float>(((planeOrigin.y % size.y) + size.y) % size.y)/static_cast<float>(size.y)));
+    
+    if (areas.empty()) return;
     
-    computeTexture->uniformMap().setFloatUniform(2.0f*scale, "mapScale");
-    computeTexture->setInput(heightMap, "source");
-    computeTexture->setOutput(attributeMap, "colour");
-    computeTexture->compute();
-    attributeMap.getFromDevice();
+    //Zoom into the far-away heightmap and refine it with the diamond-square algorithm, only for the new areas.
+    draw::computeToroidalResizedTexture(*farHeightTexture, *heightTexture,
+                                        vec2(1.0f/static_cast<float>(farScale.x), 1.0f/static_cast<float>(farScale.y)),
+                                        baseOffset, areas);
+    draw::computeToroidalDiamondSquareRefinement(*heightTexture, *scratchHeightTexture, farScale.x, 1.0f, areas);
     
-    delete computeTexture;
+    //The surface maps also change one texel around the new heights.
+    const std::vector<ivec4> heightRegions = draw::getToroidalRegions(size, areas);
+    const std::vector<ivec4> surfaceRegions = draw::getToroidalRegions(size, areas, 1);
+    
+    draw::computeSurfaceMaps(*heightTexture, *tangentTexture, *normalTexture, *attributeTexture, attributeShaderCode, scale.x, false, surfaceRegions);
+    
+    //Only read back the texels that have changed.
+    heightTexture->beginReadback(heightRegions);
+    attributeTexture->beginReadback(surfaceRegions);
+    heightFieldIsValid = false;
 }
 
 float GameTerrain::getHeight(const vec2 &a_pos) const
 {
-    return sampleTextureBilinear(*heightTexture, scale, a_pos).x;
+    finishReadbacks();
+    
+    return heightField.getHeight(a_pos);
+}
+
+void GameTerrain::getHeights(const vec2 *positions, float *heights, const size_t &n) const
+{
+    finishReadbacks();
+    
+    heightField.getHeights(positions, heights, n);
+}
+
+bool GameTerrain::intersectSegment(const vec3 &a, const vec3 &b, float &t) const
+{
+    finishReadbacks();
+    
+    return heightPyramid.intersectSegment(a, b, t);
 }
 
 float GameTerrain::getAttribute(const vec2 &a_pos) const
 {
-    return sampleTextureBilinear(*attributeTexture, scale, a_pos).x;
+    finishReadbacks();
+    
+    return sampleTextureBilinear(*attributeTexture, scale, a_pos, planeOrigin).x;
+}
+
+void GameTerrain::finishReadbacks() const
+{
+    //Wait for the height and attribute maps, if they are still being read back from the device.
+    heightTexture->finishReadback();
+    attributeTexture->finishReadback();
+    
+    if (!heightFieldIsValid)
+    {
+        heightField.setHeights(*heightTexture, scale, planeOrigin);
+        heightPyramid.build(heightField);
+        heightFieldIsValid = true;
+    }
 }
 
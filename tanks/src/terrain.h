@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/terrain.h>
 #include <tiny/draw/texture2d.h>
 #include <tiny/draw/texture2darray.h>
+#include <tiny/draw/heightmap/heightfield.h>
+#include <tiny/draw/heightmap/heightpyramid.h>
 
 namespace tanks
 {
@@ -37,24 +39,39 @@ class GameTerrain
         void setOffset(const tiny::vec2 &);
         
         float getHeight(const tiny::vec2 &) const;
+        void getHeights(const tiny::vec2 *, float *, const size_t &) const;
+        bool intersectSegment(const tiny::vec3 &, const tiny::vec3 &, float &) const;
         float getAttribute(const tiny::vec2 &) const;
         
         tiny::draw::Terrain *terrain;
         
     private:
-        static void calculateAttributes(const tiny::draw::FloatTexture2D &, tiny::draw::RGBATexture2D &, const std::string &, const float &);
+        void updateOffsetIncrementally(const tiny::vec2 &);
+        void finishReadbacks() const;
+        
+        //Maps texel x of the zoomed-in terrain to the texel of a texture that stores it toroidally, texels outside the terrain are left as they are.
+        static int wrapTexel(const int &x, const int &origin, const int &size)
+        {
+            if (x < 0 || x >= size) return x;
+            
+            return (x + ((origin % size) + size) % size) % size;
+        }
         
         //A simple bilinear texture sampler, which converts world coordinates to the corresponding texture coordinates on the zoomed-in terrain.
         template<typename TextureType>
-        static tiny::vec4 sampleTextureBilinear(const TextureType &texture, const tiny::vec2 &scale, const tiny::vec2 &a_pos)
+        static tiny::vec4 sampleTextureBilinear(const TextureType &texture, const tiny::vec2 &scale, const tiny::vec2 &a_pos, const tiny::ivec2 &origin)
         {
             //Sample texture at the four points surrounding pos.
             const tiny::vec2 pos = tiny::vec2(a_pos.x/scale.x + 0.5f*static_cast<float>(texture.getWidth()), a_pos.y/scale.y + 0.5f*static_cast<float>(texture.getHeight()));
             const tiny::ivec2 intPos = tiny::ivec2(floor(pos.x), floor(pos.y));
-            const tiny::vec4 h00 = texture(intPos.x + 0, intPos.y + 0);
-            const tiny::vec4 h01 = texture(intPos.x + 0, intPos.y + 1);
-            const tiny::vec4 h10 = texture(intPos.x + 1, intPos.y + 0);
-            const tiny::vec4 h11 = texture(intPos.x + 1, intPos.y + 1);
+            const int x0 = wrapTexel(intPos.x + 0, origin.x, texture.getWidth());
+            const int x1 = wrapTexel(intPos.x + 1, origin.x, texture.getWidth());
+            const int y0 = wrapTexel(intPos.y + 0, origin.y, texture.getHeight());
+            const int y1 = wrapTexel(intPos.y + 1, origin.y, texture.getHeight());
+            const tiny::vec4 h00 = texture(x0, y0);
+            const tiny::vec4 h01 = texture(x0, y1);
+            const tiny::vec4 h10 = texture(x1, y0);
+            const tiny::vec4 h11 = texture(x1, y1);
             const tiny::vec2 delta = tiny::vec2(pos.x - floor(pos.x), pos.y - floor(pos.y));
             
             //Interpolate between these four points.
@@ -67,7 +84,15 @@ class GameTerrain
         tiny::vec2 localTextureScale;
         std::string attributeShaderCode;
         
+        //In incremental mode, the zoomed-in textures are a window onto a plane of texels that is stored toroidally, such that moving the offset by whole texels only requires the newly exposed strips to be computed.
+        //Plane texel (0, 0) is sampled from the far-away height map at baseOffset, and the window starts at plane texel planeOrigin.
+        bool incrementalOffset;
+        bool planeIsValid;
+        tiny::vec2 baseOffset;
+        tiny::ivec2 planeOrigin;
+        
         tiny::draw::FloatTexture2D *heightTexture;
+        tiny::draw::FloatTexture2D *scratchHeightTexture;
         tiny::draw::FloatTexture2D *farHeightTexture;
         tiny::draw::RGBTexture2D *normalTexture;
         tiny::draw::RGBTexture2D *farNormalTexture;
@@ -77,6 +102,11 @@ class GameTerrain
         tiny::draw::RGBATexture2D *farAttributeTexture;
         tiny::draw::RGBTexture2DArray *localDiffuseTextures;
         tiny::draw::RGBTexture2DArray *localNormalTextures;
+        
+        //Copy of the zoomed-in height map for sampling on the CPU, rebuilt after every readback.
+        mutable tiny::draw::HeightField heightField;
+        mutable tiny::draw::HeightPyramid heightPyramid;
+        mutable bool heightFieldIsValid;
 };
 
 } //namespace tanks
@@ -0,0 +1,260 @@
+/*
+Copyright 2015, Matthijs van Dorp.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace tiny
+{
+
+namespace algo
+{
+    /** A flat, open-addressed hash map with linear probing, intended as a drop-in replacement for std::map<K,V> inside the TypeCluster
+      * whenever ordered iteration is not required. All elements live in a single contiguous array, so a lookup costs one hash and (usually)
+      * a single cache line instead of O(log n) pointer chasing through tree nodes.
+      *
+      * Deletion uses backward shifting instead of tombstones: after erasing an element, the following elements of the probe sequence
+      * are moved back so that the table never accumulates deleted markers and lookups never slow down after many insert/erase cycles.
+      *
+      * The key type K must be default-constructible, copyable and comparable with ==. The hash functor H must provide
+      * 'std::size_t operator () (const K &) const'. Unlike std::map, iteration order is unspecified and any insertion or erasure
+      * invalidates all iterators. No lower_bound() or upper_bound() is provided.
+      */
+    template <class K, class V, class H> class FlatHashMap
+    {
+        public:
+            typedef K key_type;
+            typedef V mapped_type;
+            typedef std::pair<K, V> value_type;
+            typedef std::size_t size_type;
+
+            class const_iterator;
+
+            /** Iterator over the occupied slots of the map. */
+            class iterator
+            {
+                private:
+                    friend class FlatHashMap<K,V,H>;
+                    friend class const_iterator;
+                    FlatHashMap<K,V,H> * map;
+                    size_type index;
+
+                    iterator(FlatHashMap<K,V,H> * _map, size_type _index) : map(_map), index(_index) {}
+                public:
+                    iterator(void) : map(0), index(0) {}
+
+                    value_type & operator * (void) const { return map->slots[index]; }
+                    value_type * operator -> (void) const { return &map->slots[index]; }
+                    iterator & operator ++ (void) { index = map->nextOccupied(index + 1); return *this; }
+                    iterator operator ++ (int) { iterator it(*this); ++(*this); return it; }
+                    bool operator == (const iterator & it) const { return index == it.index && map == it.map; }
+                    bool operator != (const iterator & it) const { return index != it.index || map != it.map; }
+            };
+
+            /** Const iterator over the occupied slots of the map. */
+            class const_iterator
+            {
+                private:
+                    friend class FlatHashMap<K,V,H>;
+                    const FlatHashMap<K,V,H> * map;
+                    size_type index;
+
+                    const_iterator(const FlatHashMap<K,V,H> * _map, size_type _index) : map(_map), index(_index) {}
+                public:
+                    const_iterator(void) : map(0), index(0) {}
+                    const_iterator(const iterator & it) : map(it.map), index(it.index) {}
+
+                    const value_type & operator * (void) const { return map->slots[index]; }
+                    const value_type * operator -> (void) const { return &map->slots[index]; }
+                    const_iterator & operator ++ (void) { index = map->nextOccupied(index + 1); return *this; }
+                    const_iterator operator ++ (int) { const_iterator it(*this); ++(*this); return it; }
+                    bool operator == (const const_iterator & it) const { return index == it.index && map == it.map; }
+                    bool operator != (const const_iterator & it) const { return index != it.index || map != it.map; }
+            };
+
+            FlatHashMap(void) : slots(), occupied(), nrElements(0), mask(0), hasher()
+            {
+                rehash(16);
+            }
+
+            ~FlatHashMap(void)
+            {
+            }
+
+            size_type size(void) const { return nrElements; }
+            bool empty(void) const { return nrElements == 0; }
+
+            iterator begin(void) { return iterator(this, nextOccupied(0)); }
+            iterator end(void) { return iterator(this, slots.size()); }
+            const_iterator begin(void) const { return const_iterator(this, nextOccupied(0)); }
+            const_iterator end(void) const { return const_iterator(this, slots.size()); }
+            const_iterator cbegin(void) const { return begin(); }
+            const_iterator cend(void) const { return end(); }
+
+            /** Remove all elements, but keep the allocated table. */
+            void clear(void)
+            {
+                for (size_type i = 0; i < slots.size(); ++i)
+                {
+                    if (occupied[i]) slots[i] = value_type();
+                    occupied[i] = 0;
+                }
+
+                nrElements = 0;
+            }
+
+            /** Make sure that at least 'n' elements can be stored without growing the table. */
+            void reserve(size_type n)
+            {
+                size_type capacity = slots.size();
+
+                while (4*n > 3*capacity) capacity *= 2;
+
+                if (capacity != slots.size()) rehash(capacity);
+            }
+
+            iterator find(const K & key)
+            {
+                return iterator(this, findSlot(key));
+            }
+
+            const_iterator find(const K & key) const
+            {
+                return const_iterator(this, findSlot(key));
+            }
+
+            /** Insert an element if its key is not yet present. Mirrors std::map::insert(): the returned bool is false if the key already existed. */
+            std::pair<iterator, bool> insert(const value_type & value)
+            {
+                size_type index = findSlot(value.first);
+
+                if (index != slots.size()) return std::make_pair(iterator(this, index), false);
+
+                if (4*(nrElements + 1) > 3*slots.size()) rehash(2*slots.size());
+
+                index = hasher(value.first) & mask;
+
+                while (occupied[index]) index = (index + 1) & mask;
+
+                slots[index] = value;
+                occupied[index] = 1;
+                ++nrElements;
+
+                return std::make_pair(iterator(this, index), true);
+            }
+
+            /** Erase the element with the given key, returning the number of erased elements (0 or 1). */
+            size_type erase(const K & key)
+            {
+                const size_type index = findSlot(key);
+
+                if (index == slots.size()) return 0;
+
+                eraseSlot(index);
+
+                return 1;
+            }
+
+            /** Erase the element pointed to by 'it'. */
+            void erase(iterator it)
+            {
+                eraseSlot(it.index);
+            }
+
+        private:
+            std::vector<value_type> slots; /**< All slots of the table, the number of which is always a power of two. */
+            std::vector<unsigned char> occupied; /**< Whether or not the corresponding slot contains an element. */
+            size_type nrElements; /**< Number of occupied slots. */
+            size_type mask; /**< slots.size() - 1, used to wrap the probe sequence. */
+            H hasher;
+
+            /** Return the slot containing 'key', or slots.size() if it is not present. */
+            size_type findSlot(const K & key) const
+            {
+                size_type index = hasher(key) & mask;
+
+                while (occupied[index])
+                {
+                    if (slots[index].first == key) return index;
+                    index = (index + 1) & mask;
+                }
+
+                return slots.size();
+            }
+
+            /** Return the first occupied slot at or after 'index', or slots.size() if there is none. */
+            size_type nextOccupied(size_type index) const
+            {
+                while (index < slots.size() && !occupied[index]) ++index;
+
+                return index;
+            }
+
+            /** Empty a slot and shift back subsequent elements of the probe sequence such that no element becomes unreachable. */
+            void eraseSlot(size_type hole)
+            {
+                size_type index = hole;
+
+                while (true)
+                {
+                    index = (index + 1) & mask;
+
+                    if (!occupied[index]) break;
+
+                    //An element may only fill the hole if its ideal slot does not lie cyclically in (hole, index].
+                    const size_type ideal = hasher(slots[index].first) & mask;
+
+                    if (hole <= index ? (hole < ideal && ideal <= index) : (hole < ideal || ideal <= index)) continue;
+
+                    slots[hole] = slots[index];
+                    hole = index;
+                }
+
+                slots[hole] = value_type();
+                occupied[hole] = 0;
+                --nrElements;
+            }
+
+            /** Re-insert all elements in a table with 'capacity' slots, which should be a power of two. */
+            void rehash(size_type capacity)
+            {
+                std::vector<value_type> oldSlots(capacity);
+                std::vector<unsigned char> oldOccupied(capacity, 0);
+
+                oldSlots.swap(slots);
+                oldOccupied.swap(occupied);
+                mask = capacity - 1;
+
+                for (size_type i = 0; i < oldSlots.size(); ++i)
+                {
+                    if (oldOccupied[i])
+                    {
+                        size_type index = hasher(oldSlots[i].first) & mask;
+
+                        while (occupied[index]) index = (index + 1) & mask;
+
+                        slots[index] = oldSlots[i];
+                        occupied[index] = 1;
+                    }
+                }
+            }
+    };
+} // end namespace algo
+
+} // end namespace tiny
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <limits>
 
 #include <tiny/algo/typecluster.h>
+#include <tiny/algo/flathashmap.h>
 
 namespace tiny
 {
@@ -40,8 +41,9 @@ namespace algo
     class GridPoint
     {
         private:
-            const ivec2 location;
+            ivec2 location;
         public:
+            GridPoint(void) : location(0, 0) {}
             GridPoint(const ivec2 & v) : location(v) {}
             GridPoint(const vec3 &v, const float gridsize) : location( ivec2( convertFloatToInt(v.x/gridsize), convertFloatToInt(v.z/gridsize)) ) {}
             const ivec2 & getLocation(void) const { return location; }
@@ -70,19 +72,49 @@ namespace algo
     /** An operator overload to allow printing of GridPoint objects. */
     inline std::ostream & operator<< (std::ostream & s, const GridPoint & gp) { s << "(" << gp.getLocation().x << "," << gp.getLocation().y << ")"; return s; }
 
-    template <class T> class GridMap;
+    /** Hash functor for GridPoint keys, for use with the FlatHashMap. Both cell coordinates are packed together and mixed such that
+      * neighbouring cells end up far apart in the table. */
+    struct GridPointHash
+    {
+        std::size_t operator() (const GridPoint & gp) const
+        {
+            unsigned int h = static_cast<unsigned int>(gp.getLocation().x)*0x9e3779b1u ^ static_cast<unsigned int>(gp.getLocation().y)*0x85ebca77u;
+
+            h ^= h >> 16;
+            h *= 0x7feb352du;
+            h ^= h >> 15;
+
+            return h;
+        }
+    };
+
+    /** Index selecting an std::map to store the tiles of a GridMap. This gives ordered iteration and lower_bound()/upper_bound() at logarithmic lookup cost. */
+    struct OrderedGridIndex
+    {
+        template <class T> struct container { typedef std::map<GridPoint,T*> type; };
+    };
+
+    /** Index selecting a FlatHashMap to store the tiles of a GridMap. This gives constant-time tile lookup, but iteration order is unspecified. */
+    struct FlatGridIndex
+    {
+        template <class T> struct container { typedef FlatHashMap<GridPoint,T*,GridPointHash> type; };
+    };
+
+    template <class T, class I> class GridMap;
 
     /** The GridMap manages tiles (of a fixed size) in a 2-dimensional grid and provides convenient methods for looking up tiles, creating new tiles and deleting obsolete tiles.
-      * Tiles use an std::map for logarithmic-complexity access of a tile given its location.
+      * Tiles use an std::map for logarithmic-complexity access of a tile given its location, or a flat hash map for constant-time access if FlatGridIndex is passed as I.
+      * GridTile and GridMap should always be given the same index.
       */
-    template <class T> class GridTile : private TypeClusterObject<GridPoint,T>
+    template <class T, class I = OrderedGridIndex> class GridTile : private TypeClusterObject<GridPoint,T,typename I::template container<T>::type>
     {
         private:
+            typedef typename I::template container<T>::type C;
         public:
             /** The constructor must set up the TypeClusterObject properly, using its constructor. For this it needs the pointer of the derived class and
               * it must cast the GridMap (or a class derived from it) back to the TypeCluster class. */
-            GridTile(const vec3 & _origin, T * _derivedObject, GridMap<T> * _map) :
-                TypeClusterObject<GridPoint,T>(GridPoint(_origin, _map->edgeSize()), _derivedObject, *(static_cast<TypeCluster<GridPoint,T>*>(_map)))
+            GridTile(const vec3 & _origin, T * _derivedObject, GridMap<T,I> * _map) :
+                TypeClusterObject<GridPoint,T,C>(GridPoint(_origin, _map->edgeSize()), _derivedObject, *(static_cast<TypeCluster<GridPoint,T,C>*>(_map)))
             {
             }
 
@@ -94,20 +126,23 @@ namespace algo
     };
 
     /** The GridMap clusters TileMapObjects. Its interface is constructed similar to that of the preceding TileCluster class. */
-    template <class T> class GridMap : private TypeCluster<GridPoint,T>
+    template <class T, class I = OrderedGridIndex> class GridMap : private TypeCluster<GridPoint,T,typename I::template container<T>::type>
     {
         private:
-            friend class GridTile<T>; // for the GridTile constructor's cast of GridMap to a TypeCluster.
+            typedef typename I::template container<T>::type C;
+            friend class GridTile<T,I>; // for the GridTile constructor's cast of GridMap to a TypeCluster.
             double edgesize;
         public:
+            typedef typename TypeCluster<GridPoint,T,C>::iterator iterator;
+
             /** GridMap constructor. Use farthest possible location as error code (corresponding to the farthest possible tile of the lower left quadrant). */
-            GridMap(double _edgesize, std::string name) : TypeCluster<GridPoint,T>(GridPoint(ivec2(std::numeric_limits<int>::min(),std::numeric_limits<int>::min())),name), edgesize(_edgesize) {}
+            GridMap(double _edgesize, std::string name) : TypeCluster<GridPoint,T,C>(GridPoint(ivec2(std::numeric_limits<int>::min(),std::numeric_limits<int>::min())),name), edgesize(_edgesize) {}
 
             double edgeSize(void) const { return edgesize; }
-            unsigned int numTiles(void) const { return TypeCluster<GridPoint,T>::size(); } /**< Redirects to TypeCluster::size(). */
+            unsigned int numTiles(void) const { return TypeCluster<GridPoint,T,C>::size(); } /**< Redirects to TypeCluster::size(). */
 
             /** Get a tile if it exists. If the tile doesn't exist a NULL pointer is returned. */
-            T * getTile(vec3 pos) {    return TypeCluster<GridPoint,T>::find(GridPoint(pos,edgesize)); } // Convert vec3 to GridPoint. Any vec3 in the tile should normally be converted to the same GridPoint as the tile's origin itself.
+            T * getTile(vec3 pos) {    return TypeCluster<GridPoint,T,C>::find(GridPoint(pos,edgesize)); } // Convert vec3 to GridPoint. Any vec3 in the tile should normally be converted to the same GridPoint as the tile's origin itself.
 
             /** Check for existence of a tile. */
             bool hasTile(vec3 pos) { return (getTile(pos) != 0); }
@@ -130,26 +165,28 @@ namespace algo
             /** Get all tiles closer than 'range' to the position 'pos'. */
             void getMultipleTiles(std::deque<T*> &tilelist, vec3 pos, float range)
             {
-                for(unsigned int z = convertFloatToInt(pos.z - range); z <= convertFloatToInt(pos.z + range); z++)
+                const ivec2 lo = GridPoint(vec3(pos.x - range, 0.0f, pos.z - range), edgesize).getLocation();
+                const ivec2 hi = GridPoint(vec3(pos.x + range, 0.0f, pos.z + range), edgesize).getLocation();
+                for(int z = lo.y; z <= hi.y; z++)
                 {
                     // For the inner loop cover the full square [x-r,x+r] x [z-r,z+r].
                     // It would be better to do the circle (e.g. run x from sqrt(r^2-y^2) for pos=(0,0)) but the gain is minimal and the code sloppier.
-                    for(unsigned int x = convertFloatToInt(pos.x - range); x <= convertFloatToInt(pos.x + range); x++)
+                    for(int x = lo.x; x <= hi.x; x++)
                     {
-                        T * tile = getTile(vec3(x,0,z));
+                        T * tile = TypeCluster<GridPoint,T,C>::find(GridPoint(ivec2(x,z))); // Look up cells directly, avoiding float-to-int conversion per tile.
                         if(tile) tilelist.push_back(tile);
                     }
                 }
             }
 
             // A list of 'using' declarations to expose base class functions publicly.
-            using TypeCluster<GridPoint,T>::getName;
-            using TypeCluster<GridPoint,T>::is_empty;
-            using TypeCluster<GridPoint,T>::size;
-            using TypeCluster<GridPoint,T>::begin;
-            using TypeCluster<GridPoint,T>::end;
-            using TypeCluster<GridPoint,T>::lower_bound;
-            using TypeCluster<GridPoint,T>::upper_bound;
+            using TypeCluster<GridPoint,T,C>::getName;
+            using TypeCluster<GridPoint,T,C>::is_empty;
+            using TypeCluster<GridPoint,T,C>::size;
+            using TypeCluster<GridPoint,T,C>::begin;
+            using TypeCluster<GridPoint,T,C>::end;
+            using TypeCluster<GridPoint,T,C>::lower_bound;
+            using TypeCluster<GridPoint,T,C>::upper_bound;
     };
 } // namespace algo
 
@@ -29,7 +29,7 @@ namespace tiny
 namespace algo
 {
     /**< Forward declaration of TypeClusterObject, which are objects that are clustered by the TypeCluster class. */
-    template <class K, class T> class TypeClusterObject;
+    template <class K, class T, class C> class TypeClusterObject;
 
     /** The Cluster is a container class, which is designed to extend default std::map functionality by ensuring that all objects of a class are
       * collected and managed together (*). Furthermore, it can temporarily exclude some objects from the functionality by hiding them in another map.
@@ -40,15 +40,18 @@ namespace algo
       * (*) That is, the TypeClusterObject constructor has the form (K, T*, TypeCluster<K,T>&) which enforces that every object is not only given a key but also
       * a map which contains the key. The TypeClusterObject takes care of adding the T object to the map. At deletion of the derived object the TypeClusterObject
       * ensures that the deleted object is erased from the map.
+      *
+      * The container C defaults to std::map<K,T*>, but any container with the same find/insert/erase/iteration interface can be used instead,
+      * such as the FlatHashMap. Note that lower_bound() and upper_bound() are only available if the container provides them.
       */
-    template <class K, class T> class TypeCluster
+    template <class K, class T, class C = std::map<K,T*> > class TypeCluster
     {
         private:
-            template <class R, class S> friend class TypeClusterObject; /**< We will let the TypeClusterObject add and remove itself through private functions.*/
+            template <class R, class S, class U> friend class TypeClusterObject; /**< We will let the TypeClusterObject add and remove itself through private functions.*/
 
             std::string typeClusterName; /**< The name of the TypeCluster. This way, diagnostic messages can also specify what derived class is causing the problems.*/
-            std::map<K,T*> cluster; /**< A container for all T objects that have been created (unless unclustered through UnclusterObject()). */
-            std::map<K,T*> excluster; /**< A container for elements that are tagged to be excluded from the cluster, through using UnclusterObject(). */
+            C cluster; /**< A container for all T objects that have been created (unless unclustered through UnclusterObject()). */
+            C excluster; /**< A container for elements that are tagged to be excluded from the cluster, through using UnclusterObject(). */
 
             /** A key to be assigned to a TypeClusterObject whenever its passed key is invalid for whatever reason. Such ClusterObjects will not become
               * part of the Cluster and any cluster operations will therefore fail to find it. */
@@ -73,6 +76,9 @@ namespace algo
             }
         protected:
         public:
+            typedef typename C::iterator iterator; /**< Iterator over the clustered objects, dereferencing to a (key, pointer) pair. */
+            typedef typename C::const_iterator const_iterator; /**< Const iterator over the clustered objects. */
+
             /** The constructor takes the unique key (first template argument) and a descriptive name (used for error printing) as its arguments. */
             TypeCluster(const K & e, std::string _name) : typeClusterName(_name), errorKey(e)
             {
@@ -82,7 +88,19 @@ namespace algo
               * destructors are not virtual. */
             ~TypeCluster(void)
             {
-                while(cluster.size() > 0) delete cluster.begin()->second;
+                // Collect the objects in one pass: restarting from begin() after every erase would rescan the empty slots of a hashed container.
+                // Objects whose destructor already removed another object from the cluster are skipped, and a final pass catches any added during deletion.
+                while(cluster.size() > 0)
+                {
+                    std::vector<std::pair<K,T*> > objects;
+                    objects.reserve(cluster.size());
+                    for(iterator it = cluster.begin(); it != cluster.end(); ++it) objects.push_back(std::pair<K,T*>(it->first, it->second));
+                    for(typename std::vector<std::pair<K,T*> >::const_iterator it = objects.begin(); it != objects.end(); ++it)
+                    {
+                        iterator current = cluster.find(it->first);
+                        if(current != cluster.end() && current->second == it->second) delete it->second;
+                    }
+                }
             }
 
             std::string getName(void) const { return typeClusterName; } /**< Get the name of the TypeCluster. */
@@ -90,7 +108,7 @@ namespace algo
             /** Allow deleting a member from the cluster without deleting the object itself. */
             void UnclusterObject(K _key)
             {
-                typename std::map<K,T*>::iterator _it = cluster.find(_key);
+                iterator _it = cluster.find(_key);
                 if(_it == cluster.end())
                 {
                     std::cerr << " TypeCluster::UnclusterObject() : Cannot uncluster iterator std::map::end()! "<<std::endl;
@@ -108,7 +126,7 @@ namespace algo
             {
                 if(excluster.find(key) != excluster.end())
                 {
-                    typename std::map<K,T*>::iterator it = excluster.find(key);
+                    iterator it = excluster.find(key);
                     cluster.insert(std::make_pair(it->first, it->second));
                     excluster.erase(it);
                 }
@@ -122,68 +140,68 @@ namespace algo
               * Instead, store the key and ask for the T object when it is required. */
             T * find(K key)
             {
-                typename std::map<K,T*>::iterator it = cluster.find(key);
+                iterator it = cluster.find(key);
                 return ( (it == cluster.end()) ? 0 : it->second);
             }
 
             T * operator[] (const K & key) { return find(key); }
 
             /** Signals whether the cluster is empty. */
-            bool is_empty(void)
+            bool is_empty(void) const
             {
                 return cluster.empty();
             }
 
             /** Returns the number of members in the cluster. */
-            unsigned int size(void)
+            unsigned int size(void) const
             {
                 return cluster.size();
             }
 
             /** The cluster itself is private, but you can linearly access the contents of the cluster by using the ++ operator and using the first/last iterators. */
-            typename std::map<K,T*>::iterator begin(void)
+            iterator begin(void)
             {
                 return cluster.begin();
             }
 
             /** The cluster itself is private, but you can linearly access the contents of the cluster by using the ++ operator and using the first/last iterators. */
-            typename std::map<K,T*>::iterator end(void)
+            iterator end(void)
             {
                 return cluster.end();
             }
 
             /** Give access to const iterators on the cluster. */
-            typename std::map<K,T*>::const_iterator cbegin(void) const
+            const_iterator cbegin(void) const
             {
                 return cluster.cbegin();
             }
 
             /** Give access to const iterators on the cluster. */
-            typename std::map<K,T*>::const_iterator cend(void) const
+            const_iterator cend(void) const
             {
                 return cluster.cend();
             }
 
             /** Gives the cluster's lower bound using the provided key. Uses std::map::lower_bound(). */
-            typename std::map<K,T*>::iterator lower_bound(K & key)
+            iterator lower_bound(K & key)
             {
                 return cluster.lower_bound(key);
             }
 
             /** Gives the cluster's upper bound using the provided key. Uses std::map::upper_bound(). */
-            typename std::map<K,T*>::iterator upper_bound(K & key)
+            iterator upper_bound(K & key)
             {
                 return cluster.upper_bound(key);
             }
     };
 
     /** The base class for objects to be clustered. Deriving from this class should be done in the CRTP way, i.e. class A : public TypeClusterObject<K,A>. */
-    template <class K, class T> class TypeClusterObject
+    template <class K, class T, class C = std::map<K,T*> > class TypeClusterObject
     {
         private:
             K key; /**< A unique key that is used to identify the element it is associated to. */
             T * elt; /**< Pointer to the element that is being clustered - essentially 'this' but then the derived class. */
-            TypeCluster<K,T> & typeCluster; /**< Reference to the TypeCluster class that controls the TypeClusterObject's. */
+            TypeCluster<K,T,C> & typeCluster; /**< Reference to the TypeCluster class that controls the TypeClusterObject's. */
 
             TypeClusterObject(const TypeClusterObject &); /**< NO copy construction - it should not be necessary and unintended copy construction will likely cause fatal errors or memory leakage. */
 
@@ -196,7 +214,7 @@ namespace algo
             }
 
             /** Constructor. Add ourselves to the TypeCluster. */
-            TypeClusterObject(K _key, T * derivedObject, TypeCluster<K,T> & tc) : key(_key), elt(derivedObject), typeCluster(tc)
+            TypeClusterObject(K _key, T * derivedObject, TypeCluster<K,T,C> & tc) : key(_key), elt(derivedObject), typeCluster(tc)
             {
                 if(!typeCluster.subscribe(key,elt))
                 {
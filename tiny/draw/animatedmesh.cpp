@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::draw;
 
 AnimatedMeshVertexBufferInterpreter::AnimatedMeshVertexBufferInterpreter(const tiny::mesh::AnimatedMesh &mesh) :
-    VertexBufferInterpreter<tiny::mesh::AnimatedMeshVertex>(mesh.vertices.begin(), mesh.vertices.end())
+    VertexBufferInterpreter<tiny::mesh::AnimatedMeshVertex>(mesh.vertices.begin(), mesh.vertices.end(), bf::dropHostData)
 {
     addVec2Attribute(0*sizeof(float), "v_textureCoordinate");
     addVec3Attribute(2*sizeof(float), "v_tangent");
@@ -35,7 +35,7 @@ AnimatedMeshVertexBufferInterpreter::~AnimatedMeshVertexBufferInterpreter()
 }
 
 AnimatedMeshIndexBuffer::AnimatedMeshIndexBuffer(const tiny::mesh::AnimatedMesh &mesh) :
-    IndexBuffer<unsigned int>(mesh.indices.begin(), mesh.indices.end())
+    IndexBuffer<unsigned int>(mesh.indices.begin(), mesh.indices.end(), bf::dropHostData)
 {
 
 }
@@ -174,8 +174,8 @@ std::string AnimatedMesh::getFragmentShaderCode() const
 
 void AnimatedMesh::render(const ShaderProgram &program) const
 {
-    vertices.bind(program);
+    if (vertexArrays.bind(program, vertices)) vertices.bind(program);
     renderIndicesAsTriangles(indices);
-    vertices.unbind(program);
+    vertexArrays.unbind();
 }
 
@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::draw;
 
 AnimatedMeshInstanceVertexBufferInterpreter::AnimatedMeshInstanceVertexBufferInterpreter(const size_t &nrMeshes) :
-    VertexBufferInterpreter<AnimatedMeshInstance>(nrMeshes)
+    StreamingVertexBufferInterpreter<AnimatedMeshInstance>(nrMeshes)
 {
     addVec4Attribute(0*sizeof(float), "v_positionAndSize");
     addVec4Attribute(4*sizeof(float), "v_orientation");
@@ -145,10 +145,14 @@ std::string AnimatedMeshHorde::getFragmentShaderCode() const
 
 void AnimatedMeshHorde::render(const ShaderProgram &program) const
 {
-    vertices.bind(program);
-    meshes.bind(program, 1);
+    if (vertexArrays.bind(program, vertices, &meshes))
+    {
+        vertices.bind(program);
+        meshes.bind(program, 1);
+    }
+    
     renderIndicesAsTrianglesInstanced(indices, nrMeshes);
-    meshes.unbind(program);
-    vertices.unbind(program);
+    vertexArrays.unbind();
+    meshes.fence();
 }
 
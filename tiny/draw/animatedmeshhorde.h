@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/indexbuffer.h>
 #include <tiny/draw/vertexbuffer.h>
 #include <tiny/draw/vertexbufferinterpreter.h>
+#include <tiny/draw/streamingvertexbufferinterpreter.h>
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/animatedmesh.h>
 
@@ -57,7 +58,7 @@ struct AnimatedMeshInstance
     ivec2 animationFrames;
 };
 
-class AnimatedMeshInstanceVertexBufferInterpreter : public VertexBufferInterpreter<AnimatedMeshInstance>
+class AnimatedMeshInstanceVertexBufferInterpreter : public StreamingVertexBufferInterpreter<AnimatedMeshInstance>
 {
     public:
         AnimatedMeshInstanceVertexBufferInterpreter(const size_t &);
@@ -94,14 +95,27 @@ class AnimatedMeshHorde : public Renderable
         template <typename Iterator>
         void setInstances(Iterator first, Iterator last)
         {
-            nrMeshes = 0;
+            AnimatedMeshInstance *instances = mapInstances();
+            size_t count = 0;
             
-            for (Iterator i = first; i != last && nrMeshes < maxNrMeshes; ++i)
+            for (Iterator i = first; i != last && count < maxNrMeshes; ++i)
             {
-                meshes[nrMeshes++] = *i;
+                instances[count++] = *i;
             }
             
-            meshes.sendToDevice();
+            unmapInstances(count);
+        }
+        
+        /** Returns memory to which up to maxNrMeshes instances can be written directly, these are shown after calling unmapInstances() with the number of instances written. */
+        AnimatedMeshInstance *mapInstances()
+        {
+            return meshes.map();
+        }
+        
+        void unmapInstances(const size_t &count)
+        {
+            nrMeshes = (count < maxNrMeshes ? count : maxNrMeshes);
+            meshes.unmap(nrMeshes);
         }
         
         std::string getVertexShaderCode() const;
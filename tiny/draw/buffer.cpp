@@ -18,11 +18,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace tiny::draw;
 
-BufferInterface::BufferInterface(const size_t &a_sizeInBytes, const GLenum &a_target, const GLenum &a_usage) :
+BufferInterface::BufferInterface(const size_t &a_sizeInBytes, const GLenum &a_target, const GLenum &a_usage, const unsigned int &a_flags) :
     sizeInBytes(0),
     target(a_target),
     usage(a_usage),
-    bufferIndex(0)
+    flags(a_flags),
+    bufferIndex(0),
+    deviceIdentifier(0)
 {
     resizeDeviceBuffer(a_sizeInBytes);
 }
@@ -31,7 +33,9 @@ BufferInterface::BufferInterface(const BufferInterface &a_buffer) :
     sizeInBytes(0),
     target(a_buffer.target),
     usage(a_buffer.usage),
-    bufferIndex(0)
+    flags(a_buffer.flags),
+    bufferIndex(0),
+    deviceIdentifier(0)
 {
     resizeDeviceBuffer(a_buffer.sizeInBytes);
 }
@@ -46,6 +50,11 @@ GLuint BufferInterface::getIndex() const
     return bufferIndex;
 }
 
+unsigned int BufferInterface::getDeviceIdentifier() const
+{
+    return deviceIdentifier;
+}
+
 void BufferInterface::bind() const
 {
     GL_CHECK(glBindBuffer(target, bufferIndex));
@@ -62,15 +71,22 @@ void BufferInterface::createDeviceBuffer()
     
     if (bufferIndex == 0)
         throw std::bad_alloc();
+    
+    deviceIdentifier = acquireDeviceIdentifier();
 }
 
 void BufferInterface::destroyDeviceBuffer()
 {
     //Frees all data bound to this class on the device.
-    if (bufferIndex != 0) GL_CHECK(glDeleteBuffers(1, &bufferIndex));
+    if (bufferIndex != 0)
+    {
+        GL_CHECK(glDeleteBuffers(1, &bufferIndex));
+        releaseDeviceIdentifier(deviceIdentifier);
+    }
     
     sizeInBytes = 0;
     bufferIndex = 0;
+    deviceIdentifier = 0;
 }
 
 void BufferInterface::resizeDeviceBuffer(const size_t &a_sizeInBytes)
@@ -96,3 +112,30 @@ void BufferInterface::resizeDeviceBuffer(const size_t &a_sizeInBytes)
     GL_CHECK(glBindBuffer(target, 0));
 }
 
+std::set<unsigned int> &BufferInterface::deviceIdentifiersInUse()
+{
+    static std::set<unsigned int> identifiers;
+    
+    return identifiers;
+}
+
+unsigned int BufferInterface::acquireDeviceIdentifier()
+{
+    static unsigned int lastDeviceIdentifier = 0;
+    
+    deviceIdentifiersInUse().insert(++lastDeviceIdentifier);
+    
+    return lastDeviceIdentifier;
+}
+
+void BufferInterface::releaseDeviceIdentifier(const unsigned int &identifier)
+{
+    deviceIdentifiersInUse().erase(identifier);
+}
+
+bool BufferInterface::isDeviceIdentifierInUse(const unsigned int &identifier)
+{
+    //Returns false once the device buffer with this identifier has been deleted, such that caches can drop their entries.
+    return deviceIdentifiersInUse().count(identifier) > 0;
+}
+
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <exception>
 #include <vector>
+#include <set>
 
 #include <cassert>
 
@@ -33,26 +34,48 @@ namespace tiny
 namespace draw
 {
 
+namespace bf
+{
+
+//Buffer flags for the residency of the host copy of the buffer data, which is kept for the lifetime of the buffer by default.
+const unsigned int none         = 0x0000;
+const unsigned int dropHostData = 0x0001; //Free the host data after each upload to the device, reading back from the device is not allowed.
+const unsigned int hostOnDemand = 0x0002; //Only allocate host data when it is needed for an upload or a readback, and free it after each upload.
+
+} //namespace bf
+
 class BufferInterface
 {
     public:
-        BufferInterface(const size_t &a_sizeInBytes, const GLenum &a_target, const GLenum &a_usage);
+        BufferInterface(const size_t &a_sizeInBytes, const GLenum &a_target, const GLenum &a_usage, const unsigned int &a_flags = bf::none);
         BufferInterface(const BufferInterface &a_buffer);
         virtual ~BufferInterface();
         
         GLuint getIndex() const;
+        unsigned int getDeviceIdentifier() const;
         void bind() const;
         void unbind() const;
         
+        static bool isDeviceIdentifierInUse(const unsigned int &);
+        
     protected:
         void createDeviceBuffer();
         void destroyDeviceBuffer();
         void resizeDeviceBuffer(const size_t &a_sizeInBytes);
         
+        static unsigned int acquireDeviceIdentifier();
+        static void releaseDeviceIdentifier(const unsigned int &);
+        
         size_t sizeInBytes;
         const GLenum target;
         const GLenum usage;
+        const unsigned int flags;
         GLuint bufferIndex;
+        
+        //Unique identifier of the current device buffer, OpenGL may reuse buffer indices after deletion.
+        unsigned int deviceIdentifier;        
+    private:
+        static std::set<unsigned int> &deviceIdentifiersInUse();
 };
 
 /*! \p Buffer : data buffer on an OpenGL device.
@@ -63,11 +86,11 @@ template<typename T>
 class Buffer : public BufferInterface
 {
     public:
-        Buffer(const size_t &a_size, const GLenum &a_target, const GLenum &a_usage) :
-            BufferInterface(a_size*sizeof(T), a_target, a_usage),
-            hostData(a_size)
+        Buffer(const size_t &a_size, const GLenum &a_target, const GLenum &a_usage, const unsigned int &a_flags = bf::none) :
+            BufferInterface(a_size*sizeof(T), a_target, a_usage, a_flags),
+            hostData((a_flags & bf::hostOnDemand) != 0 ? 0 : a_size)
         {
-            if (hostData.empty())
+            if (a_size == 0)
                 throw std::bad_alloc();
         }
         
@@ -75,12 +98,27 @@ class Buffer : public BufferInterface
             BufferInterface(a_buffer),
             hostData(a_buffer.hostData)
         {
+            //The device data is not copied directly, so the source buffer has to keep its host data or allow it to be read back.
+            if (hostData.empty() && sizeInBytes != 0)
+            {
+                if ((flags & bf::hostOnDemand) == 0)
+                {
+                    std::cerr << "Unable to copy buffer " << a_buffer.bufferIndex << " because its host data has been dropped!" << std::endl;
+                    throw std::exception();
+                }
+                
+                hostData.resize(size());
+                GL_CHECK(glBindBuffer(target, a_buffer.bufferIndex));
+                GL_CHECK(glGetBufferSubData(target, 0, sizeInBytes, &hostData[0]));
+                GL_CHECK(glBindBuffer(target, 0));
+            }
+            
             sendToDevice();
         }
         
         template<typename Iterator>
-        Buffer(Iterator first, Iterator last, const GLenum &a_target, const GLenum &a_usage) :
-            BufferInterface((last - first)*sizeof(T), a_target, a_usage),
+        Buffer(Iterator first, Iterator last, const GLenum &a_target, const GLenum &a_usage, const unsigned int &a_flags = bf::none) :
+            BufferInterface((last - first)*sizeof(T), a_target, a_usage, a_flags),
             hostData(first, last)
         {
             sendToDevice();
@@ -91,25 +129,62 @@ class Buffer : public BufferInterface
             
         }
         
-        void sendToDevice() const
+        /**
+         * Uploads the host data to the device.
+         * For buffers with the bf::dropHostData or bf::hostOnDemand flag, the host data is freed afterwards.
+         */
+        void sendToDevice()
         {
-            assert(hostData.size()*sizeof(T) == sizeInBytes);
-            
             if (hostData.empty()) return;
             
+            assert(hostData.size()*sizeof(T) == sizeInBytes);
+            
             GL_CHECK(glBindBuffer(target, bufferIndex));
             GL_CHECK(glBufferSubData(target, 0, sizeInBytes, &hostData[0]));
             GL_CHECK(glBindBuffer(target, 0));
+            
+            if ((flags & (bf::dropHostData | bf::hostOnDemand)) != 0) std::vector<T>().swap(hostData);
+        }
+        
+        /**
+         * Reads the device data back into the host data.
+         */
+        void getFromDevice()
+        {
+            if (sizeInBytes == 0) return;
+            
+            if (hostData.empty())
+            {
+                if ((flags & bf::dropHostData) != 0)
+                {
+                    std::cerr << "Buffer " << bufferIndex << " does not keep host data, use bf::hostOnDemand to read it back from the device!" << std::endl;
+                    throw std::exception();
+                }
+                
+                hostData.resize(size());
+            }
+            
+            GL_CHECK(glBindBuffer(target, bufferIndex));
+            GL_CHECK(glGetBufferSubData(target, 0, sizeInBytes, &hostData[0]));
+            GL_CHECK(glBindBuffer(target, 0));
         }
         
         bool empty() const
         {
-            return (hostData.empty() || sizeInBytes == 0);
+            return (sizeInBytes == 0);
         }
         
         size_t size() const
         {
-            return hostData.size();
+            return sizeInBytes/sizeof(T);
+        }
+        
+        /**
+         * Returns whether the host copy of the buffer data is currently available.
+         */
+        bool hasHostData() const
+        {
+            return !hostData.empty();
         }
         
         void resize(const size_t &a_size)
@@ -135,35 +210,50 @@ class Buffer : public BufferInterface
         
         T & operator [] (const size_t &a_index)
         {
+            requireHostData();
             return hostData[a_index];
         }
         
         const T & operator [] (const size_t &a_index) const
         {
+            requireHostData();
             return hostData[a_index];
         }
         
         typename std::vector<T>::iterator begin()
         {
+            requireHostData();
             return hostData.begin();
         }
         
         typename std::vector<T>::const_iterator begin() const
         {
+            requireHostData();
             return hostData.begin();
         }
         
         typename std::vector<T>::iterator end()
         {
+            requireHostData();
             return hostData.end();
         }
         
         typename std::vector<T>::const_iterator end() const
         {
+            requireHostData();
             return hostData.end();
         }
         
     protected:
+        void requireHostData() const
+        {
+            if (hostData.empty() && sizeInBytes != 0)
+            {
+                std::cerr << "The host data of buffer " << bufferIndex << " is not available!" << std::endl;
+                throw std::exception();
+            }
+        }
+        
         std::vector<T> hostData;
 };
 
@@ -80,9 +80,9 @@ std::string ComputeTextureInput::getFragmentShaderCode() const
 void ComputeTextureInput::render(const ShaderProgram &program) const
 {
     //Draw screen-filling quad.
-    square.bind(program);
+    if (vertexArrays.bind(program, square)) square.bind(program);
     renderRangeAsTriangleStrip(0, 4);
-    square.unbind(program);
+    vertexArrays.unbind();
 }
 
 ComputeTextureOutput::ComputeTextureOutput(const std::vector<std::string> &outputNames) :
@@ -99,6 +99,14 @@ ComputeTextureOutput::~ComputeTextureOutput()
 
 }
 
+void ComputeTextureOutput::generateMipmaps() const
+{
+    for (std::map<std::string, const TextureInterface *>::const_iterator i = outputTextures.begin(); i != outputTextures.end(); ++i)
+    {
+        i->second->generateMipmaps();
+    }
+}
+
 ComputeTexture::ComputeTexture(const std::vector<std::string> &inputNames, const std::vector<std::string> &outputNames, const std::string &fragmentShaderCode) :
     input(inputNames, fragmentShaderCode),
     output(outputNames)
@@ -113,7 +121,30 @@ ComputeTexture::~ComputeTexture()
 
 void ComputeTexture::compute() const
 {
+    //Only the first level of the outputs is written, so update the other mipmap levels afterwards.
     output.render();
+    output.generateMipmaps();
+}
+
+void ComputeTexture::compute(const std::vector<ivec4> &regions) const
+{
+    //Only write the texels inside the rectangles (x, y, width, height), the rest of the outputs keeps its contents. An empty list computes the entire outputs.
+    if (regions.empty())
+    {
+        compute();
+        return;
+    }
+    
+    GL_CHECK(glEnable(GL_SCISSOR_TEST));
+    
+    for (std::vector<ivec4>::const_iterator i = regions.begin(); i != regions.end(); ++i)
+    {
+        GL_CHECK(glScissor(i->x, i->y, i->z, i->w));
+        output.render();
+    }
+    
+    GL_CHECK(glDisable(GL_SCISSOR_TEST));
+    output.generateMipmaps();
 }
 
 UniformMap &ComputeTexture::uniformMap()
@@ -121,3 +152,34 @@ UniformMap &ComputeTexture::uniformMap()
     return input.uniformMap;
 }
 
+std::map<std::string, ComputeTexture *> ComputeTexture::kernels = std::map<std::string, ComputeTexture *>();
+
+ComputeTexture *ComputeTexture::getKernel(const std::vector<std::string> &inputNames, const std::vector<std::string> &outputNames, const std::string &fragmentShaderCode)
+{
+    //Returns a compute texture owned by the cache, all inputs, outputs, and uniforms should be set before each computation.
+    std::string key = fragmentShaderCode;
+    
+    for (std::vector<std::string>::const_iterator i = inputNames.begin(); i != inputNames.end(); ++i) key += "\n<" + *i;
+    for (std::vector<std::string>::const_iterator i = outputNames.begin(); i != outputNames.end(); ++i) key += "\n>" + *i;
+    
+    std::map<std::string, ComputeTexture *>::iterator i = kernels.find(key);
+    
+    if (i == kernels.end())
+    {
+        i = kernels.insert(std::make_pair(key, new ComputeTexture(inputNames, outputNames, fragmentShaderCode))).first;
+    }
+    
+    return i->second;
+}
+
+void ComputeTexture::clearKernels()
+{
+    //Should be called while the OpenGL context still exists.
+    for (std::map<std::string, ComputeTexture *>::iterator i = kernels.begin(); i != kernels.end(); ++i)
+    {
+        delete i->second;
+    }
+    
+    kernels.clear();
+}
+
@@ -103,7 +103,13 @@ class ComputeTextureOutput : public Renderer
         void setOutput(const TextureType &texture, const std::string &name)
         {
             setTextureTarget(texture, name);
+            outputTextures[name] = &texture;
         }
+        
+        void generateMipmaps() const;
+        
+    private:
+        std::map<std::string, const TextureInterface *> outputTextures;
 };
 
 class ComputeTexture
@@ -127,8 +133,12 @@ class ComputeTexture
         }
         
         void compute() const;
+        void compute(const std::vector<ivec4> &) const;
         UniformMap &uniformMap();
         
+        static ComputeTexture *getKernel(const std::vector<std::string> &inputNames, const std::vector<std::string> &outputNames, const std::string &fragmentShaderCode);
+        static void clearKernels();
+        
     protected:
         void addInput(const std::string &);
         void addOutput(const std::string &);
@@ -136,6 +146,9 @@ class ComputeTexture
     private:
         ComputeTextureInput input;
         ComputeTextureOutput output;
+        
+        //Compute textures that are shared by all callers with the same inputs, outputs, and shader code, such that each shader is only compiled once.
+        static std::map<std::string, ComputeTexture *> kernels;
 };
 
 }
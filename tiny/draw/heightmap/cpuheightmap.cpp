@@ -0,0 +1,568 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <tiny/draw/heightmap/cpuheightmap.h>
+
+using namespace tiny;
+using namespace tiny::draw;
+using namespace tiny::draw::cpu;
+
+namespace
+{
+
+//Number of rows of an image that are processed by a single job.
+const int rowsPerJob = 32;
+
+/** Returns the texel that is sampled at integer coordinate x, which repeats or is clamped to the edge outside [0, size). */
+inline int wrapTexel(const int &x, const int &size, const bool &repeat)
+{
+    if (x >= 0 && x < size) return x;
+    if (repeat) return ((x % size) + size) % size;
+    return (x < 0 ? 0 : size - 1);
+}
+
+/** Converts a colour component to an unsigned char, like writing it to an 8-bit render target. */
+inline unsigned char toUnsignedChar(const float &a)
+{
+    return static_cast<unsigned char>(static_cast<int>(std::min(std::max(a, 0.0f), 1.0f)*255.0f + 0.5f));
+}
+
+/** Writes the normalised direction (x, y, z) as a colour 0.5*(n + 1). */
+inline float storeDirection(const float &x, const float &y, const float &z, unsigned char *out)
+{
+    const float inverseLength = 1.0f/std::sqrt(x*x + y*y + z*z);
+    
+    out[0] = toUnsignedChar(0.5f*(x*inverseLength + 1.0f));
+    out[1] = toUnsignedChar(0.5f*(y*inverseLength + 1.0f));
+    out[2] = toUnsignedChar(0.5f*(z*inverseLength + 1.0f));
+    
+    return inverseLength;
+}
+
+#ifdef TINY_SIMD_SSE
+/** Converts four colour components to unsigned chars, identical to toUnsignedChar(). */
+inline __m128i toUnsignedChars(const __m128 &a)
+{
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+/** Writes four normalised directions as colours, identical to storeDirection(). */
+inline __m128 storeDirections(const __m128 &x, const __m128 &y, const __m128 &z, unsigned char *out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+    int c[3][4];
+    
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c[0]), toUnsignedChars(_mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(x, inverseLength), one))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c[1]), toUnsignedChars(_mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(y, inverseLength), one))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c[2]), toUnsignedChars(_mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(z, inverseLength), one))));
+    
+    for (int i = 0; i < 4; ++i)
+    {
+        out[3*i + 0] = static_cast<unsigned char>(c[0][i]);
+        out[3*i + 1] = static_cast<unsigned char>(c[1][i]);
+        out[3*i + 2] = static_cast<unsigned char>(c[2][i]);
+    }
+    
+    return inverseLength;
+}
+#endif
+
+/** Random displacement in [-0.25, 0.25) for texel (x, y), which only depends on the texel and the seed. */
+inline float getRandomDisplacement(const int &x, const int &y, const unsigned int &seed)
+{
+    unsigned int h = (static_cast<unsigned int>(x)*0x85ebca6bu) ^ (static_cast<unsigned int>(y)*0xc2b2ae35u) ^ (seed*0x9e3779b9u);
+    
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    
+    return 0.5f*(static_cast<float>(h >> 8)/16777216.0f) - 0.25f;
+}
+
+void checkSizes(const size_t &sourceWidth, const size_t &sourceHeight, const size_t &destWidth, const size_t &destHeight)
+{
+    if (sourceWidth != destWidth || sourceHeight != destHeight)
+    {
+        std::cerr << "The " << destWidth << "x" << destHeight << " destination should have the same size as the " << sourceWidth << "x" << sourceHeight << " source image!" << std::endl;
+        throw std::exception();
+    }
+}
+
+/** Copies a range of rows from one image to another. */
+class CopyJob
+{
+    public:
+        CopyJob(const FloatImage &a_source, FloatImage &a_dest) :
+            source(a_source),
+            dest(a_dest)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const size_t width = source.getWidth();
+            
+            memcpy(&dest[width*first], &source[width*first], width*(last - first)*sizeof(float));
+        }
+        
+    private:
+        const FloatImage &source;
+        FloatImage &dest;
+};
+
+/** Diamond step of the diamond-square algorithm: refines the midpoints of the edges between the corners of the current step.
+ *  Every lattice row r corresponds to row r*step of the image.
+ *  Midpoints only read corners and themselves, which are not modified by this step, so all rows can be refined in place and in parallel.
+ */
+class DiamondJob
+{
+    public:
+        DiamondJob(FloatImage &a_heightMap, const int &a_step, const float &a_amplitude, const unsigned int &a_seed) :
+            heightMap(a_heightMap),
+            width(a_heightMap.getWidth()),
+            height(a_heightMap.getHeight()),
+            step(a_step),
+            amplitude(a_amplitude),
+            seed(a_seed)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const bool repeat = heightMap.isRepeating();
+            
+            for (int y = first*step; y < last*step && y < height; y += step)
+            {
+                float *row = &heightMap[width*y];
+                
+                if ((y & (2*step - 1)) == 0)
+                {
+                    //Midpoints of the horizontal edges.
+                    for (int x = step; x < width; x += 2*step)
+                    {
+                        const float h1 = row[x - step];
+                        const float h2 = row[wrapTexel(x + step, width, repeat)];
+                        
+                        row[x] = 0.5f*(h1 + h2) + amplitude*(0.5f + std::fabs(h2 - h1))*getRandomDisplacement(x, y, seed);
+                    }
+                }
+                else
+                {
+                    //Midpoints of the vertical edges.
+                    const float *row1 = &heightMap[width*(y - step)];
+                    const float *row2 = &heightMap[width*wrapTexel(y + step, height, repeat)];
+                    
+                    for (int x = 0; x < width; x += 2*step)
+                    {
+                        const float h1 = row1[x];
+                        const float h2 = row2[x];
+                        
+                        row[x] = 0.5f*(h1 + h2) + amplitude*(0.5f + std::fabs(h2 - h1))*getRandomDisplacement(x, y, seed);
+                    }
+                }
+            }
+        }
+        
+    private:
+        FloatImage &heightMap;
+        const int width;
+        const int height;
+        const int step;
+        const float amplitude;
+        const unsigned int seed;
+};
+
+/** Square step of the diamond-square algorithm: refines the centres of the squares of the current step, which only read edge midpoints and themselves. */
+class SquareJob
+{
+    public:
+        SquareJob(FloatImage &a_heightMap, const int &a_step, const float &a_amplitude, const unsigned int &a_seed) :
+            heightMap(a_heightMap),
+            width(a_heightMap.getWidth()),
+            height(a_heightMap.getHeight()),
+            step(a_step),
+            amplitude(a_amplitude),
+            seed(a_seed)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const bool repeat = heightMap.isRepeating();
+            
+            for (int y = first*step; y < last*step && y < height; y += step)
+            {
+                if ((y & (2*step - 1)) == 0) continue;
+                
+                float *row = &heightMap[width*y];
+                const float *row3 = &heightMap[width*(y - step)];
+                const float *row4 = &heightMap[width*wrapTexel(y + step, height, repeat)];
+                
+                for (int x = step; x < width; x += 2*step)
+                {
+                    const float h1 = row[x - step];
+                    const float h2 = row[wrapTexel(x + step, width, repeat)];
+                    const float h3 = row3[x];
+                    const float h4 = row4[x];
+                    
+                    row[x] = 0.25f*(h1 + h2 + h3 + h4) + amplitude*(0.5f + std::fabs(std::max(h2 - h1, h4 - h3)))*getRandomDisplacement(x, y, seed);
+                }
+            }
+        }
+        
+    private:
+        FloatImage &heightMap;
+        const int width;
+        const int height;
+        const int step;
+        const float amplitude;
+        const unsigned int seed;
+};
+
+/** Computes any combination of the tangent, normal, and slope colour maps from the four neighbours of every texel. */
+class SurfaceMapJob
+{
+    public:
+        SurfaceMapJob(const FloatImage &a_heightMap, const float &a_mapScale, RGBImage *a_tangentMap, RGBImage *a_normalMap, RGBAImage *a_colourMap) :
+            heightMap(a_heightMap),
+            width(a_heightMap.getWidth()),
+            height(a_heightMap.getHeight()),
+            mapScale(2.0f*a_mapScale),
+            tangentMap(a_tangentMap),
+            normalMap(a_normalMap),
+            colourMap(a_colourMap)
+        {
+            //Rock, mud, and grass.
+            const float colours[3][4] = {{0.6f, 0.6f, 0.6f, 1.0f}, {0.4f, 0.2f, 0.1f, 1.0f}, {0.2f, 0.5f, 0.1f, 1.0f}};
+            
+            for (int i = 0; i < 3; ++i)
+            {
+                for (int j = 0; j < 4; ++j) slopeColours[i][j] = toUnsignedChar(colours[i][j]);
+            }
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const bool repeat = heightMap.isRepeating();
+            
+            for (int y = first; y < last; ++y)
+            {
+                const float *row = &heightMap[width*y];
+                const float *northRow = &heightMap[width*wrapTexel(y + 1, height, repeat)];
+                const float *southRow = &heightMap[width*wrapTexel(y - 1, height, repeat)];
+                int x = 0;
+                
+                computeTexel(row, northRow, southRow, width*y, x++, repeat);
+
+#ifdef TINY_SIMD_SSE
+                const __m128 scale = _mm_set1_ps(mapScale);
+                
+                //Interior texels have both horizontal neighbours in the same row.
+                for ( ; x + 4 <= width - 1; x += 4)
+                {
+                    const __m128 east = _mm_loadu_ps(row + x + 1);
+                    const __m128 west = _mm_loadu_ps(row + x - 1);
+                    const __m128 north = _mm_loadu_ps(northRow + x);
+                    const __m128 south = _mm_loadu_ps(southRow + x);
+                    const size_t index = width*y + x;
+                    
+                    if (tangentMap) storeDirections(scale, _mm_sub_ps(east, west), _mm_setzero_ps(), &(*tangentMap)[3*index]);
+                    
+                    if (normalMap || colourMap)
+                    {
+                        unsigned char normals[12];
+                        const __m128 inverseLength = storeDirections(_mm_sub_ps(west, east), scale, _mm_sub_ps(south, north), normalMap ? &(*normalMap)[3*index] : normals);
+                        
+                        if (colourMap)
+                        {
+                            float normalY[4];
+                            
+                            _mm_storeu_ps(normalY, _mm_mul_ps(scale, inverseLength));
+                            for (int i = 0; i < 4; ++i) storeColour(normalY[i], &(*colourMap)[4*(index + i)]);
+                        }
+                    }
+                }
+#endif
+
+                for ( ; x < width; ++x)
+                {
+                    computeTexel(row, northRow, southRow, width*y, x, repeat);
+                }
+            }
+        }
+        
+    private:
+        void computeTexel(const float *row, const float *northRow, const float *southRow, const size_t &rowIndex, const int &x, const bool &repeat) const
+        {
+            const float east = row[wrapTexel(x + 1, width, repeat)];
+            const float west = row[wrapTexel(x - 1, width, repeat)];
+            const float north = northRow[x];
+            const float south = southRow[x];
+            const size_t index = rowIndex + x;
+            
+            if (tangentMap) storeDirection(mapScale, east - west, 0.0f, &(*tangentMap)[3*index]);
+            
+            if (normalMap || colourMap)
+            {
+                unsigned char normal[3];
+                const float inverseLength = storeDirection(west - east, mapScale, south - north, normalMap ? &(*normalMap)[3*index] : normal);
+                
+                if (colourMap) storeColour(mapScale*inverseLength, &(*colourMap)[4*index]);
+            }
+        }
+        
+        void storeColour(const float &normalY, unsigned char *out) const
+        {
+            const unsigned char *colour = slopeColours[normalY < 0.5f ? 0 : (normalY < 0.9f ? 1 : 2)];
+            
+            out[0] = colour[0];
+            out[1] = colour[1];
+            out[2] = colour[2];
+            out[3] = colour[3];
+        }
+        
+        const FloatImage &heightMap;
+        const int width;
+        const int height;
+        const float mapScale;
+        RGBImage *tangentMap;
+        RGBImage *normalMap;
+        RGBAImage *colourMap;
+        unsigned char slopeColours[3][4];
+};
+
+/** Multiplies and offsets the heights of a range of rows. */
+class ScaleJob
+{
+    public:
+        ScaleJob(const FloatImage &a_source, FloatImage &a_dest, const float &a_scale, const float &a_add) :
+            source(a_source),
+            dest(a_dest),
+            width(a_source.getWidth()),
+            scale(a_scale),
+            add(a_add)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const float *in = &source[width*first];
+            float *out = &dest[width*first];
+            const size_t n = width*(last - first);
+            size_t i = 0;
+
+#ifdef TINY_SIMD_SSE
+            const __m128 scale4 = _mm_set1_ps(scale);
+            const __m128 add4 = _mm_set1_ps(add);
+            
+            for ( ; i + 4 <= n; i += 4)
+            {
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale4), add4));
+            }
+#endif
+
+            for ( ; i < n; ++i)
+            {
+                out[i] = in[i]*scale + add;
+            }
+        }
+        
+    private:
+        const FloatImage &source;
+        FloatImage &dest;
+        const size_t width;
+        const float scale;
+        const float add;
+};
+
+/** Position of a destination texel in the source image: the two texels that are interpolated and the weight of the second one. */
+struct ResizeSample
+{
+    int texel0;
+    int texel1;
+    float weight;
+};
+
+void getResizeSamples(std::vector<ResizeSample> &samples, const int &destSize, const int &sourceSize, const bool &repeat, const float &scale, const float &add)
+{
+    samples.resize(destSize);
+    
+    for (int i = 0; i < destSize; ++i)
+    {
+        //Texture coordinate of the destination texel centre in texels of the source image.
+        const float t = ((static_cast<float>(i) + 0.5f)/static_cast<float>(destSize)*scale + add)*static_cast<float>(sourceSize) - 0.5f;
+        const float ft = std::floor(t);
+        const int it = static_cast<int>(ft);
+        
+        samples[i].texel0 = wrapTexel(it, sourceSize, repeat);
+        samples[i].texel1 = wrapTexel(it + 1, sourceSize, repeat);
+        samples[i].weight = t - ft;
+    }
+}
+
+/** Bilinearly samples the source image for a range of destination rows. */
+class ResizeJob
+{
+    public:
+        ResizeJob(const FloatImage &a_source, FloatImage &a_dest, const std::vector<ResizeSample> &a_columns, const std::vector<ResizeSample> &a_rows) :
+            source(a_source),
+            dest(a_dest),
+            columns(a_columns),
+            rows(a_rows)
+        {
+
+        }
+        
+        void operator () (const int &first, const int &last) const
+        {
+            const size_t sourceWidth = source.getWidth();
+            const size_t destWidth = dest.getWidth();
+            
+            for (int y = first; y < last; ++y)
+            {
+                const float *row0 = &source[sourceWidth*rows[y].texel0];
+                const float *row1 = &source[sourceWidth*rows[y].texel1];
+                const float wy = rows[y].weight;
+                float *out = &dest[destWidth*y];
+                
+                for (size_t x = 0; x < destWidth; ++x)
+                {
+                    const ResizeSample &c = columns[x];
+                    const float h0 = (1.0f - c.weight)*row0[c.texel0] + c.weight*row0[c.texel1];
+                    const float h1 = (1.0f - c.weight)*row1[c.texel0] + c.weight*row1[c.texel1];
+                    
+                    out[x] = (1.0f - wy)*h0 + wy*h1;
+                }
+            }
+        }
+        
+    private:
+        const FloatImage &source;
+        FloatImage &dest;
+        const std::vector<ResizeSample> &columns;
+        const std::vector<ResizeSample> &rows;
+};
+
+}
+
+void tiny::draw::cpu::computeDiamondSquareRefinement(os::ThreadPool &pool, const FloatImage &source, FloatImage &dest, const size_t &stepSize, const float &amplitude, const unsigned int &seed)
+{
+    if (stepSize >= source.getWidth() || stepSize >= source.getHeight() || stepSize <= 1 || (stepSize & (stepSize - 1)) != 0)
+    {
+        std::cerr << "Invalid step size " << stepSize << " for diamond square algorithm on a " << source.getWidth() << "x" << source.getHeight() << " height map. Should be a power of two." << std::endl;
+        throw std::exception();
+    }
+    
+    checkSizes(source.getWidth(), source.getHeight(), dest.getWidth(), dest.getHeight());
+    
+    if (&dest != &source)
+    {
+        CopyJob copyJob(source, dest);
+        
+        pool.parallelFor(source.getHeight(), rowsPerJob, copyJob);
+    }
+    
+    //Every texel is refined at most once, so the whole refinement can be done in place.
+    for (int step = stepSize/2; step >= 1; step >>= 1)
+    {
+        const int nrLatticeRows = (dest.getHeight() + step - 1)/step;
+        DiamondJob diamondJob(dest, step, amplitude, seed);
+        SquareJob squareJob(dest, step, amplitude, seed);
+        
+        pool.parallelFor(nrLatticeRows, rowsPerJob, diamondJob);
+        pool.parallelFor(nrLatticeRows, rowsPerJob, squareJob);
+    }
+}
+
+void tiny::draw::cpu::computeNormalMap(os::ThreadPool &pool, const FloatImage &heightMap, RGBImage &normalMap, const float &mapScale)
+{
+    checkSizes(heightMap.getWidth(), heightMap.getHeight(), normalMap.getWidth(), normalMap.getHeight());
+    
+    SurfaceMapJob job(heightMap, mapScale, 0, &normalMap, 0);
+    
+    pool.parallelFor(heightMap.getHeight(), rowsPerJob, job);
+}
+
+void tiny::draw::cpu::computeTangentMap(os::ThreadPool &pool, const FloatImage &heightMap, RGBImage &tangentMap, const float &mapScale)
+{
+    checkSizes(heightMap.getWidth(), heightMap.getHeight(), tangentMap.getWidth(), tangentMap.getHeight());
+    
+    SurfaceMapJob job(heightMap, mapScale, &tangentMap, 0, 0);
+    
+    pool.parallelFor(heightMap.getHeight(), rowsPerJob, job);
+}
+
+void tiny::draw::cpu::computeTangentAndNormalMaps(os::ThreadPool &pool, const FloatImage &heightMap, RGBImage &tangentMap, RGBImage &normalMap, const float &mapScale)
+{
+    checkSizes(heightMap.getWidth(), heightMap.getHeight(), tangentMap.getWidth(), tangentMap.getHeight());
+    checkSizes(heightMap.getWidth(), heightMap.getHeight(), normalMap.getWidth(), normalMap.getHeight());
+    
+    SurfaceMapJob job(heightMap, mapScale, &tangentMap, &normalMap, 0);
+    
+    pool.parallelFor(heightMap.getHeight(), rowsPerJob, job);
+}
+
+void tiny::draw::cpu::computeColourFromHeight(os::ThreadPool &pool, const FloatImage &heightMap, RGBAImage &colourMap, const float &mapScale)
+{
+    checkSizes(heightMap.getWidth(), heightMap.getHeight(), colourMap.getWidth(), colourMap.getHeight());
+    
+    SurfaceMapJob job(heightMap, mapScale, 0, 0, &colourMap);
+    
+    pool.parallelFor(heightMap.getHeight(), rowsPerJob, job);
+}
+
+void tiny::draw::cpu::computeScaledTexture(os::ThreadPool &pool, const FloatImage &source, FloatImage &dest, const vec4 &scale, const vec4 &add)
+{
+    checkSizes(source.getWidth(), source.getHeight(), dest.getWidth(), dest.getHeight());
+    
+    ScaleJob job(source, dest, scale.x, add.x);
+    
+    pool.parallelFor(source.getHeight(), rowsPerJob, job);
+}
+
+void tiny::draw::cpu::computeResizedTexture(os::ThreadPool &pool, const FloatImage &source, FloatImage &dest, const vec2 &scale, const vec2 &add)
+{
+    if (&source == &dest)
+    {
+        //Every destination texel reads several source texels, so sample from a copy.
+        const FloatImage copy(source);
+        
+        computeResizedTexture(pool, copy, dest, scale, add);
+        return;
+    }
+    
+    std::vector<ResizeSample> columns, rows;
+    
+    getResizeSamples(columns, dest.getWidth(), source.getWidth(), source.isRepeating(), scale.x, add.x);
+    getResizeSamples(rows, dest.getHeight(), source.getHeight(), source.isRepeating(), scale.y, add.y);
+    
+    ResizeJob job(source, dest, columns, rows);
+    
+    pool.parallelFor(dest.getHeight(), rowsPerJob, job);
+}
+
@@ -0,0 +1,191 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <exception>
+#include <vector>
+#include <algorithm>
+
+#include <tiny/math/vec.h>
+#include <tiny/img/image.h>
+#include <tiny/os/threadpool.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! Host implementations of the height map kernels in tiny/draw/heightmap, which do not need an OpenGL context.
+ *
+ *  Every kernel evaluates the corresponding fragment shader at all texel centres, with the same sampling rules as the device: linear filtering of the first mipmap level, repeating or clamping to the edge outside the image.
+ *  The images are split into bands of rows that are processed in parallel by a thread pool, and the results do not depend on the number of threads.
+ *  The tolerance with respect to the device kernels is documented for each function; it is caused by differences in rounding and in the hardware's linear filtering.
+ */
+namespace cpu
+{
+
+/*! \p Image : host-only image with the same layout as a \p Texture2D with the given data type and number of channels.
+ *
+ *  As with textures, floating point images store values as they are, while unsigned char images store values in [0, 1] as multiples of 1/255.
+ */
+template <typename T, size_t Channels>
+class Image
+{
+    public:
+        Image(const size_t &a_width, const size_t &a_height, const bool &a_repeat = false) :
+            width(a_width),
+            height(a_height),
+            repeat(a_repeat),
+            data(a_width*a_height*Channels, T())
+        {
+            if (width*height == 0)
+                throw std::bad_alloc();
+        }
+        
+        /** Copies the first channels of an image, in the same way as the \p Texture2D constructor. */
+        Image(const tiny::img::Image &image, const bool &a_repeat = false) :
+            width(image.width),
+            height(image.height),
+            repeat(a_repeat),
+            data(image.width*image.height*Channels, T())
+        {
+            if (width*height == 0)
+                throw std::bad_alloc();
+            
+            for (size_t i = 0; i < width*height; ++i)
+            {
+                for (size_t j = 0; j < Channels; ++j) data[Channels*i + j] = image.data[4*i + j];
+            }
+        }
+        
+        ~Image()
+        {
+
+        }
+        
+        size_t getWidth() const
+        {
+            return width;
+        }
+        
+        size_t getHeight() const
+        {
+            return height;
+        }
+        
+        /** Returns whether the image repeats outside [0, 1], like a texture with the tf::repeat flag, instead of clamping to the edge. */
+        bool isRepeating() const
+        {
+            return repeat;
+        }
+        
+        size_t size() const
+        {
+            return data.size();
+        }
+        
+        T & operator [] (const size_t &a_index)
+        {
+            return data[a_index];
+        }
+        
+        const T & operator [] (const size_t &a_index) const
+        {
+            return data[a_index];
+        }
+        
+        /** Copies the image into the host data of a texture of the same size, which should not have dropped its host data, and uploads it to the device. */
+        template <typename TextureType>
+        void sendToTexture(TextureType &texture) const
+        {
+            if (texture.getWidth() != width || texture.getHeight() != height || texture.size() != data.size())
+            {
+                std::cerr << "Unable to copy a " << width << "x" << height << " image to a " << texture.getWidth() << "x" << texture.getHeight() << " texture!" << std::endl;
+                throw std::exception();
+            }
+            
+            std::copy(data.begin(), data.end(), texture.begin());
+            texture.sendToDevice();
+        }
+        
+    private:
+        size_t width;
+        size_t height;
+        bool repeat;
+        std::vector<T> data;
+};
+
+typedef Image<float, 1> FloatImage;
+typedef Image<unsigned char, 3> RGBImage;
+typedef Image<unsigned char, 4> RGBAImage;
+
+/**
+ * Refines a height map with the diamond-square algorithm, like the device version of computeDiamondSquareRefinement().
+ * The source and destination may be the same image.
+ *
+ * The texels that are not refined are identical to the device result.
+ * The device perturbs the refined texels with a hash of the texture coordinate that uses sin(), which differs between graphics drivers, so here the perturbation is an integer hash of the texel and the seed instead.
+ * Refined texels therefore follow the same distribution as on the device, but the two can differ by up to 0.5*amplitude*(0.5 + |h2 - h1|) per step, where h1 and h2 are the heights that are interpolated.
+ */
+void computeDiamondSquareRefinement(os::ThreadPool &, const FloatImage &, FloatImage &, const size_t &, const float & = 1.0f, const unsigned int & = 0);
+
+/**
+ * Computes a normal map of a height map, like the device version of computeNormalMap().
+ * Every channel is within one unit (1/255) of the device result.
+ */
+void computeNormalMap(os::ThreadPool &, const FloatImage &, RGBImage &, const float &);
+
+/**
+ * Computes a tangent map of a height map, like the device version of computeTangentMap().
+ * Every channel is within one unit (1/255) of the device result.
+ */
+void computeTangentMap(os::ThreadPool &, const FloatImage &, RGBImage &, const float &);
+
+/**
+ * Computes the tangent and normal maps of a height map in a single pass, like the device version of computeTangentAndNormalMaps().
+ * Every channel is within one unit (1/255) of the device result.
+ */
+void computeTangentAndNormalMaps(os::ThreadPool &, const FloatImage &, RGBImage &, RGBImage &, const float &);
+
+/**
+ * Colours a height map by its slope, like the device version of computeColourFromHeight().
+ * Every channel is within one unit (1/255) of the device result, except for texels where the vertical component of the normal lies within a few units in the last place of the thresholds 0.5 and 0.9, which may be classified differently.
+ */
+void computeColourFromHeight(os::ThreadPool &, const FloatImage &, RGBAImage &, const float &);
+
+/**
+ * Scales and offsets a height map of the same size, like the device version of computeScaledTexture() for single-channel textures, using the first component of the scale and offset.
+ * The source and destination may be the same image.
+ * The result differs at most one unit in the last place from the device result.
+ */
+void computeScaledTexture(os::ThreadPool &, const FloatImage &, FloatImage &, const vec4 &, const vec4 &);
+
+/**
+ * Samples a scaled and offset area of a height map into another one, like the device version of computeResizedTexture().
+ * The source is always sampled bilinearly from the full resolution image, which matches the device when magnifying and for textures without mipmaps.
+ * Graphics hardware typically computes the filter weights with 8 bits of precision, so the result differs from the device by up to 1/256 of the difference between neighbouring source texels.
+ */
+void computeResizedTexture(os::ThreadPool &, const FloatImage &, FloatImage &, const vec2 &, const vec2 &);
+
+}
+
+}
+
+}
+
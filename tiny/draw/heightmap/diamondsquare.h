@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <exception>
 
+#include <cmath>
+
 #include <tiny/draw/computetexture.h>
 
 namespace tiny
@@ -28,28 +30,16 @@ namespace tiny
 namespace draw
 {
 
-template<typename TextureType>
-void computeDiamondSquareRefinement(const TextureType &source, TextureType &dest, const size_t &stepSize, const float &amplitude = 1.0f)
+namespace detail
 {
-    if (stepSize >= source.getWidth() || stepSize >= source.getHeight() || stepSize <= 1 || (stepSize & (stepSize - 1)) != 0)
-    {
-        std::cerr << "Invalid step size " << stepSize << " for diamond square algorithm on a " << source.getWidth() << "x" << source.getHeight() << " height map. Should be a power of two." << std::endl;
-        throw std::exception();
-    }
-    
-    //Allocate temporary textures.
-    TextureType *tmp[2];
-    
-    tmp[0] = new TextureType(source);
-    tmp[1] = new TextureType(source);
-    
-    std::vector<std::string> inputTextures;
-    std::vector<std::string> outputTextures;
-    
-    inputTextures.push_back("source");
-    outputTextures.push_back("colour");
-    
-    const std::string diamondFragmentShader =
+
+/**
+ * Fragment shader code of the diamond step of computeDiamondSquareRefinement(), which refines the midpoints of the edges of the squares with sides of 2*step texels.
+ * Texels are addressed by their position in the texture, so the result only depends on the texture coordinate and the texels within step texels.
+ */
+inline std::string getDiamondShaderCode()
+{
+    return
 "#version 150\n"
 "\n"
 "precision highp float;\n"
@@ -99,7 +89,14 @@ void computeDiamondSquareRefinement(const TextureType &source, TextureType &dest
 "		colour = texture(source, tex);\n"
 "	}\n"
 "}\n";
-		const std::string squareFragmentShader =
+}
+
+/**
+ * Fragment shader code of the square step of computeDiamondSquareRefinement(), which refines the centres of the squares from the edge midpoints written by the diamond step.
+ */
+inline std::string getSquareShaderCode()
+{
+    return
 "#version 150\n"
 "\n"
 "precision highp float;\n"
@@ -139,9 +136,58 @@ void computeDiamondSquareRefinement(const TextureType &source, TextureType &dest
 "		colour = texture(source, tex);\n"
 "	}\n"
 "}\n";
+}
+
+}
+
+/**
+ * Returns a conservative range of the heights produced by computeDiamondSquareRefinement() from a height map with heights in the given range.
+ * Every diamond and square step displaces a texel by at most amplitude*(0.5 + h)/4, with h the width of the current range, which is useful to bound the terrain when culling it.
+ */
+inline vec2 getDiamondSquareHeightRange(const vec2 &range, const size_t &stepSize, const float &amplitude = 1.0f)
+{
+    vec2 result = range;
+    
+    for (size_t step = stepSize/2; step >= 1; step >>= 1)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            const float displacement = 0.25f*std::fabs(amplitude)*(0.5f + result.y - result.x);
+            
+            result.x -= displacement;
+            result.y += displacement;
+        }
+    }
+    
+    return result;
+}
+
+template<typename TextureType>
+void computeDiamondSquareRefinement(const TextureType &source, TextureType &dest, const size_t &stepSize, const float &amplitude = 1.0f, const bool &readBack = true)
+{
+    if (stepSize >= source.getWidth() || stepSize >= source.getHeight() || stepSize <= 1 || (stepSize & (stepSize - 1)) != 0)
+    {
+        std::cerr << "Invalid step size " << stepSize << " for diamond square algorithm on a " << source.getWidth() << "x" << source.getHeight() << " height map. Should be a power of two." << std::endl;
+        throw std::exception();
+    }
+    
+    //Allocate temporary textures.
+    TextureType *tmp[2];
+    
+    tmp[0] = new TextureType(source);
+    tmp[1] = new TextureType(source);
+    
+    std::vector<std::string> inputTextures;
+    std::vector<std::string> outputTextures;
+    
+    inputTextures.push_back("source");
+    outputTextures.push_back("colour");
+    
+    const std::string diamondFragmentShader = detail::getDiamondShaderCode();
+    const std::string squareFragmentShader = detail::getSquareShaderCode();
     
-    ComputeTexture *diamondComputeTexture = new ComputeTexture(inputTextures, outputTextures, diamondFragmentShader);
-    ComputeTexture *squareComputeTexture = new ComputeTexture(inputTextures, outputTextures, squareFragmentShader);
+    ComputeTexture *diamondComputeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, diamondFragmentShader);
+    ComputeTexture *squareComputeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, squareFragmentShader);
     
     diamondComputeTexture->uniformMap().setFloatUniform(amplitude, "amplitude");
     diamondComputeTexture->uniformMap().setVec2Uniform(source.getWidth(), source.getHeight(), "sourceSize");
@@ -184,11 +230,9 @@ void computeDiamondSquareRefinement(const TextureType &source, TextureType &dest
         squareComputeTexture->compute();
     }
     
-    dest.getFromDevice();
+    if (readBack) dest.getFromDevice();
     
     //Free all data.
-    delete diamondComputeTexture;
-    delete squareComputeTexture;
     delete tmp[0];
     delete tmp[1];
 }
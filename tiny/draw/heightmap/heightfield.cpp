@@ -0,0 +1,218 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cmath>
+#include <algorithm>
+
+#include <tiny/draw/heightmap/heightfield.h>
+
+using namespace tiny;
+using namespace tiny::draw;
+
+HeightField::HeightField() :
+    width(0),
+    height(0),
+    nrTiles(0, 0),
+    scale(1.0f, 1.0f),
+    halfWidth(0.0f),
+    halfHeight(0.0f),
+    zeroCell(0),
+    texels(tileStride + 2, 0.0f)
+{
+
+}
+
+HeightField::HeightField(const FloatTexture2D &texture, const vec2 &a_scale) :
+    width(0),
+    height(0),
+    nrTiles(0, 0),
+    scale(a_scale),
+    halfWidth(0.0f),
+    halfHeight(0.0f),
+    zeroCell(0),
+    texels()
+{
+    setHeights(texture, a_scale);
+}
+
+HeightField::~HeightField()
+{
+
+}
+
+void HeightField::setHeights(const FloatTexture2D &texture, const vec2 &a_scale, const ivec2 &origin)
+{
+    setHeights(texture.empty() ? 0 : &texture[0], texture.getWidth(), texture.getHeight(), a_scale, origin);
+}
+
+void HeightField::setHeights(const cpu::FloatImage &image, const vec2 &a_scale)
+{
+    setHeights(&image[0], image.getWidth(), image.getHeight(), a_scale);
+}
+
+void HeightField::setHeights(const float *heights, const int &a_width, const int &a_height, const vec2 &a_scale, const ivec2 &origin)
+{
+    width = (heights ? a_width : 0);
+    height = (heights ? a_height : 0);
+    scale = a_scale;
+    halfWidth = 0.5f*static_cast<float>(width);
+    halfHeight = 0.5f*static_cast<float>(height);
+    
+    //There are width + 1 cells along the x-axis, starting at texel -1.
+    nrTiles = ivec2((width + tileSize)/tileSize, (height + tileSize)/tileSize);
+    zeroCell = nrTiles.x*nrTiles.y*tileStride*tileStride;
+    texels.assign(zeroCell + tileStride + 2, 0.0f);
+    
+    //Texel (x, y) is stored at ((x + origin.x) mod width, (y + origin.y) mod height) of the height map.
+    const int originX = (width > 0 ? ((origin.x % width) + width) % width : 0);
+    const int originY = (height > 0 ? ((origin.y % height) + height) % height : 0);
+    
+    for (int ty = 0; ty < nrTiles.y; ++ty)
+    {
+        for (int tx = 0; tx < nrTiles.x; ++tx)
+        {
+            float *tile = &texels[(ty*nrTiles.x + tx)*tileStride*tileStride];
+            
+            for (int y = 0; y < tileStride; ++y)
+            {
+                const int sy = ty*tileSize + y - 1;
+                
+                if (sy < 0 || sy >= height) continue;
+                
+                const float *row = &heights[width*(sy + originY < height ? sy + originY : sy + originY - height)];
+                
+                for (int x = 0; x < tileStride; ++x)
+                {
+                    const int sx = tx*tileSize + x - 1;
+                    
+                    if (sx >= 0 && sx < width) tile[y*tileStride + x] = row[sx + originX < width ? sx + originX : sx + originX - width];
+                }
+            }
+        }
+    }
+}
+
+float HeightField::getHeight(const vec2 &a_pos) const
+{
+    //Perform the same operations as bilinearly sampling the height texture.
+    const vec2 pos = vec2(a_pos.x/scale.x + halfWidth, a_pos.y/scale.y + halfHeight);
+    const float fx = std::floor(pos.x);
+    const float fy = std::floor(pos.y);
+    const float *h = getCell(static_cast<int>(fx), static_cast<int>(fy));
+    const float dx = pos.x - fx;
+    const float dy = pos.y - fy;
+    
+    return dy*(dx*h[tileStride + 1] + (1.0f - dx)*h[tileStride]) + (1.0f - dy)*(dx*h[1] + (1.0f - dx)*h[0]);
+}
+
+void HeightField::getHeights(const vec2 *positions, float *heights, const size_t &n) const
+{
+    size_t i = 0;
+    
+#ifdef TINY_SIMD_SSE
+    //Sample blocks of positions, four at a time as a structure of arrays.
+    //The cells of all positions in a block are located and prefetched first, such that their texel fetches overlap.
+    const size_t blockSize = 64;
+    const float *cells[blockSize];
+    float deltaX[blockSize], deltaY[blockSize];
+    
+    const __m128 scaleX = _mm_set1_ps(scale.x);
+    const __m128 scaleY = _mm_set1_ps(scale.y);
+    const __m128 offsetX = _mm_set1_ps(halfWidth);
+    const __m128 offsetY = _mm_set1_ps(halfHeight);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    
+    while (i + 4 <= n)
+    {
+        const size_t m = std::min(blockSize, (n - i) & ~static_cast<size_t>(3));
+        
+        for (size_t j = 0; j < m; j += 4)
+        {
+            const __m128 a = _mm_loadu_ps(&positions[i + j].x);
+            const __m128 b = _mm_loadu_ps(&positions[i + j + 2].x);
+            const __m128 px = _mm_add_ps(_mm_div_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), scaleX), offsetX);
+            const __m128 py = _mm_add_ps(_mm_div_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), scaleY), offsetY);
+            
+            //Round towards minus infinity, keeping the sign of zero like floor() does.
+            __m128 fx = _mm_cvtepi32_ps(_mm_cvttps_epi32(px));
+            __m128 fy = _mm_cvtepi32_ps(_mm_cvttps_epi32(py));
+            
+            fx = _mm_or_ps(_mm_sub_ps(fx, _mm_and_ps(_mm_cmpgt_ps(fx, px), one)), _mm_and_ps(px, signMask));
+            fy = _mm_or_ps(_mm_sub_ps(fy, _mm_and_ps(_mm_cmpgt_ps(fy, py), one)), _mm_and_ps(py, signMask));
+            
+            _mm_storeu_ps(&deltaX[j], _mm_sub_ps(px, fx));
+            _mm_storeu_ps(&deltaY[j], _mm_sub_ps(py, fy));
+            
+            int ix[4], iy[4];
+            
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(ix), _mm_cvttps_epi32(fx));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(iy), _mm_cvttps_epi32(fy));
+            
+            for (int k = 0; k < 4; ++k)
+            {
+                const float *h = getCell(ix[k], iy[k]);
+                
+                _mm_prefetch(reinterpret_cast<const char *>(h), _MM_HINT_T0);
+                _mm_prefetch(reinterpret_cast<const char *>(h + tileStride), _MM_HINT_T0);
+                cells[j + k] = h;
+            }
+        }
+        
+        for (size_t j = 0; j < m; j += 4)
+        {
+            float h00[4], h10[4], h01[4], h11[4];
+            
+            for (int k = 0; k < 4; ++k)
+            {
+                const float *h = cells[j + k];
+                
+                h00[k] = h[0];
+                h10[k] = h[1];
+                h01[k] = h[tileStride];
+                h11[k] = h[tileStride + 1];
+            }
+            
+            const __m128 dx = _mm_loadu_ps(&deltaX[j]);
+            const __m128 dy = _mm_loadu_ps(&deltaY[j]);
+            const __m128 rx = _mm_sub_ps(one, dx);
+            const __m128 ry = _mm_sub_ps(one, dy);
+            const __m128 top = _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(h11)), _mm_mul_ps(rx, _mm_loadu_ps(h01)));
+            const __m128 bottom = _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(h10)), _mm_mul_ps(rx, _mm_loadu_ps(h00)));
+            
+            _mm_storeu_ps(&heights[i + j], _mm_add_ps(_mm_mul_ps(dy, top), _mm_mul_ps(ry, bottom)));
+        }
+        
+        i += m;
+    }
+#endif
+    
+    for ( ; i < n; ++i)
+    {
+        heights[i] = getHeight(positions[i]);
+    }
+}
+
+ivec2 HeightField::getSize() const
+{
+    return ivec2(width, height);
+}
+
+vec2 HeightField::getScale() const
+{
+    return scale;
+}
+
@@ -0,0 +1,92 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+
+#include <tiny/math/vec.h>
+#include <tiny/draw/texture2d.h>
+#include <tiny/draw/heightmap/cpuheightmap.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! \p HeightField : a host copy of a height map, laid out for fast bilinear sampling of many world positions at once.
+ * 
+ *  The height map is stored in square tiles of (tileSize + 1) x (tileSize + 1) texels that overlap by one texel, such that the four texels of every sample lie in a single tile, within two adjacent rows.
+ *  A sample gives exactly the same result as bilinearly sampling the height texture through its accessor, where texels outside the texture have height zero, for all positions that map to texel coordinates representable as an int.
+ *  This holds as long as the compiler does not contract multiplications and additions into fused multiply-adds, which the default compiler flags do not allow.
+ *
+ *  For height maps that are stored toroidally, an origin can be given when setting the heights: texel (x, y) is then read from texel ((x + origin.x) mod width, (y + origin.y) mod height) of the height map.
+ */
+class HeightField
+{
+    public:
+        HeightField();
+        HeightField(const FloatTexture2D &, const vec2 &);
+        ~HeightField();
+        
+        void setHeights(const FloatTexture2D &, const vec2 &, const ivec2 & = ivec2(0, 0));
+        void setHeights(const float *, const int &, const int &, const vec2 &, const ivec2 & = ivec2(0, 0));
+        void setHeights(const cpu::FloatImage &, const vec2 &);
+        
+        float getHeight(const vec2 &) const;
+        void getHeights(const vec2 *, float *, const size_t &) const;
+        
+        /** Returns the height of texel (x, y), which is zero outside the height map. */
+        float getTexel(const int &x, const int &y) const
+        {
+            return getCell(x - 1, y - 1)[tileStride + 1];
+        }
+        
+        ivec2 getSize() const;
+        vec2 getScale() const;
+        
+        static const int tileSize = 16;
+        
+    private:
+        static const int tileStride = tileSize + 1;
+        
+        /** Returns the height of texel (x, y) of cell (x, y); the other corners of the cell are at offsets 1, tileStride, and tileStride + 1. */
+        const float *getCell(const int &x, const int &y) const
+        {
+            //Cells start at texel -1, such that cells which only partially overlap the texture are also stored.
+            const int cx = x + 1;
+            const int cy = y + 1;
+            
+            if (cx < 0 || cy < 0 || cx > width || cy > height) return &texels[zeroCell];
+            
+            return &texels[((cy/tileSize)*nrTiles.x + cx/tileSize)*tileStride*tileStride + (cy % tileSize)*tileStride + (cx % tileSize)];
+        }
+        
+        int width;
+        int height;
+        ivec2 nrTiles;
+        vec2 scale;
+        float halfWidth;
+        float halfHeight;
+        size_t zeroCell;
+        std::vector<float> texels;
+};
+
+}
+
+}
+
@@ -0,0 +1,399 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cmath>
+#include <algorithm>
+
+#include <tiny/draw/heightmap/heightpyramid.h>
+
+using namespace tiny;
+using namespace tiny::draw;
+
+namespace
+{
+
+/** Node of the pyramid that still needs to be visited, with the part of the segment that lies inside it. */
+struct PyramidNode
+{
+    int level;
+    int x;
+    int y;
+    float t0;
+    float t1;
+};
+
+bool compareNodes(const PyramidNode &a, const PyramidNode &b)
+{
+    return a.t0 < b.t0;
+}
+
+/** Restricts [t0, t1] to the part where o + t*d lies in [lo, hi], given the reciprocal of d. */
+bool clipToSlab(const float &o, const float &d, const float &invD, const float &lo, const float &hi, float &t0, float &t1)
+{
+    if (d == 0.0f) return (o >= lo && o <= hi && t0 <= t1);
+    
+    float a = (lo - o)*invD;
+    float b = (hi - o)*invD;
+    
+    if (a > b) std::swap(a, b);
+    
+    t0 = std::max(t0, a);
+    t1 = std::min(t1, b);
+    
+    return (t0 <= t1);
+}
+
+/** Finds the first t in [t0, t1] for which the segment is at or below the plane at height zero. */
+bool intersectPlane(const vec3 &o, const vec3 &d, const float &t0, const float &t1, float &t)
+{
+    if (o.y + t0*d.y <= 0.0f)
+    {
+        t = t0;
+        return true;
+    }
+    
+    if (d.y < 0.0f && -o.y/d.y <= t1)
+    {
+        t = -o.y/d.y;
+        return true;
+    }
+    
+    return false;
+}
+
+}
+
+HeightPyramid::HeightPyramid() :
+    heightField(0),
+    scale(1.0f, 1.0f),
+    offset(0.0f, 0.0f),
+    levels()
+{
+
+}
+
+HeightPyramid::HeightPyramid(const HeightField &a_heightField) :
+    heightField(0),
+    scale(1.0f, 1.0f),
+    offset(0.0f, 0.0f),
+    levels()
+{
+    build(a_heightField);
+}
+
+HeightPyramid::~HeightPyramid()
+{
+
+}
+
+void HeightPyramid::build(const HeightField &a_heightField)
+{
+    heightField = &a_heightField;
+    
+    const ivec2 size = heightField->getSize();
+    
+    //Cell (x, y) spans texels x - 1 to x, such that world position p lies in cell floor(p/scale + offset).
+    scale = heightField->getScale();
+    offset = vec2(0.5f*static_cast<float>(size.x) + 1.0f, 0.5f*static_cast<float>(size.y) + 1.0f);
+    
+    levels.clear();
+    
+    if (size.x <= 0 || size.y <= 0) return;
+    
+    //Height range of every bilinear cell.
+    levels.push_back(Level(size.x + 1, size.y + 1));
+    
+    for (int y = 0; y < levels[0].height; ++y)
+    {
+        for (int x = 0; x < levels[0].width; ++x)
+        {
+            const float h00 = heightField->getTexel(x - 1, y - 1);
+            const float h10 = heightField->getTexel(x, y - 1);
+            const float h01 = heightField->getTexel(x - 1, y);
+            const float h11 = heightField->getTexel(x, y);
+            
+            levels[0].minHeights[x + levels[0].width*y] = std::min(std::min(h00, h10), std::min(h01, h11));
+            levels[0].maxHeights[x + levels[0].width*y] = std::max(std::max(h00, h10), std::max(h01, h11));
+        }
+    }
+    
+    //Combine 2x2 nodes until a single node remains.
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const Level &fine = levels.back();
+        Level coarse((fine.width + 1)/2, (fine.height + 1)/2);
+        
+        for (int y = 0; y < coarse.height; ++y)
+        {
+            for (int x = 0; x < coarse.width; ++x)
+            {
+                float minHeight = fine.minHeights[2*x + fine.width*2*y];
+                float maxHeight = fine.maxHeights[2*x + fine.width*2*y];
+                
+                for (int j = 2*y; j < 2*y + 2 && j < fine.height; ++j)
+                {
+                    for (int i = 2*x; i < 2*x + 2 && i < fine.width; ++i)
+                    {
+                        minHeight = std::min(minHeight, fine.minHeights[i + fine.width*j]);
+                        maxHeight = std::max(maxHeight, fine.maxHeights[i + fine.width*j]);
+                    }
+                }
+                
+                coarse.minHeights[x + coarse.width*y] = minHeight;
+                coarse.maxHeights[x + coarse.width*y] = maxHeight;
+            }
+        }
+        
+        levels.push_back(coarse);
+    }
+}
+
+bool HeightPyramid::intersectSegment(const vec3 &a, const vec3 &b, float &t) const
+{
+    //Transform the horizontal coordinates of the segment to cells, heights stay in world units.
+    const vec3 o = vec3(a.x/scale.x + offset.x, a.y, a.z/scale.y + offset.y);
+    const vec3 d = vec3((b.x - a.x)/scale.x, b.y - a.y, (b.z - a.z)/scale.y);
+    const vec3 invD = vec3(d.x != 0.0f ? 1.0f/d.x : 0.0f, 0.0f, d.z != 0.0f ? 1.0f/d.z : 0.0f);
+    
+    float tIn = 0.0f;
+    float tOut = 1.0f;
+    
+    if (levels.empty() ||
+        !clipToSlab(o.x, d.x, invD.x, 0.0f, static_cast<float>(levels[0].width), tIn, tOut) ||
+        !clipToSlab(o.z, d.z, invD.z, 0.0f, static_cast<float>(levels[0].height), tIn, tOut))
+    {
+        return intersectPlane(o, d, 0.0f, 1.0f, t);
+    }
+    
+    //Check the parts of the segment before and after the height map against the plane around it.
+    if (tIn > 0.0f && intersectPlane(o, d, 0.0f, tIn, t)) return true;
+    if (intersectNodes(o, d, invD, tIn, tOut, t)) return true;
+    if (tOut < 1.0f && intersectPlane(o, d, tOut, 1.0f, t)) return true;
+    
+    return false;
+}
+
+bool HeightPyramid::intersectNodes(const vec3 &o, const vec3 &d, const vec3 &invD, const float &tIn, const float &tOut, float &t) const
+{
+    //Visit nodes front to back, by always pushing the nodes that overlap the segment in reverse order of entry.
+    PyramidNode stack[4*32];
+    PyramidNode children[4];
+    int nrNodes = 0;
+    int nrChildren = 0;
+    
+    //Start at the finest level at which at most 2x2 nodes cover the part of the segment over the height map, instead of at the root.
+    const ivec2 lo = ivec2(static_cast<int>(std::min(o.x + tIn*d.x, o.x + tOut*d.x)), static_cast<int>(std::min(o.z + tIn*d.z, o.z + tOut*d.z)));
+    const ivec2 hi = ivec2(static_cast<int>(std::max(o.x + tIn*d.x, o.x + tOut*d.x)), static_cast<int>(std::max(o.z + tIn*d.z, o.z + tOut*d.z)));
+    int startLevel = 0;
+    
+    while (startLevel + 1 < static_cast<int>(levels.size()) && ((hi.x >> startLevel) - (lo.x >> startLevel) > 1 || (hi.y >> startLevel) - (lo.y >> startLevel) > 1)) ++startLevel;
+    
+    const Level &start = levels[startLevel];
+    const float startSize = static_cast<float>(1 << startLevel);
+    
+    for (int j = std::max(0, lo.y >> startLevel); j <= (hi.y >> startLevel) && j < start.height; ++j)
+    {
+        for (int i = std::max(0, lo.x >> startLevel); i <= (hi.x >> startLevel) && i < start.width; ++i)
+        {
+            PyramidNode &child = children[nrChildren];
+            
+            child.level = startLevel;
+            child.x = i;
+            child.y = j;
+            child.t0 = tIn;
+            child.t1 = tOut;
+            
+            if (clipToSlab(o.x, d.x, invD.x, startSize*static_cast<float>(i), startSize*static_cast<float>(i + 1), child.t0, child.t1) &&
+                clipToSlab(o.z, d.z, invD.z, startSize*static_cast<float>(j), startSize*static_cast<float>(j + 1), child.t0, child.t1))
+            {
+                ++nrChildren;
+            }
+        }
+    }
+    
+    std::sort(children, children + nrChildren, compareNodes);
+    
+    for (int i = nrChildren - 1; i >= 0; --i)
+    {
+        stack[nrNodes++] = children[i];
+    }
+    
+    while (nrNodes > 0)
+    {
+        const PyramidNode node = stack[--nrNodes];
+        const Level &level = levels[node.level];
+        const float y0 = o.y + node.t0*d.y;
+        const float y1 = o.y + node.t1*d.y;
+        const float minHeight = level.minHeights[node.x + level.width*node.y];
+        const float maxHeight = level.maxHeights[node.x + level.width*node.y];
+        
+        //Skip nodes that lie entirely below the segment.
+        if (std::min(y0, y1) > maxHeight) continue;
+        
+        //If the segment lies entirely below the node, it hits the terrain where it enters the node.
+        if (std::max(y0, y1) <= minHeight)
+        {
+            t = node.t0;
+            return true;
+        }
+        
+        if (node.level == 0)
+        {
+            if (intersectCell(node.x, node.y, o, d, node.t0, node.t1, t)) return true;
+            continue;
+        }
+        
+        //Determine the part of the segment that lies in each child.
+        const Level &fine = levels[node.level - 1];
+        const float childSize = static_cast<float>(1 << (node.level - 1));
+        
+        nrChildren = 0;
+        
+        for (int j = 2*node.y; j < 2*node.y + 2 && j < fine.height; ++j)
+        {
+            for (int i = 2*node.x; i < 2*node.x + 2 && i < fine.width; ++i)
+            {
+                PyramidNode &child = children[nrChildren];
+                
+                child.level = node.level - 1;
+                child.x = i;
+                child.y = j;
+                child.t0 = node.t0;
+                child.t1 = node.t1;
+                
+                if (clipToSlab(o.x, d.x, invD.x, childSize*static_cast<float>(i), childSize*static_cast<float>(i + 1), child.t0, child.t1) &&
+                    clipToSlab(o.z, d.z, invD.z, childSize*static_cast<float>(j), childSize*static_cast<float>(j + 1), child.t0, child.t1))
+                {
+                    ++nrChildren;
+                }
+            }
+        }
+        
+        std::sort(children, children + nrChildren, compareNodes);
+        
+        for (int i = nrChildren - 1; i >= 0; --i)
+        {
+            stack[nrNodes++] = children[i];
+        }
+    }
+    
+    return false;
+}
+
+bool HeightPyramid::intersectCell(const int &x, const int &y, const vec3 &o, const vec3 &d, const float &t0, const float &t1, float &t) const
+{
+    //Along the segment, the bilinear surface of the cell is a quadratic function of t.
+    const double h00 = heightField->getTexel(x - 1, y - 1);
+    const double h10 = heightField->getTexel(x, y - 1);
+    const double h01 = heightField->getTexel(x - 1, y);
+    const double h11 = heightField->getTexel(x, y);
+    const double hu = h10 - h00;
+    const double hv = h01 - h00;
+    const double huv = h00 - h10 - h01 + h11;
+    const double u0 = o.x - static_cast<double>(x);
+    const double v0 = o.z - static_cast<double>(y);
+    const double du = d.x;
+    const double dv = d.z;
+    
+    //Height of the segment above the surface: a*t^2 + b*t + c.
+    const double a = -huv*du*dv;
+    const double b = static_cast<double>(d.y) - (hu*du + hv*dv + huv*(u0*dv + v0*du));
+    const double c = static_cast<double>(o.y) - (h00 + hu*u0 + hv*v0 + huv*u0*v0);
+    
+    if ((a*t0 + b)*t0 + c <= 0.0)
+    {
+        t = t0;
+        return true;
+    }
+    
+    //Find the first root in [t0, t1].
+    double roots[2];
+    int nrRoots = 0;
+    
+    if (std::fabs(a) <= 1.0e-12*(std::fabs(b) + std::fabs(c)))
+    {
+        if (b != 0.0) roots[nrRoots++] = -c/b;
+    }
+    else
+    {
+        const double discriminant = b*b - 4.0*a*c;
+        
+        if (discriminant >= 0.0)
+        {
+            //Avoid cancellation by computing one root from the other.
+            const double q = -0.5*(b + (b >= 0.0 ? std::sqrt(discriminant) : -std::sqrt(discriminant)));
+            
+            roots[nrRoots++] = q/a;
+            if (q != 0.0) roots[nrRoots++] = c/q;
+            if (nrRoots == 2 && roots[1] < roots[0]) std::swap(roots[0], roots[1]);
+        }
+    }
+    
+    for (int i = 0; i < nrRoots; ++i)
+    {
+        if (roots[i] >= t0 && roots[i] <= t1)
+        {
+            t = static_cast<float>(roots[i]);
+            return true;
+        }
+    }
+    
+    //Guard against rounding when the segment ends just below the surface.
+    if ((a*t1 + b)*t1 + c <= 0.0)
+    {
+        t = t1;
+        return true;
+    }
+    
+    return false;
+}
+
+bool HeightPyramid::intersectRay(const vec3 &origin, const vec3 &direction, const float &maxDistance, float &distance) const
+{
+    const float l = length(direction);
+    
+    if (l <= 0.0f) return false;
+    
+    float t = 0.0f;
+    
+    if (!intersectSegment(origin, origin + (maxDistance/l)*direction, t)) return false;
+    
+    distance = t*maxDistance;
+    
+    return true;
+}
+
+bool HeightPyramid::isVisible(const vec3 &a, const vec3 &b) const
+{
+    //Points on or below the terrain are never visible.
+    float t = 0.0f;
+    
+    return !intersectSegment(a, b, t);
+}
+
+void HeightPyramid::areVisible(const vec3 *a, const vec3 *b, bool *visible, const size_t &n) const
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        visible[i] = isVisible(a[i], b[i]);
+    }
+}
+
+size_t HeightPyramid::getNrLevels() const
+{
+    return levels.size();
+}
+
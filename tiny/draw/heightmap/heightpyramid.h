@@ -0,0 +1,83 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+
+#include <tiny/math/vec.h>
+#include <tiny/draw/heightmap/heightfield.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! \p HeightPyramid : a hierarchy of minimum and maximum heights over a \p HeightField, to intersect segments with the terrain without marching along them.
+ * 
+ *  The finest level stores the height range of every bilinear cell of the height field, every coarser level the range of 2x2 cells of the level below.
+ *  Queries descend the pyramid front to back and only visit nodes whose height range overlaps the segment, inside a cell the bilinear surface is intersected exactly.
+ *  Outside the height map the terrain is a plane at height zero, as it is for the height field.
+ *  Everything is done on the CPU, such that the pyramid can also be used without a graphics device.
+ */
+class HeightPyramid
+{
+    public:
+        HeightPyramid();
+        HeightPyramid(const HeightField &);
+        ~HeightPyramid();
+        
+        void build(const HeightField &);
+        
+        bool intersectSegment(const vec3 &, const vec3 &, float &) const;
+        bool intersectRay(const vec3 &, const vec3 &, const float &, float &) const;
+        bool isVisible(const vec3 &, const vec3 &) const;
+        void areVisible(const vec3 *, const vec3 *, bool *, const size_t &) const;
+        
+        size_t getNrLevels() const;
+        
+    private:
+        struct Level
+        {
+            Level(const int &a_width, const int &a_height) :
+                width(a_width),
+                height(a_height),
+                minHeights(a_width*a_height, 0.0f),
+                maxHeights(a_width*a_height, 0.0f)
+            {
+
+            }
+            
+            int width;
+            int height;
+            std::vector<float> minHeights;
+            std::vector<float> maxHeights;
+        };
+        
+        bool intersectNodes(const vec3 &, const vec3 &, const vec3 &, const float &, const float &, float &) const;
+        bool intersectCell(const int &, const int &, const vec3 &, const vec3 &, const float &, const float &, float &) const;
+        
+        const HeightField *heightField;
+        vec2 scale;
+        vec2 offset;
+        std::vector<Level> levels;
+};
+
+}
+
+}
+
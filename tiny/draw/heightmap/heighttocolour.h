@@ -28,7 +28,7 @@ namespace draw
 {
 
 template<typename TextureType1, typename TextureType2>
-void computeColourFromHeight(const TextureType1 &heightMap, TextureType2 &colourMap, const float &mapScale)
+void computeColourFromHeight(const TextureType1 &heightMap, TextureType2 &colourMap, const float &mapScale, const bool &readBack = true)
 {
     std::vector<std::string> inputTextures;
     std::vector<std::string> outputTextures;
@@ -63,15 +63,14 @@ void computeColourFromHeight(const TextureType1 &heightMap, TextureType2 &colour
     inputTextures.push_back("source");
     outputTextures.push_back("colour");
 
-    ComputeTexture *computeTexture = new ComputeTexture(inputTextures, outputTextures, fragmentShader);
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
     
     computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
     computeTexture->setInput(heightMap, "source");
     computeTexture->setOutput(colourMap, "colour");
     computeTexture->compute();
-    colourMap.getFromDevice();
     
-    delete computeTexture;
+    if (readBack) colourMap.getFromDevice();
 }
 
 }
@@ -28,7 +28,7 @@ namespace draw
 {
 
 template<typename TextureType1, typename TextureType2>
-void computeNormalMap(const TextureType1 &heightMap, TextureType2 &normalMap, const float &mapScale)
+void computeNormalMap(const TextureType1 &heightMap, TextureType2 &normalMap, const float &mapScale, const bool &readBack = true)
 {
     std::vector<std::string> inputTextures;
     std::vector<std::string> outputTextures;
@@ -59,15 +59,14 @@ void computeNormalMap(const TextureType1 &heightMap, TextureType2 &normalMap, co
     inputTextures.push_back("source");
     outputTextures.push_back("normal");
 
-    ComputeTexture *computeTexture = new ComputeTexture(inputTextures, outputTextures, fragmentShader);
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
     
     computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
     computeTexture->setInput(heightMap, "source");
     computeTexture->setOutput(normalMap, "normal");
     computeTexture->compute();
-    normalMap.getFromDevice();
     
-    delete computeTexture;
+    if (readBack) normalMap.getFromDevice();
 }
 
 }
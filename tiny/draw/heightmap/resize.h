@@ -27,8 +27,12 @@ namespace tiny
 namespace draw
 {
 
+/**
+ * Samples the area tex*scale + add of the source texture into the destination texture.
+ * When regions (x, y, width, height) are given, only the texels of the destination inside them are written.
+ */
 template<typename TextureType1, typename TextureType2>
-void computeResizedTexture(const TextureType1 &source, TextureType2 &dest, const vec2 &scale, const vec2 &add)
+void computeResizedTexture(const TextureType1 &source, TextureType2 &dest, const vec2 &scale, const vec2 &add, const bool &readBack = true, const std::vector<ivec4> &regions = std::vector<ivec4>())
 {
     std::vector<std::string> inputTextures;
     std::vector<std::string> outputTextures;
@@ -52,16 +56,15 @@ void computeResizedTexture(const TextureType1 &source, TextureType2 &dest, const
     inputTextures.push_back("source");
     outputTextures.push_back("colour");
 
-    ComputeTexture *computeTexture = new ComputeTexture(inputTextures, outputTextures, fragmentShader);
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
     
     computeTexture->uniformMap().setVec2Uniform(scale, "scaleVec");
     computeTexture->uniformMap().setVec2Uniform(add, "addVec");
     computeTexture->setInput(source, "source");
     computeTexture->setOutput(dest, "colour");
-    computeTexture->compute();
-    dest.getFromDevice();
+    computeTexture->compute(regions);
     
-    delete computeTexture;
+    if (readBack) dest.getFromDevice();
 }
 
 }
@@ -28,7 +28,7 @@ namespace draw
 {
 
 template<typename TextureType1, typename TextureType2>
-void computeScaledTexture(const TextureType1 &source, TextureType2 &dest, const vec4 &scale, const vec4 &add)
+void computeScaledTexture(const TextureType1 &source, TextureType2 &dest, const vec4 &scale, const vec4 &add, const bool &readBack = true)
 {
     std::vector<std::string> inputTextures;
     std::vector<std::string> outputTextures;
@@ -52,16 +52,15 @@ void computeScaledTexture(const TextureType1 &source, TextureType2 &dest, const
     inputTextures.push_back("source");
     outputTextures.push_back("colour");
 
-    ComputeTexture *computeTexture = new ComputeTexture(inputTextures, outputTextures, fragmentShader);
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
     
     computeTexture->uniformMap().setVec4Uniform(scale, "scaleVec");
     computeTexture->uniformMap().setVec4Uniform(add, "addVec");
     computeTexture->setInput(source, "source");
     computeTexture->setOutput(dest, "colour");
     computeTexture->compute();
-    dest.getFromDevice();
     
-    delete computeTexture;
+    if (readBack) dest.getFromDevice();
 }
 
 }
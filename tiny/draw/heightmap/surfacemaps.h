@@ -0,0 +1,193 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <tiny/draw/computetexture.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+namespace detail
+{
+
+/**
+ * Fragment shader code that writes the tangent and normal of a height map in a single pass.
+ * The result is identical to that of computeTangentMap() and computeNormalMap().
+ */
+inline std::string getSurfaceMapShaderCode()
+{
+    return
+"out vec4 surfaceTangent;\n"
+"out vec4 surfaceNormal;\n"
+"\n"
+"void computeSurfaceMaps(void)\n"
+"{\n"
+"   float east = texture(source, tex + vec2(sourceInverseSize.x, 0.0f)).x;\n"
+"   float west = texture(source, tex - vec2(sourceInverseSize.x, 0.0f)).x;\n"
+"   float north = texture(source, tex + vec2(0.0f, sourceInverseSize.y)).x;\n"
+"   float south = texture(source, tex - vec2(0.0f, sourceInverseSize.y)).x;\n"
+"   \n"
+"   vec3 t = normalize(vec3(mapScale, east - west, 0.0f));\n"
+"   vec3 n = normalize(vec3(west - east, mapScale, south - north));\n"
+"   \n"
+"   surfaceTangent = vec4(0.5f*(t + 1.0f), 1.0f);\n"
+"   surfaceNormal = vec4(0.5f*(n + 1.0f), 1.0f);\n"
+"}\n";
+}
+
+}
+
+/**
+ * Computes the tangent and normal maps of a height map using a single compute pass.
+ * When regions (x, y, width, height) are given, only the texels inside them are written.
+ */
+template<typename TextureType1, typename TextureType2, typename TextureType3>
+void computeTangentAndNormalMaps(const TextureType1 &heightMap, TextureType2 &tangentMap, TextureType3 &normalMap, const float &mapScale, const bool &readBack = true, const std::vector<ivec4> &regions = std::vector<ivec4>())
+{
+    std::vector<std::string> inputTextures;
+    std::vector<std::string> outputTextures;
+    const std::string fragmentShader =
+"#version 150\n"
+"\n"
+"precision highp float;\n"
+"\n"
+"uniform sampler2D source;\n"
+"uniform vec2 sourceInverseSize;\n"
+"uniform float mapScale;\n"
+"\n"
+"in vec2 tex;\n"
+"\n"
++ detail::getSurfaceMapShaderCode() +
+"\n"
+"void main(void)\n"
+"{\n"
+"   computeSurfaceMaps();\n"
+"}\n";
+    
+    inputTextures.push_back("source");
+    outputTextures.push_back("surfaceTangent");
+    outputTextures.push_back("surfaceNormal");
+
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
+    
+    computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
+    computeTexture->setInput(heightMap, "source");
+    computeTexture->setOutput(tangentMap, "surfaceTangent");
+    computeTexture->setOutput(normalMap, "surfaceNormal");
+    computeTexture->compute(regions);
+    
+    if (readBack)
+    {
+        tangentMap.getFromDevice();
+        normalMap.getFromDevice();
+    }
+}
+
+/**
+ * Computes an attribute map from a height map using a user-supplied fragment shader.
+ * The shader reads the height map from 'source' (with 'sourceInverseSize' and 'mapScale' available) and writes to 'colour'.
+ * When regions (x, y, width, height) are given, only the texels inside them are written.
+ */
+template<typename TextureType1, typename TextureType2>
+void computeAttributeMap(const TextureType1 &heightMap, TextureType2 &attributeMap, const std::string &attributeShaderCode, const float &mapScale, const bool &readBack = true, const std::vector<ivec4> &regions = std::vector<ivec4>())
+{
+    std::vector<std::string> inputTextures;
+    std::vector<std::string> outputTextures;
+    
+    inputTextures.push_back("source");
+    outputTextures.push_back("colour");
+
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, attributeShaderCode);
+    
+    computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
+    computeTexture->setInput(heightMap, "source");
+    computeTexture->setOutput(attributeMap, "colour");
+    computeTexture->compute(regions);
+    
+    if (readBack) attributeMap.getFromDevice();
+}
+
+/**
+ * Computes the tangent, normal, and attribute maps of a height map.
+ * When the attribute shader follows the usual convention (reading 'source', 'sourceInverseSize', and 'mapScale', writing 'colour' from 'void main(void)'), all three maps are written by a single pass that samples the height map once per texel.
+ * Otherwise, this falls back to separate passes.
+ * When regions (x, y, width, height) are given, only the texels inside them are written.
+ */
+template<typename TextureType1, typename TextureType2, typename TextureType3, typename TextureType4>
+void computeSurfaceMaps(const TextureType1 &heightMap, TextureType2 &tangentMap, TextureType3 &normalMap, TextureType4 &attributeMap,
+                        const std::string &attributeShaderCode, const float &mapScale, const bool &readBack = true, const std::vector<ivec4> &regions = std::vector<ivec4>())
+{
+    const std::string mainDeclaration = "void main(void)";
+    const size_t mainPosition = attributeShaderCode.find(mainDeclaration);
+    
+    if (mainPosition == std::string::npos ||
+        attributeShaderCode.find(mainDeclaration, mainPosition + 1) != std::string::npos ||
+        attributeShaderCode.find("sourceInverseSize") == std::string::npos ||
+        attributeShaderCode.find("mapScale") == std::string::npos)
+    {
+        computeTangentAndNormalMaps(heightMap, tangentMap, normalMap, mapScale, readBack, regions);
+        computeAttributeMap(heightMap, attributeMap, attributeShaderCode, mapScale, readBack, regions);
+        return;
+    }
+    
+    //Rename the attribute shader's entry point and call it from a new main function that also writes the tangent and normal.
+    std::vector<std::string> inputTextures;
+    std::vector<std::string> outputTextures;
+    const std::string fragmentShader = std::string(attributeShaderCode, 0, mainPosition) +
+"void computeAttributes(void)" +
+std::string(attributeShaderCode, mainPosition + mainDeclaration.size()) +
+"\n"
++ detail::getSurfaceMapShaderCode() +
+"\n"
+"void main(void)\n"
+"{\n"
+"   computeSurfaceMaps();\n"
+"   computeAttributes();\n"
+"}\n";
+    
+    inputTextures.push_back("source");
+    outputTextures.push_back("surfaceTangent");
+    outputTextures.push_back("surfaceNormal");
+    outputTextures.push_back("colour");
+
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
+    
+    computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
+    computeTexture->setInput(heightMap, "source");
+    computeTexture->setOutput(tangentMap, "surfaceTangent");
+    computeTexture->setOutput(normalMap, "surfaceNormal");
+    computeTexture->setOutput(attributeMap, "colour");
+    computeTexture->compute(regions);
+    
+    if (readBack)
+    {
+        tangentMap.getFromDevice();
+        normalMap.getFromDevice();
+        attributeMap.getFromDevice();
+    }
+}
+
+}
+
+}
+
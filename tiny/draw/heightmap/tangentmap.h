@@ -28,7 +28,7 @@ namespace draw
 {
 
 template<typename TextureType1, typename TextureType2>
-void computeTangentMap(const TextureType1 &heightMap, TextureType2 &tangentMap, const float &mapScale)
+void computeTangentMap(const TextureType1 &heightMap, TextureType2 &tangentMap, const float &mapScale, const bool &readBack = true)
 {
     std::vector<std::string> inputTextures;
     std::vector<std::string> outputTextures;
@@ -57,15 +57,14 @@ void computeTangentMap(const TextureType1 &heightMap, TextureType2 &tangentMap,
     inputTextures.push_back("source");
     outputTextures.push_back("tangent");
 
-    ComputeTexture *computeTexture = new ComputeTexture(inputTextures, outputTextures, fragmentShader);
+    ComputeTexture *computeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, fragmentShader);
     
     computeTexture->uniformMap().setFloatUniform(2.0f*mapScale, "mapScale");
     computeTexture->setInput(heightMap, "source");
     computeTexture->setOutput(tangentMap, "tangent");
     computeTexture->compute();
-    tangentMap.getFromDevice();
     
-    delete computeTexture;
+    if (readBack) tangentMap.getFromDevice();
 }
 
 }
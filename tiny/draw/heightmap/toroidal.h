@@ -0,0 +1,211 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <exception>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <tiny/math/vec.h>
+#include <tiny/draw/computetexture.h>
+#include <tiny/draw/heightmap/resize.h>
+#include <tiny/draw/heightmap/diamondsquare.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! Functions to update a window onto an infinite plane of texels that is stored toroidally in a repeating texture.
+ *
+ *  Texel (x, y) of the plane is stored at texel (x mod width, y mod height) of the texture, so moving the window by a few texels only requires the newly exposed strips to be computed.
+ *  Areas of the plane are given as rectangles (x, y, width, height) in plane texels, which may lie anywhere in the plane.
+ */
+
+/**
+ * Splits an area of the plane into rectangles (x, y, width, height) of a texture of the given size, after growing the area by border texels on each side.
+ * For each rectangle, the offset that should be added to its texels to obtain the corresponding texels of the plane is appended to offsets.
+ * An area that is larger than the texture is clipped to the size of the texture.
+ */
+inline void splitToroidalArea(const ivec2 &size, const ivec4 &area, std::vector<ivec4> &regions, std::vector<ivec2> &offsets, const int &border = 0)
+{
+    int start[2] = {area.x - border, area.y - border};
+    int length[2] = {area.z + 2*border, area.w + 2*border};
+    const int sizes[2] = {size.x, size.y};
+    int segments[2][2][3];
+    int nrSegments[2] = {0, 0};
+    
+    if (length[0] <= 0 || length[1] <= 0) return;
+    
+    //Split both axes into at most two segments (start in the texture, length, offset to the plane).
+    for (int i = 0; i < 2; ++i)
+    {
+        const int first = ((start[i] % sizes[i]) + sizes[i]) % sizes[i];
+        
+        length[i] = std::min(length[i], sizes[i]);
+        segments[i][0][0] = first;
+        segments[i][0][1] = std::min(length[i], sizes[i] - first);
+        segments[i][0][2] = start[i] - first;
+        nrSegments[i] = 1;
+        
+        if (segments[i][0][1] < length[i])
+        {
+            segments[i][1][0] = 0;
+            segments[i][1][1] = length[i] - segments[i][0][1];
+            segments[i][1][2] = start[i] - first + sizes[i];
+            nrSegments[i] = 2;
+        }
+    }
+    
+    for (int y = 0; y < nrSegments[1]; ++y)
+    {
+        for (int x = 0; x < nrSegments[0]; ++x)
+        {
+            regions.push_back(ivec4(segments[0][x][0], segments[1][y][0], segments[0][x][1], segments[1][y][1]));
+            offsets.push_back(ivec2(segments[0][x][2], segments[1][y][2]));
+        }
+    }
+}
+
+/**
+ * Returns the rectangles of a texture of the given size that store the areas of the plane, grown by border texels on each side.
+ */
+inline std::vector<ivec4> getToroidalRegions(const ivec2 &size, const std::vector<ivec4> &areas, const int &border = 0)
+{
+    std::vector<ivec4> regions;
+    std::vector<ivec2> offsets;
+    
+    for (std::vector<ivec4>::const_iterator i = areas.begin(); i != areas.end(); ++i)
+    {
+        splitToroidalArea(size, *i, regions, offsets, border);
+    }
+    
+    return regions;
+}
+
+/**
+ * Returns the areas of the plane that have to be recomputed when a window of the given size moves from oldOrigin to newOrigin.
+ * These are the newly exposed strips, grown by margin texels into the old window, because texels near the old edge depended on texels beyond it.
+ * The shift should be smaller than the size of the window minus the margin, otherwise the whole window should be recomputed.
+ */
+inline std::vector<ivec4> getToroidalShiftAreas(const ivec2 &size, const ivec2 &oldOrigin, const ivec2 &newOrigin, const int &margin)
+{
+    const ivec2 shift = newOrigin - oldOrigin;
+    std::vector<ivec4> areas;
+    
+    if (shift.x > 0) areas.push_back(ivec4(oldOrigin.x + size.x - margin, newOrigin.y, shift.x + margin, size.y));
+    else if (shift.x < 0) areas.push_back(ivec4(newOrigin.x, newOrigin.y, margin - shift.x, size.y));
+    
+    if (shift.y > 0) areas.push_back(ivec4(newOrigin.x, oldOrigin.y + size.y - margin, size.x, shift.y + margin));
+    else if (shift.y < 0) areas.push_back(ivec4(newOrigin.x, newOrigin.y, size.x, margin - shift.y));
+    
+    return areas;
+}
+
+/**
+ * Samples the areas of the plane into a toroidally stored destination texture, like computeResizedTexture().
+ * Texel (x, y) of the plane receives the source texture at ((x, y) + 0.5)/(size of the destination)*scale + add, which does not depend on where the window onto the plane lies.
+ */
+template<typename TextureType1, typename TextureType2>
+void computeToroidalResizedTexture(const TextureType1 &source, TextureType2 &dest, const vec2 &scale, const vec2 &add, const std::vector<ivec4> &areas)
+{
+    const ivec2 size = ivec2(dest.getWidth(), dest.getHeight());
+    std::vector<ivec4> regions;
+    std::vector<ivec2> offsets;
+    
+    for (std::vector<ivec4>::const_iterator i = areas.begin(); i != areas.end(); ++i)
+    {
+        splitToroidalArea(size, *i, regions, offsets);
+    }
+    
+    //Each rectangle has a constant offset to the plane, which becomes part of the translation.
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        const vec2 regionAdd = add + vec2(scale.x*static_cast<float>(offsets[i].x)/static_cast<float>(size.x),
+                                          scale.y*static_cast<float>(offsets[i].y)/static_cast<float>(size.y));
+        
+        computeResizedTexture(source, dest, scale, regionAdd, false, std::vector<ivec4>(1, regions[i]));
+    }
+}
+
+/**
+ * Refines the areas of a toroidally stored height map in place with the diamond-square algorithm, like computeDiamondSquareRefinement().
+ * The height map and the scratch texture should have the same size and repeat, and their size should be a multiple of the step size.
+ *
+ * The texels of the areas that lie on the coarsest lattice (multiples of the step size) are kept, and all other texels of the areas are refined from the texels around them.
+ * Texels outside the areas are not written, but they are read up to stepSize - 1 texels away from the areas, so they should already be refined.
+ */
+template<typename TextureType>
+void computeToroidalDiamondSquareRefinement(TextureType &heightMap, TextureType &scratch, const size_t &stepSize, const float &amplitude, const std::vector<ivec4> &areas)
+{
+    if (stepSize >= heightMap.getWidth() || stepSize >= heightMap.getHeight() || stepSize <= 1 || (stepSize & (stepSize - 1)) != 0 ||
+        heightMap.getWidth() % stepSize != 0 || heightMap.getHeight() % stepSize != 0)
+    {
+        std::cerr << "Invalid step size " << stepSize << " for toroidal diamond square algorithm on a " << heightMap.getWidth() << "x" << heightMap.getHeight() << " height map. Should be a power of two that divides the size." << std::endl;
+        throw std::exception();
+    }
+    
+    if (scratch.getWidth() != heightMap.getWidth() || scratch.getHeight() != heightMap.getHeight())
+    {
+        std::cerr << "The scratch texture of the toroidal diamond square algorithm should have the same size as the height map!" << std::endl;
+        throw std::exception();
+    }
+    
+    if (areas.empty()) return;
+    
+    const ivec2 size = ivec2(heightMap.getWidth(), heightMap.getHeight());
+    std::vector<std::string> inputTextures;
+    std::vector<std::string> outputTextures;
+    
+    inputTextures.push_back("source");
+    outputTextures.push_back("colour");
+    
+    ComputeTexture *diamondComputeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, detail::getDiamondShaderCode());
+    ComputeTexture *squareComputeTexture = ComputeTexture::getKernel(inputTextures, outputTextures, detail::getSquareShaderCode());
+    
+    diamondComputeTexture->uniformMap().setFloatUniform(amplitude, "amplitude");
+    diamondComputeTexture->uniformMap().setVec2Uniform(size.x, size.y, "sourceSize");
+    diamondComputeTexture->setInput(heightMap, "source");
+    diamondComputeTexture->setOutput(scratch, "colour");
+    
+    squareComputeTexture->uniformMap().setFloatUniform(amplitude, "amplitude");
+    squareComputeTexture->uniformMap().setVec2Uniform(size.x, size.y, "sourceSize");
+    squareComputeTexture->setInput(scratch, "source");
+    squareComputeTexture->setOutput(heightMap, "colour");
+    
+    const std::vector<ivec4> regions = getToroidalRegions(size, areas);
+    
+    for (size_t step = stepSize/2; step >= 1; step >>= 1)
+    {
+        diamondComputeTexture->uniformMap().setIntUniform(step, "step");
+        diamondComputeTexture->uniformMap().setVec2Uniform(static_cast<float>(step)/static_cast<float>(size.x), static_cast<float>(step)/static_cast<float>(size.y), "sourceStep");
+        squareComputeTexture->uniformMap().setIntUniform(step, "step");
+        squareComputeTexture->uniformMap().setVec2Uniform(static_cast<float>(step)/static_cast<float>(size.x), static_cast<float>(step)/static_cast<float>(size.y), "sourceStep");
+        
+        //Texels set by this step are final, so the scratch texture only needs the diamond vertices that the square step reads around the areas.
+        diamondComputeTexture->compute(getToroidalRegions(size, areas, step));
+        squareComputeTexture->compute(regions);
+    }
+}
+
+}
+
+}
+
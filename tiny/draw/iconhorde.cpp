@@ -132,9 +132,9 @@ std::string ScreenIconHorde::getFragmentShaderCode() const
 
 void ScreenIconHorde::render(const ShaderProgram &program) const
 {
-    icons.bind(program);
+    if (vertexArrays.bind(program, icons)) icons.bind(program);
     renderRangeAsPoints(0, nrIcons);
-    icons.unbind(program);
+    vertexArrays.unbind();
 }
 
 void ScreenIconHorde::appendText(vec4 & pos, const float &size, const float &aspectRatio, const std::string &text, const IconTexture2D &map, const Colour &colour, const vec4 &boxSize)
@@ -259,7 +259,7 @@ void ScreenIconHorde::setText(const float &x, const float &y, const float &size,
 }
 
 WorldIconVertexBufferInterpreter::WorldIconVertexBufferInterpreter(const size_t &nrIcons) :
-    VertexBufferInterpreter<WorldIconInstance>(nrIcons)
+    StreamingVertexBufferInterpreter<WorldIconInstance>(nrIcons)
 {
     addVec4Attribute(0*sizeof(float), "v_position");
     addVec2Attribute(4*sizeof(float), "v_size");
@@ -470,9 +470,10 @@ std::string WorldIconHorde::getFragmentShaderCode() const
 
 void WorldIconHorde::render(const ShaderProgram &program) const
 {
-    icons.bind(program);
+    if (vertexArrays.bind(program, icons)) icons.bind(program);
     renderRangeAsPoints(0, nrIcons);
-    icons.unbind(program);
+    vertexArrays.unbind();
+    icons.fence();
 }
 
 void WorldIconHorde::setText(const float &x, const float &y, const float &size, const std::string &text, const IconTexture2D &map)
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/vertexbuffer.h>
 #include <tiny/draw/vertexbufferinterpreter.h>
+#include <tiny/draw/streamingvertexbufferinterpreter.h>
 #include <tiny/draw/icontexture2d.h>
 #include <tiny/draw/colour.h>
 
@@ -132,7 +133,7 @@ struct WorldIconInstance
     vec4 colour;
 };
 
-class WorldIconVertexBufferInterpreter : public VertexBufferInterpreter<WorldIconInstance>
+class WorldIconVertexBufferInterpreter : public StreamingVertexBufferInterpreter<WorldIconInstance>
 {
     public:
         WorldIconVertexBufferInterpreter(const size_t &);
@@ -163,14 +164,27 @@ class WorldIconHorde : public Renderable
         template <typename Iterator>
         void setInstances(Iterator first, Iterator last)
         {
-            nrIcons = 0;
+            WorldIconInstance *instances = mapInstances();
+            size_t count = 0;
             
-            for (Iterator i = first; i != last && nrIcons < maxNrIcons; ++i)
+            for (Iterator i = first; i != last && count < maxNrIcons; ++i)
             {
-                icons[nrIcons++] = *i;
+                instances[count++] = *i;
             }
             
-            icons.sendToDevice();
+            unmapInstances(count);
+        }
+        
+        /** Returns memory to which up to maxNrIcons instances can be written directly, these are shown after calling unmapInstances() with the number of instances written. */
+        WorldIconInstance *mapInstances()
+        {
+            return icons.map();
+        }
+        
+        void unmapInstances(const size_t &count)
+        {
+            nrIcons = (count < maxNrIcons ? count : maxNrIcons);
+            icons.unmap(nrIcons);
         }
 
         
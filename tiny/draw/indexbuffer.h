@@ -32,8 +32,8 @@ template<typename T>
 class IndexBuffer : public Buffer<T>
 {
     public:
-        IndexBuffer(const size_t &a_size) :
-            Buffer<T>(a_size, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW)
+        IndexBuffer(const size_t &a_size, const unsigned int &a_flags = bf::none) :
+            Buffer<T>(a_size, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, a_flags)
         {
 
         }
@@ -45,8 +45,8 @@ class IndexBuffer : public Buffer<T>
         }
         
         template <typename Iterator>
-        IndexBuffer(Iterator first, Iterator last) :
-            Buffer<T>(first, last, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW)
+        IndexBuffer(Iterator first, Iterator last, const unsigned int &a_flags = bf::none) :
+            Buffer<T>(first, last, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, a_flags)
         {
 
         }
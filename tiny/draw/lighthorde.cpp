@@ -20,7 +20,7 @@ using namespace tiny;
 using namespace tiny::draw;
 
 PointLightVertexBufferInterpreter::PointLightVertexBufferInterpreter(const size_t &nrLights) :
-    VertexBufferInterpreter<PointLightInstance>(nrLights)
+    StreamingVertexBufferInterpreter<PointLightInstance>(nrLights)
 {
     addVec4Attribute(0*sizeof(float), "v_position");
     addVec4Attribute(4*sizeof(float), "v_colour");
@@ -142,8 +142,9 @@ std::string PointLightHorde::getFragmentShaderCode() const
 
 void PointLightHorde::render(const ShaderProgram &program) const
 {
-    lights.bind(program);
+    if (vertexArrays.bind(program, lights)) lights.bind(program);
     renderRangeAsPoints(0, nrLights);
-    lights.unbind(program);
+    vertexArrays.unbind();
+    lights.fence();
 }
 
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/vertexbuffer.h>
 #include <tiny/draw/vertexbufferinterpreter.h>
+#include <tiny/draw/streamingvertexbufferinterpreter.h>
 #include <tiny/draw/icontexture2d.h>
 
 namespace tiny
@@ -47,7 +48,7 @@ struct PointLightInstance
     vec4 colour;
 };
 
-class PointLightVertexBufferInterpreter : public VertexBufferInterpreter<PointLightInstance>
+class PointLightVertexBufferInterpreter : public StreamingVertexBufferInterpreter<PointLightInstance>
 {
     public:
         PointLightVertexBufferInterpreter(const size_t &);
@@ -67,14 +68,27 @@ class PointLightHorde : public Renderable
         template <typename Iterator>
         void setLights(Iterator first, Iterator last)
         {
-            nrLights = 0;
+            PointLightInstance *instances = mapLights();
+            size_t count = 0;
             
-            for (Iterator i = first; i != last && nrLights < maxNrLights; ++i)
+            for (Iterator i = first; i != last && count < maxNrLights; ++i)
             {
-                lights[nrLights++] = *i;
+                instances[count++] = *i;
             }
             
-            lights.sendToDevice();
+            unmapLights(count);
+        }
+        
+        /** Returns memory to which up to maxNrLights lights can be written directly, these are shown after calling unmapLights() with the number of lights written. */
+        PointLightInstance *mapLights()
+        {
+            return lights.map();
+        }
+        
+        void unmapLights(const size_t &count)
+        {
+            nrLights = (count < maxNrLights ? count : maxNrLights);
+            lights.unmap(nrLights);
         }
         
     protected:
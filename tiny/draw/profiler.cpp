@@ -0,0 +1,252 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <SDL.h>
+
+#include <tiny/draw/glcheck.h>
+#include <tiny/draw/iconhorde.h>
+#include <tiny/draw/icontexture2d.h>
+#include <tiny/draw/profiler.h>
+
+using namespace tiny::draw;
+
+namespace
+{
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+bool compareTimings(const std::pair<double, std::pair<std::string, unsigned int> > &a, const std::pair<double, std::pair<std::string, unsigned int> > &b)
+{
+    return a.first > b.first;
+}
+
+}
+
+FrameProfiler::FrameProfiler(const size_t &a_maxNrSamples) :
+    maxNrSamples(a_maxNrSamples),
+    current(0),
+    nrQueriesUsed(0),
+    sampleStart(0.0),
+    sampleActive(false),
+    nrFrames(0),
+    renderableTimings(),
+    stageTimings()
+{
+    //Timestamp queries, unlike elapsed time queries, can be issued while another timer query is active.
+    if (GLEW_VERSION_3_3 || GLEW_ARB_timer_query)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            queries[i].assign(2*maxNrSamples, 0);
+            GL_CHECK(glGenQueries(queries[i].size(), &queries[i][0]));
+        }
+    }
+    else
+    {
+        std::cerr << "Warning: timer queries are not supported, only CPU times will be profiled!" << std::endl;
+    }
+    
+    samples[0].reserve(maxNrSamples);
+    samples[1].reserve(maxNrSamples);
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!queries[i].empty()) glDeleteQueries(queries[i].size(), &queries[i][0]);
+    }
+}
+
+void FrameProfiler::beginFrame()
+{
+    if (sampleActive) endRenderable();
+    
+    //Switch query sets and collect the results of the frame before the previous one, which used the same set.
+    current = 1 - current;
+    nrQueriesUsed = 0;
+    resolveSamples(samples[current]);
+}
+
+void FrameProfiler::beginRenderable(const std::string &stage, const unsigned int &index)
+{
+    if (sampleActive) endRenderable();
+    
+    int query = -1;
+    
+    if (!queries[current].empty() && nrQueriesUsed + 2 <= static_cast<int>(queries[current].size()))
+    {
+        query = nrQueriesUsed;
+        nrQueriesUsed += 2;
+        GL_CHECK(glQueryCounter(queries[current][query], GL_TIMESTAMP));
+    }
+    
+    samples[current].push_back(detail::ProfileSample(stage, index, query));
+    sampleActive = true;
+    sampleStart = getTime();
+}
+
+void FrameProfiler::endRenderable()
+{
+    if (!sampleActive) return;
+    
+    detail::ProfileSample &sample = samples[current].back();
+    
+    sample.cpuTime = getTime() - sampleStart;
+    sampleActive = false;
+    
+    if (sample.query >= 0)
+    {
+        GL_CHECK(glQueryCounter(queries[current][sample.query + 1], GL_TIMESTAMP));
+    }
+}
+
+void FrameProfiler::resolveSamples(std::vector<detail::ProfileSample> &frameSamples)
+{
+    if (frameSamples.empty()) return;
+    
+    //Queries complete in order, so if the last one is available, all are. Never wait for them.
+    bool gpuAvailable = false;
+    
+    for (std::vector<detail::ProfileSample>::const_reverse_iterator i = frameSamples.rbegin(); i != frameSamples.rend(); ++i)
+    {
+        if (i->query >= 0)
+        {
+            GLint available = 0;
+            
+            GL_CHECK(glGetQueryObjectiv(queries[current][i->query + 1], GL_QUERY_RESULT_AVAILABLE, &available));
+            gpuAvailable = (available != 0);
+            break;
+        }
+    }
+    
+    std::map<std::string, ProfileTimings> frameStageTimings;
+    
+    for (std::vector<detail::ProfileSample>::const_iterator i = frameSamples.begin(); i != frameSamples.end(); ++i)
+    {
+        double gpuTime = -1.0;
+        
+        if (gpuAvailable && i->query >= 0)
+        {
+            GLuint64 start = 0, end = 0;
+            
+            GL_CHECK(glGetQueryObjectui64v(queries[current][i->query], GL_QUERY_RESULT, &start));
+            GL_CHECK(glGetQueryObjectui64v(queries[current][i->query + 1], GL_QUERY_RESULT, &end));
+            gpuTime = (end > start ? 1.0e-9*static_cast<double>(end - start) : 0.0);
+        }
+        
+        const ProfileTimings timings(i->cpuTime, gpuTime);
+        
+        renderableTimings[std::make_pair(i->stage, i->index)] += timings;
+        frameStageTimings[i->stage] += timings;
+    }
+    
+    //Each stage counts as a single sample per frame.
+    for (std::map<std::string, ProfileTimings>::const_iterator i = frameStageTimings.begin(); i != frameStageTimings.end(); ++i)
+    {
+        stageTimings[i->first] += ProfileTimings(i->second.cpuTime, i->second.nrGPUSamples > 0 ? i->second.gpuTime : -1.0);
+    }
+    
+    ++nrFrames;
+    frameSamples.clear();
+}
+
+void FrameProfiler::reset()
+{
+    nrFrames = 0;
+    renderableTimings.clear();
+    stageTimings.clear();
+}
+
+bool FrameProfiler::hasGPUTimings() const
+{
+    return !queries[0].empty();
+}
+
+unsigned int FrameProfiler::getNrFrames() const
+{
+    return nrFrames;
+}
+
+const std::map<std::pair<std::string, unsigned int>, ProfileTimings> &FrameProfiler::getRenderableTimings() const
+{
+    return renderableTimings;
+}
+
+const std::map<std::string, ProfileTimings> &FrameProfiler::getStageTimings() const
+{
+    return stageTimings;
+}
+
+std::string FrameProfiler::getReport(const size_t &maxNrRenderables) const
+{
+    std::ostringstream stream;
+    
+    stream << std::fixed << std::setprecision(2);
+    stream << "Profiled " << nrFrames << " frames (ms):" << std::endl;
+    
+    for (std::map<std::string, ProfileTimings>::const_iterator i = stageTimings.begin(); i != stageTimings.end(); ++i)
+    {
+        stream << i->first << ": CPU " << 1.0e3*i->second.getCPUTime();
+        if (i->second.getGPUTime() >= 0.0) stream << ", GPU " << 1.0e3*i->second.getGPUTime();
+        stream << std::endl;
+    }
+    
+    //List the most expensive renderables, by GPU time if available.
+    std::vector<std::pair<double, std::pair<std::string, unsigned int> > > costs;
+    
+    for (std::map<std::pair<std::string, unsigned int>, ProfileTimings>::const_iterator i = renderableTimings.begin(); i != renderableTimings.end(); ++i)
+    {
+        costs.push_back(std::make_pair(i->second.getGPUTime() >= 0.0 ? i->second.getGPUTime() : i->second.getCPUTime(), i->first));
+    }
+    
+    std::sort(costs.begin(), costs.end(), compareTimings);
+    
+    for (size_t i = 0; i < costs.size() && i < maxNrRenderables; ++i)
+    {
+        const ProfileTimings &timings = renderableTimings.find(costs[i].second)->second;
+        
+        stream << "  " << costs[i].second.first << " " << costs[i].second.second << ": CPU " << 1.0e3*timings.getCPUTime();
+        if (timings.getGPUTime() >= 0.0) stream << ", GPU " << 1.0e3*timings.getGPUTime();
+        stream << std::endl;
+    }
+    
+    return stream.str();
+}
+
+void FrameProfiler::printReport(const size_t &maxNrRenderables) const
+{
+    std::cerr << getReport(maxNrRenderables);
+}
+
+void FrameProfiler::updateOverlay(ScreenIconHorde &overlay, const IconTexture2D &font, const float &x, const float &y, const float &size, const float &aspectRatio, const size_t &maxNrRenderables) const
+{
+    //Lines of text are placed upwards from (x, y), so reverse them such that the report reads from top to bottom.
+    std::istringstream report(getReport(maxNrRenderables));
+    std::string line, text;
+    
+    while (std::getline(report, line)) text = line + "\n" + text;
+    
+    overlay.setText(x, y, size, aspectRatio, text, font);
+}
+
@@ -0,0 +1,155 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <GL/glew.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+class ScreenIconHorde;
+class IconTexture2D;
+
+/*! Accumulated CPU and GPU time, in seconds, of a renderable or rendering stage. */
+struct ProfileTimings
+{
+    ProfileTimings() :
+        nrSamples(0),
+        nrGPUSamples(0),
+        cpuTime(0.0),
+        gpuTime(0.0)
+    {
+
+    }
+    
+    ProfileTimings(const double &a_cpuTime, const double &a_gpuTime) :
+        nrSamples(1),
+        nrGPUSamples(a_gpuTime >= 0.0 ? 1 : 0),
+        cpuTime(a_cpuTime),
+        gpuTime(a_gpuTime >= 0.0 ? a_gpuTime : 0.0)
+    {
+
+    }
+    
+    ProfileTimings & operator += (const ProfileTimings &a)
+    {
+        nrSamples += a.nrSamples;
+        nrGPUSamples += a.nrGPUSamples;
+        cpuTime += a.cpuTime;
+        gpuTime += a.gpuTime;
+        return *this;
+    }
+    
+    /** Returns the average CPU time per sample. */
+    double getCPUTime() const
+    {
+        return (nrSamples > 0 ? cpuTime/static_cast<double>(nrSamples) : 0.0);
+    }
+    
+    /** Returns the average GPU time per sample, or a negative value if no GPU timings are available. */
+    double getGPUTime() const
+    {
+        return (nrGPUSamples > 0 ? gpuTime/static_cast<double>(nrGPUSamples) : -1.0);
+    }
+    
+    unsigned int nrSamples;
+    unsigned int nrGPUSamples;
+    double cpuTime;
+    double gpuTime;
+};
+
+namespace detail
+{
+
+struct ProfileSample
+{
+    ProfileSample(const std::string &a_stage, const unsigned int &a_index, const int &a_query) :
+        stage(a_stage),
+        index(a_index),
+        query(a_query),
+        cpuTime(0.0)
+    {
+
+    }
+    
+    std::string stage;
+    unsigned int index;
+    int query;
+    double cpuTime;
+};
+
+}
+
+/*! \p FrameProfiler : measures the CPU and GPU time spent on each renderable of the renderers it is attached to.
+ * 
+ *  Attach the profiler with Renderer::setProfiler() or WorldRenderer::setProfiler() and call beginFrame() once at the start of every frame.
+ *  os::HeadlessApplication owns a profiler that it advances every frame and reports at the end of a benchmark.
+ *  GPU time is measured with timestamp queries, alternating between two sets of queries each frame, such that results are read back one frame later without stalling the pipeline.
+ *  Timings are accumulated per renderable index and per rendering stage until reset() is called.
+ */
+class FrameProfiler
+{
+    public:
+        FrameProfiler(const size_t & = 256);
+        ~FrameProfiler();
+        
+        void beginFrame();
+        void beginRenderable(const std::string &, const unsigned int &);
+        void endRenderable();
+        
+        void reset();
+        
+        bool hasGPUTimings() const;
+        unsigned int getNrFrames() const;
+        const std::map<std::pair<std::string, unsigned int>, ProfileTimings> &getRenderableTimings() const;
+        const std::map<std::string, ProfileTimings> &getStageTimings() const;
+        
+        std::string getReport(const size_t & = 8) const;
+        void printReport(const size_t & = 8) const;
+        void updateOverlay(ScreenIconHorde &, const IconTexture2D &, const float &, const float &, const float &, const float &, const size_t & = 8) const;
+        
+    private:
+        void resolveSamples(std::vector<detail::ProfileSample> &);
+        
+        //This class should not be copied.
+        FrameProfiler(const FrameProfiler &);
+        
+        const size_t maxNrSamples;
+        std::vector<GLuint> queries[2];
+        std::vector<detail::ProfileSample> samples[2];
+        int current;
+        int nrQueriesUsed;
+        double sampleStart;
+        bool sampleActive;
+        
+        unsigned int nrFrames;
+        std::map<std::pair<std::string, unsigned int>, ProfileTimings> renderableTimings;
+        std::map<std::string, ProfileTimings> stageTimings;
+};
+
+}
+
+}
+
@@ -21,12 +21,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace tiny::draw;
 
-Renderable::Renderable()
+Renderable::Renderable() :
+    uniformMap(),
+    vertexArrays()
 {
     createVertexArray();
 }
 
-Renderable::Renderable(const Renderable &)
+Renderable::Renderable(const Renderable &) :
+    uniformMap(),
+    vertexArrays()
 {
     //TODO.
     createVertexArray();
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/shader.h>
 #include <tiny/draw/shaderprogram.h>
 #include <tiny/draw/uniformmap.h>
+#include <tiny/draw/vertexarraycache.h>
 #include <tiny/draw/detail/formats.h>
 
 namespace tiny
@@ -100,6 +101,7 @@ class Renderable
         }
         
         UniformMap uniformMap;
+        VertexArrayCache vertexArrays;
         
     private:
         void createVertexArray();
@@ -16,11 +16,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <algorithm>
 
+#include <SDL.h>
+
 #include <tiny/hash/md5.h>
 #include <tiny/draw/renderer.h>
 
 using namespace tiny::draw;
 
+namespace
+{
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+}
+
 detail::BoundProgram::BoundProgram(const std::string &a_vertexShaderCode, const std::string &a_geometryShaderCode, const std::string &a_fragmentShaderCode) :
     hash(tiny::hash::md5hash(a_vertexShaderCode + a_geometryShaderCode + a_fragmentShaderCode)),
     vertexShader(0),
@@ -121,6 +133,41 @@ void detail::BoundProgram::link()
     program->link();
 }
 
+std::string detail::BoundProgram::getCacheKey(const std::vector<std::string> &renderTargetNames) const
+{
+    //The render targets are bound before linking, so they are part of the program binary.
+    std::string key = vertexShaderCode + "\n" + geometryShaderCode + "\n" + fragmentShaderCode;
+    
+    for (std::vector<std::string>::const_iterator i = renderTargetNames.begin(); i != renderTargetNames.end(); ++i)
+    {
+        key += "\n" + *i;
+    }
+    
+    return ShaderProgramCache::getKey(key);
+}
+
+bool detail::BoundProgram::loadFromCache(const std::string &key)
+{
+    if (!ShaderProgramCache::isEnabled()) return false;
+    
+    if (program) delete program;
+    
+    program = new ShaderProgram();
+    
+    if (ShaderProgramCache::load(*program, key)) return true;
+    
+    delete program;
+    program = 0;
+    
+    return false;
+}
+
+void detail::BoundProgram::storeInCache(const std::string &key, const double &buildTime) const
+{
+    assert(program);
+    ShaderProgramCache::store(*program, key, buildTime);
+}
+
 bool detail::BoundProgram::validate() const
 {
     if (program) return program->validate();
@@ -145,12 +192,88 @@ unsigned int detail::BoundProgram::numRenderables() const
     return renderableIndices.size();
 }
 
+detail::RenderState::RenderState(RenderStatistics &a_statistics) :
+    statistics(a_statistics),
+    depthTest(-1),
+    depthMask(-1),
+    blendMode(-1),
+    cullMode(-1)
+{
+
+}
+
+void detail::RenderState::setDepthTest(const bool &enable)
+{
+    if (depthTest == static_cast<int>(enable)) return;
+    
+    if (enable) GL_CHECK(glEnable(GL_DEPTH_TEST));
+    else GL_CHECK(glDisable(GL_DEPTH_TEST));
+    
+    depthTest = enable;
+    ++statistics.nrStateChanges;
+}
+
+void detail::RenderState::setDepthMask(const bool &enable)
+{
+    if (depthMask == static_cast<int>(enable)) return;
+    
+    GL_CHECK(glDepthMask(enable ? GL_TRUE : GL_FALSE));
+    
+    depthMask = enable;
+    ++statistics.nrStateChanges;
+}
+
+void detail::RenderState::setBlendMode(const BlendMode &mode)
+{
+    if (blendMode == static_cast<int>(mode)) return;
+    
+    if (mode == BlendReplace)
+    {
+        GL_CHECK(glDisable(GL_BLEND));
+    }
+    else
+    {
+        if (blendMode < 0 || blendMode == BlendReplace) GL_CHECK(glEnable(GL_BLEND));
+        
+             if (mode == BlendAdd) GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+        else if (mode == BlendMix) GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+    }
+    
+    blendMode = mode;
+    ++statistics.nrStateChanges;
+}
+
+void detail::RenderState::setCullMode(const CullMode &mode)
+{
+    if (cullMode == static_cast<int>(mode)) return;
+    
+    if (mode == CullNothing)
+    {
+        GL_CHECK(glDisable(GL_CULL_FACE));
+    }
+    else
+    {
+        if (cullMode < 0 || cullMode == CullNothing) GL_CHECK(glEnable(GL_CULL_FACE));
+        
+        GL_CHECK(glCullFace(mode == CullBack ? GL_BACK : GL_FRONT));
+    }
+    
+    cullMode = mode;
+    ++statistics.nrStateChanges;
+}
+
 Renderer::Renderer() :
     frameBufferIndex(0),
     renderTargetNames(),
     renderTargetTextures(),
     depthTargetTexture(0),
-    viewportSize(0, 0)
+    viewportSize(0, 0),
+    renderOrder(RenderInIndexOrder),
+    renderQueue(),
+    renderQueueIsValid(false),
+    renderStatistics(),
+    profiler(0),
+    profilerStage()
 {
     
 }
@@ -159,7 +282,13 @@ Renderer::Renderer(const Renderer &) :
     frameBufferIndex(0),
     renderTargetNames(),
     renderTargetTextures(),
-    depthTargetTexture(0)
+    depthTargetTexture(0),
+    renderOrder(RenderInIndexOrder),
+    renderQueue(),
+    renderQueueIsValid(false),
+    renderStatistics(),
+    profiler(0),
+    profilerStage()
 {
     
 }
@@ -226,18 +355,26 @@ void Renderer::addRenderable(const unsigned int &renderableIndex, Renderable *re
     //Has this program already been compiled earlier?
     if (k == shaderPrograms.end())
     {
-        //If not, then add it to the list of programs.
-        shaderProgram->compile();
+        //If not, then add it to the list of programs, loading it from the cache if it was linked before.
+        const std::string cacheKey = shaderProgram->getCacheKey(renderTargetNames);
         
-        //Set program outputs.
-        for (size_t i = 0; i < renderTargetNames.size(); ++i)
+        if (!shaderProgram->loadFromCache(cacheKey))
         {
-            std::cerr << "Bound '" << renderTargetNames[i].c_str() << "' to colour number " << i << " for program " << shaderProgram->getProgram().getIndex() << "." << std::endl;
-            shaderProgram->bindRenderTarget(i, renderTargetNames[i]);
+            const double startTime = getTime();
+            
+            shaderProgram->compile();
+            
+            //Set program outputs.
+            for (size_t i = 0; i < renderTargetNames.size(); ++i)
+            {
+                std::cerr << "Bound '" << renderTargetNames[i].c_str() << "' to colour number " << i << " for program " << shaderProgram->getProgram().getIndex() << "." << std::endl;
+                shaderProgram->bindRenderTarget(i, renderTargetNames[i]);
+            }
+            
+            shaderProgram->link();
+            shaderProgram->storeInCache(cacheKey, getTime() - startTime);
         }
         
-        shaderProgram->link();
-        
         //Bind uniforms and textures to program.
         shaderProgram->bind();
         shaderProgram->setUniformsAndTextures(uniformMap);
@@ -261,6 +398,7 @@ void Renderer::addRenderable(const unsigned int &renderableIndex, Renderable *re
     
     k->second->addRenderableIndex(renderableIndex);
     renderables.insert(std::make_pair(renderableIndex, new detail::BoundRenderable(renderable, k->first, readFromDepthTexture, writeToDepthTexture, blendMode, cullMode)));
+    renderQueueIsValid = false;
 }
 
 bool Renderer::freeRenderable(const unsigned int &renderableIndex)
@@ -282,6 +420,7 @@ bool Renderer::freeRenderable(const unsigned int &renderableIndex)
     //Remove renderable.
     delete renderable;
     renderables.erase(j);
+    renderQueueIsValid = false;
     
     //Remove shader program if it is no longer referenced by any renderable.
     if (k->second->numRenderables() == 0)
@@ -350,15 +489,87 @@ void Renderer::updateRenderTargets()
 
 void Renderer::clearTargets() const
 {
-    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frameBufferIndex));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frameBufferIndex != 0 ? frameBufferIndex : screenFrameBufferIndex));
     GL_CHECK(glDepthMask(GL_TRUE));
     GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
     GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
+GLuint Renderer::screenFrameBufferIndex = 0;
+
+void Renderer::setScreenFrameBuffer(const GLuint &index)
+{
+    //Renderers without render targets draw to this frame buffer, 0 is the screen.
+    screenFrameBufferIndex = index;
+}
+
+void Renderer::setRenderOrder(const RenderOrder &order)
+{
+    renderOrder = order;
+    renderQueueIsValid = false;
+}
+
+RenderStatistics Renderer::getRenderStatistics() const
+{
+    return renderStatistics;
+}
+
+void Renderer::setProfiler(FrameProfiler *a_profiler, const std::string &stage)
+{
+    profiler = a_profiler;
+    profilerStage = stage;
+}
+
+void Renderer::updateRenderQueue() const
+{
+    renderQueue.clear();
+    renderQueue.reserve(renderables.size());
+    
+    //Renderables without depth testing, or opaque renderables that do not write depth, depend on what has been drawn before them.
+    //These act as barriers: other renderables are never moved across them.
+    unsigned int segment = 0;
+    
+    for (std::map<unsigned int, detail::BoundRenderable *>::const_iterator i = renderables.begin(); i != renderables.end(); ++i)
+    {
+        const detail::BoundRenderable *renderable = i->second;
+        
+        //We should never have invalid hashes.
+        assert(shaderPrograms.find(renderable->shaderProgramHash) != shaderPrograms.end());
+        
+        detail::RenderQueueEntry entry(i->first, renderable, shaderPrograms.find(renderable->shaderProgramHash)->second);
+        
+        if (renderOrder == RenderStateSorted)
+        {
+            if (!renderable->readFromDepthTexture || (renderable->blendMode == BlendReplace && !renderable->writeToDepthTexture))
+            {
+                entry.segment = ++segment;
+                ++segment;
+            }
+            else if (renderable->blendMode == BlendReplace)
+            {
+                //Opaque renderables can be drawn in any order.
+                entry.segment = segment;
+                entry.programKey = renderable->shaderProgramHash;
+                entry.stateKey = renderable->cullMode;
+            }
+            else
+            {
+                //Blended renderables are drawn after the opaque ones, in index order.
+                entry.segment = segment;
+                entry.pass = 1;
+            }
+        }
+        
+        renderQueue.push_back(entry);
+    }
+    
+    std::sort(renderQueue.begin(), renderQueue.end());
+    renderQueueIsValid = true;
+}
+
 void Renderer::render() const
 {
-    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frameBufferIndex));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frameBufferIndex != 0 ? frameBufferIndex : screenFrameBufferIndex));
     //GL_CHECK(glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT));
     
     if (viewportSize.x > 0 && viewportSize.y > 0)
@@ -366,59 +577,33 @@ void Renderer::render() const
         GL_CHECK(glViewport(0, 0, viewportSize.x, viewportSize.y));
     }
     
-    //Try to minimize shader program switching.
-    unsigned int lastShaderProgramHash = 0;
+    if (!renderQueueIsValid) updateRenderQueue();
+    
+    //Only change the OpenGL state and shader program when required.
+    renderStatistics = RenderStatistics();
+    renderStatistics.nrRenderables = renderQueue.size();
+    
+    detail::RenderState state(renderStatistics);
     const detail::BoundProgram *shaderProgram = 0;
-    unsigned int nrShaderProgramSwitches = 0;
     
     uniformMap.bindTextures();
     
-    for (std::map<unsigned int, detail::BoundRenderable *>::const_iterator i = renderables.begin(); i != renderables.end(); ++i)
+    for (std::vector<detail::RenderQueueEntry>::const_iterator i = renderQueue.begin(); i != renderQueue.end(); ++i)
     {
-        const detail::BoundRenderable *renderable = i->second;
-        
-        if (renderable->readFromDepthTexture) GL_CHECK(glEnable(GL_DEPTH_TEST));
-        else GL_CHECK(glDisable(GL_DEPTH_TEST));
-        
-        GL_CHECK(glDepthMask(renderable->writeToDepthTexture ? GL_TRUE : GL_FALSE));
-
-        if (renderable->blendMode == BlendReplace)
-        {
-            GL_CHECK(glDisable(GL_BLEND));
-        }
-        else
-        {
-            GL_CHECK(glEnable(GL_BLEND));
-            
-                 if (renderable->blendMode == BlendAdd) GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-            else if (renderable->blendMode == BlendMix) GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-        }
+        const detail::BoundRenderable *renderable = i->renderable;
         
-        if (renderable->cullMode == CullBack)
-        {
-            GL_CHECK(glEnable(GL_CULL_FACE));
-            GL_CHECK(glCullFace(GL_BACK));
-        }
-        else if (renderable->cullMode == CullFront)
-        {
-            GL_CHECK(glEnable(GL_CULL_FACE));
-            GL_CHECK(glCullFace(GL_FRONT));
-        }
-        else if (renderable->cullMode == CullNothing)
-        {
-            GL_CHECK(glDisable(GL_CULL_FACE));
-        }
+        state.setDepthTest(renderable->readFromDepthTexture);
+        state.setDepthMask(renderable->writeToDepthTexture);
+        state.setBlendMode(renderable->blendMode);
+        state.setCullMode(renderable->cullMode);
         
         //TODO: Is this very inefficient? Should we let the rendererable decide whether or not to update the uniforms every frame?
-        if (renderable->shaderProgramHash != lastShaderProgramHash)
+        if (i->program != shaderProgram)
         {
             //If we have a different shader program, bind it.
-            lastShaderProgramHash = renderable->shaderProgramHash;
-            ++nrShaderProgramSwitches;
+            shaderProgram = i->program;
+            ++renderStatistics.nrProgramSwitches;
             
-            //We should never have invalid hashes.
-            assert(shaderPrograms.find(lastShaderProgramHash) != shaderPrograms.end());
-            shaderProgram = shaderPrograms.find(lastShaderProgramHash)->second;
             shaderProgram->bind();
             shaderProgram->setUniforms(uniformMap);
         }
@@ -428,9 +613,15 @@ void Renderer::render() const
         shaderProgram->setUniforms(renderable->renderable->uniformMap);
         
         renderable->renderable->uniformMap.bindTextures(uniformMap.getNrTextures());
+        
+        if (profiler) profiler->beginRenderable(profilerStage, i->index);
+        
         renderable->renderable->bind();
         renderable->renderable->render(shaderProgram->getProgram());
         renderable->renderable->unbind();
+        
+        if (profiler) profiler->endRenderable();
+        
         renderable->renderable->uniformMap.unbindTextures(uniformMap.getNrTextures());
     }
     
@@ -440,9 +631,4 @@ void Renderer::render() const
     
     //GL_CHECK(glPopAttrib());
     GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-    
-#ifndef NDEBUG
-    //std::cerr << "Switched shaders " << nrShaderProgramSwitches << " times for " << renderables.size() << " renderables." << std::endl;
-#endif
 }
-
@@ -26,9 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cassert>
 
 #include <tiny/draw/glcheck.h>
+#include <tiny/draw/profiler.h>
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/shader.h>
 #include <tiny/draw/shaderprogram.h>
+#include <tiny/draw/shaderprogramcache.h>
 #include <tiny/draw/texture2d.h>
 #include <tiny/draw/uniformmap.h>
 
@@ -52,6 +54,37 @@ enum BlendMode
     BlendMix
 };
 
+/*! Order in which a \p Renderer draws its renderables. */
+enum RenderOrder
+{
+    RenderInIndexOrder, /**< Draw renderables in order of increasing index. */
+    RenderStateSorted   /**< Draw opaque, depth-tested renderables grouped by shader program and OpenGL state, followed by depth-tested blended renderables in index order. Renderables without depth testing keep their place in the index order. */
+};
+
+/*! Number of OpenGL state changes issued by a \p Renderer during the last call to render(). */
+struct RenderStatistics
+{
+    RenderStatistics() :
+        nrRenderables(0),
+        nrStateChanges(0),
+        nrProgramSwitches(0)
+    {
+
+    }
+    
+    RenderStatistics & operator += (const RenderStatistics &a)
+    {
+        nrRenderables += a.nrRenderables;
+        nrStateChanges += a.nrStateChanges;
+        nrProgramSwitches += a.nrProgramSwitches;
+        return *this;
+    }
+    
+    unsigned int nrRenderables;
+    unsigned int nrStateChanges;
+    unsigned int nrProgramSwitches;
+};
+
 namespace detail
 {
 
@@ -65,6 +98,9 @@ class BoundProgram
         void unbind() const;
         void compile();
         void link();
+        std::string getCacheKey(const std::vector<std::string> &) const;
+        bool loadFromCache(const std::string &);
+        void storeInCache(const std::string &, const double &) const;
         void bindRenderTarget(const unsigned int &, const std::string &) const;
         void setUniforms(const UniformMap &) const;
         void setUniformsAndTextures(const UniformMap &, const int & = 0) const;
@@ -116,6 +152,58 @@ struct BoundRenderable
     CullMode cullMode;
 };
 
+/*! Entry of the render queue, ordered by segment, pass, shader program, OpenGL state and finally renderable index. */
+struct RenderQueueEntry
+{
+    RenderQueueEntry(const unsigned int &a_index, const BoundRenderable *a_renderable, const BoundProgram *a_program) :
+        segment(0),
+        pass(0),
+        programKey(0),
+        stateKey(0),
+        index(a_index),
+        renderable(a_renderable),
+        program(a_program)
+    {
+
+    }
+    
+    bool operator < (const RenderQueueEntry &a) const
+    {
+        if (segment != a.segment) return segment < a.segment;
+        if (pass != a.pass) return pass < a.pass;
+        if (programKey != a.programKey) return programKey < a.programKey;
+        if (stateKey != a.stateKey) return stateKey < a.stateKey;
+        return index < a.index;
+    }
+    
+    unsigned int segment;
+    unsigned int pass;
+    unsigned int programKey;
+    unsigned int stateKey;
+    unsigned int index;
+    const BoundRenderable *renderable;
+    const BoundProgram *program;
+};
+
+/*! Keeps track of the current OpenGL state during rendering to avoid redundant state changes. */
+class RenderState
+{
+    public:
+        RenderState(RenderStatistics &);
+        
+        void setDepthTest(const bool &);
+        void setDepthMask(const bool &);
+        void setBlendMode(const BlendMode &);
+        void setCullMode(const CullMode &);
+        
+    private:
+        RenderStatistics &statistics;
+        int depthTest;
+        int depthMask;
+        int blendMode;
+        int cullMode;
+};
+
 }
 
 /*! \p Renderer : a class capable of drawing \p Renderable objects to \p RenderTarget objects.
@@ -143,6 +231,14 @@ class Renderer
         void clearTargets() const;
         void render() const;
         
+        void setRenderOrder(const RenderOrder &);
+        RenderStatistics getRenderStatistics() const;
+        
+        /** Measure the time spent on each renderable with the given profiler, under the given stage name. Pass 0 to stop profiling. */
+        void setProfiler(FrameProfiler *, const std::string &);
+        
+        static void setScreenFrameBuffer(const GLuint &);
+        
     protected:
         void addRenderTarget(const std::string &name);
         
@@ -176,6 +272,7 @@ class Renderer
         void createFrameBuffer();
         void destroyFrameBuffer();
         void updateRenderTargets();
+        void updateRenderQueue() const;
         
         //This class should not be copied.
         Renderer(const Renderer &renderer);
@@ -187,6 +284,17 @@ class Renderer
         std::vector<GLuint> renderTargetTextures;
         GLuint depthTargetTexture;
         ivec2 viewportSize;
+        
+        RenderOrder renderOrder;
+        mutable std::vector<detail::RenderQueueEntry> renderQueue;
+        mutable bool renderQueueIsValid;
+        mutable RenderStatistics renderStatistics;
+        
+        FrameProfiler *profiler;
+        std::string profilerStage;
+        
+        //Frame buffer used by renderers without render targets instead of the screen, for offscreen rendering.
+        static GLuint screenFrameBufferIndex;
 };
 
 }
@@ -26,14 +26,15 @@ RendererWithCamera::RendererWithCamera(const float &aspectRatio) :
     cameraToWorld(mat4::identityMatrix()),
     worldToCamera(mat4::identityMatrix()),
     worldToScreen(mat4::identityMatrix()),
-    cameraPosition(0.0f, 0.0f, 0.0f)
+    cameraPosition(0.0f, 0.0f, 0.0f),
+    cameraUniformBuffer(0)
 {
     updateCameraUniforms();
 }
 
 RendererWithCamera::~RendererWithCamera()
 {
-
+    if (cameraUniformBuffer) delete cameraUniformBuffer;
 }
 
 void RendererWithCamera::setProjectionMatrix(const mat4 &matrix)
@@ -50,11 +51,39 @@ void RendererWithCamera::setCamera(const vec3 &position, const vec4 &orientation
     updateCameraUniforms();
 }
 
+void RendererWithCamera::enableCameraUniformBuffer()
+{
+    if (cameraUniformBuffer) return;
+    
+    //Two mat4s followed by a vec3 that is padded to 16 bytes in the std140 layout.
+    cameraUniformBuffer = new UniformBuffer<float>(36);
+    uniformMap.setUniformBuffer(*cameraUniformBuffer, "Camera", 0);
+    updateCameraUniforms();
+}
+
+tiny::mat4 RendererWithCamera::getWorldToScreenMatrix() const
+{
+    return worldToScreen;
+}
+
 void RendererWithCamera::updateCameraUniforms()
 {
     worldToScreen = cameraToScreen*worldToCamera;
     uniformMap.setVec3Uniform(cameraPosition, "cameraPosition");
     uniformMap.setMat4Uniform(cameraToWorld, "cameraToWorld");
     uniformMap.setMat4Uniform(worldToScreen, "worldToScreen");
+    
+    if (cameraUniformBuffer)
+    {
+        UniformBuffer<float> &buffer = *cameraUniformBuffer;
+        
+        worldToScreen.toOpenGL(&buffer[0]);
+        cameraToWorld.toOpenGL(&buffer[16]);
+        buffer[32] = cameraPosition.x;
+        buffer[33] = cameraPosition.y;
+        buffer[34] = cameraPosition.z;
+        buffer[35] = 0.0f;
+        buffer.sendToDevice();
+    }
 }
 
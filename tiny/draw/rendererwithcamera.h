@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <tiny/math/vec.h>
 #include <tiny/draw/renderer.h>
+#include <tiny/draw/uniformbuffer.h>
 
 namespace tiny
 {
@@ -39,6 +40,13 @@ class RendererWithCamera : public Renderer
         
         void setProjectionMatrix(const mat4 &);
         void setCamera(const vec3 &, const vec4 &);
+        mat4 getWorldToScreenMatrix() const;
+        
+        /** Also provide the camera uniforms to shaders as the uniform block
+         *  layout(std140) uniform Camera {mat4 worldToScreen; mat4 cameraToWorld; vec3 cameraPosition;};
+         *  bound to binding point 0, such that they are uploaded once per frame instead of once per shader program.
+         *  The individual uniforms remain available, and the block is only connected to renderables that are added after this call. */
+        void enableCameraUniformBuffer();
         
     private:
         void updateCameraUniforms();
@@ -48,6 +56,7 @@ class RendererWithCamera : public Renderer
         mat4 worldToCamera;
         mat4 worldToScreen;
         vec3 cameraPosition;
+        UniformBuffer<float> *cameraUniformBuffer;
 };
 
 }
@@ -87,8 +87,8 @@ std::string ScreenFillingSquare::getVertexShaderCode() const
 void ScreenFillingSquare::render(const ShaderProgram &program) const
 {
     //Draw screen-filling quad.
-    square.bind(program);
+    if (vertexArrays.bind(program, square)) square.bind(program);
     renderRangeAsTriangleStrip(0, 4);
-    square.unbind(program);
+    vertexArrays.unbind();
 }
 
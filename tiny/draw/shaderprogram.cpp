@@ -16,12 +16,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <iostream>
 #include <exception>
+#include <algorithm>
 
 #include <tiny/draw/shaderprogram.h>
 
 using namespace tiny::draw;
 
-ShaderProgram::ShaderProgram()
+ShaderProgram::ShaderProgram() :
+    linkIdentifier(0),
+    uniformStamps()
 {
     programIndex = glCreateProgram();
     
@@ -29,7 +32,9 @@ ShaderProgram::ShaderProgram()
         throw std::bad_alloc();
 }
 
-ShaderProgram::ShaderProgram(const ShaderProgram &)
+ShaderProgram::ShaderProgram(const ShaderProgram &) :
+    linkIdentifier(0),
+    uniformStamps()
 {
 
 }
@@ -38,13 +43,30 @@ ShaderProgram::~ShaderProgram()
 {
     assert(programIndex != 0);
     GL_CHECK(glDeleteProgram(programIndex));
+    linkIdentifiersInUse().erase(linkIdentifier);
 }
 
 void ShaderProgram::link()
 {
-    GLint result = GL_FALSE;
+    //Allow the linked program to be stored in a binary cache.
+    if (GLEW_ARB_get_program_binary) GL_CHECK(glProgramParameteri(programIndex, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
     
     GL_CHECK(glLinkProgram(programIndex));
+    
+    checkLinkStatus();
+}
+
+bool ShaderProgram::checkLinkStatus()
+{
+    static unsigned int lastLinkIdentifier = 0;
+    GLint result = GL_FALSE;
+    
+    //Linking invalidates all uniform locations and values.
+    linkIdentifiersInUse().erase(linkIdentifier);
+    linkIdentifier = ++lastLinkIdentifier;
+    linkIdentifiersInUse().insert(linkIdentifier);
+    uniformStamps.clear();
+    
     GL_CHECK(glGetProgramiv(programIndex, GL_LINK_STATUS, &result));
     
     if (result != GL_TRUE)
@@ -56,7 +78,7 @@ void ShaderProgram::link()
         if (logLength <= 0)
         {
             std::cerr << "Unable to link program and there was no info log available!" << std::endl;
-            return;
+            return false;
         }
         
         GLchar *logText = new GLchar [logLength + 1];
@@ -71,6 +93,7 @@ void ShaderProgram::link()
 #ifndef NDEBUG
         throw std::exception();
 #endif
+        return false;
     }
 #ifndef NDEBUG
     else
@@ -78,6 +101,54 @@ void ShaderProgram::link()
         std::cerr << "Successfully linked shader program " << programIndex << "." << std::endl;
     }
 #endif
+    
+    return true;
+}
+
+bool ShaderProgram::getBinary(GLenum &format, std::vector<unsigned char> &data) const
+{
+    //Retrieve the linked program in the driver's binary format.
+    GLint length = 0;
+    
+    if (!GLEW_ARB_get_program_binary) return false;
+    
+    GL_CHECK(glGetProgramiv(programIndex, GL_PROGRAM_BINARY_LENGTH, &length));
+    
+    if (length <= 0) return false;
+    
+    data.resize(length);
+    GL_CHECK(glGetProgramBinary(programIndex, length, 0, &format, &data[0]));
+    
+    return true;
+}
+
+bool ShaderProgram::setBinary(const GLenum &format, const std::vector<unsigned char> &data)
+{
+    //Replace this program by a binary obtained from getBinary(), this fails if the driver has changed.
+    GLint result = GL_FALSE;
+    
+    if (!GLEW_ARB_get_program_binary || data.empty()) return false;
+    
+    //Only hand the driver a format it supports, such that glProgramBinary() cannot raise an error.
+    GLint nrFormats = 0;
+    
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nrFormats));
+    
+    if (nrFormats <= 0) return false;
+    
+    std::vector<GLint> formats(nrFormats);
+    
+    GL_CHECK(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, &formats[0]));
+    
+    if (std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) == formats.end()) return false;
+    
+    //A corrupt or outdated binary is rejected by clearing the link status, after which the caller falls back to compiling the program.
+    GL_CHECK(glProgramBinary(programIndex, format, &data[0], data.size()));
+    GL_CHECK(glGetProgramiv(programIndex, GL_LINK_STATUS, &result));
+    
+    if (result != GL_TRUE) return false;
+    
+    return checkLinkStatus();
 }
 
 bool ShaderProgram::validate() const
@@ -125,6 +196,40 @@ GLuint ShaderProgram::getIndex() const
     return programIndex;
 }
 
+unsigned int ShaderProgram::getLinkIdentifier() const
+{
+    return linkIdentifier;
+}
+
+std::set<unsigned int> &ShaderProgram::linkIdentifiersInUse()
+{
+    static std::set<unsigned int> identifiers;
+    
+    return identifiers;
+}
+
+bool ShaderProgram::isLinkIdentifierInUse(const unsigned int &identifier)
+{
+    //Returns false once the program with this link identifier has been relinked or deleted, such that caches can drop their entries.
+    return linkIdentifiersInUse().count(identifier) > 0;
+}
+
+bool ShaderProgram::updateUniformStamp(const GLint &location, const unsigned int &serial, const unsigned int &version) const
+{
+    //Returns whether the uniform value with the given serial and version still has to be uploaded to this location.
+    assert(location >= 0);
+    
+    if (location >= static_cast<GLint>(uniformStamps.size())) uniformStamps.resize(location + 1, std::make_pair(0u, 0u));
+    
+    std::pair<unsigned int, unsigned int> &stamp = uniformStamps[location];
+    
+    if (stamp.first == serial && stamp.second == version) return false;
+    
+    stamp = std::make_pair(serial, version);
+    
+    return true;
+}
+
 void ShaderProgram::bind() const
 {
     GL_CHECK(glUseProgram(programIndex));
@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <exception>
 #include <vector>
+#include <set>
+#include <utility>
 
 #include <cassert>
 
@@ -51,14 +53,31 @@ class ShaderProgram
 
         void link();
         bool validate() const;
+        
+        bool getBinary(GLenum &, std::vector<unsigned char> &) const;
+        bool setBinary(const GLenum &, const std::vector<unsigned char> &);
+        
         GLuint getIndex() const;
+        unsigned int getLinkIdentifier() const;
+        static bool isLinkIdentifierInUse(const unsigned int &);
         void bind() const;
         void unbind() const;
         
+        bool updateUniformStamp(const GLint &, const unsigned int &, const unsigned int &) const;
+        
     private:
         ShaderProgram(const ShaderProgram &);
         
+        bool checkLinkStatus();
+        static std::set<unsigned int> &linkIdentifiersInUse();
+        
         GLuint programIndex;
+        
+        //Unique identifier of the last successful link, such that cached uniform locations can be invalidated.
+        unsigned int linkIdentifier;
+        
+        //Serial and version of the uniform value that was last uploaded to each uniform location.
+        mutable std::vector<std::pair<unsigned int, unsigned int> > uniformStamps;
 };
 
 }
@@ -0,0 +1,196 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include <SDL.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <tiny/hash/md5.h>
+#include <tiny/draw/shaderprogramcache.h>
+
+using namespace tiny::draw;
+
+namespace
+{
+
+const char cacheFileMagic[8] = {'T', 'I', 'N', 'Y', 'P', 'R', 'G', '1'};
+
+double getTime()
+{
+    return static_cast<double>(SDL_GetPerformanceCounter())/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+std::string getGLString(const GLenum &name)
+{
+    const GLubyte *text = 0;
+    
+    GL_CHECK(text = glGetString(name));
+    
+    return (text ? std::string(reinterpret_cast<const char *>(text)) : std::string(""));
+}
+
+}
+
+std::string ShaderProgramCache::directory = "";
+ShaderProgramCacheStatistics ShaderProgramCache::statistics = ShaderProgramCacheStatistics();
+
+void ShaderProgramCache::setDirectory(const std::string &a_directory)
+{
+    directory = a_directory;
+    
+    if (directory.empty()) return;
+    
+    if (directory[directory.size() - 1] != '/') directory += "/";
+    
+    //Create the directory if it does not exist yet, failure shows up when storing programs.
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    
+    std::cerr << "Caching shader programs in '" << directory << "'." << std::endl;
+}
+
+bool ShaderProgramCache::isEnabled()
+{
+    return !directory.empty() && GLEW_ARB_get_program_binary;
+}
+
+std::string ShaderProgramCache::getKey(const std::string &source)
+{
+    //Binaries are only valid for the driver that created them.
+    return source + "\n" + getGLString(GL_VENDOR) + "\n" + getGLString(GL_RENDERER) + "\n" + getGLString(GL_VERSION);
+}
+
+std::string ShaderProgramCache::getFileName(const std::string &key)
+{
+    return directory + tiny::hash::md5(key) + ".bin";
+}
+
+bool ShaderProgramCache::load(ShaderProgram &program, const std::string &key)
+{
+    if (!isEnabled()) return false;
+    
+    const double startTime = getTime();
+    std::ifstream file(getFileName(key).c_str(), std::ios::binary);
+    
+    if (!file.good())
+    {
+        ++statistics.nrMisses;
+        return false;
+    }
+    
+    //Read header and verify that the file belongs to this key, to rule out hash collisions.
+    char magic[8];
+    unsigned int keyLength = 0, format = 0, buildMicroseconds = 0, binaryLength = 0;
+    
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&keyLength), sizeof(keyLength));
+    
+    std::string storedKey(file.good() && keyLength == key.size() ? keyLength : 0, ' ');
+    
+    if (!storedKey.empty()) file.read(&storedKey[0], keyLength);
+    
+    file.read(reinterpret_cast<char *>(&format), sizeof(format));
+    file.read(reinterpret_cast<char *>(&buildMicroseconds), sizeof(buildMicroseconds));
+    file.read(reinterpret_cast<char *>(&binaryLength), sizeof(binaryLength));
+    
+    if (!file.good() || !std::equal(magic, magic + sizeof(magic), cacheFileMagic) || storedKey != key || binaryLength == 0)
+    {
+        std::cerr << "Ignoring invalid shader program cache file '" << getFileName(key) << "'." << std::endl;
+        ++statistics.nrMisses;
+        return false;
+    }
+    
+    std::vector<unsigned char> binary(binaryLength);
+    
+    file.read(reinterpret_cast<char *>(&binary[0]), binaryLength);
+    
+    //The driver may still reject the binary, for example after an update that did not change its version string.
+    if (!file.good() || !program.setBinary(format, binary))
+    {
+        std::cerr << "Unable to load shader program from cache file '" << getFileName(key) << "'." << std::endl;
+        ++statistics.nrMisses;
+        return false;
+    }
+    
+    const double time = getTime() - startTime;
+    
+    ++statistics.nrHits;
+    statistics.loadTime += time;
+    statistics.savedTime += 1.0e-6*static_cast<double>(buildMicroseconds) - time;
+    
+    return true;
+}
+
+void ShaderProgramCache::store(const ShaderProgram &program, const std::string &key, const double &buildTime)
+{
+    statistics.buildTime += buildTime;
+    
+    if (!isEnabled()) return;
+    
+    GLenum format = 0;
+    std::vector<unsigned char> binary;
+    
+    if (!program.getBinary(format, binary)) return;
+    
+    std::ofstream file(getFileName(key).c_str(), std::ios::binary | std::ios::trunc);
+    const unsigned int keyLength = key.size();
+    const unsigned int storedFormat = format;
+    const unsigned int buildMicroseconds = static_cast<unsigned int>(1.0e6*buildTime);
+    const unsigned int binaryLength = binary.size();
+    
+    file.write(cacheFileMagic, sizeof(cacheFileMagic));
+    file.write(reinterpret_cast<const char *>(&keyLength), sizeof(keyLength));
+    file.write(key.data(), keyLength);
+    file.write(reinterpret_cast<const char *>(&storedFormat), sizeof(storedFormat));
+    file.write(reinterpret_cast<const char *>(&buildMicroseconds), sizeof(buildMicroseconds));
+    file.write(reinterpret_cast<const char *>(&binaryLength), sizeof(binaryLength));
+    file.write(reinterpret_cast<const char *>(&binary[0]), binaryLength);
+    
+    if (!file.good())
+    {
+        std::cerr << "Unable to write shader program cache file '" << getFileName(key) << "'!" << std::endl;
+    }
+}
+
+ShaderProgramCacheStatistics ShaderProgramCache::getStatistics()
+{
+    return statistics;
+}
+
+void ShaderProgramCache::printStatistics()
+{
+    const unsigned int nrPrograms = statistics.nrHits + statistics.nrMisses;
+    
+    std::cerr << "Shader program cache: " << statistics.nrHits << " of " << nrPrograms << " programs loaded from cache ("
+              << (nrPrograms > 0 ? (100*statistics.nrHits)/nrPrograms : 0) << "% hit rate), "
+              << 1.0e3*statistics.loadTime << " ms loading, "
+              << 1.0e3*statistics.buildTime << " ms compiling, "
+              << 1.0e3*statistics.savedTime << " ms saved." << std::endl;
+}
+
@@ -0,0 +1,78 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include <tiny/draw/shaderprogram.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! Number of shader programs loaded from and stored in the \p ShaderProgramCache. */
+struct ShaderProgramCacheStatistics
+{
+    ShaderProgramCacheStatistics() :
+        nrHits(0),
+        nrMisses(0),
+        loadTime(0.0),
+        buildTime(0.0),
+        savedTime(0.0)
+    {
+
+    }
+    
+    unsigned int nrHits;
+    unsigned int nrMisses;
+    double loadTime;  /**< Time spent loading programs from the cache in seconds. */
+    double buildTime; /**< Time spent compiling and linking programs that were not in the cache in seconds. */
+    double savedTime; /**< Time it originally took to build the programs that were loaded from the cache, minus the time needed to load them. */
+};
+
+/*! \p ShaderProgramCache : stores linked shader programs on disk, such that they do not have to be compiled again the next time the application is started.
+ * 
+ *  Programs are stored under the md5 hash of their source code, render targets, and the OpenGL vendor, renderer, and version strings.
+ *  The cache is disabled until a directory is set with setDirectory().
+ */
+class ShaderProgramCache
+{
+    public:
+        static void setDirectory(const std::string &);
+        static bool isEnabled();
+        
+        static std::string getKey(const std::string &);
+        static bool load(ShaderProgram &, const std::string &);
+        static void store(const ShaderProgram &, const std::string &, const double &);
+        
+        static ShaderProgramCacheStatistics getStatistics();
+        static void printStatistics();
+        
+    private:
+        static std::string getFileName(const std::string &);
+        
+        static std::string directory;
+        static ShaderProgramCacheStatistics statistics;
+};
+
+}
+
+}
+
@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::draw;
 
 StaticMeshVertexBufferInterpreter::StaticMeshVertexBufferInterpreter(const tiny::mesh::StaticMesh &mesh) :
-    VertexBufferInterpreter<tiny::mesh::StaticMeshVertex>(mesh.vertices.begin(), mesh.vertices.end())
+    VertexBufferInterpreter<tiny::mesh::StaticMeshVertex>(mesh.vertices.begin(), mesh.vertices.end(), bf::dropHostData)
 {
     addVec2Attribute(0*sizeof(float), "v_textureCoordinate");
     addVec3Attribute(2*sizeof(float), "v_tangent");
@@ -33,7 +33,7 @@ StaticMeshVertexBufferInterpreter::~StaticMeshVertexBufferInterpreter()
 }
 
 StaticMeshIndexBuffer::StaticMeshIndexBuffer(const tiny::mesh::StaticMesh &mesh) :
-    IndexBuffer<unsigned int>(mesh.indices.begin(), mesh.indices.end())
+    IndexBuffer<unsigned int>(mesh.indices.begin(), mesh.indices.end(), bf::dropHostData)
 {
 
 }
@@ -130,8 +130,8 @@ std::string StaticMesh::getFragmentShaderCode() const
 
 void StaticMesh::render(const ShaderProgram &program) const
 {
-    vertices.bind(program);
+    if (vertexArrays.bind(program, vertices)) vertices.bind(program);
     renderIndicesAsTriangles(indices);
-    vertices.unbind(program);
+    vertexArrays.unbind();
 }
 
@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::draw;
 
 StaticMeshInstanceVertexBufferInterpreter::StaticMeshInstanceVertexBufferInterpreter(const size_t &nrMeshes) :
-    VertexBufferInterpreter<StaticMeshInstance>(nrMeshes)
+    StreamingVertexBufferInterpreter<StaticMeshInstance>(nrMeshes)
 {
     addVec4Attribute(0*sizeof(float), "v_positionAndSize");
     addVec4Attribute(4*sizeof(float), "v_orientation");
@@ -124,10 +124,14 @@ std::string StaticMeshHorde::getFragmentShaderCode() const
 
 void StaticMeshHorde::render(const ShaderProgram &program) const
 {
-    vertices.bind(program);
-    meshes.bind(program, 1);
+    if (vertexArrays.bind(program, vertices, &meshes))
+    {
+        vertices.bind(program);
+        meshes.bind(program, 1);
+    }
+    
     renderIndicesAsTrianglesInstanced(indices, nrMeshes);
-    meshes.unbind(program);
-    vertices.unbind(program);
+    vertexArrays.unbind();
+    meshes.fence();
 }
 
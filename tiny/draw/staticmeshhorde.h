@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tiny/draw/indexbuffer.h>
 #include <tiny/draw/vertexbuffer.h>
 #include <tiny/draw/vertexbufferinterpreter.h>
+#include <tiny/draw/streamingvertexbufferinterpreter.h>
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/staticmesh.h>
 
@@ -54,7 +55,7 @@ struct StaticMeshInstance
     vec4 orientation;
 };
 
-class StaticMeshInstanceVertexBufferInterpreter : public VertexBufferInterpreter<StaticMeshInstance>
+class StaticMeshInstanceVertexBufferInterpreter : public StreamingVertexBufferInterpreter<StaticMeshInstance>
 {
     public:
         StaticMeshInstanceVertexBufferInterpreter(const size_t &);
@@ -85,14 +86,27 @@ class StaticMeshHorde : public Renderable
         template <typename Iterator>
         void setInstances(Iterator first, Iterator last)
         {
-            nrMeshes = 0;
+            StaticMeshInstance *instances = mapInstances();
+            size_t count = 0;
             
-            for (Iterator i = first; i != last && nrMeshes < maxNrMeshes; ++i)
+            for (Iterator i = first; i != last && count < maxNrMeshes; ++i)
             {
-                meshes[nrMeshes++] = *i;
+                instances[count++] = *i;
             }
             
-            meshes.sendToDevice();
+            unmapInstances(count);
+        }
+        
+        /** Returns memory to which up to maxNrMeshes instances can be written directly, these are shown after calling unmapInstances() with the number of instances written. */
+        StaticMeshInstance *mapInstances()
+        {
+            return meshes.map();
+        }
+        
+        void unmapInstances(const size_t &count)
+        {
+            nrMeshes = (count < maxNrMeshes ? count : maxNrMeshes);
+            meshes.unmap(nrMeshes);
         }
         
         std::string getVertexShaderCode() const;
@@ -0,0 +1,195 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <exception>
+#include <vector>
+
+#include <cassert>
+
+#include <tiny/draw/vertexbufferinterpreter.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+namespace detail
+{
+
+struct StreamingFrame
+{
+    StreamingFrame(const GLuint &a_bufferIndex,
+                   const unsigned int &a_deviceIdentifier,
+                   void *a_mappedData) :
+        bufferIndex(a_bufferIndex),
+        deviceIdentifier(a_deviceIdentifier),
+        mappedData(a_mappedData),
+        fence(0)
+    {
+
+    }
+    
+    GLuint bufferIndex;
+    unsigned int deviceIdentifier;
+    void *mappedData;
+    GLsync fence;
+};
+
+}
+
+/*! \p StreamingVertexBufferInterpreter : vertex buffer for data that is replaced every frame, such as instances of a horde.
+ * 
+ * If ARB_buffer_storage is available, the data is written directly into a ring of persistently mapped device buffers, one for each frame in flight, which are guarded by fences.
+ * Otherwise, a single buffer is orphaned before each upload such that the device does not have to finish reading the previous data.
+ * In both cases only the live range of elements is transferred.
+ * 
+ * Usage: write up to size() elements to the memory returned by map(), call unmap() with the number of elements written, and call fence() after the last draw call that reads the buffer.
+ * The buffer should not be resized.
+ */
+template <typename T>
+class StreamingVertexBufferInterpreter : public VertexBufferInterpreter<T>
+{
+    public:
+        StreamingVertexBufferInterpreter(const size_t &a_size, const size_t &a_nrFrames = 3) :
+            VertexBufferInterpreter<T>(a_size, GL_STREAM_DRAW),
+            frames(),
+            currentFrame(0)
+        {
+            if (GLEW_ARB_buffer_storage && a_nrFrames > 1) createFrames(a_nrFrames);
+        }
+        
+        ~StreamingVertexBufferInterpreter()
+        {
+            destroyFrames();
+        }
+        
+        T *map()
+        {
+            if (frames.empty()) return &this->hostData[0];
+            
+            //Move to the next frame in the ring and wait until the device has finished reading from it.
+            currentFrame = (currentFrame + 1) % frames.size();
+            
+            detail::StreamingFrame &frame = frames[currentFrame];
+            
+            if (frame.fence)
+            {
+                while (glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+                
+                GL_CHECK(glDeleteSync(frame.fence));
+                frame.fence = 0;
+            }
+            
+            this->bufferIndex = frame.bufferIndex;
+            this->deviceIdentifier = frame.deviceIdentifier;
+            
+            return static_cast<T *>(frame.mappedData);
+        }
+        
+        void unmap(const size_t &count)
+        {
+            assert(count <= this->hostData.size());
+            
+            //Persistently mapped buffers are coherent, so the data is already visible to the device.
+            if (!frames.empty() || count == 0) return;
+            
+            GL_CHECK(glBindBuffer(this->target, this->bufferIndex));
+            GL_CHECK(glBufferData(this->target, this->sizeInBytes, 0, this->usage));
+            GL_CHECK(glBufferSubData(this->target, 0, count*sizeof(T), &this->hostData[0]));
+            GL_CHECK(glBindBuffer(this->target, 0));
+        }
+        
+        void fence() const
+        {
+            if (frames.empty()) return;
+            
+            detail::StreamingFrame &frame = frames[currentFrame];
+            
+            if (frame.fence) GL_CHECK(glDeleteSync(frame.fence));
+            
+            frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        
+    private:
+        //This class should not be copied.
+        StreamingVertexBufferInterpreter(const StreamingVertexBufferInterpreter &);
+        
+        void createFrames(const size_t &nrFrames)
+        {
+            const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            
+            //Replace the mutable device buffer by a ring of immutable buffers, that can still be updated with sendToDevice().
+            GL_CHECK(glDeleteBuffers(1, &this->bufferIndex));
+            this->releaseDeviceIdentifier(this->deviceIdentifier);
+            
+            for (size_t i = 0; i < nrFrames; ++i)
+            {
+                this->createDeviceBuffer();
+                GL_CHECK(glBindBuffer(this->target, this->bufferIndex));
+                GL_CHECK(glBufferStorage(this->target, this->sizeInBytes, 0, mapFlags | GL_DYNAMIC_STORAGE_BIT));
+                void *mappedData = glMapBufferRange(this->target, 0, this->sizeInBytes, mapFlags);
+                GL_CHECK(glBindBuffer(this->target, 0));
+                
+                frames.push_back(detail::StreamingFrame(this->bufferIndex, this->deviceIdentifier, mappedData));
+                
+                if (!mappedData)
+                {
+                    std::cerr << "Unable to map streaming vertex buffer!" << std::endl;
+                    destroyFrames();
+                    throw std::bad_alloc();
+                }
+            }
+            
+            currentFrame = 0;
+            this->bufferIndex = frames[currentFrame].bufferIndex;
+            this->deviceIdentifier = frames[currentFrame].deviceIdentifier;
+        }
+        
+        void destroyFrames()
+        {
+            for (std::vector<detail::StreamingFrame>::iterator i = frames.begin(); i != frames.end(); ++i)
+            {
+                if (i->fence) GL_CHECK(glDeleteSync(i->fence));
+                
+                if (i->mappedData)
+                {
+                    GL_CHECK(glBindBuffer(this->target, i->bufferIndex));
+                    GL_CHECK(glUnmapBuffer(this->target));
+                    GL_CHECK(glBindBuffer(this->target, 0));
+                }
+                
+                GL_CHECK(glDeleteBuffers(1, &i->bufferIndex));
+                this->releaseDeviceIdentifier(i->deviceIdentifier);
+            }
+            
+            //The buffers have been freed, so make sure the base class does not free them again.
+            if (!frames.empty()) this->bufferIndex = 0;
+            
+            frames.clear();
+        }
+        
+        mutable std::vector<detail::StreamingFrame> frames;
+        size_t currentFrame;
+};
+
+}
+
+}
+
@@ -15,6 +15,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <climits>
+#include <cfloat>
 
 #include <tiny/draw/terrain.h>
 
@@ -81,7 +82,8 @@ TerrainBlockIndexBuffer::~TerrainBlockIndexBuffer()
 TerrainBlock::TerrainBlock(const size_t &width, const size_t &height, const size_t &maxNrInstances) :
     vertices(width, height),
     instances(maxNrInstances),
-    indices(width, height)
+    indices(width, height),
+    vertexArrays()
 {
 
 }
@@ -101,21 +103,23 @@ const TerrainBlockInstance &TerrainBlock::operator [] (const size_t &index) cons
     return instances[index];
 }
 
-void TerrainBlock::sendToDevice() const
+void TerrainBlock::sendToDevice()
 {
     instances.sendToDevice();
 }
 
 void TerrainBlock::bind(const ShaderProgram &program) const
 {
-    vertices.bind(program);
-    instances.bind(program, 1);
+    if (vertexArrays.bind(program, vertices, &instances))
+    {
+        vertices.bind(program);
+        instances.bind(program, 1);
+    }
 }
 
-void TerrainBlock::unbind(const ShaderProgram &program) const
+void TerrainBlock::unbind(const ShaderProgram &) const
 {
-    instances.unbind(program);
-    vertices.unbind(program);
+    vertexArrays.unbind();
 }
 
 TerrainStitchVertexBufferInterpreter::TerrainStitchVertexBufferInterpreter(const size_t &width) :
@@ -184,7 +188,8 @@ TerrainStitchIndexBuffer::~TerrainStitchIndexBuffer()
 TerrainStitch::TerrainStitch(const size_t &size, const size_t &maxNrInstances) :
     vertices(size),
     instances(maxNrInstances),
-    indices(size)
+    indices(size),
+    vertexArrays()
 {
 
 }
@@ -204,21 +209,23 @@ const TerrainBlockInstance &TerrainStitch::operator [] (const size_t &index) con
     return instances[index];
 }
 
-void TerrainStitch::sendToDevice() const
+void TerrainStitch::sendToDevice()
 {
     instances.sendToDevice();
 }
 
 void TerrainStitch::bind(const ShaderProgram &program) const
 {
-    vertices.bind(program);
-    instances.bind(program, 1);
+    if (vertexArrays.bind(program, vertices, &instances))
+    {
+        vertices.bind(program);
+        instances.bind(program, 1);
+    }
 }
 
-void TerrainStitch::unbind(const ShaderProgram &program) const
+void TerrainStitch::unbind(const ShaderProgram &) const
 {
-    instances.unbind(program);
-    vertices.unbind(program);
+    vertexArrays.unbind();
 }
 
 Terrain::Terrain(const int &a_shiftBlockSize, const int &a_maxLevel) :
@@ -231,6 +238,7 @@ Terrain::Terrain(const int &a_shiftBlockSize, const int &a_maxLevel) :
     farScale(ivec2(1, 1)),
     bitShifts(ivec2(0, 0)),
     blockTranslations(maxLevel, ivec2(0, 0)),
+    levelHeightRanges(maxLevel, vec2(-FLT_MAX, FLT_MAX)),
     smallBlock(blockSize, blockSize, 12*maxLevel),
     largeBlock(2*blockSize + 3, 2*blockSize + 3, maxLevel),
     crossBlockX(blockSize, 5, 2*maxLevel),
@@ -238,11 +246,16 @@ Terrain::Terrain(const int &a_shiftBlockSize, const int &a_maxLevel) :
     ellBlockX(2*blockSize + 3, 2, maxLevel),
     ellBlockY(2, 2*blockSize + 3, maxLevel),
     stitch(2*blockSize + 2, maxLevel),
-    nrSmallBlocks(0),
-    nrCrossBlocks(0),
-    nrLargeBlocks(0),
-    nrEllBlocks(0),
-    nrStitch(0)
+    smallBlocks(vec2(blockSize - 1, blockSize - 1)),
+    crossBlocksX(vec2(blockSize - 1, 4)),
+    crossBlocksY(vec2(4, blockSize - 1)),
+    largeBlocks(vec2(2*blockSize + 2, 2*blockSize + 2)),
+    ellBlocksX(vec2(2*blockSize + 2, 1)),
+    ellBlocksY(vec2(1, 2*blockSize + 2)),
+    stitches(vec2(4*blockSize + 2, 4*blockSize + 2)),
+    isCulling(false),
+    nrBlocks(0),
+    nrCulledBlocks(0)
 {
     //Setup textures.
     uniformMap.addTexture("heightTexture");
@@ -257,6 +270,8 @@ Terrain::Terrain(const int &a_shiftBlockSize, const int &a_maxLevel) :
     uniformMap.addTexture("localDiffuseTexture");
     uniformMap.addTexture("localNormalTexture");
     
+    setTextureWrapOffset(vec2(0.0f, 0.0f));
+    
     //Setup initial blockTranslations.
     blockTranslations[maxLevel - 1] = ivec2(-(superBlockSize << (maxLevel - 2)));
     
@@ -286,6 +301,7 @@ std::string Terrain::getVertexShaderCode() const
 "uniform vec2 worldScale;\n"
 "uniform vec2 inverseHeightTextureSize;\n"
 "uniform vec2 textureShift;\n"
+"uniform vec2 textureWrapOffset;\n"
 "uniform vec4 scaleAndTranslateFar;\n"
 "\n"
 "in vec2 v_vertex;\n"
@@ -308,7 +324,7 @@ std::string Terrain::getVertexShaderCode() const
 "   morph = max(vec2(1.0f) - 16.0f*morph, 16.0f*morph - vec2(15.0f));\n"
 "   f_farMorphFactor = max(max(morph.x, morph.y), 0.0f);\n"
 "   \n"
-"   float height1 = texture(heightTexture, f_texturePosition.xy).x;\n"
+"   float height1 = texture(heightTexture, f_texturePosition.xy + textureWrapOffset).x;\n"
 "   float height2 = texture(farHeightTexture, f_texturePosition.zw).x;\n"
 "   \n"
 "   f_worldPosition.y = mix(height1, height2, f_farMorphFactor);\n"
@@ -335,6 +351,7 @@ std::string Terrain::getFragmentShaderCode() const
 "uniform sampler2DArray localDiffuseTexture;\n"
 "uniform sampler2DArray localNormalTexture;\n"
 "uniform vec2 diffuseScale;\n"
+"uniform vec2 textureWrapOffset;\n"
 "\n"
 "const float C = 1.0f, D = 1.0e8, E = 1.0f;\n"
 "\n"
@@ -349,15 +366,15 @@ std::string Terrain::getFragmentShaderCode() const
 "\n"
 "void main(void)\n"
 "{\n"
-"   vec4 att = mix(texture(attributeTexture, f_texturePosition.xy),\n"
+"   vec4 att = mix(texture(attributeTexture, f_texturePosition.xy + textureWrapOffset),\n"
 "                  texture(farAttributeTexture, f_texturePosition.zw),\n"
 "                  f_farMorphFactor);\n"
 "   vec3 f_worldTangent = normalize(2.0f*mix(\n"
-"                            texture(tangentTexture, f_texturePosition.xy),\n"
+"                            texture(tangentTexture, f_texturePosition.xy + textureWrapOffset),\n"
 "                            texture(farTangentTexture, f_texturePosition.zw),\n"
 "                            f_farMorphFactor).xyz - vec3(1.0f));\n"
 "   vec3 f_worldNormal = normalize(2.0f*mix(\n"
-"                            texture(normalTexture, f_texturePosition.xy),\n"
+"                            texture(normalTexture, f_texturePosition.xy + textureWrapOffset),\n"
 "                            texture(farNormalTexture, f_texturePosition.zw),\n"
 "                            f_farMorphFactor).xyz - vec3(1.0f));\n"
 "   \n"
@@ -492,18 +509,68 @@ bool Terrain::updateBlockTranslations(const vec2 &viewer)
     return true;
 }
 
+void Terrain::setTextureWrapOffset(const vec2 &offset)
+{
+    //The zoomed-in textures should repeat for a non-zero offset, the far-away textures and the morph factor are not affected.
+    uniformMap.setVec2Uniform(offset, "textureWrapOffset");
+}
+
 void Terrain::setCameraPosition(const vec3 &a_position)
 {
     //Updates shifts and blockTranslations to re-centre the map at the player's position.
-    //Do not update display lists if the camera's position has not changed.
-    if (!updateBlockTranslations(vec2(a_position.x/scale.x, a_position.z/scale.y))) return;
+    //Do not update the instance buffers if the camera's position has not changed and no blocks were culled.
+    const bool hasMoved = updateBlockTranslations(vec2(a_position.x/scale.x, a_position.z/scale.y));
+    
+    if (hasMoved) placeBlocks();
     
-    //Create new instance buffers.
-    nrSmallBlocks = 0;
-    nrCrossBlocks = 0;
-    nrLargeBlocks = 0;
-    nrEllBlocks = 0;
-    nrStitch = 0;
+    if (hasMoved || isCulling)
+    {
+        isCulling = false;
+        updateInstances(0);
+    }
+}
+
+void Terrain::setCameraPosition(const vec3 &a_position, const mat4 &worldToScreen)
+{
+    //Re-centre the map as above, but only send the blocks that may be visible to the device.
+    //The view changes nearly every frame, so the instance buffers are always updated.
+    if (updateBlockTranslations(vec2(a_position.x/scale.x, a_position.z/scale.y))) placeBlocks();
+    
+    const Frustum frustum(worldToScreen);
+    
+    isCulling = true;
+    updateInstances(&frustum);
+}
+
+void Terrain::setHeightRange(const float &minHeight, const float &maxHeight)
+{
+    levelHeightRanges.assign(maxLevel, vec2(minHeight, maxHeight));
+}
+
+void Terrain::setHeightRange(const int &level, const float &minHeight, const float &maxHeight)
+{
+    if (level >= 0 && level < maxLevel) levelHeightRanges[level] = vec2(minHeight, maxHeight);
+}
+
+size_t Terrain::getNrBlocks() const
+{
+    return nrBlocks;
+}
+
+size_t Terrain::getNrCulledBlocks() const
+{
+    return nrCulledBlocks;
+}
+
+void Terrain::placeBlocks()
+{
+    detail::TerrainBlockPlacement *placements[7] = {&smallBlocks, &crossBlocksX, &crossBlocksY, &largeBlocks, &ellBlocksX, &ellBlocksY, &stitches};
+    
+    for (int j = 0; j < 7; ++j)
+    {
+        placements[j]->instances.clear();
+        placements[j]->levels.clear();
+    }
     
     for (int i = minLevel; i < maxLevel; ++i)
     {
@@ -514,85 +581,161 @@ void Terrain::setCameraPosition(const vec3 &a_position)
         const vec2 t = vec2(blockTranslations[i].x, blockTranslations[i].y);
         
         //Draw blocks.
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + s.y + 2.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + s.y + 3.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 2.0f*bs.x, t.y + s.y + 3.0f*bs.y));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + s.y + 2.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + s.y + 3.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 2.0f*bs.x, t.y + s.y + 3.0f*bs.y)));
 
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 1.0f*bs.x, t.y + s.y + 3.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + s.y + 3.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + s.y + 2.0f*bs.y));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 1.0f*bs.x, t.y + s.y + 3.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + s.y + 3.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + s.y + 2.0f*bs.y)));
         
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + 1.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + 0.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 1.0f*bs.x, t.y + 0.0f*bs.y));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + 1.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 0.0f*bs.x, t.y + 0.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 1.0f*bs.x, t.y + 0.0f*bs.y)));
         
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 2.0f*bs.x, t.y + 0.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 0.0f*bs.y));
-        smallBlock[nrSmallBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 1.0f*bs.y));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 2.0f*bs.x, t.y + 0.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 0.0f*bs.y)));
+        smallBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 1.0f*bs.y)));
 		
         //Draw cross.
-        crossBlockX[nrCrossBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x, t.y + 2.0f*bs.y));
-        crossBlockY[nrCrossBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 2.0f*bs.x, t.y));
-        nrCrossBlocks++;
-        crossBlockX[nrCrossBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 2.0f*bs.y));
-        crossBlockY[nrCrossBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x + 2.0f*bs.x, t.y + s.y + 3.0f*bs.y));
-        nrCrossBlocks++;
+        crossBlocksX.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x, t.y + 2.0f*bs.y)));
+        crossBlocksY.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 2.0f*bs.x, t.y)));
+        crossBlocksX.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + s.x + 3.0f*bs.x, t.y + 2.0f*bs.y)));
+        crossBlocksY.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + 2.0f*bs.x, t.y + s.y + 3.0f*bs.y)));
         
         if (i == minLevel)
         {
             //Draw big block in the centre.
-            largeBlock[nrLargeBlocks++] = TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x, t.y + bs.y));
+            largeBlocks.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x, t.y + bs.y)));
         }
         else
         {
             //Draw L.
-            ellBlockX[nrEllBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x, t.y + bs.y + ((bitShifts.y & (1 << (i - 1))) != 0 ? 0.0f : 2.0f*bs.y + s.y - r.y)));
-            ellBlockY[nrEllBlocks] = TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x + ((bitShifts.x & (1 << (i - 1))) != 0 ? 0.0f : 2.0f*bs.x + s.x - r.x), t.y + bs.y + ((bitShifts.y & (1 << (i - 1))) != 0 ? r.y : 0.0f)));
-            nrEllBlocks++;
+            ellBlocksX.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x, t.y + bs.y + ((bitShifts.y & (1 << (i - 1))) != 0 ? 0.0f : 2.0f*bs.y + s.y - r.y))));
+            ellBlocksY.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x + bs.x + ((bitShifts.x & (1 << (i - 1))) != 0 ? 0.0f : 2.0f*bs.x + s.x - r.x), t.y + bs.y + ((bitShifts.y & (1 << (i - 1))) != 0 ? r.y : 0.0f))));
         }
         
         //Draw stitch.
-        stitch[nrStitch++] = TerrainBlockInstance(vec4(r.x, r.y, t.x - r.x, t.y - r.y));
+        stitches.instances.push_back(TerrainBlockInstance(vec4(r.x, r.y, t.x - r.x, t.y - r.y)));
+        
+        //Record the level of all blocks that have been placed.
+        for (int j = 0; j < 7; ++j)
+        {
+            placements[j]->levels.resize(placements[j]->instances.size(), i);
+        }
+    }
+}
+
+void Terrain::getBlockBox(const detail::TerrainBlockPlacement &placement, const size_t &index, vec3 &a, vec3 &b) const
+{
+    //Conservative bounding box of a block instance in world space, using the height range of its level.
+    const vec4 &st = placement.instances[index].scaleAndTranslate;
+    const vec2 &heights = levelHeightRanges[placement.levels[index]];
+    const vec2 p0 = vec2(st.z, st.w);
+    const vec2 p1 = vec2(st.x*placement.extent.x + st.z, st.y*placement.extent.y + st.w);
+    
+    a = vec3(std::min(p0.x, p1.x)*scale.x, heights.x, std::min(p0.y, p1.y)*scale.y);
+    b = vec3(std::max(p0.x, p1.x)*scale.x, heights.y, std::max(p0.y, p1.y)*scale.y);
+}
+
+void Terrain::updateInstances(const Frustum *frustum)
+{
+    detail::TerrainBlockPlacement *placements[7] = {&smallBlocks, &crossBlocksX, &crossBlocksY, &largeBlocks, &ellBlocksX, &ellBlocksY, &stitches};
+    detail::TerrainBlockInstanceBufferInterpreter *buffers[7] = {&smallBlock.instances, &crossBlockX.instances, &crossBlockY.instances, &largeBlock.instances, &ellBlockX.instances, &ellBlockY.instances, &stitch.instances};
+    std::vector<bool> levelIsVisible(maxLevel, true);
+    vec3 a, b;
+    
+    if (frustum)
+    {
+        //Skip entire levels that lie outside the frustum, using the bounding box of all their blocks.
+        std::vector<vec3> levelMin(maxLevel, vec3(FLT_MAX, FLT_MAX, FLT_MAX));
+        std::vector<vec3> levelMax(maxLevel, vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+        
+        for (int j = 0; j < 7; ++j)
+        {
+            for (size_t k = 0; k < placements[j]->instances.size(); ++k)
+            {
+                const int level = placements[j]->levels[k];
+                
+                getBlockBox(*placements[j], k, a, b);
+                levelMin[level] = min(levelMin[level], a);
+                levelMax[level] = max(levelMax[level], b);
+            }
+        }
+        
+        for (int i = 0; i < maxLevel; ++i)
+        {
+            levelIsVisible[i] = (levelMin[i].x <= levelMax[i].x && frustum->intersectsBox(levelMin[i], levelMax[i]));
+        }
     }
     
-    //Update buffers on the GPU.
-    smallBlock.sendToDevice();
-    crossBlockX.sendToDevice();
-    crossBlockY.sendToDevice();
-    largeBlock.sendToDevice();
-    ellBlockX.sendToDevice();
-    ellBlockY.sendToDevice();
-    stitch.sendToDevice();
+    //Copy the visible instances to the instance buffers.
+    nrBlocks = 0;
+    nrCulledBlocks = 0;
+    
+    for (int j = 0; j < 7; ++j)
+    {
+        detail::TerrainBlockPlacement &placement = *placements[j];
+        
+        placement.nrVisible = 0;
+        
+        for (size_t k = 0; k < placement.instances.size(); ++k)
+        {
+            ++nrBlocks;
+            
+            if (frustum)
+            {
+                if (!levelIsVisible[placement.levels[k]])
+                {
+                    ++nrCulledBlocks;
+                    continue;
+                }
+                
+                getBlockBox(placement, k, a, b);
+                
+                if (!frustum->intersectsBox(a, b))
+                {
+                    ++nrCulledBlocks;
+                    continue;
+                }
+            }
+            
+            (*buffers[j])[placement.nrVisible++] = placement.instances[k];
+        }
+        
+        //Update buffers on the GPU.
+        buffers[j]->sendToDevice();
+    }
 }
 
 void Terrain::render(const ShaderProgram &program) const
 {
     largeBlock.bind(program);
-    renderIndicesAsTriangleStripsInstanced(largeBlock.indices, nrLargeBlocks);
+    renderIndicesAsTriangleStripsInstanced(largeBlock.indices, largeBlocks.nrVisible);
     largeBlock.unbind(program);
     
     smallBlock.bind(program);
-    renderIndicesAsTriangleStripsInstanced(smallBlock.indices, nrSmallBlocks);
+    renderIndicesAsTriangleStripsInstanced(smallBlock.indices, smallBlocks.nrVisible);
     smallBlock.unbind(program);
     
     crossBlockX.bind(program);
-    renderIndicesAsTriangleStripsInstanced(crossBlockX.indices, nrCrossBlocks);
+    renderIndicesAsTriangleStripsInstanced(crossBlockX.indices, crossBlocksX.nrVisible);
     crossBlockX.unbind(program);
     
     crossBlockY.bind(program);
-    renderIndicesAsTriangleStripsInstanced(crossBlockY.indices, nrCrossBlocks);
+    renderIndicesAsTriangleStripsInstanced(crossBlockY.indices, crossBlocksY.nrVisible);
     crossBlockY.unbind(program);
     
     ellBlockX.bind(program);
-    renderIndicesAsTriangleStripsInstanced(ellBlockX.indices, nrEllBlocks);
+    renderIndicesAsTriangleStripsInstanced(ellBlockX.indices, ellBlocksX.nrVisible);
     ellBlockX.unbind(program);
     
     ellBlockY.bind(program);
-    renderIndicesAsTriangleStripsInstanced(ellBlockY.indices, nrEllBlocks);
+    renderIndicesAsTriangleStripsInstanced(ellBlockY.indices, ellBlocksY.nrVisible);
     ellBlockY.unbind(program);
     
     stitch.bind(program);
-    renderIndicesAsTriangleStripsInstanced(stitch.indices, nrStitch);
+    renderIndicesAsTriangleStripsInstanced(stitch.indices, stitches.nrVisible);
     stitch.unbind(program);
 }
 
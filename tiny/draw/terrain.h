@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include <tiny/math/vec.h>
+#include <tiny/math/frustum.h>
 #include <tiny/draw/renderable.h>
 #include <tiny/draw/vertexbufferinterpreter.h>
 
@@ -48,6 +49,24 @@ struct TerrainBlockInstance
     vec4 scaleAndTranslate;
 };
 
+/*! Instances of one kind of terrain block that have been placed around the camera, from which the visible instances are copied to the instance buffer. */
+struct TerrainBlockPlacement
+{
+    TerrainBlockPlacement(const vec2 &a_extent) :
+        extent(a_extent),
+        instances(),
+        levels(),
+        nrVisible(0)
+    {
+
+    }
+    
+    vec2 extent;
+    std::vector<TerrainBlockInstance> instances;
+    std::vector<int> levels;
+    size_t nrVisible;
+};
+
 class TerrainBlockInstanceBufferInterpreter : public VertexBufferInterpreter<TerrainBlockInstance>
 {
     public:
@@ -77,7 +96,7 @@ class TerrainBlock
         
         TerrainBlockInstance & operator [] (const size_t &);
         const TerrainBlockInstance & operator [] (const size_t &) const;
-        void sendToDevice() const;
+        void sendToDevice();
         
         void bind(const ShaderProgram &) const;
         void unbind(const ShaderProgram &) const;
@@ -85,6 +104,9 @@ class TerrainBlock
         TerrainBlockVertexBufferInterpreter vertices;
         TerrainBlockInstanceBufferInterpreter instances;
         TerrainBlockIndexBuffer indices;
+        
+    private:
+        VertexArrayCache vertexArrays;
 };
 
 class TerrainStitchVertexBufferInterpreter : public VertexBufferInterpreter<vec2>
@@ -109,7 +131,7 @@ class TerrainStitch
         
         TerrainBlockInstance & operator [] (const size_t &);
         const TerrainBlockInstance & operator [] (const size_t &) const;
-        void sendToDevice() const;
+        void sendToDevice();
         
         void bind(const ShaderProgram &) const;
         void unbind(const ShaderProgram &) const;
@@ -117,6 +139,9 @@ class TerrainStitch
         TerrainStitchVertexBufferInterpreter vertices;
         TerrainBlockInstanceBufferInterpreter instances;
         TerrainStitchIndexBuffer indices;
+        
+    private:
+        VertexArrayCache vertexArrays;
 };
 
 }
@@ -184,12 +209,29 @@ class Terrain : public Renderable
         std::string getFragmentShaderCode() const;
         
         void setCameraPosition(const vec3 &);
+        void setCameraPosition(const vec3 &, const mat4 &);
+        
+        /** Sets the range of heights of the terrain, used to bound the blocks of all levels when culling them. */
+        void setHeightRange(const float &, const float &);
+        
+        /** Sets the range of heights of the terrain covered by a single level. */
+        void setHeightRange(const int &, const float &, const float &);
+        
+        /** Number of blocks placed around the camera and the number of them that were culled by the last call to setCameraPosition(). */
+        size_t getNrBlocks() const;
+        size_t getNrCulledBlocks() const;
+        
+        /** Offset (in texture coordinates) added to all lookups in the zoomed-in height, tangent, normal, and attribute textures, for textures that are updated toroidally. */
+        void setTextureWrapOffset(const vec2 &);
         
     protected:
         void render(const ShaderProgram &) const;
         
     private:
         bool updateBlockTranslations(const vec2 &);
+        void placeBlocks();
+        void updateInstances(const Frustum *);
+        void getBlockBox(const detail::TerrainBlockPlacement &, const size_t &, vec3 &, vec3 &) const;
         
         int minLevel;
         const int maxLevel;
@@ -199,6 +241,7 @@ class Terrain : public Renderable
         ivec2 farScale;
         ivec2 bitShifts;
         std::vector<ivec2> blockTranslations;
+        std::vector<vec2> levelHeightRanges;
         
         detail::TerrainBlock smallBlock;
         detail::TerrainBlock largeBlock;
@@ -208,11 +251,17 @@ class Terrain : public Renderable
         detail::TerrainBlock ellBlockY;
         detail::TerrainStitch stitch;
         
-        size_t nrSmallBlocks;
-        size_t nrCrossBlocks;
-        size_t nrLargeBlocks;
-        size_t nrEllBlocks;
-        size_t nrStitch;
+        detail::TerrainBlockPlacement smallBlocks;
+        detail::TerrainBlockPlacement crossBlocksX;
+        detail::TerrainBlockPlacement crossBlocksY;
+        detail::TerrainBlockPlacement largeBlocks;
+        detail::TerrainBlockPlacement ellBlocksX;
+        detail::TerrainBlockPlacement ellBlocksY;
+        detail::TerrainBlockPlacement stitches;
+        
+        bool isCulling;
+        size_t nrBlocks;
+        size_t nrCulledBlocks;
 };
 
 }
@@ -15,6 +15,9 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <iostream>
+#include <cstring>
+
+#include <SDL.h>
 
 #include <tiny/draw/texture.h>
 
@@ -36,7 +39,15 @@ TextureInterface::TextureInterface(const GLenum &a_textureTarget,
     width(a_width),
     height(a_height),
     depth(a_depth),
-    textureIndex(0)
+    textureIndex(0),
+    readbackBuffer(0),
+    readbackFence(0),
+    readbackFrameBuffer(0),
+    readbackAll(true),
+    readbackRegions(),
+    uploadBuffers(),
+    uploadFences(),
+    currentUploadBuffer(0)
 {
     createDeviceTexture();
 }
@@ -50,13 +61,22 @@ TextureInterface::TextureInterface(const TextureInterface &a_texture) :
     width(a_texture.width),
     height(a_texture.height),
     depth(a_texture.depth),
-    textureIndex(0)
+    textureIndex(0),
+    readbackBuffer(0),
+    readbackFence(0),
+    readbackFrameBuffer(0),
+    readbackAll(true),
+    readbackRegions(),
+    uploadBuffers(),
+    uploadFences(),
+    currentUploadBuffer(0)
 {
     createDeviceTexture();
 }
 
 TextureInterface::~TextureInterface()
 {
+    destroyTransferBuffers();
     destroyDeviceTexture();
 }
 
@@ -93,6 +113,26 @@ void TextureInterface::unbind(const int &bindTarget) const
     GL_CHECK(glBindTexture(textureTarget, 0));
 }
 
+void TextureInterface::generateMipmaps() const
+{
+    if ((flags & tf::mipmap) == 0) return;
+    
+    GL_CHECK(glBindTexture(textureTarget, textureIndex));
+    GL_CHECK(glGenerateMipmap(textureTarget));
+    GL_CHECK(glBindTexture(textureTarget, 0));
+}
+
+bool TextureInterface::readbackReady() const
+{
+    assertContextThread();
+    
+    if (!readbackFence) return true;
+    
+    const GLenum result = glClientWaitSync(readbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    
+    return (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED);
+}
+
 void TextureInterface::createDeviceTexture()
 {
     GL_CHECK(glGenTextures(1, &textureIndex));
@@ -156,3 +196,250 @@ void TextureInterface::destroyDeviceTexture()
     textureIndex = 0;
 }
 
+void TextureInterface::uploadDeviceData(const GLvoid *data, const size_t &nrBytes) const
+{
+    //The data is either a pointer to host memory or an offset into the currently bound pixel unpack buffer.
+    const char *bytes = static_cast<const char *>(data);
+    
+    GL_CHECK(glBindTexture(textureTarget, textureIndex));
+    
+    if (textureTarget == GL_TEXTURE_1D)
+    {
+        GL_CHECK(glTexSubImage1D(textureTarget, 0, 0, width, textureChannels, textureDataType, bytes));
+    }
+    else if (textureTarget == GL_TEXTURE_2D)
+    {
+        GL_CHECK(glTexSubImage2D(textureTarget, 0, 0, 0, width, height, textureChannels, textureDataType, bytes));
+    }
+    else if (textureTarget == GL_TEXTURE_3D)
+    {
+        GL_CHECK(glTexSubImage3D(textureTarget, 0, 0, 0, 0, width, height, depth, textureChannels, textureDataType, bytes));
+    }
+    else if (textureTarget == GL_TEXTURE_2D_ARRAY)
+    {
+        const size_t layerSize = nrBytes/depth;
+        
+        for (size_t i = 0; i < depth; ++i)
+        {
+            GL_CHECK(glTexSubImage3D(textureTarget, 0, 0, 0, i, width, height, 1, textureChannels, textureDataType, bytes + i*layerSize));
+        }
+    }
+    else
+    {
+        GL_CHECK(glBindTexture(textureTarget, 0));
+        throw std::exception();
+    }
+    
+    GL_CHECK(glBindTexture(textureTarget, 0));
+}
+
+void TextureInterface::streamDeviceData(const GLvoid *data, const size_t &nrBytes) const
+{
+    const size_t nrUploadBuffers = 3;
+    
+    if (uploadBuffers.empty())
+    {
+        uploadBuffers.assign(nrUploadBuffers, 0);
+        uploadFences.assign(nrUploadBuffers, 0);
+        GL_CHECK(glGenBuffers(nrUploadBuffers, &uploadBuffers[0]));
+        
+        for (size_t i = 0; i < nrUploadBuffers; ++i)
+        {
+            GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[i]));
+            GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, nrBytes, 0, GL_STREAM_DRAW));
+        }
+        
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    }
+    
+    //Move to the next buffer in the ring and wait until the device has finished the upload from it.
+    currentUploadBuffer = (currentUploadBuffer + 1) % uploadBuffers.size();
+    
+    if (uploadFences[currentUploadBuffer])
+    {
+        while (glClientWaitSync(uploadFences[currentUploadBuffer], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        
+        GL_CHECK(glDeleteSync(uploadFences[currentUploadBuffer]));
+        uploadFences[currentUploadBuffer] = 0;
+    }
+    
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[currentUploadBuffer]));
+    
+    void *mappedData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, nrBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    
+    if (!mappedData)
+    {
+        std::cerr << "Unable to map pixel unpack buffer, uploading texture " << textureIndex << " synchronously!" << std::endl;
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        uploadDeviceData(data, nrBytes);
+        return;
+    }
+    
+    memcpy(mappedData, data, nrBytes);
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    
+    //The texture is updated from the pixel unpack buffer, such that the copy happens asynchronously on the device.
+    uploadDeviceData(0, nrBytes);
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    
+    uploadFences[currentUploadBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void TextureInterface::assertContextThread() const
+{
+#ifndef NDEBUG
+    //Readbacks issue OpenGL calls, so they must start and finish on the thread that owns the context, which is the first thread to use them.
+    static const SDL_threadID contextThread = SDL_ThreadID();
+    
+    assert(SDL_ThreadID() == contextThread);
+#endif
+}
+
+void TextureInterface::beginDeviceReadback(const size_t &nrBytes)
+{
+    assertContextThread();
+    
+    if (!readbackBuffer)
+    {
+        GL_CHECK(glGenBuffers(1, &readbackBuffer));
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer));
+        GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, nrBytes, 0, GL_STREAM_READ));
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    }
+    
+    //A new readback replaces the pending one.
+    if (readbackFence) GL_CHECK(glDeleteSync(readbackFence));
+    
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer));
+    GL_CHECK(glBindTexture(textureTarget, textureIndex));
+    GL_CHECK(glGetTexImage(textureTarget, 0, textureChannels, textureDataType, 0));
+    GL_CHECK(glBindTexture(textureTarget, 0));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    
+    readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readbackAll = true;
+    readbackRegions.clear();
+}
+
+void TextureInterface::beginDeviceReadback(const size_t &nrBytes, const std::vector<ivec4> &regions)
+{
+    assertContextThread();
+    
+    //Reads the rectangles (x, y, width, height) of a two-dimensional texture into the same place of the pixel buffer object as a full readback.
+    if (!readbackBuffer)
+    {
+        GL_CHECK(glGenBuffers(1, &readbackBuffer));
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer));
+        GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, nrBytes, 0, GL_STREAM_READ));
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    }
+    
+    if (!readbackFrameBuffer)
+    {
+        GL_CHECK(glGenFramebuffers(1, &readbackFrameBuffer));
+    }
+    
+    //A pending readback is extended rather than replaced, since the pixel buffer object still holds the texels it has read.
+    if (readbackFence)
+    {
+        GL_CHECK(glDeleteSync(readbackFence));
+    }
+    else
+    {
+        readbackAll = false;
+        readbackRegions.clear();
+    }
+    
+    const size_t bytesPerTexel = nrBytes/(width*height);
+    
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, readbackFrameBuffer));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureTarget, textureIndex, 0));
+    GL_CHECK(glReadBuffer(GL_COLOR_ATTACHMENT0));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer));
+    GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL_CHECK(glPixelStorei(GL_PACK_ROW_LENGTH, width));
+    
+    for (std::vector<ivec4>::const_iterator i = regions.begin(); i != regions.end(); ++i)
+    {
+        if (i->x < 0 || i->y < 0 || i->z <= 0 || i->w <= 0 || static_cast<size_t>(i->x + i->z) > width || static_cast<size_t>(i->y + i->w) > height)
+        {
+            std::cerr << "Warning: readback region " << *i << " does not fit in texture " << textureIndex << "!" << std::endl;
+            continue;
+        }
+        
+        GL_CHECK(glReadPixels(i->x, i->y, i->z, i->w, textureChannels, textureDataType, reinterpret_cast<GLvoid *>(bytesPerTexel*(i->x + width*i->y))));
+        readbackRegions.push_back(*i);
+    }
+    
+    GL_CHECK(glPixelStorei(GL_PACK_ROW_LENGTH, 0));
+    GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureTarget, 0, 0));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    
+    readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void TextureInterface::finishDeviceReadback(GLvoid *data, const size_t &nrBytes)
+{
+    if (!readbackFence) return;
+    
+    while (glClientWaitSync(readbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+    
+    GL_CHECK(glDeleteSync(readbackFence));
+    readbackFence = 0;
+    
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffer));
+    
+    const void *mappedData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, nrBytes, GL_MAP_READ_BIT);
+    
+    if (mappedData && readbackAll)
+    {
+        memcpy(data, mappedData, nrBytes);
+        GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    else if (mappedData)
+    {
+        //Only copy the rows of the rectangles that have been read.
+        const size_t bytesPerTexel = nrBytes/(width*height);
+        
+        for (std::vector<ivec4>::const_iterator i = readbackRegions.begin(); i != readbackRegions.end(); ++i)
+        {
+            for (int y = i->y; y < i->y + i->w; ++y)
+            {
+                const size_t offset = bytesPerTexel*(i->x + width*y);
+                
+                memcpy(static_cast<char *>(data) + offset, static_cast<const char *>(mappedData) + offset, bytesPerTexel*i->z);
+            }
+        }
+        
+        GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    else
+    {
+        std::cerr << "Unable to map pixel pack buffer of texture " << textureIndex << "!" << std::endl;
+    }
+    
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+void TextureInterface::destroyTransferBuffers()
+{
+    if (readbackFence) GL_CHECK(glDeleteSync(readbackFence));
+    if (readbackBuffer) GL_CHECK(glDeleteBuffers(1, &readbackBuffer));
+    if (readbackFrameBuffer) GL_CHECK(glDeleteFramebuffers(1, &readbackFrameBuffer));
+    
+    for (std::vector<GLsync>::const_iterator i = uploadFences.begin(); i != uploadFences.end(); ++i)
+    {
+        if (*i) GL_CHECK(glDeleteSync(*i));
+    }
+    
+    if (!uploadBuffers.empty()) GL_CHECK(glDeleteBuffers(uploadBuffers.size(), &uploadBuffers[0]));
+    
+    readbackFence = 0;
+    readbackBuffer = 0;
+    readbackFrameBuffer = 0;
+    uploadFences.clear();
+    uploadBuffers.clear();
+}
+
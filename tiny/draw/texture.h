@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <GL/glew.h>
 #include <GL/gl.h>
 
+#include <tiny/math/vec.h>
 #include <tiny/draw/glcheck.h>
 #include <tiny/draw/detail/formats.h>
 
@@ -42,6 +43,10 @@ const unsigned int repeat = 0x0001;
 const unsigned int filter = 0x0002;
 const unsigned int mipmap = 0x0004;
 
+//Texture flags for the residency of the host copy of the texture data, which is kept for the lifetime of the texture by default.
+const unsigned int dropHostData = 0x0008; //Free the host data after each upload to the device, reading back from the device is not allowed.
+const unsigned int hostOnDemand = 0x0010; //Only allocate host data when it is needed for an upload or a readback, and free it after each upload.
+
 } //namespace tf
 
 class TextureInterface
@@ -57,10 +62,19 @@ class TextureInterface
         size_t getDepth() const;
         void bind(const int & = 0) const;
         void unbind(const int & = 0) const;
+        void generateMipmaps() const;
+        bool readbackReady() const;
         
     protected:
         void createDeviceTexture();
         void destroyDeviceTexture();
+        void uploadDeviceData(const GLvoid *, const size_t &) const;
+        void streamDeviceData(const GLvoid *, const size_t &) const;
+        void assertContextThread() const;
+        void beginDeviceReadback(const size_t &);
+        void beginDeviceReadback(const size_t &, const std::vector<ivec4> &);
+        void finishDeviceReadback(GLvoid *, const size_t &);
+        void destroyTransferBuffers();
         
         const GLenum textureTarget;
         const GLint textureFormat;
@@ -69,6 +83,17 @@ class TextureInterface
         const unsigned int flags;
         const size_t width, height, depth;
         GLuint textureIndex;
+        
+    private:
+        //Pixel buffer objects for asynchronous transfers, which are created when they are first used.
+        GLuint readbackBuffer;
+        GLsync readbackFence;
+        GLuint readbackFrameBuffer;
+        bool readbackAll;
+        std::vector<ivec4> readbackRegions;
+        mutable std::vector<GLuint> uploadBuffers;
+        mutable std::vector<GLsync> uploadFences;
+        mutable size_t currentUploadBuffer;
 };
 
 template<typename T, size_t Channels>
@@ -84,9 +109,9 @@ class Texture : public TextureInterface
                              a_width,
                              a_height,
                              a_depth),
-            hostData(a_width*a_height*a_depth*Channels)
+            hostData((a_flags & tf::hostOnDemand) != 0 ? 0 : a_width*a_height*a_depth*Channels)
         {
-            if (hostData.empty())
+            if (a_width*a_height*a_depth == 0)
                 throw std::bad_alloc();
         }
         
@@ -94,6 +119,21 @@ class Texture : public TextureInterface
             TextureInterface(a_texture),
             hostData(a_texture.hostData)
         {
+            //The device data cannot be copied directly, so the source texture has to keep its host data or allow it to be read back.
+            if (hostData.empty())
+            {
+                if ((flags & tf::hostOnDemand) == 0)
+                {
+                    std::cerr << "Unable to copy texture " << a_texture.textureIndex << " because its host data has been dropped!" << std::endl;
+                    throw std::exception();
+                }
+                
+                allocateHostData();
+                GL_CHECK(glBindTexture(textureTarget, a_texture.textureIndex));
+                GL_CHECK(glGetTexImage(textureTarget, 0, textureChannels, textureDataType, &hostData[0]));
+                GL_CHECK(glBindTexture(textureTarget, 0));
+            }
+            
             sendToDevice();
         }
         
@@ -122,104 +162,147 @@ class Texture : public TextureInterface
             a_texture.sendToDevice();
         }
         
-        void sendToDevice() const
+        /**
+         * Uploads the host data to the device and waits for the transfer to complete.
+         * For textures with the tf::mipmap flag, this also regenerates all mipmap levels.
+         * For textures with the tf::dropHostData or tf::hostOnDemand flag, the host data is freed afterwards.
+         */
+        void sendToDevice()
         {
             if (hostData.empty()) return;
             
-            GL_CHECK(glBindTexture(textureTarget, textureIndex));
-            
-            if (textureTarget == GL_TEXTURE_1D)
-            {
-                GL_CHECK(glTexSubImage1D(textureTarget, 0, 0, width, textureChannels, textureDataType, &hostData[0]));
-            }
-            else if (textureTarget == GL_TEXTURE_2D)
-            {
-                GL_CHECK(glTexSubImage2D(textureTarget, 0, 0, 0, width, height, textureChannels, textureDataType, &hostData[0]));
-            }
-            else if (textureTarget == GL_TEXTURE_3D)
-            {
-                GL_CHECK(glTexSubImage3D(textureTarget, 0, 0, 0, 0, width, height, depth, textureChannels, textureDataType, &hostData[0]));
-            }
-            else if (textureTarget == GL_TEXTURE_2D_ARRAY)
-            {
-                size_t offset = 0;
-                
-                for (size_t i = 0; i < depth; ++i)
-                {
-                    GL_CHECK(glTexSubImage3D(textureTarget, 0, 0, 0, i, width, height, 1, textureChannels, textureDataType, &hostData[offset]));
-                    
-                    offset += Channels*width*height;
-                }
-            }
-            else
-            {
-                throw std::exception();
-            }
-    
-            if ((flags & tf::mipmap) != 0)
-            {
-                GL_CHECK(glGenerateMipmap(textureTarget));
-            }
+            uploadDeviceData(&hostData[0], hostData.size()*sizeof(T));
+            generateMipmaps();
+            releaseHostData();
+        }
+        
+        /**
+         * Uploads the host data to the device through a ring of pixel buffer objects, such that the call returns without waiting for the device.
+         * Mipmaps are not regenerated, call generateMipmaps() afterwards if required.
+         */
+        void streamToDevice()
+        {
+            if (hostData.empty()) return;
             
-            GL_CHECK(glBindTexture(textureTarget, 0));
+            streamDeviceData(&hostData[0], hostData.size()*sizeof(T));
+            releaseHostData();
         }
         
+        /**
+         * Reads the first mipmap level from the device into the host data and waits for the transfer to complete.
+         */
         void getFromDevice()
         {
-            if (hostData.empty()) return;
+            allocateHostData();
             
             GL_CHECK(glBindTexture(textureTarget, textureIndex));
-            
-            if ((flags & tf::mipmap) != 0)
-            {
-                GL_CHECK(glGenerateMipmap(textureTarget));
-            }
-            
             GL_CHECK(glGetTexImage(textureTarget, 0, textureChannels, textureDataType, &hostData[0]));
             GL_CHECK(glBindTexture(textureTarget, 0));
         }
         
+        /**
+         * Starts copying the first mipmap level from the device into a pixel buffer object without waiting for the device.
+         * The host data is only updated by finishReadback(), readbackReady() indicates whether this will not block.
+         */
+        void beginReadback()
+        {
+            allocateHostData();
+            beginDeviceReadback(hostData.size()*sizeof(T));
+        }
+        
+        /**
+         * Copies the result of the last call to beginReadback() into the host data, waiting for the device if necessary.
+         * Does nothing if there is no pending readback. Like beginReadback(), this must be called from the thread that owns the OpenGL context.
+         */
+        void finishReadback()
+        {
+            assertContextThread();
+            allocateHostData();
+            finishDeviceReadback(&hostData[0], hostData.size()*sizeof(T));
+        }
+        
         bool empty() const
         {
-            return hostData.empty();
+            return (size() == 0);
         }
         
         size_t size() const
         {
-            return hostData.size();
+            return width*height*depth*Channels;
+        }
+        
+        /**
+         * Returns whether the host copy of the texture data is currently available.
+         */
+        bool hasHostData() const
+        {
+            return !hostData.empty();
         }
         
         T & operator [] (const size_t &a_index)
         {
+            requireHostData();
             return hostData[a_index];
         }
         
         const T & operator [] (const size_t &a_index) const
         {
+            requireHostData();
             return hostData[a_index];
         }
         
         typename std::vector<T>::iterator begin()
         {
+            requireHostData();
             return hostData.begin();
         }
         
         typename std::vector<T>::const_iterator begin() const
         {
+            requireHostData();
             return hostData.begin();
         }
         
         typename std::vector<T>::iterator end()
         {
+            requireHostData();
             return hostData.end();
         }
         
         typename std::vector<T>::const_iterator end() const
         {
+            requireHostData();
             return hostData.end();
         }
         
     protected:
+        void allocateHostData()
+        {
+            if (!hostData.empty()) return;
+            
+            if ((flags & tf::dropHostData) != 0)
+            {
+                std::cerr << "Texture " << textureIndex << " does not keep host data, use tf::hostOnDemand to read it back from the device!" << std::endl;
+                throw std::exception();
+            }
+            
+            hostData.resize(size());
+        }
+        
+        void releaseHostData()
+        {
+            if ((flags & (tf::dropHostData | tf::hostOnDemand)) != 0) std::vector<T>().swap(hostData);
+        }
+        
+        void requireHostData() const
+        {
+            if (hostData.empty())
+            {
+                std::cerr << "The host data of texture " << textureIndex << " is not available!" << std::endl;
+                throw std::exception();
+            }
+        }
+        
         std::vector<T> hostData;
 };
 
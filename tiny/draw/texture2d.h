@@ -66,6 +66,8 @@ class Texture2D : public Texture<T, Channels>
         Texture2D(const tiny::img::Image &image, const unsigned int &a_flags = tf::repeat | tf::filter | tf::mipmap) :
             Texture<T, Channels>(GL_TEXTURE_2D, a_flags, image.width, image.height)
         {
+            this->allocateHostData();
+            
             for (size_t y = 0; y < image.height; ++y)
             {
                 for (size_t x = 0; x < image.width; ++x)
@@ -82,6 +84,18 @@ class Texture2D : public Texture<T, Channels>
             
         }
         
+        using Texture<T, Channels>::beginReadback;
+        
+        /**
+         * Starts copying the given rectangles (x, y, width, height) of the first mipmap level from the device, like beginReadback().
+         * The other texels of the host data are left untouched by finishReadback(), and a pending readback is extended with the new rectangles.
+         */
+        void beginReadback(const std::vector<ivec4> &regions)
+        {
+            this->allocateHostData();
+            this->beginDeviceReadback(this->hostData.size()*sizeof(T), regions);
+        }
+        
         vec4 operator () (const size_t &, const size_t &) const;
 };
 
@@ -89,6 +103,8 @@ class Texture2D : public Texture<T, Channels>
 template <>
 inline vec4 Texture2D<unsigned char, 3>::operator () (const size_t &a_x, const size_t &a_y) const
 {
+    requireHostData();
+    
     if (a_x >= width || a_y >= height)
     {
         return vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -103,6 +119,8 @@ inline vec4 Texture2D<unsigned char, 3>::operator () (const size_t &a_x, const s
 template <>
 inline vec4 Texture2D<unsigned char, 4>::operator () (const size_t &a_x, const size_t &a_y) const
 {
+    requireHostData();
+    
     if (a_x >= width || a_y >= height)
     {
         return vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -117,6 +135,8 @@ inline vec4 Texture2D<unsigned char, 4>::operator () (const size_t &a_x, const s
 template <>
 inline vec4 Texture2D<float, 1>::operator () (const size_t &a_x, const size_t &a_y) const
 {
+    requireHostData();
+    
     if (a_x >= width || a_y >= height)
     {
         return vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -47,6 +47,8 @@ class Texture2DArray : public Texture<T, Channels>
         Texture2DArray(const tiny::img::Image &image, const unsigned int &a_flags = tf::repeat | tf::filter | tf::mipmap) :
             Texture<T, Channels>(GL_TEXTURE_2D_ARRAY, a_flags, image.width, image.height, 1)
         {
+            this->allocateHostData();
+            
             for (size_t y = 0; y < image.height; ++y)
             {
                 for (size_t x = 0; x < image.width; ++x)
@@ -64,6 +66,8 @@ class Texture2DArray : public Texture<T, Channels>
         Texture2DArray(ImageIterator first, ImageIterator last, const unsigned int &a_flags = tf::repeat | tf::filter | tf::mipmap) :
             Texture<T, Channels>(GL_TEXTURE_2D_ARRAY, a_flags, first->width, first->height, last - first)
         {
+            this->allocateHostData();
+            
             size_t offset = 0;
             
             for (ImageIterator i = first; i != last; ++i)
@@ -0,0 +1,56 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <tiny/draw/buffer.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! \p UniformBuffer : data buffer on an OpenGL device that backs a GLSL uniform block.
+ * 
+ * \tparam T type of object stored in this buffer, the host data should follow the std140 layout of the block
+ */
+template<typename T>
+class UniformBuffer : public Buffer<T>
+{
+    public:
+        UniformBuffer(const size_t &a_size) :
+            Buffer<T>(a_size, GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW)
+        {
+
+        }
+
+        UniformBuffer(const UniformBuffer &a_buffer) :
+            Buffer<T>(a_buffer)
+        {
+
+        }
+        
+        virtual ~UniformBuffer()
+        {
+
+        }
+};
+
+}
+
+}
+
@@ -22,7 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::draw;
 
 UniformMap::UniformMap() :
-    texturesAreLocked(false)
+    texturesAreLocked(false),
+    uniforms(),
+    uniformIndices(),
+    programLocations(),
+    textures(),
+    uniformBlocks()
 {
 
 }
@@ -34,7 +39,7 @@ UniformMap::~UniformMap()
 
 size_t UniformMap::getNrUniforms() const
 {
-    return intUniforms.size() + floatUniforms.size() + matrixUniforms.size();
+    return uniforms.size();
 }
 
 size_t UniformMap::getNrTextures() const
@@ -64,76 +69,133 @@ void UniformMap::lockTextures()
     texturesAreLocked = true;
 }
 
-void UniformMap::setIntUniform(const int &x, const std::string &name) {intUniforms[name] = detail::IntUniform(name, 1, x);}
+detail::BoundUniform &UniformMap::getUniform(const std::string &name)
+{
+    std::map<std::string, size_t>::const_iterator i = uniformIndices.find(name);
+    
+    if (i != uniformIndices.end()) return uniforms[i->second];
+    
+    //Give each new uniform a unique serial, such that programs can tell apart uniforms with the same name from different maps.
+    static unsigned int lastSerial = 0;
+    
+    uniformIndices.insert(std::make_pair(name, uniforms.size()));
+    uniforms.push_back(detail::BoundUniform(name, ++lastSerial));
+    
+    return uniforms.back();
+}
+
+void UniformMap::setIntValues(const std::string &name, const size_t &numParameters, const GLint &x, const GLint &y, const GLint &z, const GLint &w)
+{
+    detail::BoundUniform &uniform = getUniform(name);
+    
+    //Only increment the version if the value has actually changed.
+    if (uniform.type == detail::IntUniform && uniform.numParameters == numParameters && uniform.version > 0 &&
+        uniform.intValues[0] == x && uniform.intValues[1] == y && uniform.intValues[2] == z && uniform.intValues[3] == w) return;
+    
+    uniform.type = detail::IntUniform;
+    uniform.numParameters = numParameters;
+    uniform.intValues[0] = x;
+    uniform.intValues[1] = y;
+    uniform.intValues[2] = z;
+    uniform.intValues[3] = w;
+    ++uniform.version;
+}
+
+void UniformMap::setFloatValues(const std::string &name, const detail::UniformType &type, const size_t &numParameters, const GLfloat *values)
+{
+    detail::BoundUniform &uniform = getUniform(name);
+    
+    //Only increment the version if the value has actually changed.
+    if (uniform.type == type && uniform.numParameters == numParameters && uniform.version > 0 &&
+        std::equal(values, values + numParameters, uniform.values)) return;
+    
+    uniform.type = type;
+    uniform.numParameters = numParameters;
+    std::copy(values, values + numParameters, uniform.values);
+    ++uniform.version;
+}
 
-void UniformMap::setFloatUniform(const float &x, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 1, x);}
-void UniformMap::setVec2Uniform(const float &x, const float &y, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 2, x, y);}
-void UniformMap::setVec3Uniform(const float &x, const float &y, const float &z, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 3, x, y, z);}
-void UniformMap::setVec4Uniform(const float &x, const float &y, const float &z, const float &w, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 4, x, y, z, w);}
+void UniformMap::setIntUniform(const int &x, const std::string &name) {setIntValues(name, 1, x);}
 
-void UniformMap::setVec2Uniform(const vec2 &v, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 2, v.x, v.y);}
-void UniformMap::setVec3Uniform(const vec3 &v, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 3, v.x, v.y, v.z);}
-void UniformMap::setVec4Uniform(const vec4 &v, const std::string &name) {floatUniforms[name] = detail::FloatUniform(name, 4, v.x, v.y, v.z, v.w);}
-void UniformMap::setMat4Uniform(const mat4 &m, const std::string &name) {matrixUniforms[name] = detail::MatrixUniform(name, m);}
+void UniformMap::setFloatUniform(const float &x, const std::string &name) {const GLfloat v[1] = {x}; setFloatValues(name, detail::FloatUniform, 1, v);}
+void UniformMap::setVec2Uniform(const float &x, const float &y, const std::string &name) {const GLfloat v[2] = {x, y}; setFloatValues(name, detail::FloatUniform, 2, v);}
+void UniformMap::setVec3Uniform(const float &x, const float &y, const float &z, const std::string &name) {const GLfloat v[3] = {x, y, z}; setFloatValues(name, detail::FloatUniform, 3, v);}
+void UniformMap::setVec4Uniform(const float &x, const float &y, const float &z, const float &w, const std::string &name) {const GLfloat v[4] = {x, y, z, w}; setFloatValues(name, detail::FloatUniform, 4, v);}
 
-void UniformMap::setUniformsInProgram(const ShaderProgram &program) const
+void UniformMap::setVec2Uniform(const vec2 &v, const std::string &name) {setVec2Uniform(v.x, v.y, name);}
+void UniformMap::setVec3Uniform(const vec3 &v, const std::string &name) {setVec3Uniform(v.x, v.y, v.z, name);}
+void UniformMap::setVec4Uniform(const vec4 &v, const std::string &name) {setVec4Uniform(v.x, v.y, v.z, v.w, name);}
+void UniformMap::setMat4Uniform(const mat4 &m, const std::string &name) {GLfloat v[16]; m.toOpenGL(v); setFloatValues(name, detail::MatrixUniform, 16, v);}
+
+void UniformMap::setUniformBuffer(const BufferInterface &buffer, const std::string &blockName, const GLuint &bindingPoint)
 {
-    for (std::map<std::string, detail::IntUniform>::const_iterator i = intUniforms.begin(); i != intUniforms.end(); ++i)
+    for (std::vector<detail::BoundUniformBlock>::iterator i = uniformBlocks.begin(); i != uniformBlocks.end(); ++i)
     {
-        const detail::IntUniform uniform = i->second;
-        const GLint location = glGetUniformLocation(program.getIndex(), uniform.name.c_str());
-        
-        if (location < 0)
+        if (i->name == blockName)
         {
-#ifndef NDEBUG
-            //std::cerr << "Warning: uniform variable '" << uniform.name << "' does not exist in the GLSL program " << program.getIndex() << "!" << std::endl;
-#endif
-            continue;
+            *i = detail::BoundUniformBlock(blockName, &buffer, bindingPoint);
+            return;
         }
-        
-             if (uniform.numParameters == 1) GL_CHECK(glUniform1i(location, uniform.x));
-        else if (uniform.numParameters == 2) GL_CHECK(glUniform2i(location, uniform.x, uniform.y));
-        else if (uniform.numParameters == 3) GL_CHECK(glUniform3i(location, uniform.x, uniform.y, uniform.z));
-        else if (uniform.numParameters == 4) GL_CHECK(glUniform4i(location, uniform.x, uniform.y, uniform.z, uniform.w));
-        else std::cerr << "Warning: uniform variable '" << uniform.name << "' has an invalid number of parameters (" << uniform.numParameters << ")!" << std::endl;
     }
     
-    for (std::map<std::string, detail::FloatUniform>::const_iterator i = floatUniforms.begin(); i != floatUniforms.end(); ++i)
+    uniformBlocks.push_back(detail::BoundUniformBlock(blockName, &buffer, bindingPoint));
+}
+
+void UniformMap::setUniformsInProgram(const ShaderProgram &program) const
+{
+    //Look up the locations of all uniforms in this program only once.
+    std::map<unsigned int, std::vector<GLint> >::iterator entry = programLocations.find(program.getLinkIdentifier());
+    
+    if (entry == programLocations.end())
     {
-        const detail::FloatUniform uniform = i->second;
-        const GLint location = glGetUniformLocation(program.getIndex(), uniform.name.c_str());
-        
-        if (location < 0)
+        //Drop the locations of programs that have since been relinked or deleted.
+        for (std::map<unsigned int, std::vector<GLint> >::iterator i = programLocations.begin(); i != programLocations.end(); )
         {
-#ifndef NDEBUG
-            //std::cerr << "Warning: uniform variable '" << uniform.name << "' does not exist in the GLSL program " << program.getIndex() << "!" << std::endl;
-#endif
-            continue;
+            if (ShaderProgram::isLinkIdentifierInUse(i->first)) ++i;
+            else programLocations.erase(i++);
         }
         
-             if (uniform.numParameters == 1) GL_CHECK(glUniform1f(location, uniform.x));
-        else if (uniform.numParameters == 2) GL_CHECK(glUniform2f(location, uniform.x, uniform.y));
-        else if (uniform.numParameters == 3) GL_CHECK(glUniform3f(location, uniform.x, uniform.y, uniform.z));
-        else if (uniform.numParameters == 4) GL_CHECK(glUniform4f(location, uniform.x, uniform.y, uniform.z, uniform.w));
-        else std::cerr << "Warning: uniform variable '" << uniform.name << "' has an invalid number of parameters (" << uniform.numParameters << ")!" << std::endl;
+        entry = programLocations.insert(std::make_pair(program.getLinkIdentifier(), std::vector<GLint>())).first;
     }
     
-    for (std::map<std::string, detail::MatrixUniform>::const_iterator i = matrixUniforms.begin(); i != matrixUniforms.end(); ++i)
+    std::vector<GLint> &locations = entry->second;
+    
+    while (locations.size() < uniforms.size())
     {
-        const detail::MatrixUniform uniform = i->second;
-        const GLint location = glGetUniformLocation(program.getIndex(), uniform.name.c_str());
-        GLfloat data[16]; 
+        locations.push_back(glGetUniformLocation(program.getIndex(), uniforms[locations.size()].name.c_str()));
+    }
+    
+    for (size_t i = 0; i < uniforms.size(); ++i)
+    {
+        const detail::BoundUniform &uniform = uniforms[i];
+        const GLint location = locations[i];
         
-        if (location < 0)
+        //Skip uniforms that do not exist in this program or of which this value has already been uploaded.
+        if (location < 0 || !program.updateUniformStamp(location, uniform.serial, uniform.version))
         {
-#ifndef NDEBUG
-            //std::cerr << "Warning: uniform matrix variable '" << uniform.name << "' does not exist in the GLSL program " << program.getIndex() << "!" << std::endl;
-#endif
             continue;
         }
         
-        uniform.m.toOpenGL(data);
-        GL_CHECK(glUniformMatrix4fv(location, 1, GL_FALSE, data));
+        if (uniform.type == detail::IntUniform)
+        {
+                 if (uniform.numParameters == 1) GL_CHECK(glUniform1i(location, uniform.intValues[0]));
+            else if (uniform.numParameters == 2) GL_CHECK(glUniform2i(location, uniform.intValues[0], uniform.intValues[1]));
+            else if (uniform.numParameters == 3) GL_CHECK(glUniform3i(location, uniform.intValues[0], uniform.intValues[1], uniform.intValues[2]));
+            else if (uniform.numParameters == 4) GL_CHECK(glUniform4i(location, uniform.intValues[0], uniform.intValues[1], uniform.intValues[2], uniform.intValues[3]));
+            else std::cerr << "Warning: uniform variable '" << uniform.name << "' has an invalid number of parameters (" << uniform.numParameters << ")!" << std::endl;
+        }
+        else if (uniform.type == detail::FloatUniform)
+        {
+                 if (uniform.numParameters == 1) GL_CHECK(glUniform1f(location, uniform.values[0]));
+            else if (uniform.numParameters == 2) GL_CHECK(glUniform2f(location, uniform.values[0], uniform.values[1]));
+            else if (uniform.numParameters == 3) GL_CHECK(glUniform3f(location, uniform.values[0], uniform.values[1], uniform.values[2]));
+            else if (uniform.numParameters == 4) GL_CHECK(glUniform4f(location, uniform.values[0], uniform.values[1], uniform.values[2], uniform.values[3]));
+            else std::cerr << "Warning: uniform variable '" << uniform.name << "' has an invalid number of parameters (" << uniform.numParameters << ")!" << std::endl;
+        }
+        else if (uniform.type == detail::MatrixUniform)
+        {
+            GL_CHECK(glUniformMatrix4fv(location, 1, GL_FALSE, uniform.values));
+        }
     }
 }
 
@@ -141,6 +203,17 @@ void UniformMap::setUniformsAndTexturesInProgram(const ShaderProgram &program, c
 {
     setUniformsInProgram(program);
     
+    //Connect uniform blocks to their binding points, programs that do not use a block simply ignore it.
+    for (std::vector<detail::BoundUniformBlock>::const_iterator i = uniformBlocks.begin(); i != uniformBlocks.end(); ++i)
+    {
+        const GLuint blockIndex = glGetUniformBlockIndex(program.getIndex(), i->name.c_str());
+        
+        if (blockIndex != GL_INVALID_INDEX)
+        {
+            GL_CHECK(glUniformBlockBinding(program.getIndex(), blockIndex, i->bindingPoint));
+        }
+    }
+    
     int textureBindPoint = textureOffset;
     
     for (std::map<std::string, detail::BoundTexture>::const_iterator i = textures.begin(); i != textures.end(); ++i)
@@ -165,6 +238,11 @@ void UniformMap::bindTextures(const int &textureOffset) const
 {
     int textureBindPoint = textureOffset;
     
+    for (std::vector<detail::BoundUniformBlock>::const_iterator i = uniformBlocks.begin(); i != uniformBlocks.end(); ++i)
+    {
+        GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, i->bindingPoint, i->buffer->getIndex()));
+    }
+    
     for (std::map<std::string, detail::BoundTexture>::const_iterator i = textures.begin(); i != textures.end(); ++i)
     {
         if (i->second.texture) i->second.texture->bind(textureBindPoint);
@@ -177,6 +255,11 @@ void UniformMap::unbindTextures(const int &textureOffset) const
 {
     int textureBindPoint = textureOffset;
     
+    for (std::vector<detail::BoundUniformBlock>::const_iterator i = uniformBlocks.begin(); i != uniformBlocks.end(); ++i)
+    {
+        GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, i->bindingPoint, 0));
+    }
+    
     for (std::map<std::string, detail::BoundTexture>::const_iterator i = textures.begin(); i != textures.end(); ++i)
     {
         if (i->second.texture) i->second.texture->unbind(textureBindPoint);
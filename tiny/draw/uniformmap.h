@@ -19,12 +19,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <exception>
 #include <string>
+#include <vector>
 #include <map>
 
 #include <cassert>
 
 #include <tiny/draw/glcheck.h>
 #include <tiny/draw/texture.h>
+#include <tiny/draw/buffer.h>
 #include <tiny/draw/indexbuffer.h>
 #include <tiny/draw/shader.h>
 #include <tiny/draw/shaderprogram.h>
@@ -40,65 +42,67 @@ namespace draw
 namespace detail
 {
 
-template<typename T>
+enum UniformType
+{
+    IntUniform,
+    FloatUniform,
+    MatrixUniform
+};
+
+/*! Value of a uniform variable, with a globally unique serial and a version that is incremented whenever the value changes. */
 struct BoundUniform
 {
     BoundUniform() :
         name(""),
+        type(FloatUniform),
         numParameters(0),
-        x(0),
-        y(0),
-        z(0),
-        w(0)
+        serial(0),
+        version(0)
     {
-
+        for (int i = 0; i < 16; ++i) values[i] = 0.0f;
     }
     
     BoundUniform(const std::string &a_name,
-                 const size_t &a_numParameters,
-                 const T &a_x,
-                 const T &a_y = 0,
-                 const T &a_z = 0,
-                 const T &a_w = 0) :
+                 const unsigned int &a_serial) :
         name(a_name),
-        numParameters(a_numParameters),
-        x(a_x),
-        y(a_y),
-        z(a_z),
-        w(a_w)
+        type(FloatUniform),
+        numParameters(0),
+        serial(a_serial),
+        version(0)
     {
-
+        for (int i = 0; i < 16; ++i) values[i] = 0.0f;
     }
     
     std::string name;
+    UniformType type;
     size_t numParameters;
-    T x, y, z, w;
+    unsigned int serial;
+    unsigned int version;
+    
+    union
+    {
+        GLint intValues[4];
+        GLfloat values[16];
+    };
 };
 
-struct MatrixUniform
+struct BoundUniformBlock
 {
-    MatrixUniform() :
-        name(""),
-        m(mat4::identityMatrix())
-    {
-
-    }
-    
-    MatrixUniform(const std::string &a_name,
-                 const mat4 &a_m) :
+    BoundUniformBlock(const std::string &a_name,
+                      const BufferInterface *a_buffer,
+                      const GLuint &a_bindingPoint) :
         name(a_name),
-        m(a_m)
+        buffer(a_buffer),
+        bindingPoint(a_bindingPoint)
     {
 
     }
     
     std::string name;
-    mat4 m;
+    const BufferInterface *buffer;
+    GLuint bindingPoint;
 };
 
-typedef BoundUniform<GLfloat> FloatUniform;
-typedef BoundUniform<GLint> IntUniform;
-
 struct BoundTexture
 {
     BoundTexture() :
@@ -158,18 +162,27 @@ class UniformMap
         void setVec4Uniform(const vec4 &v, const std::string &name);
         void setMat4Uniform(const mat4 &m, const std::string &name);
         
+        void setUniformBuffer(const BufferInterface &buffer, const std::string &blockName, const GLuint &bindingPoint);
+        
         void setUniformsInProgram(const ShaderProgram &) const;
         void setUniformsAndTexturesInProgram(const ShaderProgram &, const int & = 0) const;
         void bindTextures(const int & = 0) const;
         void unbindTextures(const int & = 0) const;
         
     private:
+        void setIntValues(const std::string &, const size_t &, const GLint &, const GLint & = 0, const GLint & = 0, const GLint & = 0);
+        void setFloatValues(const std::string &, const detail::UniformType &, const size_t &, const GLfloat *);
+        detail::BoundUniform &getUniform(const std::string &);
+        
         bool texturesAreLocked;
         
-        std::map<std::string, detail::IntUniform> intUniforms;
-        std::map<std::string, detail::FloatUniform> floatUniforms;
-        std::map<std::string, detail::MatrixUniform> matrixUniforms;
+        //All uniforms are stored contiguously, such that their locations can be cached per program in the same order.
+        std::vector<detail::BoundUniform> uniforms;
+        std::map<std::string, size_t> uniformIndices;
+        mutable std::map<unsigned int, std::vector<GLint> > programLocations;
+        
         std::map<std::string, detail::BoundTexture> textures;
+        std::vector<detail::BoundUniformBlock> uniformBlocks;
 };
 
 }
@@ -0,0 +1,95 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <tiny/draw/vertexarraycache.h>
+
+using namespace tiny::draw;
+
+VertexArrayCache::VertexArrayCache() :
+    vertexArrays()
+{
+
+}
+
+VertexArrayCache::VertexArrayCache(const VertexArrayCache &) :
+    vertexArrays()
+{
+    //Vertex array objects cannot be shared, so a copy starts with an empty cache.
+}
+
+VertexArrayCache::~VertexArrayCache()
+{
+    clear();
+}
+
+bool VertexArrayCache::bind(const ShaderProgram &program, const BufferInterface &vertexBuffer, const BufferInterface *instanceBuffer) const
+{
+    //Binds the vertex array object for this program and these buffers and returns true if the vertex attributes still have to be specified by binding the buffers.
+    const std::pair<unsigned int, unsigned int> bufferIdentifiers(vertexBuffer.getDeviceIdentifier(), instanceBuffer ? instanceBuffer->getDeviceIdentifier() : 0);
+    const std::pair<unsigned int, std::pair<unsigned int, unsigned int> > key(program.getLinkIdentifier(), bufferIdentifiers);
+    
+    if (vertexArrays.find(key) == vertexArrays.end())
+    {
+        //Drop the vertex arrays of programs that have since been relinked or deleted and of buffers that have been recreated or deleted on the device.
+        for (std::map<std::pair<unsigned int, std::pair<unsigned int, unsigned int> >, GLuint>::iterator i = vertexArrays.begin(); i != vertexArrays.end(); )
+        {
+            if (ShaderProgram::isLinkIdentifierInUse(i->first.first) &&
+                BufferInterface::isDeviceIdentifierInUse(i->first.second.first) &&
+                (i->first.second.second == 0 || BufferInterface::isDeviceIdentifierInUse(i->first.second.second)))
+            {
+                ++i;
+            }
+            else
+            {
+                if (i->second != 0) GL_CHECK(glDeleteVertexArrays(1, &i->second));
+                vertexArrays.erase(i++);
+            }
+        }
+    }
+    
+    GLuint &vertexArrayIndex = vertexArrays[key];
+    bool isNew = false;
+    
+    if (vertexArrayIndex == 0)
+    {
+        GL_CHECK(glGenVertexArrays(1, &vertexArrayIndex));
+        
+        if (vertexArrayIndex == 0)
+            throw std::bad_alloc();
+        
+        isNew = true;
+    }
+    
+    GL_CHECK(glBindVertexArray(vertexArrayIndex));
+    
+    return isNew;
+}
+
+void VertexArrayCache::unbind() const
+{
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void VertexArrayCache::clear()
+{
+    for (std::map<std::pair<unsigned int, std::pair<unsigned int, unsigned int> >, GLuint>::iterator i = vertexArrays.begin(); i != vertexArrays.end(); ++i)
+    {
+        if (i->second != 0) GL_CHECK(glDeleteVertexArrays(1, &i->second));
+    }
+    
+    vertexArrays.clear();
+}
+
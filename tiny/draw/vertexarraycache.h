@@ -0,0 +1,62 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <exception>
+#include <map>
+#include <utility>
+
+#include <cassert>
+
+#include <tiny/draw/glcheck.h>
+#include <tiny/draw/buffer.h>
+#include <tiny/draw/shaderprogram.h>
+
+namespace tiny
+{
+
+namespace draw
+{
+
+/*! \p VertexArrayCache : keeps one vertex array object per combination of shader program, vertex buffer, and instance buffer.
+ * 
+ *  The vertex attribute layout only has to be specified the first time a combination is used, such that a buffer that is recreated on the device, or a streaming buffer that cycles through several device buffers, simply gets its own vertex array.
+ *  Vertex arrays of relinked or deleted programs and of deleted device buffers are freed when a new combination is encountered.
+ */
+class VertexArrayCache
+{
+    public:
+        VertexArrayCache();
+        VertexArrayCache(const VertexArrayCache &);
+        ~VertexArrayCache();
+        
+        bool bind(const ShaderProgram &, const BufferInterface &, const BufferInterface * = 0) const;
+        void unbind() const;
+        void clear();
+        
+    private:
+        VertexArrayCache & operator = (const VertexArrayCache &);
+        
+        //Vertex arrays indexed by shader program link identifier and the device identifiers of the vertex and instance buffers.
+        mutable std::map<std::pair<unsigned int, std::pair<unsigned int, unsigned int> >, GLuint> vertexArrays;
+};
+
+}
+
+}
+
@@ -32,8 +32,8 @@ template<typename T>
 class VertexBuffer : public Buffer<T>
 {
     public:
-        VertexBuffer(const size_t &a_size) :
-            Buffer<T>(a_size, GL_ARRAY_BUFFER, GL_STATIC_DRAW)
+        VertexBuffer(const size_t &a_size, const GLenum &a_usage = GL_STATIC_DRAW, const unsigned int &a_flags = bf::none) :
+            Buffer<T>(a_size, GL_ARRAY_BUFFER, a_usage, a_flags)
         {
 
         }
@@ -45,8 +45,8 @@ class VertexBuffer : public Buffer<T>
         }
         
         template <typename Iterator>
-        VertexBuffer(Iterator first, Iterator last) :
-            Buffer<T>(first, last, GL_ARRAY_BUFFER, GL_STATIC_DRAW)
+        VertexBuffer(Iterator first, Iterator last, const unsigned int &a_flags = bf::none) :
+            Buffer<T>(first, last, GL_ARRAY_BUFFER, GL_STATIC_DRAW, a_flags)
         {
 
         }
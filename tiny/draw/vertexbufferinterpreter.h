@@ -65,15 +65,15 @@ template <typename T>
 class VertexBufferInterpreter : public VertexBuffer<T>
 {
     public:
-        VertexBufferInterpreter(const size_t &a_size) :
-            VertexBuffer<T>(a_size)
+        VertexBufferInterpreter(const size_t &a_size, const GLenum &a_usage = GL_STATIC_DRAW, const unsigned int &a_flags = bf::none) :
+            VertexBuffer<T>(a_size, a_usage, a_flags)
         {
 
         }
         
         template <typename Iterator>
-        VertexBufferInterpreter(Iterator first, Iterator last) :
-            VertexBuffer<T>(first, last)
+        VertexBufferInterpreter(Iterator first, Iterator last, const unsigned int &a_flags = bf::none) :
+            VertexBuffer<T>(first, last, a_flags)
         {
 
         }
@@ -22,9 +22,9 @@ using namespace tiny::draw;
 
 WorldRenderer::WorldRenderer(const int &screenWidth, const int &screenHeight) :
     aspectRatio(static_cast<float>(screenWidth)/std::max(static_cast<float>(screenHeight), 1.0f)),
-    diffuseTexture(screenWidth, screenHeight, tf::none),
-    worldNormalTexture(screenWidth, screenHeight, tf::none),
-    worldPositionTexture(screenWidth, screenHeight, tf::none),
+    diffuseTexture(screenWidth, screenHeight, tf::hostOnDemand),
+    worldNormalTexture(screenWidth, screenHeight, tf::hostOnDemand),
+    worldPositionTexture(screenWidth, screenHeight, tf::hostOnDemand),
     depthTexture(screenWidth, screenHeight),
     worldToScreenRenderer(aspectRatio),
     screenToColourRenderer(aspectRatio)
@@ -57,6 +57,17 @@ void WorldRenderer::setCamera(const vec3 &position, const vec4 &orientation)
     screenToColourRenderer.setCamera(position, orientation);
 }
 
+void WorldRenderer::enableCameraUniformBuffer()
+{
+    worldToScreenRenderer.enableCameraUniformBuffer();
+    screenToColourRenderer.enableCameraUniformBuffer();
+}
+
+tiny::mat4 WorldRenderer::getWorldToScreenMatrix() const
+{
+    return worldToScreenRenderer.getWorldToScreenMatrix();
+}
+
 void WorldRenderer::addWorldRenderable(const unsigned int &renderableIndex, Renderable *renderable, const bool &readFromDepthTexture, const bool &writeToDepthTexture, const BlendMode &blendMode, const CullMode &cullMode)
 {
     worldToScreenRenderer.addRenderable(renderableIndex, renderable, readFromDepthTexture, writeToDepthTexture, blendMode, cullMode);
@@ -88,3 +99,24 @@ void WorldRenderer::render() const
     screenToColourRenderer.render();
 }
 
+void WorldRenderer::setRenderOrder(const RenderOrder &order)
+{
+    worldToScreenRenderer.setRenderOrder(order);
+    screenToColourRenderer.setRenderOrder(order);
+}
+
+RenderStatistics WorldRenderer::getRenderStatistics() const
+{
+    RenderStatistics statistics = worldToScreenRenderer.getRenderStatistics();
+    
+    statistics += screenToColourRenderer.getRenderStatistics();
+    
+    return statistics;
+}
+
+void WorldRenderer::setProfiler(FrameProfiler *profiler)
+{
+    worldToScreenRenderer.setProfiler(profiler, "world");
+    screenToColourRenderer.setProfiler(profiler, "screen");
+}
+
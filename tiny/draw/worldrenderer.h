@@ -41,6 +41,10 @@ class WorldRenderer
         
         void setProjectionMatrix(const mat4 &);
         void setCamera(const vec3 &, const vec4 &);
+        mat4 getWorldToScreenMatrix() const;
+        
+        /** Provide the camera uniforms of both stages as a std140 uniform block as well, see RendererWithCamera::enableCameraUniformBuffer(). */
+        void enableCameraUniformBuffer();
         
         void addWorldRenderable(const unsigned int &, Renderable *, const bool & = true, const bool & = true, const BlendMode & = BlendReplace, const CullMode & = CullBack);
         void addScreenRenderable(const unsigned int &, Renderable *, const bool & = true, const bool & = true, const BlendMode & = BlendReplace, const CullMode & = CullBack);
@@ -50,6 +54,12 @@ class WorldRenderer
         void clearTargets() const;
         void render() const;
         
+        void setRenderOrder(const RenderOrder &);
+        RenderStatistics getRenderStatistics() const;
+        
+        /** Profile the world (geometry) and screen (lighting) stages with the given profiler, or stop profiling when 0 is passed. */
+        void setProfiler(FrameProfiler *);
+        
     private:
         const float aspectRatio;
         
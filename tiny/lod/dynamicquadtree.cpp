@@ -0,0 +1,356 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits>
+
+#include <tiny/lod/dynamicquadtree.h>
+
+using namespace tiny;
+using namespace tiny::lod;
+
+DynamicQuadtree::DynamicQuadtree(const vec2 &centre, const float &halfSize, const int &a_maxLeafSize, const float &a_looseness) :
+    maxLeafSize(std::max(a_maxLeafSize, 2)),
+    looseness(std::max(a_looseness, 1.0f)),
+    minHalfSize(halfSize/65536.0f),
+    nodes(1),
+    freeNodes(),
+    instances(),
+    nrInstances(0),
+    traversalQueue()
+{
+    nodes[0].centre = centre;
+    nodes[0].halfSize = halfSize;
+    clear();
+}
+
+DynamicQuadtree::~DynamicQuadtree()
+{
+
+}
+
+void DynamicQuadtree::clear()
+{
+    DynamicQuadtreeNode root;
+
+    root.centre = nodes[0].centre;
+    root.halfSize = nodes[0].halfSize;
+
+    nodes.assign(1, root);
+    freeNodes.clear();
+    instances.clear();
+    nrInstances = 0;
+    computeBounds(0);
+}
+
+void DynamicQuadtree::insert(const int &id, const vec3 &position)
+{
+    assert(id >= 0);
+
+    if (id >= static_cast<int>(instances.size()))
+    {
+        instances.resize(id + 1);
+    }
+
+    if (instances[id].node >= 0)
+    {
+        std::cerr << "Warning: Instance " << id << " is already present in the quadtree, moving it instead!" << std::endl;
+        move(id, position);
+        return;
+    }
+
+    instances[id].position = position;
+    insertIntoTree(id);
+    ++nrInstances;
+}
+
+void DynamicQuadtree::remove(const int &id)
+{
+    if (!contains(id))
+    {
+        std::cerr << "Warning: Unable to remove instance " << id << " that is not present in the quadtree!" << std::endl;
+        return;
+    }
+
+    const int leaf = instances[id].node;
+
+    removeFromTree(id);
+    mergeAncestors(leaf);
+    --nrInstances;
+}
+
+void DynamicQuadtree::move(const int &id, const vec3 &position)
+{
+    if (!contains(id))
+    {
+        insert(id, position);
+        return;
+    }
+
+    const int leaf = instances[id].node;
+
+    instances[id].position = position;
+
+    if (insideLooseCell(nodes[leaf], position))
+    {
+        //The instance remains in its leaf, so we only have to make sure that the bounding boxes of the leaf and its ancestors contain it.
+        for (int i = leaf; i >= 0; i = nodes[i].parent)
+        {
+            const DynamicQuadtreeNode &n = nodes[i];
+
+            if (position.x >= n.minBound.x && position.y >= n.minBound.y && position.z >= n.minBound.z &&
+                position.x <= n.maxBound.x && position.y <= n.maxBound.y && position.z <= n.maxBound.z)
+            {
+                break;
+            }
+
+            growBounds(nodes[i], position);
+        }
+    }
+    else
+    {
+        //Re-insert the instance from the root and merge the subtree it left behind if it became too sparse.
+        removeFromTree(id);
+        insertIntoTree(id);
+        mergeAncestors(leaf);
+    }
+}
+
+bool DynamicQuadtree::contains(const int &id) const
+{
+    return (id >= 0 && id < static_cast<int>(instances.size()) && instances[id].node >= 0);
+}
+
+int DynamicQuadtree::getNrInstances() const
+{
+    return nrInstances;
+}
+
+int DynamicQuadtree::getNrNodes() const
+{
+    return nodes.size() - freeNodes.size();
+}
+
+void DynamicQuadtree::growBounds(DynamicQuadtreeNode &n, const vec3 &p)
+{
+    n.minBound = vec3(std::min(n.minBound.x, p.x), std::min(n.minBound.y, p.y), std::min(n.minBound.z, p.z));
+    n.maxBound = vec3(std::max(n.maxBound.x, p.x), std::max(n.maxBound.y, p.y), std::max(n.maxBound.z, p.z));
+}
+
+bool DynamicQuadtree::insideLooseCell(const DynamicQuadtreeNode &n, const vec3 &p) const
+{
+    const float h = looseness*n.halfSize;
+
+    return (fabsf(p.x - n.centre.x) <= h && fabsf(p.z - n.centre.y) <= h);
+}
+
+void DynamicQuadtree::insertIntoTree(const int &id)
+{
+    const vec3 p = instances[id].position;
+    int i = 0;
+
+    //Descend to the leaf whose cell contains the position, growing the bounds of all nodes along the way.
+    //Positions outside the root cell end up in the nearest leaf.
+    while (true)
+    {
+        DynamicQuadtreeNode &n = nodes[i];
+
+        growBounds(n, p);
+        ++n.nrInstances;
+
+        if (n.firstChild < 0) break;
+
+        i = n.firstChild + ((p.x < n.centre.x ? 0 : 1) | (p.z < n.centre.y ? 0 : 2));
+    }
+
+    instances[id].node = i;
+    instances[id].slot = nodes[i].items.size();
+    nodes[i].items.push_back(id);
+
+    if (static_cast<int>(nodes[i].items.size()) > maxLeafSize)
+    {
+        splitNode(i);
+    }
+}
+
+void DynamicQuadtree::removeFromTree(const int &id)
+{
+    const int leaf = instances[id].node;
+    const int slot = instances[id].slot;
+    std::vector<int> &items = nodes[leaf].items;
+
+    //Swap the instance with the last item of its leaf.
+    items[slot] = items.back();
+    instances[items[slot]].slot = slot;
+    items.pop_back();
+
+    instances[id].node = -1;
+
+    for (int i = leaf; i >= 0; i = nodes[i].parent)
+    {
+        --nodes[i].nrInstances;
+    }
+}
+
+void DynamicQuadtree::splitNode(const int &index)
+{
+    if (nodes[index].halfSize <= minHalfSize)
+    {
+        //Do not subdivide (nearly) coincident instances indefinitely.
+        return;
+    }
+
+    //Allocate four consecutive children.
+    int firstChild = 0;
+
+    if (!freeNodes.empty())
+    {
+        firstChild = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else
+    {
+        firstChild = nodes.size();
+        nodes.resize(nodes.size() + 4);
+    }
+
+    DynamicQuadtreeNode &n = nodes[index];
+    const float h = 0.5f*n.halfSize;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        DynamicQuadtreeNode &c = nodes[firstChild + i];
+
+        c.centre = vec2(n.centre.x + ((i & 1) != 0 ? h : -h), n.centre.y + ((i & 2) != 0 ? h : -h));
+        c.halfSize = h;
+        c.parent = index;
+        c.firstChild = -1;
+        c.nrInstances = 0;
+        c.items.clear();
+    }
+
+    //Distribute the items over the children.
+    for (std::vector<int>::const_iterator i = n.items.begin(); i != n.items.end(); ++i)
+    {
+        const vec3 p = instances[*i].position;
+        const int child = firstChild + ((p.x < n.centre.x ? 0 : 1) | (p.z < n.centre.y ? 0 : 2));
+
+        instances[*i].node = child;
+        instances[*i].slot = nodes[child].items.size();
+        nodes[child].items.push_back(*i);
+        ++nodes[child].nrInstances;
+    }
+
+    n.firstChild = firstChild;
+    std::vector<int>().swap(n.items);
+
+    for (int i = firstChild; i < firstChild + 4; ++i)
+    {
+        computeBounds(i);
+
+        if (static_cast<int>(nodes[i].items.size()) > maxLeafSize)
+        {
+            splitNode(i);
+        }
+    }
+}
+
+void DynamicQuadtree::mergeAncestors(const int &leaf)
+{
+    //Find the highest ancestor that has become sparse enough to become a single leaf.
+    //Merging at half the split size avoids repeatedly splitting and merging the same node.
+    int candidate = -1;
+
+    for (int i = nodes[leaf].parent; i >= 0 && 2*nodes[i].nrInstances <= maxLeafSize; i = nodes[i].parent)
+    {
+        candidate = i;
+    }
+
+    if (candidate >= 0)
+    {
+        mergeNode(candidate);
+    }
+}
+
+void DynamicQuadtree::mergeNode(const int &index)
+{
+    std::vector<int> items;
+
+    items.reserve(nodes[index].nrInstances);
+    collectItems(index, items);
+    freeChildren(index);
+
+    DynamicQuadtreeNode &n = nodes[index];
+
+    n.firstChild = -1;
+    n.items.swap(items);
+
+    for (unsigned int i = 0; i < n.items.size(); ++i)
+    {
+        instances[n.items[i]].node = index;
+        instances[n.items[i]].slot = i;
+    }
+
+    computeBounds(index);
+}
+
+void DynamicQuadtree::collectItems(const int &index, std::vector<int> &items)
+{
+    const DynamicQuadtreeNode &n = nodes[index];
+
+    if (n.firstChild < 0)
+    {
+        items.insert(items.end(), n.items.begin(), n.items.end());
+    }
+    else
+    {
+        for (int i = n.firstChild; i < n.firstChild + 4; ++i)
+        {
+            collectItems(i, items);
+        }
+    }
+}
+
+void DynamicQuadtree::freeChildren(const int &index)
+{
+    const int firstChild = nodes[index].firstChild;
+
+    if (firstChild < 0) return;
+
+    for (int i = firstChild; i < firstChild + 4; ++i)
+    {
+        freeChildren(i);
+        nodes[i].firstChild = -1;
+        nodes[i].nrInstances = 0;
+        std::vector<int>().swap(nodes[i].items);
+    }
+
+    freeNodes.push_back(firstChild);
+}
+
+void DynamicQuadtree::computeBounds(const int &index)
+{
+    DynamicQuadtreeNode &n = nodes[index];
+
+    //Empty nodes get an inverted box, such that growing it with a single position gives a box containing only that position.
+    n.minBound = vec3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    n.maxBound = vec3(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+
+    for (std::vector<int>::const_iterator i = n.items.begin(); i != n.items.end(); ++i)
+    {
+        growBounds(n, instances[*i].position);
+    }
+}
+
@@ -0,0 +1,226 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <tiny/math/vec.h>
+#include <tiny/lod/quadtree.h>
+
+namespace tiny
+{
+
+namespace lod
+{
+
+/** A node of a DynamicQuadtree.
+  * Each node covers a square cell in the xz-plane and stores a conservative bounding box of all instances below it.
+  * The children of a node are stored as four consecutive nodes starting at firstChild, and leaves have firstChild < 0. */
+struct DynamicQuadtreeNode
+{
+    DynamicQuadtreeNode() :
+        minBound(0.0f, 0.0f, 0.0f),
+        maxBound(0.0f, 0.0f, 0.0f),
+        centre(0.0f, 0.0f),
+        halfSize(0.0f),
+        parent(-1),
+        firstChild(-1),
+        nrInstances(0),
+        items()
+    {
+
+    }
+
+    vec3 minBound, maxBound;
+    vec2 centre;
+    float halfSize;
+    int parent, firstChild;
+    int nrInstances;
+    std::vector<int> items;
+};
+
+/** Location of an instance inside a DynamicQuadtree. */
+struct DynamicQuadtreeInstance
+{
+    DynamicQuadtreeInstance() :
+        position(0.0f, 0.0f, 0.0f),
+        node(-1),
+        slot(0)
+    {
+
+    }
+
+    vec3 position;
+    int node;
+    int slot;
+};
+
+/** A quadtree that supports inserting, removing and moving individual instances, such that it can be kept up to date for moving objects without rebuilding it every frame.
+  * Instances are identified by non-negative integer ids, which should be small since a table indexed by id is kept.
+  *
+  * Node bounds are loose: an instance only leaves its leaf once it moves outside the leaf's cell enlarged by the looseness factor, and bounding boxes only grow when instances move or are removed.
+  * Leaves are split once they contain more than maxLeafSize instances and subtrees are merged back into a single leaf once they contain at most half that number.
+  * Bounding boxes are recomputed exactly whenever a node is split or merged.
+  *
+  * Queries return the same indices as a Quadtree built from the same positions, but not necessarily in the same order.
+  * This only holds for queries that are not truncated by maxNrIndices: both trees visit their nodes from near to far, but since their nodes differ, a truncated query can return a different set of indices.
+  */
+class DynamicQuadtree
+{
+    public:
+        DynamicQuadtree(const vec2 &, const float &, const int & = 16, const float & = 1.5f);
+        ~DynamicQuadtree();
+
+        void clear();
+
+        void insert(const int &, const vec3 &);
+        void remove(const int &);
+        void move(const int &, const vec3 &);
+
+        bool contains(const int &) const;
+        int getNrInstances() const;
+        int getNrNodes() const;
+
+        /** Retrieve the indices of at most maxNrIndices objects whose distance to position lies in [minRadius, maxRadius), traversing the tree from near to far.
+          * A truncated query returns the first maxNrIndices indices of the untruncated query, which are not necessarily the nearest objects nor those that a Quadtree would return.
+          * As for Quadtree, the traversal queue is stored in the tree such that a single tree should not be queried from multiple threads simultaneously. */
+        template <typename Iterator>
+        Iterator retrieveIndicesBetweenRadii(const vec3 &position, const float &minRadius, const float &maxRadius, Iterator indices, int maxNrIndices) const
+        {
+            if (maxNrIndices <= 0)
+            {
+                std::cerr << "Warning: Filling empty instance list!" << std::endl;
+                return indices;
+            }
+
+            if (nodes[0].nrInstances == 0)
+            {
+                return indices;
+            }
+
+            //Traverse the nodes ordered by their minimum distance to the supplied position.
+            //The annuli field of the queue entries is set for nodes that are known to lie entirely within the annulus.
+            int order = 0;
+
+            traversalQueue.clear();
+            traversalQueue.push_back(QuadtreeQueueEntry(minimumDistance(nodes[0], position), order++, 0, 0));
+
+            while (!traversalQueue.empty() && maxNrIndices > 0)
+            {
+                std::pop_heap(traversalQueue.begin(), traversalQueue.end());
+
+                const QuadtreeQueueEntry entry = traversalQueue.back();
+                const DynamicQuadtreeNode &n = nodes[entry.node];
+                bool contained = (entry.annuli != 0);
+
+                traversalQueue.pop_back();
+
+                if (!contained)
+                {
+                    const float maxDistance = maximumDistance(n, position);
+
+                    if (entry.distance >= maxRadius || maxDistance < minRadius)
+                    {
+                        //The node is completely outside the annulus.
+                        continue;
+                    }
+
+                    contained = (entry.distance >= minRadius && maxDistance < maxRadius);
+                }
+
+                if (n.firstChild < 0)
+                {
+                    for (std::vector<int>::const_iterator i = n.items.begin(); i != n.items.end() && maxNrIndices > 0; ++i)
+                    {
+                        const float instanceDistance = length(instances[*i].position - position);
+
+                        if (contained || (instanceDistance >= minRadius && instanceDistance < maxRadius))
+                        {
+                            *indices++ = *i;
+                            --maxNrIndices;
+                        }
+                    }
+                }
+                else
+                {
+                    for (int i = n.firstChild; i < n.firstChild + 4; ++i)
+                    {
+                        if (nodes[i].nrInstances > 0)
+                        {
+                            traversalQueue.push_back(QuadtreeQueueEntry(minimumDistance(nodes[i], position), order++, i, contained ? 1 : 0));
+                            std::push_heap(traversalQueue.begin(), traversalQueue.end());
+                        }
+                    }
+                }
+            }
+
+            return indices;
+        }
+
+    private:
+        /** Distance from a position to the nearest point of a node's bounding box. */
+        static float minimumDistance(const DynamicQuadtreeNode &n, const vec3 &p)
+        {
+            const float dx = std::max(0.0f, std::max(n.minBound.x - p.x, p.x - n.maxBound.x));
+            const float dy = std::max(0.0f, std::max(n.minBound.y - p.y, p.y - n.maxBound.y));
+            const float dz = std::max(0.0f, std::max(n.minBound.z - p.z, p.z - n.maxBound.z));
+
+            return sqrtf(dx*dx + dy*dy + dz*dz);
+        }
+
+        /** Distance from a position to the furthest point of a node's bounding box. */
+        static float maximumDistance(const DynamicQuadtreeNode &n, const vec3 &p)
+        {
+            const float dx = std::max(fabsf(p.x - n.minBound.x), fabsf(p.x - n.maxBound.x));
+            const float dy = std::max(fabsf(p.y - n.minBound.y), fabsf(p.y - n.maxBound.y));
+            const float dz = std::max(fabsf(p.z - n.minBound.z), fabsf(p.z - n.maxBound.z));
+
+            return sqrtf(dx*dx + dy*dy + dz*dz);
+        }
+
+        static void growBounds(DynamicQuadtreeNode &, const vec3 &);
+        bool insideLooseCell(const DynamicQuadtreeNode &, const vec3 &) const;
+
+        void insertIntoTree(const int &);
+        void removeFromTree(const int &);
+        void splitNode(const int &);
+        void mergeAncestors(const int &);
+        void mergeNode(const int &);
+        void collectItems(const int &, std::vector<int> &);
+        void freeChildren(const int &);
+        void computeBounds(const int &);
+
+        const int maxLeafSize;
+        const float looseness;
+        const float minHalfSize;
+
+        std::vector<DynamicQuadtreeNode> nodes;
+        std::vector<int> freeNodes;
+        std::vector<DynamicQuadtreeInstance> instances;
+        int nrInstances;
+        mutable std::vector<QuadtreeQueueEntry> traversalQueue;
+};
+
+}
+
+}
+
@@ -14,14 +14,46 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <algorithm>
+
 #include <tiny/lod/quadtree.h>
 
+using namespace tiny;
 using namespace tiny::lod;
 
+/** Builds the subtree below a single node into a separate node list, such that subtrees can be built independently. */
+class Quadtree::BuildJob : public os::ThreadJob
+{
+    public:
+        BuildJob(Quadtree *a_tree, const int &a_root) :
+            os::ThreadJob(),
+            tree(a_tree),
+            root(a_root),
+            subtree()
+        {
+
+        }
+        
+        void run()
+        {
+            subtree.assign(1, tree->nodes[root]);
+            tree->buildSubtreeSoA(0, subtree);
+        }
+        
+        Quadtree *tree;
+        int root;
+        std::vector<QuadtreeNode> subtree;
+};
+
 Quadtree::Quadtree() :
     instances(),
     instancePositions(),
-    nodes()
+    nodes(),
+    traversalQueue(),
+    buildX(), buildY(), buildZ(),
+    scratchX(), scratchY(), scratchZ(),
+    scratchInstances(),
+    buildLeaves()
 {
 
 }
@@ -61,10 +93,8 @@ void Quadtree::splitNode(QuadtreeNode &node, std::vector<int> &idx, const std::v
     }
     
     //Clear children for this node.
-    for (int i = 0; i < 4; ++i)
-    {
-        node.children[i] = 0;
-    }
+    node.firstChild = 0;
+    node.nrChildren = 0;
     
     //Do we want to subdivide this node further?
     if (node.endIndex - node.startIndex <= 16)
@@ -116,27 +146,256 @@ void Quadtree::splitNode(QuadtreeNode &node, std::vector<int> &idx, const std::v
     //Create leaves for all non-empty nodes.
     int offset = node.startIndex;
     
+    node.firstChild = nodes.size();
+    
     for (int i = 0; i < 4; ++i)
     {
         if (counts[i] > 0)
         {
-            node.children[i] = nodes.size();
             nodes.push_back(QuadtreeNode(offset, offset + counts[i]));
             offset += counts[i];
+            node.nrChildren++;
         }
-        else
+    }
+    
+    //Recurse on all child nodes.
+    for (int i = node.firstChild; i < node.firstChild + node.nrChildren; ++i)
+    {
+        splitNode(nodes[i], idx, pos);
+    }
+}
+
+
+void Quadtree::buildParallel(os::ThreadPool &pool)
+{
+    const int nrInstances = buildX.size();
+    
+    instances.resize(nrInstances);
+    
+    for (int i = 0; i < nrInstances; ++i)
+    {
+        instances[i] = i;
+    }
+    
+    scratchX.resize(nrInstances);
+    scratchY.resize(nrInstances);
+    scratchZ.resize(nrInstances);
+    scratchInstances.resize(nrInstances);
+    buildLeaves.resize(nrInstances);
+    
+    nodes.reserve(nrInstances/4 + 1);
+    nodes.push_back(QuadtreeNode(0, nrInstances));
+    
+    //Split the top levels breadth-first until there are enough independent subtrees to keep all threads busy.
+    const size_t minNrSubtrees = (pool.getNrThreads() > 1 ? 4*pool.getNrThreads() : 1);
+    std::vector<int> frontier(1, 0);
+    
+    while (!frontier.empty() && frontier.size() < minNrSubtrees)
+    {
+        std::vector<int> nextFrontier;
+        
+        for (std::vector<int>::const_iterator i = frontier.begin(); i != frontier.end(); ++i)
         {
-            node.children[i] = 0;
+            splitNodeSoA(*i, nodes);
+            
+            for (int j = nodes[*i].firstChild; j < nodes[*i].firstChild + nodes[*i].nrChildren; ++j)
+            {
+                nextFrontier.push_back(j);
+            }
         }
+        
+        frontier.swap(nextFrontier);
     }
     
-    //Recurse on all child nodes.
+    //Build all remaining subtrees in parallel.
+    std::vector<BuildJob> jobs;
+    std::vector<os::ThreadJob *> jobPointers;
+    
+    jobs.reserve(frontier.size());
+    
+    for (std::vector<int>::const_iterator i = frontier.begin(); i != frontier.end(); ++i)
+    {
+        jobs.push_back(BuildJob(this, *i));
+    }
+    
+    for (std::vector<BuildJob>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+        jobPointers.push_back(&*i);
+    }
+    
+    pool.run(jobPointers);
+    
+    //Append the subtrees to the node list, with the subtree roots replacing the frontier nodes.
+    for (std::vector<BuildJob>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+        const int offset = static_cast<int>(nodes.size()) - 1;
+        
+        for (std::vector<QuadtreeNode>::const_iterator j = i->subtree.begin(); j != i->subtree.end(); ++j)
+        {
+            QuadtreeNode n = *j;
+            
+            if (n.nrChildren > 0)
+            {
+                n.firstChild += offset;
+            }
+            
+            if (j == i->subtree.begin())
+            {
+                nodes[i->root] = n;
+            }
+            else
+            {
+                nodes.push_back(n);
+            }
+        }
+    }
+    
+    //Copy instance positions, which have been sorted along with the instances.
+    instancePositions.resize(nrInstances);
+    
+    for (int i = 0; i < nrInstances; ++i)
+    {
+        instancePositions[i] = vec3(buildX[i], buildY[i], buildZ[i]);
+    }
+    
+    //Every node enters the traversal queue at most once per query.
+    traversalQueue.reserve(nodes.size());
+    
+    //Release temporary storage.
+    std::vector<float>().swap(buildX);
+    std::vector<float>().swap(buildY);
+    std::vector<float>().swap(buildZ);
+    std::vector<float>().swap(scratchX);
+    std::vector<float>().swap(scratchY);
+    std::vector<float>().swap(scratchZ);
+    std::vector<int>().swap(scratchInstances);
+    std::vector<unsigned char>().swap(buildLeaves);
+}
+
+void Quadtree::buildSubtreeSoA(const int &index, std::vector<QuadtreeNode> &nodeList)
+{
+    splitNodeSoA(index, nodeList);
+    
+    const int firstChild = nodeList[index].firstChild;
+    const int nrChildren = nodeList[index].nrChildren;
+    
+    for (int i = firstChild; i < firstChild + nrChildren; ++i)
+    {
+        buildSubtreeSoA(i, nodeList);
+    }
+}
+
+void Quadtree::splitNodeSoA(const int &index, std::vector<QuadtreeNode> &nodeList)
+{
+    //Work on a copy, since adding children may reallocate the node list.
+    QuadtreeNode node = nodeList[index];
+    const int start = node.startIndex;
+    const int end = node.endIndex;
+    
+    node.firstChild = 0;
+    node.nrChildren = 0;
+    
+    //Discard empty nodes.
+    if (start >= end)
+    {
+        nodeList[index] = node;
+        return;
+    }
+    
+    //Positions of this node's instances are stored contiguously, since we sort them along with the instances.
+    float * const x = &buildX[0];
+    float * const y = &buildY[0];
+    float * const z = &buildZ[0];
+    int * const idx = &instances[0];
+    unsigned char * const leaves = &buildLeaves[0];
+    
+    //Determine the bounding box of this node.
+    float minX = x[start], minY = y[start], minZ = z[start];
+    float maxX = x[start], maxY = y[start], maxZ = z[start];
+    
+    for (int i = start + 1; i < end; ++i)
+    {
+        minX = std::min(minX, x[i]);
+        minY = std::min(minY, y[i]);
+        minZ = std::min(minZ, z[i]);
+        maxX = std::max(maxX, x[i]);
+        maxY = std::max(maxY, y[i]);
+        maxZ = std::max(maxZ, z[i]);
+    }
+    
+    //Determine the node's centre and radius, using the maximum squared distance to avoid a square root per instance.
+    const float cx = 0.5f*(minX + maxX), cy = 0.5f*(minY + maxY), cz = 0.5f*(minZ + maxZ);
+    float radius2 = 0.0f;
+    
+    for (int i = start; i < end; ++i)
+    {
+        const float dx = x[i] - cx, dy = y[i] - cy, dz = z[i] - cz;
+        
+        radius2 = std::max(radius2, dx*dx + dy*dy + dz*dz);
+    }
+    
+    node.centre = vec3(cx, cy, cz);
+    node.radius = sqrtf(radius2);
+    
+    //Do we want to subdivide this node further? We cannot split nodes whose instances all share the same horizontal position.
+    if (end - start <= 16 || (minX == maxX && minZ == maxZ))
+    {
+        nodeList[index] = node;
+        return;
+    }
+    
+    //Yes, classify all objects and count the number of objects in each leaf.
+    int counts[4] = {0, 0, 0, 0};
+    const float invScaleX = 1.0f/(maxX - minX);
+    const float invScaleZ = 1.0f/(maxZ - minZ);
+    
+    for (int i = start; i < end; ++i)
+    {
+        const unsigned char leaf = ((x[i] - minX)*invScaleX < 0.5f ? 0 : 1) | ((z[i] - minZ)*invScaleZ < 0.5f ? 0 : 2);
+        
+        leaves[i] = leaf;
+        counts[leaf]++;
+    }
+    
+    assert(start + counts[0] + counts[1] + counts[2] + counts[3] == end);
+    
+    //Perform a stable counting sort of both instances and positions.
+    int offsets[4] = {
+        start,
+        start + counts[0],
+        start + counts[0] + counts[1],
+        start + counts[0] + counts[1] + counts[2]};
+    
+    for (int i = start; i < end; ++i)
+    {
+        const int j = offsets[leaves[i]]++;
+        
+        scratchX[j] = x[i];
+        scratchY[j] = y[i];
+        scratchZ[j] = z[i];
+        scratchInstances[j] = idx[i];
+    }
+    
+    std::copy(scratchX.begin() + start, scratchX.begin() + end, buildX.begin() + start);
+    std::copy(scratchY.begin() + start, scratchY.begin() + end, buildY.begin() + start);
+    std::copy(scratchZ.begin() + start, scratchZ.begin() + end, buildZ.begin() + start);
+    std::copy(scratchInstances.begin() + start, scratchInstances.begin() + end, instances.begin() + start);
+    
+    //Create leaves for all non-empty nodes.
+    int offset = start;
+    
+    node.firstChild = nodeList.size();
+    
     for (int i = 0; i < 4; ++i)
     {
-        if (node.children[i] > 0)
+        if (counts[i] > 0)
         {
-            splitNode(nodes[node.children[i]], idx, pos);
+            nodeList.push_back(QuadtreeNode(offset, offset + counts[i]));
+            offset += counts[i];
+            node.nrChildren++;
         }
     }
+    
+    nodeList[index] = node;
 }
 
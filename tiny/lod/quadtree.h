@@ -20,11 +20,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <exception>
 #include <string>
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <utility>
 
 #include <cassert>
 
 #include <tiny/math/vec.h>
+#include <tiny/math/frustum.h>
+#include <tiny/os/threadpool.h>
 
 namespace tiny
 {
@@ -32,36 +35,59 @@ namespace tiny
 namespace lod
 {
 
+/** A quadtree node. The children of a node are stored consecutively in the node list, starting at firstChild. */
 struct QuadtreeNode
 {
     QuadtreeNode() :
+        centre(0.0f, 0.0f, 0.0f),
+        radius(0.0f),
         startIndex(0),
         endIndex(0),
-        radius(0.0f),
-        centre(0.0f, 0.0f, 0.0f)
+        firstChild(0),
+        nrChildren(0)
     {
-        for (int i = 0; i < 4; ++i)
-        {
-            children[i] = 0;
-        }
+
     }
     
     QuadtreeNode(const int &a_startIndex, const int &a_endIndex) :
+        centre(0.0f, 0.0f, 0.0f),
+        radius(0.0f),
         startIndex(a_startIndex),
         endIndex(a_endIndex),
-        radius(0.0f),
-        centre(0.0f, 0.0f, 0.0f)
+        firstChild(0),
+        nrChildren(0)
     {
-        for (int i = 0; i < 4; ++i)
-        {
-            children[i] = 0;
-        }
+
     }
     
-    int children[4];
-    int startIndex, endIndex;
-    float radius;
     vec3 centre;
+    float radius;
+    int startIndex, endIndex;
+    int firstChild, nrChildren;
+};
+
+/** An entry of the priority queue used to traverse a quadtree from near to far. */
+struct QuadtreeQueueEntry
+{
+    QuadtreeQueueEntry(const float &a_distance, const int &a_order, const int &a_node, const int &a_annuli) :
+        distance(a_distance),
+        order(a_order),
+        node(a_node),
+        annuli(a_annuli)
+    {
+
+    }
+    
+    /** Reversed ordering such that std::push_heap/std::pop_heap yield the nearest node first, with ties resolved in order of insertion. */
+    bool operator < (const QuadtreeQueueEntry &a) const
+    {
+        return (distance == a.distance ? order > a.order : distance > a.distance);
+    }
+    
+    float distance;
+    int order;
+    int node;
+    int annuli;
 };
 
 class Quadtree
@@ -126,98 +152,247 @@ class Quadtree
                 instancePositions[i] = temporaryPositions[instances[i]];
             }
 
+            //Every node enters the traversal queue at most once per query.
+            traversalQueue.reserve(nodes.size());
+            
+            std::cerr << "Built quadtree with " << nodes.size() << " nodes." << std::endl;
+        }
+        
+        /** Build the quadtree in parallel using the supplied thread pool, giving the same instance order and node bounds as buildQuadtree().
+          * Positions are kept as a structure of arrays during the build, such that the bounding box, radius and classification loops can be vectorised.
+          * The top levels of the tree are split on the calling thread, after which the remaining subtrees are built as independent jobs. */
+        template <typename Iterator>
+        void buildQuadtreeParallel(Iterator first, Iterator last, os::ThreadPool &pool)
+        {
+            instances.clear();
+            instancePositions.clear();
+            nodes.clear();
+            
+            buildX.clear();
+            buildY.clear();
+            buildZ.clear();
+            
+            for (Iterator i = first; i != last; ++i)
+            {
+                const vec3 p = *i;
+                
+                buildX.push_back(p.x);
+                buildY.push_back(p.y);
+                buildZ.push_back(p.z);
+            }
+            
+            if (buildX.empty())
+            {
+                std::cerr << "Warning: Empty quadtree!" << std::endl;
+                return;
+            }
+            
+            std::cerr << "Constructing quadtree of " << buildX.size() << " objects using " << pool.getNrThreads() << " threads..." << std::endl;
+            
+            buildParallel(pool);
+            
             std::cerr << "Built quadtree with " << nodes.size() << " nodes." << std::endl;
         }
         
+        /** Retrieve the indices of at most maxNrIndices objects whose distance to position lies in [minRadius, maxRadius), from near to far.
+          * The traversal uses a priority queue that is preallocated when the quadtree is built, such that queries do not allocate memory.
+          * Consequently, a single quadtree should not be queried from multiple threads simultaneously. */
         template <typename Iterator>
         Iterator retrieveIndicesBetweenRadii(const vec3 &position, const float &minRadius, const float &maxRadius, Iterator indices, int maxNrIndices) const
         {
-            if (instances.empty())
+            if (maxNrIndices <= 0)
             {
-                std::cerr << "Warning: Unable to determine indices within an empty quadtree!" << std::endl;
+                std::cerr << "Warning: Filling empty instance list!" << std::endl;
                 return indices;
             }
             
+            //Use an empty outer annulus.
+            return retrieveIndicesBetweenRadii(position, minRadius, maxRadius, maxRadius, indices, maxNrIndices, indices, 0).first;
+        }
+        
+        /** Retrieve indices for two adjacent annuli [minRadius, midRadius) and [midRadius, maxRadius) in a single traversal.
+          * The results are identical to calling retrieveIndicesBetweenRadii() once for each annulus. */
+        template <typename Iterator1, typename Iterator2>
+        std::pair<Iterator1, Iterator2> retrieveIndicesBetweenRadii(const vec3 &position, const float &minRadius, const float &midRadius, const float &maxRadius,
+                                                                    Iterator1 innerIndices, int maxNrInnerIndices,
+                                                                    Iterator2 outerIndices, int maxNrOuterIndices) const
+        {
+            return retrieveIndices(position, minRadius, midRadius, maxRadius, 0, 0.0f, innerIndices, maxNrInnerIndices, outerIndices, maxNrOuterIndices);
+        }
+        
+        /** Same as retrieveIndicesBetweenRadii(), but only retrieve objects that lie within the view frustum of the supplied world-to-screen matrix.
+          * Objects are treated as spheres of radius objectRadius, such that objects that stick into the frustum are still retrieved. */
+        template <typename Iterator>
+        Iterator retrieveVisibleIndicesBetweenRadii(const vec3 &position, const float &minRadius, const float &maxRadius, const mat4 &worldToScreen, const float &objectRadius,
+                                                    Iterator indices, int maxNrIndices) const
+        {
             if (maxNrIndices <= 0)
             {
                 std::cerr << "Warning: Filling empty instance list!" << std::endl;
                 return indices;
             }
             
+            const Frustum frustum(worldToScreen);
+            
+            return retrieveIndices(position, minRadius, maxRadius, maxRadius, &frustum, objectRadius, indices, maxNrIndices, indices, 0).first;
+        }
+        
+        /** Frustum-culled version of the two-annulus query. */
+        template <typename Iterator1, typename Iterator2>
+        std::pair<Iterator1, Iterator2> retrieveVisibleIndicesBetweenRadii(const vec3 &position, const float &minRadius, const float &midRadius, const float &maxRadius,
+                                                                           const mat4 &worldToScreen, const float &objectRadius,
+                                                                           Iterator1 innerIndices, int maxNrInnerIndices,
+                                                                           Iterator2 outerIndices, int maxNrOuterIndices) const
+        {
+            const Frustum frustum(worldToScreen);
+            
+            return retrieveIndices(position, minRadius, midRadius, maxRadius, &frustum, objectRadius, innerIndices, maxNrInnerIndices, outerIndices, maxNrOuterIndices);
+        }
+        
+    private:
+        class BuildJob;
+        
+        /** Traverse the quadtree for two adjacent annuli, optionally culling against a frustum if it is not null. */
+        template <typename Iterator1, typename Iterator2>
+        std::pair<Iterator1, Iterator2> retrieveIndices(const vec3 &position, const float &minRadius, const float &midRadius, const float &maxRadius,
+                                                        const Frustum *frustum, const float &objectRadius,
+                                                        Iterator1 innerIndices, int maxNrInnerIndices,
+                                                        Iterator2 outerIndices, int maxNrOuterIndices) const
+        {
+            if (instances.empty())
+            {
+                std::cerr << "Warning: Unable to determine indices within an empty quadtree!" << std::endl;
+                return std::make_pair(innerIndices, outerIndices);
+            }
+            
+            if (maxNrInnerIndices <= 0 && maxNrOuterIndices <= 0)
+            {
+                std::cerr << "Warning: Filling empty instance list!" << std::endl;
+                return std::make_pair(innerIndices, outerIndices);
+            }
+            
             //Recursively traverse the quadtree to find the indices of all objects such that their distance lies between the radii.
-            //Traverse quadtree from near the supplied position to the outside.
-            std::multimap<float, int> remaining;
+            //Traverse quadtree from near the supplied position to the outside, keeping track of the annuli for which each node should be examined.
+            //Bit 4 of the annuli marks nodes that lie entirely inside the frustum, such that their descendants need no further frustum tests.
+            int order = 0;
             
-            remaining.insert(std::pair<float, int>(length(nodes[0].centre - position), 0));
+            traversalQueue.clear();
+            traversalQueue.push_back(QuadtreeQueueEntry(length(nodes[0].centre - position), order++, 0, (maxNrInnerIndices > 0 ? 1 : 0) | (maxNrOuterIndices > 0 ? 2 : 0) | (frustum ? 0 : 4)));
             
-            while (!remaining.empty() && maxNrIndices > 0)
+            while (!traversalQueue.empty() && (maxNrInnerIndices > 0 || maxNrOuterIndices > 0))
             {
-                const float distance = remaining.begin()->first;
-                const QuadtreeNode n = nodes[remaining.begin()->second];
+                std::pop_heap(traversalQueue.begin(), traversalQueue.end());
                 
-                remaining.erase(remaining.begin());
+                const QuadtreeQueueEntry entry = traversalQueue.back();
+                const QuadtreeNode &n = nodes[entry.node];
+                int childAnnuli = entry.annuli & 4;
                 
-                const bool hasChildren = (n.children[0] != 0 || n.children[1] != 0 || n.children[2] != 0 || n.children[3] != 0);
+                traversalQueue.pop_back();
                 
-                if (distance + n.radius < minRadius || distance - n.radius >= maxRadius)
-                {
-                    //The node is completely outside the annulus.
-                    continue;
-                }
-                else if (distance - n.radius >= minRadius && distance + n.radius < maxRadius)
+                if (childAnnuli == 0)
                 {
-                    //The node is contained entirely within the annulus.
-                    for (int i = n.startIndex; i < n.endIndex && maxNrIndices > 0; ++i)
+                    const int visibility = frustum->classifySphere(n.centre, n.radius + objectRadius);
+                    
+                    if (visibility < 0)
                     {
-                        *indices++ = instances[i];
-                        --maxNrIndices;
+                        //The node is completely outside the frustum.
+                        continue;
+                    }
+                    else if (visibility > 0)
+                    {
+                        childAnnuli = 4;
                     }
                 }
-                else if (hasChildren)
+                
+                const Frustum *nodeFrustum = (childAnnuli == 0 ? frustum : 0);
+                
+                if ((entry.annuli & 1) != 0 && maxNrInnerIndices > 0 &&
+                    collectIndices(n, entry.distance, position, minRadius, midRadius, nodeFrustum, objectRadius, innerIndices, maxNrInnerIndices))
+                {
+                    childAnnuli |= 1;
+                }
+                
+                if ((entry.annuli & 2) != 0 && maxNrOuterIndices > 0 &&
+                    collectIndices(n, entry.distance, position, midRadius, maxRadius, nodeFrustum, objectRadius, outerIndices, maxNrOuterIndices))
+                {
+                    childAnnuli |= 2;
+                }
+                
+                if ((childAnnuli & 3) != 0)
                 {
                     //Partially contained node with children, so we recurse.
-                    for (int i = 0; i < 4; ++i)
+                    for (int i = n.firstChild; i < n.firstChild + n.nrChildren; ++i)
                     {
-                        if (n.children[i] != 0)
-                        {
-                            remaining.insert(std::pair<float, int>(length(nodes[n.children[i]].centre - position), n.children[i]));
-                        }
+                        traversalQueue.push_back(QuadtreeQueueEntry(length(nodes[i].centre - position), order++, i, childAnnuli));
+                        std::push_heap(traversalQueue.begin(), traversalQueue.end());
                     }
                 }
-                else
+            }
+            
+            return std::make_pair(innerIndices, outerIndices);
+        }
+        
+        /** Write the indices of a node's objects lying in [minRadius, maxRadius) and return true if the node's children should be examined instead.
+          * If a frustum is supplied, the node intersects its boundary and only objects inside the frustum are retrieved. */
+        template <typename Iterator>
+        bool collectIndices(const QuadtreeNode &n, const float &distance, const vec3 &position, const float &minRadius, const float &maxRadius,
+                            const Frustum *frustum, const float &objectRadius, Iterator &indices, int &maxNrIndices) const
+        {
+            if (distance + n.radius < minRadius || distance - n.radius >= maxRadius)
+            {
+                //The node is completely outside the annulus.
+                return false;
+            }
+            
+            const bool insideAnnulus = (distance - n.radius >= minRadius && distance + n.radius < maxRadius);
+            
+            if (insideAnnulus && !frustum)
+            {
+                //The node is contained entirely within the annulus.
+                for (int i = n.startIndex; i < n.endIndex && maxNrIndices > 0; ++i)
                 {
-                    //Indivisible partially contained node.
-                    for (int i = n.startIndex; i < n.endIndex && maxNrIndices > 0; ++i)
-                    {
-                        const float instanceDistance = length(instancePositions[i] - position);
-                        
-                        if (instanceDistance >= minRadius && instanceDistance < maxRadius)
-                        {
-                            *indices++ = instances[i];
-                            --maxNrIndices;
-                        }
-                    }
+                    *indices++ = instances[i];
+                    --maxNrIndices;
                 }
             }
-
-/*
-#ifndef NDEBUG
-            if (maxNrIndices <= 0)
+            else if (n.nrChildren > 0)
             {
-                std::cerr << "Maximum number of indices exceeded during quadtree traversal!" << std::endl;
+                return true;
+            }
+            else
+            {
+                //Indivisible partially contained node.
+                for (int i = n.startIndex; i < n.endIndex && maxNrIndices > 0; ++i)
+                {
+                    const float instanceDistance = length(instancePositions[i] - position);
+                    
+                    if ((insideAnnulus || (instanceDistance >= minRadius && instanceDistance < maxRadius)) &&
+                        (!frustum || frustum->intersectsSphere(instancePositions[i], objectRadius)))
+                    {
+                        *indices++ = instances[i];
+                        --maxNrIndices;
+                    }
+                }
             }
-#endif
-*/
             
-            return indices;
+            return false;
         }
         
-    private:
         void splitNode(QuadtreeNode &, std::vector<int> &, const std::vector<vec3> &);
+        void buildParallel(os::ThreadPool &);
+        void splitNodeSoA(const int &, std::vector<QuadtreeNode> &);
+        void buildSubtreeSoA(const int &, std::vector<QuadtreeNode> &);
         
         std::vector<int> instances;
         std::vector<vec3> instancePositions;
         std::vector<QuadtreeNode> nodes;
+        mutable std::vector<QuadtreeQueueEntry> traversalQueue;
+        
+        //Structure of arrays storage used during buildQuadtreeParallel().
+        std::vector<float> buildX, buildY, buildZ;
+        std::vector<float> scratchX, scratchY, scratchZ;
+        std::vector<int> scratchInstances;
+        std::vector<unsigned char> buildLeaves;
 };
 
 }
@@ -0,0 +1,93 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <tiny/math/vec.h>
+
+namespace tiny
+{
+
+/** The six planes bounding the visible volume of a camera, extracted from its world-to-screen (view-projection) matrix.
+  * Each plane is stored as (n, d) with |n| = 1, such that points p with dot(n, p) + d >= 0 lie on the visible side. */
+class Frustum
+{
+    public:
+        inline Frustum() {};
+
+        inline Frustum(const mat4 &m)
+        {
+            //Gribb-Hartmann plane extraction: combine the last row of the matrix with each of the other rows.
+            planes[0] = vec4(m.v30 + m.v00, m.v31 + m.v01, m.v32 + m.v02, m.v33 + m.v03);
+            planes[1] = vec4(m.v30 - m.v00, m.v31 - m.v01, m.v32 - m.v02, m.v33 - m.v03);
+            planes[2] = vec4(m.v30 + m.v10, m.v31 + m.v11, m.v32 + m.v12, m.v33 + m.v13);
+            planes[3] = vec4(m.v30 - m.v10, m.v31 - m.v11, m.v32 - m.v12, m.v33 - m.v13);
+            planes[4] = vec4(m.v30 + m.v20, m.v31 + m.v21, m.v32 + m.v22, m.v33 + m.v23);
+            planes[5] = vec4(m.v30 - m.v20, m.v31 - m.v21, m.v32 - m.v22, m.v33 - m.v23);
+
+            for (int i = 0; i < 6; ++i)
+            {
+                const float l = sqrtf(planes[i].x*planes[i].x + planes[i].y*planes[i].y + planes[i].z*planes[i].z);
+
+                if (l > 0.0f)
+                {
+                    planes[i] = vec4(planes[i].x/l, planes[i].y/l, planes[i].z/l, planes[i].w/l);
+                }
+            }
+        };
+
+        /** Returns -1 if the sphere lies entirely outside the frustum, 1 if it lies entirely inside, and 0 if it intersects the boundary. */
+        inline int classifySphere(const vec3 &c, const float &r) const
+        {
+            int result = 1;
+
+            for (int i = 0; i < 6; ++i)
+            {
+                const float d = planes[i].x*c.x + planes[i].y*c.y + planes[i].z*c.z + planes[i].w;
+
+                if (d < -r) return -1;
+                else if (d < r) result = 0;
+            }
+
+            return result;
+        };
+
+        inline bool intersectsSphere(const vec3 &c, const float &r) const
+        {
+            return classifySphere(c, r) >= 0;
+        };
+
+        /** Returns false if the axis-aligned box [a, b] lies entirely outside the frustum. */
+        inline bool intersectsBox(const vec3 &a, const vec3 &b) const
+        {
+            for (int i = 0; i < 6; ++i)
+            {
+                //Test the corner of the box that lies furthest along the plane normal.
+                const float d = planes[i].x*(planes[i].x >= 0.0f ? b.x : a.x) +
+                                planes[i].y*(planes[i].y >= 0.0f ? b.y : a.y) +
+                                planes[i].z*(planes[i].z >= 0.0f ? b.z : a.z) + planes[i].w;
+
+                if (d < 0.0f) return false;
+            }
+
+            return true;
+        };
+
+        vec4 planes[6];
+};
+
+}
+
@@ -41,6 +41,123 @@ vec4 tiny::quatrot(const float &alpha, const vec3 &a)
     return vec4(s*a.x, s*a.y, s*a.z, cos(0.5*alpha));
 }
 
+void tiny::transformPoints(const mat4 &m, const vec3 *in, vec3 *out, const size_t &n)
+{
+#ifdef TINY_SIMD_SSE
+    const __m128 c0 = _mm_loadu_ps(&m.v00);
+    const __m128 c1 = _mm_loadu_ps(&m.v01);
+    const __m128 c2 = _mm_loadu_ps(&m.v02);
+    const __m128 c3 = _mm_loadu_ps(&m.v03);
+    float r[4];
+    
+    for (size_t i = 0; i < n; ++i)
+    {
+        _mm_storeu_ps(r, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].x)),
+                                                          _mm_mul_ps(c1, _mm_set1_ps(in[i].y))),
+                                               _mm_mul_ps(c2, _mm_set1_ps(in[i].z))),
+                                    c3));
+        out[i] = vec3(r[0], r[1], r[2]);
+    }
+#else
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = m*in[i];
+    }
+#endif
+}
+
+void tiny::normalizeQuaternions(vec4 *q, const size_t &n)
+{
+    size_t i = 0;
+    
+#ifdef TINY_SIMD_SSE
+    //Process four quaternions at a time as a structure of arrays.
+    //The reciprocal length is computed in double precision, as is done by normalize().
+    for ( ; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&q[i + 0].x);
+        __m128 y = _mm_loadu_ps(&q[i + 1].x);
+        __m128 z = _mm_loadu_ps(&q[i + 2].x);
+        __m128 w = _mm_loadu_ps(&q[i + 3].x);
+        
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        
+        const __m128 l = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d epsilon = _mm_set1_pd(1.0e-8);
+        const __m128d l0 = _mm_cvtps_pd(l);
+        const __m128d l1 = _mm_cvtps_pd(_mm_movehl_ps(l, l));
+        const __m128d m0 = _mm_cmpgt_pd(l0, epsilon);
+        const __m128d m1 = _mm_cmpgt_pd(l1, epsilon);
+        const __m128d s0 = _mm_or_pd(_mm_and_pd(m0, _mm_div_pd(one, _mm_sqrt_pd(l0))), _mm_andnot_pd(m0, one));
+        const __m128d s1 = _mm_or_pd(_mm_and_pd(m1, _mm_div_pd(one, _mm_sqrt_pd(l1))), _mm_andnot_pd(m1, one));
+        const __m128 s = _mm_movelh_ps(_mm_cvtpd_ps(s0), _mm_cvtpd_ps(s1));
+        
+        x = _mm_mul_ps(x, s);
+        y = _mm_mul_ps(y, s);
+        z = _mm_mul_ps(z, s);
+        w = _mm_mul_ps(w, s);
+        
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        
+        _mm_storeu_ps(&q[i + 0].x, x);
+        _mm_storeu_ps(&q[i + 1].x, y);
+        _mm_storeu_ps(&q[i + 2].x, z);
+        _mm_storeu_ps(&q[i + 3].x, w);
+    }
+#endif
+    
+    for ( ; i < n; ++i)
+    {
+        q[i] = normalize(q[i]);
+    }
+}
+
+void tiny::dotProducts(const vec3 *a, const vec3 *b, float *out, const size_t &n)
+{
+    size_t i = 0;
+    
+#ifdef TINY_SIMD_SSE
+    for ( ; i + 4 <= n; i += 4)
+    {
+        const __m128 p = _mm_mul_ps(_mm_set_ps(a[i + 3].x, a[i + 2].x, a[i + 1].x, a[i].x), _mm_set_ps(b[i + 3].x, b[i + 2].x, b[i + 1].x, b[i].x));
+        const __m128 q = _mm_mul_ps(_mm_set_ps(a[i + 3].y, a[i + 2].y, a[i + 1].y, a[i].y), _mm_set_ps(b[i + 3].y, b[i + 2].y, b[i + 1].y, b[i].y));
+        const __m128 r = _mm_mul_ps(_mm_set_ps(a[i + 3].z, a[i + 2].z, a[i + 1].z, a[i].z), _mm_set_ps(b[i + 3].z, b[i + 2].z, b[i + 1].z, b[i].z));
+        
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(p, q), r));
+    }
+#endif
+    
+    for ( ; i < n; ++i)
+    {
+        out[i] = dot(a[i], b[i]);
+    }
+}
+
+void tiny::dotProducts(const vec4 *a, const vec4 *b, float *out, const size_t &n)
+{
+    size_t i = 0;
+    
+#ifdef TINY_SIMD_SSE
+    for ( ; i + 4 <= n; i += 4)
+    {
+        __m128 p0 = _mm_mul_ps(_mm_loadu_ps(&a[i + 0].x), _mm_loadu_ps(&b[i + 0].x));
+        __m128 p1 = _mm_mul_ps(_mm_loadu_ps(&a[i + 1].x), _mm_loadu_ps(&b[i + 1].x));
+        __m128 p2 = _mm_mul_ps(_mm_loadu_ps(&a[i + 2].x), _mm_loadu_ps(&b[i + 2].x));
+        __m128 p3 = _mm_mul_ps(_mm_loadu_ps(&a[i + 3].x), _mm_loadu_ps(&b[i + 3].x));
+        
+        //After transposing, p0 contains the x-products of all four pairs, p1 the y-products, and so on.
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(p0, p1), p2), p3));
+    }
+#endif
+    
+    for ( ; i < n; ++i)
+    {
+        out[i] = dot(a[i], b[i]);
+    }
+}
+
 vec2 tiny::randomVec2(const float &s)
 {
     return vec2(2.0f*s*static_cast<float>(rand())/static_cast<float>(RAND_MAX) - s,
@@ -17,8 +17,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <iostream>
+#include <cstddef>
 #include <cmath>
 
+//Use SSE intrinsics for single precision vector and matrix operations if they are available, unless TINY_NO_SIMD is defined.
+//The SIMD code performs exactly the same floating point operations in the same order as the scalar code, such that results are identical.
+#if !defined(TINY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TINY_SIMD_SSE
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
 namespace tiny
 {
 
@@ -103,32 +112,32 @@ template <typename t> class typed4vector
         t x, y, z, w;
 };
 
-template <typename t> typed2vector<t> & operator + (typed2vector<t> a, const typed2vector<t> &b) {return a += b;}
-template <typename t> typed2vector<t> & operator - (typed2vector<t> a, const typed2vector<t> &b) {return a -= b;}
-template <typename t> typed2vector<t> & operator * (typed2vector<t> a, const typed2vector<t> &b) {return a *= b;}
-template <typename t> typed2vector<t> & operator / (typed2vector<t> a, const typed2vector<t> &b) {return a /= b;}
-template <typename t> typed2vector<t> & operator * (typed2vector<t> a, const t &b) {return a *= b;}
-template <typename t> typed2vector<t> & operator * (const t &b, typed2vector<t> a) {return a *= b;}
-template <typename t> typed2vector<t> & operator / (typed2vector<t> a, const t &b) {return a /= b;}
-template <typename t> typed2vector<t> & operator / (const t &b, typed2vector<t> a) {return a /= b;}
-
-template <typename t> typed3vector<t> & operator + (typed3vector<t> a, const typed3vector<t> &b) {return a += b;}
-template <typename t> typed3vector<t> & operator - (typed3vector<t> a, const typed3vector<t> &b) {return a -= b;}
-template <typename t> typed3vector<t> & operator * (typed3vector<t> a, const typed3vector<t> &b) {return a *= b;}
-template <typename t> typed3vector<t> & operator / (typed3vector<t> a, const typed3vector<t> &b) {return a /= b;}
-template <typename t> typed3vector<t> & operator * (typed3vector<t> a, const t &b) {return a *= b;}
-template <typename t> typed3vector<t> & operator * (const t &b, typed3vector<t> a) {return a *= b;}
-template <typename t> typed3vector<t> & operator / (typed3vector<t> a, const t &b) {return a /= b;}
-template <typename t> typed3vector<t> & operator / (const t &b, typed3vector<t> a) {return a /= b;}
-
-template <typename t> typed4vector<t> & operator + (typed4vector<t> a, const typed4vector<t> &b) {return a += b;}
-template <typename t> typed4vector<t> & operator - (typed4vector<t> a, const typed4vector<t> &b) {return a -= b;}
-template <typename t> typed4vector<t> & operator * (typed4vector<t> a, const typed4vector<t> &b) {return a *= b;}
-template <typename t> typed4vector<t> & operator / (typed4vector<t> a, const typed4vector<t> &b) {return a /= b;}
-template <typename t> typed4vector<t> & operator * (typed4vector<t> a, const t &b) {return a *= b;}
-template <typename t> typed4vector<t> & operator * (const t &b, typed4vector<t> a) {return a *= b;}
-template <typename t> typed4vector<t> & operator / (typed4vector<t> a, const t &b) {return a /= b;}
-template <typename t> typed4vector<t> & operator / (const t &b, typed4vector<t> a) {return a /= b;}
+template <typename t> typed2vector<t> operator + (typed2vector<t> a, const typed2vector<t> &b) {return a += b;}
+template <typename t> typed2vector<t> operator - (typed2vector<t> a, const typed2vector<t> &b) {return a -= b;}
+template <typename t> typed2vector<t> operator * (typed2vector<t> a, const typed2vector<t> &b) {return a *= b;}
+template <typename t> typed2vector<t> operator / (typed2vector<t> a, const typed2vector<t> &b) {return a /= b;}
+template <typename t> typed2vector<t> operator * (typed2vector<t> a, const t &b) {return a *= b;}
+template <typename t> typed2vector<t> operator * (const t &b, typed2vector<t> a) {return a *= b;}
+template <typename t> typed2vector<t> operator / (typed2vector<t> a, const t &b) {return a /= b;}
+template <typename t> typed2vector<t> operator / (const t &b, typed2vector<t> a) {return a /= b;}
+
+template <typename t> typed3vector<t> operator + (typed3vector<t> a, const typed3vector<t> &b) {return a += b;}
+template <typename t> typed3vector<t> operator - (typed3vector<t> a, const typed3vector<t> &b) {return a -= b;}
+template <typename t> typed3vector<t> operator * (typed3vector<t> a, const typed3vector<t> &b) {return a *= b;}
+template <typename t> typed3vector<t> operator / (typed3vector<t> a, const typed3vector<t> &b) {return a /= b;}
+template <typename t> typed3vector<t> operator * (typed3vector<t> a, const t &b) {return a *= b;}
+template <typename t> typed3vector<t> operator * (const t &b, typed3vector<t> a) {return a *= b;}
+template <typename t> typed3vector<t> operator / (typed3vector<t> a, const t &b) {return a /= b;}
+template <typename t> typed3vector<t> operator / (const t &b, typed3vector<t> a) {return a /= b;}
+
+template <typename t> typed4vector<t> operator + (typed4vector<t> a, const typed4vector<t> &b) {return a += b;}
+template <typename t> typed4vector<t> operator - (typed4vector<t> a, const typed4vector<t> &b) {return a -= b;}
+template <typename t> typed4vector<t> operator * (typed4vector<t> a, const typed4vector<t> &b) {return a *= b;}
+template <typename t> typed4vector<t> operator / (typed4vector<t> a, const typed4vector<t> &b) {return a /= b;}
+template <typename t> typed4vector<t> operator * (typed4vector<t> a, const t &b) {return a *= b;}
+template <typename t> typed4vector<t> operator * (const t &b, typed4vector<t> a) {return a *= b;}
+template <typename t> typed4vector<t> operator / (typed4vector<t> a, const t &b) {return a /= b;}
+template <typename t> typed4vector<t> operator / (const t &b, typed4vector<t> a) {return a /= b;}
 
 template <typename t> typed2vector<t> min(const typed2vector<t> &a, const typed2vector<t> &b) {return typed2vector<t>(std::min(a.x, b.x), std::min(a.y, b.y));}
 template <typename t> typed2vector<t> max(const typed2vector<t> &a, const typed2vector<t> &b) {return typed2vector<t>(std::max(a.x, b.x), std::max(a.y, b.y));}
@@ -164,8 +173,31 @@ typedef typed3vector<float> vec3;
 typedef typed4vector<int> ivec4;
 typedef typed4vector<float> vec4;
 
+//Single precision vec4 arithmetic, which takes precedence over the generic templates above.
+//The same non-template overloads exist with and without SSE, such that mixed expressions like vec4*double convert their arguments in the same way.
+#ifdef TINY_SIMD_SSE
+inline vec4 simdToVec4(const __m128 &a) {vec4 b; _mm_storeu_ps(&b.x, a); return b;}
+inline vec4 operator + (const vec4 &a, const vec4 &b) {return simdToVec4(_mm_add_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));}
+inline vec4 operator - (const vec4 &a, const vec4 &b) {return simdToVec4(_mm_sub_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));}
+inline vec4 operator * (const vec4 &a, const vec4 &b) {return simdToVec4(_mm_mul_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));}
+inline vec4 operator / (const vec4 &a, const vec4 &b) {return simdToVec4(_mm_div_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));}
+inline vec4 operator * (const vec4 &a, const float &b) {return simdToVec4(_mm_mul_ps(_mm_loadu_ps(&a.x), _mm_set1_ps(b)));}
+inline vec4 operator * (const float &b, const vec4 &a) {return simdToVec4(_mm_mul_ps(_mm_loadu_ps(&a.x), _mm_set1_ps(b)));}
+inline vec4 operator / (const vec4 &a, const float &b) {return simdToVec4(_mm_div_ps(_mm_loadu_ps(&a.x), _mm_set1_ps(b)));}
+inline vec4 operator / (const float &b, const vec4 &a) {return simdToVec4(_mm_div_ps(_mm_loadu_ps(&a.x), _mm_set1_ps(b)));}
+#else
+inline vec4 operator + (vec4 a, const vec4 &b) {return a += b;}
+inline vec4 operator - (vec4 a, const vec4 &b) {return a -= b;}
+inline vec4 operator * (vec4 a, const vec4 &b) {return a *= b;}
+inline vec4 operator / (vec4 a, const vec4 &b) {return a /= b;}
+inline vec4 operator * (vec4 a, const float &b) {return a *= b;}
+inline vec4 operator * (const float &b, vec4 a) {return a *= b;}
+inline vec4 operator / (vec4 a, const float &b) {return a /= b;}
+inline vec4 operator / (const float &b, vec4 a) {return a /= b;}
+#endif
+
 // Force legality of multiplication by double; it is ridiculous that we can't multiply vectors by doubles without casting into floats. (-Takenu, 16-08-2011)
-inline vec3 & operator * (vec3 a, const double b) {return a *= b;}
+inline vec3 operator * (vec3 a, const double b) {return a *= b;}
 
 //Integer specific bit operations.
 inline ivec2 operator % (const ivec2 &a, const ivec2 &b) {return ivec2(a.x % b.x, a.y % b.y);}
@@ -235,6 +267,7 @@ class mat4
 
         inline mat4 & operator *= (const mat4 &b)
         {
+            //Kept scalar: the SSE broadcast-and-add product was slower in bench_VecMath.
             const mat4 c(v00*b.v00 + v01*b.v10 + v02*b.v20 + v03*b.v30,
                 v10*b.v00 + v11*b.v10 + v12*b.v20 + v13*b.v30,
                 v20*b.v00 + v21*b.v10 + v22*b.v20 + v23*b.v30,
@@ -260,9 +293,20 @@ class mat4
 
         inline vec3 operator * (const vec3 &a) const
         {
+#ifdef TINY_SIMD_SSE
+            float r[4];
+            
+            _mm_storeu_ps(r, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&v00), _mm_set1_ps(a.x)),
+                                                              _mm_mul_ps(_mm_loadu_ps(&v01), _mm_set1_ps(a.y))),
+                                                   _mm_mul_ps(_mm_loadu_ps(&v02), _mm_set1_ps(a.z))),
+                                        _mm_loadu_ps(&v03)));
+            
+            return vec3(r[0], r[1], r[2]);
+#else
             return vec3(v00*a.x + v01*a.y + v02*a.z + v03,
                     v10*a.x + v11*a.y + v12*a.z + v13,
                     v20*a.x + v21*a.y + v22*a.z + v23);
+#endif
         };
 
         inline void toOpenGL(float * const v) const
@@ -293,8 +337,29 @@ class mat4
                         v30, v31, v32, v33);
         };
         
+        /** Invert a rigid transformation, consisting of a rotation followed by a translation. */
         inline mat4 inverted() const
         {
+#ifdef TINY_SIMD_SSE
+            //Transpose the matrix, such that the rows become columns.
+            __m128 r0 = _mm_loadu_ps(&v00);
+            __m128 r1 = _mm_loadu_ps(&v01);
+            __m128 r2 = _mm_loadu_ps(&v02);
+            __m128 r3 = _mm_loadu_ps(&v03);
+            mat4 c;
+            
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            
+            const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+            const __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(v03)), _mm_mul_ps(r1, _mm_set1_ps(v13))), _mm_mul_ps(r2, _mm_set1_ps(v23)));
+            
+            _mm_storeu_ps(&c.v00, _mm_and_ps(r0, mask));
+            _mm_storeu_ps(&c.v01, _mm_and_ps(r1, mask));
+            _mm_storeu_ps(&c.v02, _mm_and_ps(r2, mask));
+            _mm_storeu_ps(&c.v03, _mm_or_ps(_mm_and_ps(_mm_xor_ps(t, _mm_set1_ps(-0.0f)), mask), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f)));
+            
+            return c;
+#else
             return mat4(v00, v01, v02, 0.0f,
                 v10, v11, v12, 0.0f,
                 v20, v21, v22, 0.0f,
@@ -302,6 +367,7 @@ class mat4
                 -(v01*v03 + v11*v13 + v21*v23),
                 -(v02*v03 + v12*v13 + v22*v23),
                 1.0f);
+#endif
         };
 
         inline mat4 &setTranslation(const vec3 &a)
@@ -437,12 +503,19 @@ class mat4
         };
 };
 
-inline mat4 & operator * (mat4 a, const mat4 &b) {return a *= b;}
+inline mat4 operator * (mat4 a, const mat4 &b) {return a *= b;}
 
 vec4 quatmul(const vec4 &, const vec4 &);
 vec4 quatconj(const vec4 &);
 vec4 quatrot(const float &, const vec3 &);
 
+//Operations on arrays of vectors, which process multiple vectors at once using SIMD instructions if available.
+//The results are identical to applying the corresponding single vector operations to each element.
+void transformPoints(const mat4 &, const vec3 *, vec3 *, const size_t &);
+void normalizeQuaternions(vec4 *, const size_t &);
+void dotProducts(const vec3 *, const vec3 *, float *, const size_t &);
+void dotProducts(const vec4 *, const vec4 *, float *, const size_t &);
+
 vec2 randomVec2(const float & = 1.0f);
 vec3 randomVec3(const float & = 1.0f);
 vec4 randomVec4(const float & = 1.0f);
@@ -21,7 +21,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using namespace tiny::net;
 
 Client::Client(const std::string &hostName, const unsigned int &hostPort, MessageTranslator *a_translator) :
-    translator(a_translator)
+    translator(a_translator),
+    socket(0),
+    selector(0),
+    receivedMessages()
 {
     if (!translator)
     {
@@ -43,6 +46,17 @@ Client::Client(const std::string &hostName, const unsigned int &hostPort, Messag
         throw std::exception();
     }
     
+    //Create a socket selector that is reused for every call to listen().
+    selector = SDLNet_AllocSocketSet(1);
+    
+    if (!selector || SDLNet_TCP_AddSocket(selector, socket) < 0)
+    {
+        std::cerr << "Unable to create selector: " << SDLNet_GetError() << "!" << std::endl;
+        if (selector) SDLNet_FreeSocketSet(selector);
+        SDLNet_TCP_Close(socket);
+        throw std::exception();
+    }
+    
     std::cerr << "Connected to " << hostName << ":" << hostPort << "." << std::endl;
 }
 
@@ -50,6 +64,9 @@ Client::~Client()
 {
     std::cerr << "Closing connection..." << std::endl;
     
+    translator->flushTCP(socket);
+    translator->closeTCP(socket);
+    SDLNet_FreeSocketSet(selector);
     SDLNet_TCP_Close(socket);
     
     std::cerr << "Stopped transmitting." << std::endl;
@@ -57,60 +74,60 @@ Client::~Client()
 
 bool Client::listen(const double &dt)
 {
-    //Create socket selector.
-    SDLNet_SocketSet selector = SDLNet_AllocSocketSet(3);
-    
-    if (!selector)
+    //Send all messages that were queued since the previous call.
+    if (!translator->flushTCP(socket))
     {
-        std::cerr << "Unable to create selector: " << SDLNet_GetError() << "!" << std::endl;
-        return false;
-    }
-    
-    //Populate selector.
-    if (SDLNet_TCP_AddSocket(selector, socket) < 0)
-    {
-        std::cerr << "Unable to add socket to selector: " << SDLNet_GetError() << "!" << std::endl;
-        return false;
+        std::cerr << "Unable to send queued messages to host!" << std::endl;
     }
     
-    //Are any of the sockets active?
+    //Wait for activity only once, afterwards keep processing data for as long as it is immediately available.
+    int timeout = static_cast<int>(1000.0*dt);
     bool receivedData = true;
     
     while (receivedData)
     {
         receivedData = false;
         
-        if (SDLNet_CheckSockets(selector, 1000.0*dt) > 0)
+        if (SDLNet_CheckSockets(selector, timeout) > 0)
         {
+            timeout = 0;
+            
             if (SDLNet_SocketReady(socket) != 0)
             {
-                //Receive data.
-                Message message;
+                //Receive all messages that have arrived.
+                const int nrMessages = translator->receiveMessagesTCP(socket, receivedMessages);
                 
-                if (!translator->receiveMessageTCP(socket, message))
+                if (nrMessages < 0)
                 {
                     std::cerr << "Lost connection to host!" << std::endl;
                     disconnectedFromHost();
                 }
                 else
                 {
-                    receiveMessage(message);
+                    for (int i = 0; i < nrMessages; ++i)
+                    {
+                        receiveMessage(receivedMessages[i]);
+                    }
+                    
                     receivedData = true;
                 }
             }
         }
     }
     
-    //Free socket set.
-    SDLNet_FreeSocketSet(selector);
+    //Send the replies to the received messages.
+    if (!translator->flushTCP(socket))
+    {
+        std::cerr << "Unable to send queued messages to host!" << std::endl;
+    }
     
     return true;
 }
 
 void Client::sendMessage(const Message &message)
 {
-    //Send message to host.
-    if (!translator->sendMessageTCP(message, socket))
+    //Queue message for the host, it will be sent during the next call to listen().
+    if (!translator->queueMessageTCP(message, socket))
     {
         std::cerr << "Unable to send message " << message.id << " to host!" << std::endl;
     }
@@ -48,6 +48,8 @@ class Client
         MessageTranslator * const translator;
         IPaddress hostAddress;
         TCPsocket socket;
+        SDLNet_SocketSet selector;
+        std::vector<Message> receivedMessages;
 };
 
 }
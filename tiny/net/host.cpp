@@ -21,9 +21,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace tiny::net;
 
-Host::Host(const unsigned int &listenPort, MessageTranslator *a_translator) :
+Host::Host(const unsigned int &listenPort, MessageTranslator *a_translator, const int &maxNrClients) :
     lastClientIndex(1),
-    translator(a_translator)
+    hostSocket(0),
+    selector(0),
+    selectorSize(0),
+    clients(),
+    clientSlots(1, -1),
+    translator(a_translator),
+    receivedMessages()
 {
     if (!translator)
     {
@@ -46,6 +52,13 @@ Host::Host(const unsigned int &listenPort, MessageTranslator *a_translator) :
         throw std::exception();
     }
     
+    //Create selector for the listening socket and the expected number of clients.
+    if (!createSelector(maxNrClients + 1))
+    {
+        SDLNet_TCP_Close(hostSocket);
+        throw std::exception();
+    }
+    
     //Start listening for clients.
     std::cerr << "Hosting at " << SDLNet_ResolveIP(&hostAddress) << ":" << listenPort << "." << std::endl;
 }
@@ -55,126 +68,202 @@ Host::~Host()
     //Terminate connections.
     std::cerr << "Closing " << clients.size() << " external connections..." << std::endl;
 
-    for (std::map<TCPsocket, unsigned int>::const_iterator c = clients.begin(); c != clients.end(); ++c)
+    for (std::vector<HostClient>::const_iterator c = clients.begin(); c != clients.end(); ++c)
     {
-        SDLNet_TCP_Close(c->first);
+        if (c->connected) translator->flushTCP(c->socket);
+        
+        translator->closeTCP(c->socket);
+        SDLNet_TCP_Close(c->socket);
     }
-
+    
+    SDLNet_FreeSocketSet(selector);
     SDLNet_TCP_Close(hostSocket);
     
     std::cerr << "Stopped hosting." << std::endl;
 }
 
-bool Host::listen(const double &dt)
+bool Host::createSelector(const int &size)
 {
-    //Create socket selector for the current number of clients.
-    SDLNet_SocketSet selector = SDLNet_AllocSocketSet(clients.size() + 2);
+    //(Re)create the socket set and add all sockets to it.
+    if (selector) SDLNet_FreeSocketSet(selector);
+    
+    selector = SDLNet_AllocSocketSet(size);
+    selectorSize = size;
     
     if (!selector)
     {
         std::cerr << "Unable to create host selector: " << SDLNet_GetError() << "!" << std::endl;
+        selectorSize = 0;
         return false;
     }
     
-    //Populate selector.
     if (SDLNet_TCP_AddSocket(selector, hostSocket) < 0)
     {
         std::cerr << "Unable to add listening socket to selector: " << SDLNet_GetError() << "!" << std::endl;
         return false;
     }
     
-    for (std::map<TCPsocket, unsigned int>::const_iterator c = clients.begin(); c != clients.end(); ++c)
+    for (std::vector<HostClient>::const_iterator c = clients.begin(); c != clients.end(); ++c)
     {
-        if (SDLNet_TCP_AddSocket(selector, c->first) < 0)
+        if (SDLNet_TCP_AddSocket(selector, c->socket) < 0)
         {
-            std::cerr << "Unable to add client " << c->second << "'s socket to selector: " << SDLNet_GetError() << "!" << std::endl;
+            std::cerr << "Unable to add client " << c->index << "'s socket to selector: " << SDLNet_GetError() << "!" << std::endl;
             return false;
         }
     }
     
-    //Are any of the sockets active?
-    //TODO: Keep doing this until there is no more data available?
+    return true;
+}
+
+bool Host::listen(const double &dt)
+{
+    if (!selector) return false;
+    
+    //Send all messages that were queued since the previous call.
+    removeDisconnectedClients();
+    flushClients();
+    
+    //Wait for activity only once, afterwards keep processing data for as long as it is immediately available.
+    int timeout = static_cast<int>(1000.0*dt);
     bool receivedData = true;
     
     while (receivedData)
     {
         receivedData = false;
         
-        if (SDLNet_CheckSockets(selector, 1000.0*dt) > 0)
+        if (SDLNet_CheckSockets(selector, timeout) <= 0) break;
+        
+        timeout = 0;
+        
+        if (SDLNet_SocketReady(hostSocket) != 0)
         {
-            if (SDLNet_SocketReady(hostSocket) != 0)
-            {
-                //New incoming connection.
-                TCPsocket clientSocket = SDLNet_TCP_Accept(hostSocket);
-                
-                if (clientSocket)
-                {
-                    IPaddress *clientAddress = SDLNet_TCP_GetPeerAddress(clientSocket);
-                    
-                    //SDLNet_TCP_AddSocket(selector, clientSocket);
-                    
-                    std::cerr << "Accepted connection from " << SDLNet_ResolveIP(clientAddress) << " with index " << lastClientIndex << "." << std::endl;
-                    
-                    clients.insert(std::make_pair(clientSocket, lastClientIndex));
-                    addClient(lastClientIndex);
-                    lastClientIndex++;
-                }
-                else
-                {
-                    std::cerr << "Warning: Unable to accept incoming connection: " << SDLNet_GetError() << "!" << std::endl;
-                }
-            }
+            //New incoming connection.
+            acceptClient();
+            receivedData = true;
+        }
+        
+        //Look for data from the clients, this never blocks since partially received frames are buffered by the translator.
+        for (size_t i = 0; i < clients.size(); ++i)
+        {
+            if (!clients[i].connected || SDLNet_SocketReady(clients[i].socket) == 0) continue;
             
-            //Look for data from the clients and remove the clients that have disconnected.
-            std::map<TCPsocket, unsigned int> remainingClients;
+            const int nrMessages = translator->receiveMessagesTCP(clients[i].socket, receivedMessages);
             
-            for (std::map<TCPsocket, unsigned int>::const_iterator c = clients.begin(); c != clients.end(); ++c)
+            if (nrMessages < 0)
             {
-                bool keepClient = true;
-                
-                if (SDLNet_SocketReady(c->first) != 0)
-                {
-                    //Receive data.
-                    Message message;
-                    
-                    if (!translator->receiveMessageTCP(c->first, message))
-                    {
-                        std::cerr << "Lost connection from client " << c->second << "." << std::endl;
-                        removeClient(c->second);
-                        SDLNet_TCP_Close(c->first);
-                        keepClient = false;
-                    }
-                    else
-                    {
-                        receiveMessage(c->second, message);
-                        receivedData = true;
-                    }
-                }
-                
-                if (keepClient)
+                std::cerr << "Lost connection from client " << clients[i].index << "." << std::endl;
+                clients[i].connected = false;
+            }
+            else
+            {
+                //The client vector is not modified by kickClient(), so we can safely dispatch from here.
+                for (int j = 0; j < nrMessages; ++j)
                 {
-                    remainingClients.insert(*c);
+                    receiveMessage(clients[i].index, receivedMessages[j]);
                 }
             }
             
-            clients = remainingClients;
+            receivedData = true;
         }
+        
+        removeDisconnectedClients();
     }
     
-    //Free socket set.
-    SDLNet_FreeSocketSet(selector);
+    //Send the replies to the received messages.
+    flushClients();
     
     return true;
 }
 
+void Host::acceptClient()
+{
+    TCPsocket clientSocket = SDLNet_TCP_Accept(hostSocket);
+    
+    if (!clientSocket)
+    {
+        std::cerr << "Warning: Unable to accept incoming connection: " << SDLNet_GetError() << "!" << std::endl;
+        return;
+    }
+    
+    IPaddress *clientAddress = SDLNet_TCP_GetPeerAddress(clientSocket);
+    
+    std::cerr << "Accepted connection from " << SDLNet_ResolveIP(clientAddress) << " with index " << lastClientIndex << "." << std::endl;
+    
+    clientSlots.push_back(clients.size());
+    clients.push_back(HostClient(clientSocket, lastClientIndex));
+    
+    //Grow the selector if it is full.
+    if (static_cast<int>(clients.size()) + 1 > selectorSize)
+    {
+        if (!createSelector(2*selectorSize)) clients.back().connected = false;
+    }
+    else if (SDLNet_TCP_AddSocket(selector, clientSocket) < 0)
+    {
+        std::cerr << "Unable to add client " << lastClientIndex << "'s socket to selector: " << SDLNet_GetError() << "!" << std::endl;
+        clients.back().connected = false;
+    }
+    
+    addClient(lastClientIndex++);
+}
+
+void Host::removeDisconnectedClients()
+{
+    //Swap disconnected clients with the last client and remove them.
+    for (size_t i = 0; i < clients.size(); )
+    {
+        if (clients[i].connected)
+        {
+            ++i;
+            continue;
+        }
+        
+        const HostClient client = clients[i];
+        
+        SDLNet_TCP_DelSocket(selector, client.socket);
+        translator->closeTCP(client.socket);
+        SDLNet_TCP_Close(client.socket);
+        
+        clientSlots[client.index] = -1;
+        clients[i] = clients.back();
+        clientSlots[clients[i].index] = i;
+        clients.pop_back();
+        
+        removeClient(client.index);
+    }
+}
+
+void Host::flushClients()
+{
+    for (std::vector<HostClient>::iterator c = clients.begin(); c != clients.end(); ++c)
+    {
+        if (c->connected && !translator->flushTCP(c->socket))
+        {
+            std::cerr << "Unable to send queued messages to client " << c->index << "!" << std::endl;
+            c->connected = false;
+        }
+    }
+}
+
+Host::HostClient *Host::getClient(const unsigned int &clientIndex)
+{
+    if (clientIndex >= clientSlots.size() || clientSlots[clientIndex] < 0) return 0;
+    
+    return &clients[clientSlots[clientIndex]];
+}
+
+size_t Host::getNrClients() const
+{
+    return clients.size();
+}
+
 void Host::sendMessage(const Message &message)
 {
-    //Send message to all clients.
-    for (std::map<TCPsocket, unsigned int>::const_iterator c = clients.begin(); c != clients.end(); ++c)
+    //Queue message for all clients, it will be sent during the next call to listen().
+    for (std::vector<HostClient>::const_iterator c = clients.begin(); c != clients.end(); ++c)
     {
-        if (!translator->sendMessageTCP(message, c->first))
+        if (c->connected && !translator->queueMessageTCP(message, c->socket))
         {
-            std::cerr << "Unable to send message " << message.id << " to client " << c->second << "!" << std::endl;
+            std::cerr << "Unable to send message " << message.id << " to client " << c->index << "!" << std::endl;
         }
     }
 }
@@ -182,20 +271,18 @@ void Host::sendMessage(const Message &message)
 void Host::sendPrivateMessage(const Message &message, const unsigned int &clientIndex)
 {
     //Send message to a specific client.
-    for (std::map<TCPsocket, unsigned int>::const_iterator c = clients.begin(); c != clients.end(); ++c)
+    const HostClient *client = getClient(clientIndex);
+    
+    if (!client || !client->connected)
     {
-        if (c->second == clientIndex)
-        {
-            if (!translator->sendMessageTCP(message, c->first))
-            {
-                std::cerr << "Unable to send private message " << message.id << " to client " << c->second << "!" << std::endl;
-            }
-            
-            return;
-        }
+        std::cerr << "Unable to find client with index " << clientIndex << "!" << std::endl;
+        return;
     }
     
-    std::cerr << "Unable to find client with index " << clientIndex << "!" << std::endl;
+    if (!translator->queueMessageTCP(message, client->socket))
+    {
+        std::cerr << "Unable to send private message " << message.id << " to client " << clientIndex << "!" << std::endl;
+    }
 }
 
 void Host::addClient(const unsigned int &)
@@ -213,8 +300,10 @@ void Host::removeClient(const unsigned int &)
 
 }
 
-void Host::kickClient(const unsigned int &)
+void Host::kickClient(const unsigned int &clientIndex)
 {
-    //TODO.
+    //The client is disconnected during the next call to listen().
+    HostClient *client = getClient(clientIndex);
+    
+    if (client) client->connected = false;
 }
-
@@ -31,15 +31,20 @@ namespace tiny
 namespace net
 {
 
+/** Accepts TCP connections from clients and exchanges messages with them.
+  * All sockets are kept in a single persistent socket set, which is only reallocated when the number of clients exceeds its capacity.
+  * Clients are stored contiguously and can be found from their index in constant time.
+  */
 class Host
 {
     public:
-        Host(const unsigned int &, MessageTranslator *);
+        Host(const unsigned int &, MessageTranslator *, const int & = 32);
         virtual ~Host();
         
         bool listen(const double &);
         void sendMessage(const Message &);
         void sendPrivateMessage(const Message &, const unsigned int &);
+        size_t getNrClients() const;
         
     protected:
         virtual void addClient(const unsigned int &);
@@ -49,11 +54,36 @@ class Host
         void kickClient(const unsigned int &);
         
     private:
+        struct HostClient
+        {
+            HostClient(TCPsocket a_socket, const unsigned int &a_index) :
+                socket(a_socket),
+                index(a_index),
+                connected(true)
+            {
+
+            }
+            
+            TCPsocket socket;
+            unsigned int index;
+            bool connected;
+        };
+        
+        bool createSelector(const int &);
+        void acceptClient();
+        void removeDisconnectedClients();
+        void flushClients();
+        HostClient *getClient(const unsigned int &);
+        
         unsigned int lastClientIndex;
         IPaddress hostAddress;
         TCPsocket hostSocket;
-        std::map<TCPsocket, unsigned int> clients;
+        SDLNet_SocketSet selector;
+        int selectorSize;
+        std::vector<HostClient> clients;
+        std::vector<int> clientSlots;
         MessageTranslator * const translator;
+        std::vector<Message> receivedMessages;
 };
 
 }
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <sstream>
 #include <cassert>
+#include <cstring>
 
 #include <tiny/net/message.h>
 
@@ -29,134 +30,69 @@ VariableType::VariableType(const std::string &a_name, const vt::vt_enum &a_type)
 
 }
 
-VariableData::VariableData() :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData()
 {
-
+    ints[0] = 0; ints[1] = 0; ints[2] = 0; ints[3] = 0;
 }
 
-VariableData::VariableData(const int &a) :
-    iv1(a),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const int &a)
 {
-
+    ints[0] = a; ints[1] = 0; ints[2] = 0; ints[3] = 0;
 }
 
-VariableData::VariableData(const unsigned int &a) :
-    iv1(a),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const unsigned int &a)
 {
-
+    ints[0] = a; ints[1] = 0; ints[2] = 0; ints[3] = 0;
 }
 
-VariableData::VariableData(const ivec2 &a) :
-    iv1(0),
-    iv2(a),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const ivec2 &a)
 {
-
+    ints[0] = a.x; ints[1] = a.y; ints[2] = 0; ints[3] = 0;
 }
 
-VariableData::VariableData(const ivec3 &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(a),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const ivec3 &a)
 {
-
+    ints[0] = a.x; ints[1] = a.y; ints[2] = a.z; ints[3] = 0;
 }
 
-VariableData::VariableData(const ivec4 &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(a),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const ivec4 &a)
 {
-
+    ints[0] = a.x; ints[1] = a.y; ints[2] = a.z; ints[3] = a.w;
 }
 
-VariableData::VariableData(const float &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(a),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const float &a)
 {
-
+    floats[0] = a; floats[1] = 0.0f; floats[2] = 0.0f; floats[3] = 0.0f;
 }
 
-VariableData::VariableData(const vec2 &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(a),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const vec2 &a)
 {
-
+    floats[0] = a.x; floats[1] = a.y; floats[2] = 0.0f; floats[3] = 0.0f;
 }
 
-VariableData::VariableData(const vec3 &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(a),
-    v4(0.0f, 0.0f, 0.0f, 0.0f)
+VariableData::VariableData(const vec3 &a)
 {
+    floats[0] = a.x; floats[1] = a.y; floats[2] = a.z; floats[3] = 0.0f;
+}
 
+VariableData::VariableData(const vec4 &a)
+{
+    floats[0] = a.x; floats[1] = a.y; floats[2] = a.z; floats[3] = a.w;
 }
 
-VariableData::VariableData(const vec4 &a) :
-    iv1(0),
-    iv2(0, 0),
-    iv3(0, 0, 0),
-    iv4(0, 0, 0, 0),
-    v1(0.0f),
-    v2(0.0f, 0.0f),
-    v3(0.0f, 0.0f, 0.0f),
-    v4(a)
+/** Number of 32-bit components of a variable type. */
+static size_t getNrComponents(const vt::vt_enum &type)
 {
+    if (type == vt::Integer || type == vt::Float) return 1;
+    else if (type == vt::IVec2 || type == vt::Vec2) return 2;
+    else if (type == vt::IVec3 || type == vt::Vec3) return 3;
+    
+    return 4;
+}
 
+static bool isFloatType(const vt::vt_enum &type)
+{
+    return (type == vt::Float || type == vt::Vec2 || type == vt::Vec3 || type == vt::Vec4);
 }
 
 MessageType::MessageType(const id_t &a_id, const std::string &a_name, const std::string &a_usage) :
@@ -208,18 +144,11 @@ std::string MessageType::getDescription() const
 
 size_t MessageType::getSizeInBytes() const
 {
-    size_t length = sizeof(id_t);
+    size_t length = sizeof(Uint16);
     
     for (std::vector<VariableType>::const_iterator i = variableTypes.begin(); i != variableTypes.end(); ++i)
     {
-             if (i->type == vt::Integer) length += sizeof(int);
-        else if (i->type == vt::IVec2) length += sizeof(ivec2);
-        else if (i->type == vt::IVec3) length += sizeof(ivec3);
-        else if (i->type == vt::IVec4) length += sizeof(ivec4);
-        else if (i->type == vt::Float) length += sizeof(float);
-        else if (i->type == vt::Vec2) length += sizeof(vec2);
-        else if (i->type == vt::Vec3) length += sizeof(vec3);
-        else if (i->type == vt::Vec4) length += sizeof(vec4);
+        length += sizeof(Uint32)*getNrComponents(i->type);
     }
     
     return length;
@@ -242,14 +171,14 @@ bool MessageType::messageToText(const Message &in, std::string &out) const
     {
         stream << " ";
         
-             if (i->type == vt::Integer) stream << ptr->iv1;
-        else if (i->type == vt::IVec2) stream << ptr->iv2.x << " " << ptr->iv2.y;
-        else if (i->type == vt::IVec3) stream << ptr->iv3.x << " " << ptr->iv3.y << " " << ptr->iv3.z;
-        else if (i->type == vt::IVec4) stream << ptr->iv4.x << " " << ptr->iv4.y << " " << ptr->iv4.z << " " << ptr->iv4.w;
-        else if (i->type == vt::Float) stream << ptr->v1;
-        else if (i->type == vt::Vec2) stream << ptr->v2.x << " " << ptr->v2.y;
-        else if (i->type == vt::Vec3) stream << ptr->v3.x << " " << ptr->v3.y << " " << ptr->v3.z;
-        else if (i->type == vt::Vec4) stream << ptr->v4.x << " " << ptr->v4.y << " " << ptr->v4.z << " " << ptr->v4.w;
+             if (i->type == vt::Integer) stream << ptr->iv1();
+        else if (i->type == vt::IVec2) stream << ptr->iv2().x << " " << ptr->iv2().y;
+        else if (i->type == vt::IVec3) stream << ptr->iv3().x << " " << ptr->iv3().y << " " << ptr->iv3().z;
+        else if (i->type == vt::IVec4) stream << ptr->iv4().x << " " << ptr->iv4().y << " " << ptr->iv4().z << " " << ptr->iv4().w;
+        else if (i->type == vt::Float) stream << ptr->v1();
+        else if (i->type == vt::Vec2) stream << ptr->v2().x << " " << ptr->v2().y;
+        else if (i->type == vt::Vec3) stream << ptr->v3().x << " " << ptr->v3().y << " " << ptr->v3().z;
+        else if (i->type == vt::Vec4) stream << ptr->v4().x << " " << ptr->v4().y << " " << ptr->v4().z << " " << ptr->v4().w;
         
         ptr++;
     }
@@ -340,13 +269,12 @@ bool MessageType::textToMessage(const std::string &in, Message &out) const
 
 size_t MessageType::dataToMessage(const unsigned char *data, Message &out) const
 {
-    //TODO: Different-endian systems.
     const unsigned char *dataPtr = data;
     
     //Read identifier.
-    const id_t dataId = *(const id_t *)dataPtr;
+    const id_t dataId = SDLNet_Read16(dataPtr);
     
-    dataPtr += sizeof(id_t);
+    dataPtr += sizeof(Uint16);
     
     //Invalid id.
     if (dataId != id)
@@ -361,65 +289,24 @@ size_t MessageType::dataToMessage(const unsigned char *data, Message &out) const
     
     VariableData *msgPtr = &out.data[0];
     
-    //Start extracting data.
+    //Start extracting data, all components are stored as big-endian 32-bit values.
     for (std::vector<VariableType>::const_iterator i = variableTypes.begin(); i != variableTypes.end(); ++i)
     {
-        if (i->type == vt::Integer)
-        {
-            int a = *(const int *)dataPtr;
-            
-            dataPtr += sizeof(int);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::IVec2)
-        {
-            ivec2 a = *(const ivec2 *)dataPtr;
-            
-            dataPtr += sizeof(ivec2);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::IVec3)
-        {
-            ivec3 a = *(const ivec3 *)dataPtr;
-            
-            dataPtr += sizeof(ivec3);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::IVec4)
-        {
-            ivec4 a = *(const ivec4 *)dataPtr;
-            
-            dataPtr += sizeof(ivec4);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::Float)
-        {
-            float a = *(const float *)dataPtr;
-            
-            dataPtr += sizeof(float);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::Vec2)
+        const size_t nrComponents = getNrComponents(i->type);
+        
+        *msgPtr = VariableData();
+        
+        for (size_t j = 0; j < nrComponents; ++j)
         {
-            vec2 a = *(const vec2 *)dataPtr;
+            const Uint32 a = SDLNet_Read32(dataPtr);
             
-            dataPtr += sizeof(vec2);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::Vec3)
-        {
-            vec3 a = *(const vec3 *)dataPtr;
+            if (isFloatType(i->type)) memcpy(&msgPtr->floats[j], &a, sizeof(Uint32));
+            else msgPtr->ints[j] = static_cast<int>(a);
             
-            dataPtr += sizeof(vec3);
-            *msgPtr++ = VariableData(a);
-        }
-        else if (i->type == vt::Vec4)
-        {
-            vec4 a = *(const vec4 *)dataPtr;
-            
-            dataPtr += sizeof(vec4);
-            *msgPtr++ = VariableData(a);
+            dataPtr += sizeof(Uint32);
         }
+        
+        msgPtr++;
     }
     
     assert(dataPtr - data == static_cast<int>(getSizeInBytes()));
@@ -438,50 +325,22 @@ size_t MessageType::messageToData(const Message &in, unsigned char *out) const
     const VariableData *msgPtr = &in.data[0];
     unsigned char *dataPtr = out;
     
-    *(id_t *)dataPtr = id;
-    dataPtr += sizeof(id_t);
+    SDLNet_Write16(id, dataPtr);
+    dataPtr += sizeof(Uint16);
     
     for (std::vector<VariableType>::const_iterator i = variableTypes.begin(); i != variableTypes.end(); ++i)
     {
-        if (i->type == vt::Integer)
-        {
-            *(int *)dataPtr = msgPtr->iv1;
-            dataPtr += sizeof(int);
-        }
-        else if (i->type == vt::IVec2)
-        {
-            *(ivec2 *)dataPtr = msgPtr->iv2;
-            dataPtr += sizeof(ivec2);
-        }
-        else if (i->type == vt::IVec3)
-        {
-            *(ivec3 *)dataPtr = msgPtr->iv3;
-            dataPtr += sizeof(ivec3);
-        }
-        else if (i->type == vt::IVec4)
-        {
-            *(ivec4 *)dataPtr = msgPtr->iv4;
-            dataPtr += sizeof(ivec4);
-        }
-        if (i->type == vt::Float)
-        {
-            *(float *)dataPtr = msgPtr->v1;
-            dataPtr += sizeof(float);
-        }
-        else if (i->type == vt::Vec2)
-        {
-            *(vec2 *)dataPtr = msgPtr->v2;
-            dataPtr += sizeof(vec2);
-        }
-        else if (i->type == vt::Vec3)
-        {
-            *(vec3 *)dataPtr = msgPtr->v3;
-            dataPtr += sizeof(vec3);
-        }
-        else if (i->type == vt::Vec4)
+        const size_t nrComponents = getNrComponents(i->type);
+        
+        for (size_t j = 0; j < nrComponents; ++j)
         {
-            *(vec4 *)dataPtr = msgPtr->v4;
-            dataPtr += sizeof(vec4);
+            Uint32 a = 0;
+            
+            if (isFloatType(i->type)) memcpy(&a, &msgPtr->floats[j], sizeof(Uint32));
+            else a = static_cast<Uint32>(msgPtr->ints[j]);
+            
+            SDLNet_Write32(a, dataPtr);
+            dataPtr += sizeof(Uint32);
         }
         
         msgPtr++;
@@ -505,8 +364,10 @@ void MessageType::addVariableType(const std::string &a_name, const vt::vt_enum &
     variableTypes.push_back(VariableType(a_name, a_type));
 }
 
-MessageTranslator::MessageTranslator() :
-    messageBuffer(65536)
+MessageTranslator::MessageTranslator(const size_t &a_maxFrameSize) :
+    maxFrameSize(a_maxFrameSize),
+    socketBuffers(),
+    messageTypes()
 {
 
 }
@@ -573,79 +434,177 @@ bool MessageTranslator::messageToText(const Message &message, std::string &text)
     return i->second->messageToText(message, text);
 }
 
-bool MessageTranslator::sendMessageTCP(const Message &message, TCPsocket socket)
+const MessageType *MessageTranslator::getMessageType(const id_t &id) const
 {
-    std::map<id_t, const MessageType *>::const_iterator i = messageTypes.find(message.id);
+    std::map<id_t, const MessageType *>::const_iterator i = messageTypes.find(id);
     
     if (i == messageTypes.end())
     {
-        std::cerr << "Unable to find message type with id " << message.id << "!" << std::endl;
-        return false;
+        std::cerr << "Unable to find message type with id " << id << "!" << std::endl;
+        return 0;
     }
     
-    const size_t messageSize = i->second->getSizeInBytes();
+    return i->second;
+}
+
+bool MessageTranslator::sendMessageTCP(const Message &message, TCPsocket socket)
+{
+    return queueMessageTCP(message, socket) && flushTCP(socket);
+}
+
+bool MessageTranslator::queueMessageTCP(const Message &message, TCPsocket socket)
+{
+    const MessageType *type = getMessageType(message.id);
+    
+    if (!type) return false;
     
-    if (messageSize > messageBuffer.size() || messageSize == 0)
+    const size_t messageSize = type->getSizeInBytes();
+    
+    if (messageSize > maxFrameSize || messageSize == 0)
     {
         std::cerr << "Message is too large to be sent over TCP (" << messageSize << " bytes)!" << std::endl;
         return false;
     }
     
-    if (i->second->messageToData(message, &messageBuffer[0]) != messageSize)
+    SocketBuffer &buffer = socketBuffers[socket];
+    const size_t previousSize = buffer.sendData.size();
+    const size_t previousFrameStart = buffer.frameStart;
+    
+    //Start a new frame if there is none or if the message does not fit in the current frame.
+    if (buffer.sendData.empty() || buffer.sendData.size() - buffer.frameStart - sizeof(Uint32) + messageSize > maxFrameSize)
     {
-        std::cerr << "Unable to convert message to raw data!" << std::endl;
-        return false;
+        buffer.frameStart = buffer.sendData.size();
+        buffer.sendData.resize(buffer.frameStart + sizeof(Uint32));
     }
     
-    if (SDLNet_TCP_Send(socket, &messageBuffer[0], messageSize) != static_cast<int>(messageSize))
+    const size_t offset = buffer.sendData.size();
+    
+    buffer.sendData.resize(offset + messageSize);
+    
+    if (type->messageToData(message, &buffer.sendData[offset]) != messageSize)
     {
-        std::cerr << "Unable to send all data over TCP: " << SDLNet_GetError() << "!" << std::endl;
+        std::cerr << "Unable to convert message to raw data!" << std::endl;
+        
+        //Also remove the header of a frame that was started for this message, such that no empty frames are sent.
+        buffer.sendData.resize(previousSize);
+        buffer.frameStart = previousFrameStart;
         return false;
     }
     
+    //Update the payload length of the frame.
+    SDLNet_Write32(buffer.sendData.size() - buffer.frameStart - sizeof(Uint32), &buffer.sendData[buffer.frameStart]);
+    
     return true;
 }
 
-bool MessageTranslator::receiveMessageTCP(TCPsocket socket, Message &message)
+bool MessageTranslator::flushTCP(TCPsocket socket)
 {
-    //Receive id.
-    if (SDLNet_TCP_Recv(socket, &messageBuffer[0], sizeof(id_t)) != sizeof(id_t))
-    {
-        std::cerr << "Unable to receive message id over TCP!" << std::endl;
-        return false;
-    }
+    std::map<TCPsocket, SocketBuffer>::iterator i = socketBuffers.find(socket);
     
-    const id_t id = *(id_t *)&messageBuffer[0];
-    std::map<id_t, const MessageType *>::const_iterator i = messageTypes.find(id);
+    if (i == socketBuffers.end() || i->second.sendData.empty()) return true;
     
-    if (i == messageTypes.end())
+    //Send all queued frames at once.
+    std::vector<unsigned char> &data = i->second.sendData;
+    const int dataSize = data.size();
+    const bool sentAll = (SDLNet_TCP_Send(socket, &data[0], dataSize) == dataSize);
+    
+    data.clear();
+    i->second.frameStart = 0;
+    
+    if (!sentAll)
     {
-        std::cerr << "Unable to find message type with id " << id << "!" << std::endl;
+        std::cerr << "Unable to send all data over TCP: " << SDLNet_GetError() << "!" << std::endl;
         return false;
     }
     
-    const size_t messageSize = i->second->getSizeInBytes();
+    return true;
+}
+
+int MessageTranslator::receiveMessagesTCP(TCPsocket socket, std::vector<Message> &messages)
+{
+    SocketBuffer &buffer = socketBuffers[socket];
+    
+    //A buffer of the maximum frame size always leaves room for more data while it does not contain a complete frame.
+    if (buffer.receiveData.empty()) buffer.receiveData.resize(sizeof(Uint32) + maxFrameSize);
     
-    if (messageSize > messageBuffer.size() || messageSize == 0)
+    const int nrReceived = SDLNet_TCP_Recv(socket, &buffer.receiveData[buffer.receiveSize], buffer.receiveData.size() - buffer.receiveSize);
+    
+    if (nrReceived <= 0)
     {
-        std::cerr << "Message is too large to be sent over TCP (" << messageSize << " bytes)!" << std::endl;
-        return false;
+        std::cerr << "Unable to receive data over TCP!" << std::endl;
+        return -1;
     }
     
-    //Receive data.
-    if (SDLNet_TCP_Recv(socket, &messageBuffer[sizeof(id_t)], messageSize - sizeof(id_t)) != static_cast<int>(messageSize - sizeof(id_t)))
+    buffer.receiveSize += nrReceived;
+    
+    //Decode all complete frames.
+    int nrMessages = 0;
+    size_t frameStart = 0;
+    
+    while (buffer.receiveSize - frameStart >= sizeof(Uint32))
     {
-        std::cerr << "Unable to receive message contents over TCP!" << std::endl;
-        return false;
+        const size_t frameSize = SDLNet_Read32(&buffer.receiveData[frameStart]);
+        
+        if (frameSize > maxFrameSize)
+        {
+            std::cerr << "Received a frame that is too large (" << frameSize << " bytes)!" << std::endl;
+            return -1;
+        }
+        
+        if (buffer.receiveSize - frameStart - sizeof(Uint32) < frameSize) break;
+        
+        const unsigned char *data = &buffer.receiveData[frameStart + sizeof(Uint32)];
+        size_t position = 0;
+        
+        while (position < frameSize)
+        {
+            if (frameSize - position < sizeof(Uint16))
+            {
+                std::cerr << "Received a truncated message id over TCP!" << std::endl;
+                return -1;
+            }
+            
+            const MessageType *type = getMessageType(SDLNet_Read16(data + position));
+            
+            if (!type) return -1;
+            
+            const size_t messageSize = type->getSizeInBytes();
+            
+            if (frameSize - position < messageSize)
+            {
+                std::cerr << "Received truncated message contents over TCP!" << std::endl;
+                return -1;
+            }
+            
+            //Reuse the messages already present to avoid allocating their variables.
+            if (nrMessages >= static_cast<int>(messages.size())) messages.push_back(Message());
+            
+            if (type->dataToMessage(data + position, messages[nrMessages]) != messageSize)
+            {
+                std::cerr << "Unable to convert raw data to message!" << std::endl;
+                return -1;
+            }
+            
+            position += messageSize;
+            nrMessages++;
+        }
+        
+        frameStart += sizeof(Uint32) + frameSize;
     }
     
-    if (i->second->dataToMessage(&messageBuffer[0], message) != messageSize)
+    //Keep incomplete frames for the next call.
+    if (frameStart > 0)
     {
-        std::cerr << "Unable to convert raw data to message!" << std::endl;
-        return false;
+        memmove(&buffer.receiveData[0], &buffer.receiveData[frameStart], buffer.receiveSize - frameStart);
+        buffer.receiveSize -= frameStart;
     }
     
-    return true;
+    return nrMessages;
+}
+
+void MessageTranslator::closeTCP(TCPsocket socket)
+{
+    socketBuffers.erase(socket);
 }
 
 std::string MessageTranslator::getMessageTypeNames(const std::string &separator) const
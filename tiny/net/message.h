@@ -59,6 +59,7 @@ struct VariableType
     vt::vt_enum type;
 };
 
+/** Stores the value of a single message variable in at most four 32-bit components. */
 struct VariableData
 {
     VariableData();
@@ -72,14 +73,20 @@ struct VariableData
     VariableData(const vec3 &);
     VariableData(const vec4 &);
     
-    int iv1;
-    ivec2 iv2;
-    ivec3 iv3;
-    ivec4 iv4;
-    float v1;
-    vec2 v2;
-    vec3 v3;
-    vec4 v4;
+    inline int iv1() const {return ints[0];}
+    inline ivec2 iv2() const {return ivec2(ints[0], ints[1]);}
+    inline ivec3 iv3() const {return ivec3(ints[0], ints[1], ints[2]);}
+    inline ivec4 iv4() const {return ivec4(ints[0], ints[1], ints[2], ints[3]);}
+    inline float v1() const {return floats[0];}
+    inline vec2 v2() const {return vec2(floats[0], floats[1]);}
+    inline vec3 v3() const {return vec3(floats[0], floats[1], floats[2]);}
+    inline vec4 v4() const {return vec4(floats[0], floats[1], floats[2], floats[3]);}
+    
+    union
+    {
+        int ints[4];
+        float floats[4];
+    };
 };
 
 struct Message
@@ -137,16 +144,26 @@ class MessageType
         std::vector<VariableType> variableTypes;
 };
 
+/** Translates messages to and from text and sends them over TCP connections.
+  *
+  * Messages are sent in frames: a 32-bit big-endian payload length followed by the packed messages themselves.
+  * Each message consists of its 16-bit id followed by its variables, with every component stored as a big-endian 32-bit value.
+  * Messages queued for a socket are coalesced into a single frame and sent with a single call to SDLNet_TCP_Send() by flushTCP().
+  * Received data is buffered per socket, such that all messages that arrived can be decoded from a single call to SDLNet_TCP_Recv().
+  */
 class MessageTranslator
 {
     public:
-        MessageTranslator();
+        MessageTranslator(const size_t & = 65536);
         virtual ~MessageTranslator();
         
         bool textToMessage(const std::string &, Message &) const;
         bool messageToText(const Message &, std::string &) const;
         bool sendMessageTCP(const Message &, TCPsocket);
-        bool receiveMessageTCP(TCPsocket, Message &);
+        bool queueMessageTCP(const Message &, TCPsocket);
+        bool flushTCP(TCPsocket);
+        int receiveMessagesTCP(TCPsocket, std::vector<Message> &);
+        void closeTCP(TCPsocket);
         std::string getMessageTypeNames(const std::string & = ", ") const;
         std::string getMessageTypeDescriptions() const;
         
@@ -154,7 +171,28 @@ class MessageTranslator
         bool addMessageType(const MessageType *);
         
     private:
-        std::vector<unsigned char> messageBuffer;
+        /** Outgoing and incoming data of a single socket. */
+        struct SocketBuffer
+        {
+            SocketBuffer() :
+                sendData(),
+                frameStart(0),
+                receiveData(),
+                receiveSize(0)
+            {
+
+            }
+            
+            std::vector<unsigned char> sendData;
+            size_t frameStart;
+            std::vector<unsigned char> receiveData;
+            size_t receiveSize;
+        };
+        
+        const MessageType *getMessageType(const id_t &) const;
+        
+        const size_t maxFrameSize;
+        std::map<TCPsocket, SocketBuffer> socketBuffers;
         std::map<id_t, const MessageType *> messageTypes;
 };
 
@@ -0,0 +1,324 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <climits>
+
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+
+#include <tiny/draw/renderer.h>
+#include <tiny/os/headlessapplication.h>
+
+using namespace tiny::os;
+
+namespace
+{
+
+//Number of frames that a timer query result may lag behind, such that reading it does not stall the pipeline.
+const size_t nrTimerQueries = 4;
+
+}
+
+HeadlessApplication::HeadlessApplication(const int &a_screenWidth,
+                                         const int &a_screenHeight,
+                                         const int &a_nrFrames,
+                                         const double &a_timeStep) :
+    Application(),
+    screenWidth(a_screenWidth),
+    screenHeight(a_screenHeight),
+    nrFrames(std::max(a_nrFrames, 1)),
+    timeStep(a_timeStep),
+    screen(0),
+    glContext(0),
+    frameBuffer(0),
+    colourBuffer(0),
+    depthBuffer(0),
+    frame(0),
+    frameStart(0),
+    timerQueries(),
+    cpuTimes(nrFrames, 0.0),
+    gpuTimes(nrFrames, -1.0),
+    profiler(0)
+{
+    //Initialise SDL, without audio.
+    std::cerr << "Initialising SDL for headless rendering..." << std::endl;
+    
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        std::cerr << "Unable to initialise SDL: " << SDL_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    //Request the context before the window is created, since SDL may pick the window's pixel format from these attributes.
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    
+    //Create a hidden window that owns the OpenGL context.
+    screen = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screenWidth, screenHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    
+    if (!screen)
+    {
+        std::cerr << "Unable to create hidden window: " << SDL_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    glContext = SDL_GL_CreateContext(screen);
+    
+    if (!glContext)
+    {
+        std::cerr << "Unable to create OpenGL context: " << SDL_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    //Never wait for the display.
+    SDL_GL_SetSwapInterval(0);
+    
+    std::cerr << "Initialising OpenGL..." << std::endl;
+    
+    if (glewInit() != GLEW_OK)
+    {
+        std::cerr << "Unable to initialise GLEW!" << std::endl;
+        throw std::exception();
+    }
+    
+    initOpenGL();
+    createFrameBuffer();
+    profiler = new tiny::draw::FrameProfiler();
+    
+    //Initialise image and font loading, which the scenes may use.
+    if (IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG) != (IMG_INIT_PNG | IMG_INIT_JPG))
+    {
+        std::cerr << "Unable to initialise SDL_image: " << IMG_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    if (TTF_Init() != 0)
+    {
+        std::cerr << "Unable to initialise SDL_ttf: " << TTF_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    std::cerr << "Rendering " << nrFrames << " frames of " << screenWidth << "x" << screenHeight << " pixels with a time step of " << timeStep << "s." << std::endl;
+}
+
+HeadlessApplication::~HeadlessApplication()
+{
+    std::cerr << "Shutting down SDL..." << std::endl;
+    
+    if (!timerQueries.empty()) glDeleteQueries(timerQueries.size(), &timerQueries[0]);
+    
+    delete profiler;
+    destroyFrameBuffer();
+    
+    SDL_GL_DeleteContext(glContext);
+    SDL_DestroyWindow(screen);
+    
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+}
+
+void HeadlessApplication::initOpenGL()
+{
+    if (glGetString(GL_VERSION)) std::cerr << "Using OpenGL version " << glGetString(GL_VERSION) << " (" << glGetString(GL_RENDERER) << ")." << std::endl;
+    else std::cerr << "Cannot determine OpenGL version!" << std::endl;
+    
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClearDepth(1.0);
+    
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    
+    glCullFace(GL_BACK);
+    glEnable(GL_CULL_FACE);
+    
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(UINT_MAX);
+    
+    //GPU timings require timer queries.
+    if (GLEW_VERSION_3_3 || GLEW_ARB_timer_query)
+    {
+        timerQueries.assign(nrTimerQueries, 0);
+        glGenQueries(timerQueries.size(), &timerQueries[0]);
+    }
+    else
+    {
+        std::cerr << "Warning: timer queries are not supported, GPU timings are unavailable!" << std::endl;
+    }
+    
+    //Clear OpenGL error state.
+    glGetError();
+}
+
+void HeadlessApplication::createFrameBuffer()
+{
+    //Create an offscreen frame buffer that replaces the screen.
+    glGenFramebuffers(1, &frameBuffer);
+    glGenRenderbuffers(1, &colourBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    
+    glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, screenWidth, screenHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, screenWidth, screenHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Unable to create offscreen frame buffer (status " << status << ")!" << std::endl;
+        throw std::exception();
+    }
+    
+    glViewport(0, 0, screenWidth, screenHeight);
+    tiny::draw::Renderer::setScreenFrameBuffer(frameBuffer);
+}
+
+void HeadlessApplication::destroyFrameBuffer()
+{
+    tiny::draw::Renderer::setScreenFrameBuffer(0);
+    
+    if (frameBuffer != 0) glDeleteFramebuffers(1, &frameBuffer);
+    if (colourBuffer != 0) glDeleteRenderbuffers(1, &colourBuffer);
+    if (depthBuffer != 0) glDeleteRenderbuffers(1, &depthBuffer);
+    
+    frameBuffer = 0;
+    colourBuffer = 0;
+    depthBuffer = 0;
+}
+
+double HeadlessApplication::pollEvents()
+{
+    //Discard all events, input is never received.
+    SDL_Event event;
+    
+    while (SDL_PollEvent(&event));
+    
+    if (!timerQueries.empty())
+    {
+        //Report the frame that used this timer query previously, its result should be available by now.
+        if (frame >= static_cast<int>(timerQueries.size())) reportFrame(frame - timerQueries.size());
+        
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries[frame % timerQueries.size()]);
+    }
+    
+    profiler->beginFrame();
+    frameStart = SDL_GetPerformanceCounter();
+    
+    return timeStep;
+}
+
+void HeadlessApplication::paint()
+{
+    if (frame >= nrFrames) return;
+    
+    //Submit all rendering commands, the frame buffer is never displayed.
+    glFlush();
+    cpuTimes[frame] = static_cast<double>(SDL_GetPerformanceCounter() - frameStart)/static_cast<double>(SDL_GetPerformanceFrequency());
+    
+    if (!timerQueries.empty()) glEndQuery(GL_TIME_ELAPSED);
+    else reportFrame(frame);
+    
+    if (++frame < nrFrames) return;
+    
+    //Wait for the remaining timings and stop.
+    if (!timerQueries.empty())
+    {
+        for (int i = std::max(0, frame - static_cast<int>(timerQueries.size())); i < frame; ++i) reportFrame(i);
+    }
+    
+    printStatistics();
+    stopRunning();
+}
+
+void HeadlessApplication::reportFrame(const int &index)
+{
+    if (!timerQueries.empty())
+    {
+        GLuint64 elapsed = 0;
+        
+        glGetQueryObjectui64v(timerQueries[index % timerQueries.size()], GL_QUERY_RESULT, &elapsed);
+        gpuTimes[index] = 1.0e-9*static_cast<double>(elapsed);
+    }
+    
+    std::cout << "Frame " << index << ": CPU " << 1.0e3*cpuTimes[index] << " ms";
+    
+    if (gpuTimes[index] >= 0.0) std::cout << ", GPU " << 1.0e3*gpuTimes[index] << " ms";
+    
+    std::cout << std::endl;
+}
+
+void HeadlessApplication::printStatistics() const
+{
+    const int nrTimedFrames = std::min(frame, nrFrames);
+    
+    if (nrTimedFrames <= 0) return;
+    
+    double cpuTotal = 0.0, cpuMin = cpuTimes[0], cpuMax = cpuTimes[0];
+    double gpuTotal = 0.0, gpuMin = gpuTimes[0], gpuMax = gpuTimes[0];
+    
+    for (int i = 0; i < nrTimedFrames; ++i)
+    {
+        cpuTotal += cpuTimes[i];
+        cpuMin = std::min(cpuMin, cpuTimes[i]);
+        cpuMax = std::max(cpuMax, cpuTimes[i]);
+        gpuTotal += gpuTimes[i];
+        gpuMin = std::min(gpuMin, gpuTimes[i]);
+        gpuMax = std::max(gpuMax, gpuTimes[i]);
+    }
+    
+    std::cout << "Rendered " << nrTimedFrames << " frames:" << std::endl
+              << "    CPU: " << 1.0e3*cpuTotal/nrTimedFrames << " ms/frame on average (min " << 1.0e3*cpuMin << " ms, max " << 1.0e3*cpuMax << " ms)." << std::endl;
+    
+    if (gpuMin >= 0.0)
+    {
+        std::cout << "    GPU: " << 1.0e3*gpuTotal/nrTimedFrames << " ms/frame on average (min " << 1.0e3*gpuMin << " ms, max " << 1.0e3*gpuMax << " ms)." << std::endl;
+    }
+    
+    //Break the frame time down per pass and renderable, if any renderers were profiled.
+    if (profiler->getNrFrames() > 0) std::cout << profiler->getReport();
+}
+
+tiny::draw::FrameProfiler &HeadlessApplication::getProfiler()
+{
+    return *profiler;
+}
+
+int HeadlessApplication::getScreenWidth() const
+{
+    return screenWidth;
+}
+
+int HeadlessApplication::getScreenHeight() const
+{
+    return screenHeight;
+}
+
+MouseState HeadlessApplication::getMouseState(const bool &)
+{
+    return MouseState();
+}
+
@@ -0,0 +1,87 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <SDL.h>
+
+#include <tiny/os/application.h>
+#include <tiny/draw/profiler.h>
+
+namespace tiny
+{
+
+namespace os
+{
+
+/*! \p HeadlessApplication : application without a visible window or audio device, intended for benchmarks.
+ * 
+ * The OpenGL context belongs to a hidden window and all rendering to the screen is redirected to an offscreen frame buffer.
+ * To run without a display, select SDL's EGL-based offscreen video driver (SDL_VIDEODRIVER=offscreen) or use a software rasteriser such as llvmpipe (LIBGL_ALWAYS_SOFTWARE=1) on a virtual X server.
+ * 
+ * The application runs for a fixed number of frames, pollEvents() always returns the same time step, and no input is ever received, such that runs are reproducible.
+ * The CPU time between pollEvents() and paint() and the GPU time of every frame are printed, followed by a summary.
+ * Renderers attached to getProfiler() are also timed per renderable, and their report is printed after the summary.
+ */
+class HeadlessApplication : public Application
+{
+    public:
+        HeadlessApplication(const int &, const int &, const int & = 1000, const double & = 1.0/60.0);
+        virtual ~HeadlessApplication();
+        
+        double pollEvents();
+        void paint();
+        int getScreenWidth() const;
+        int getScreenHeight() const;
+        MouseState getMouseState(const bool &);
+        
+        void printStatistics() const;
+        tiny::draw::FrameProfiler &getProfiler();
+        
+    private:
+        void initOpenGL();
+        void createFrameBuffer();
+        void destroyFrameBuffer();
+        void reportFrame(const int &);
+        
+        int screenWidth;
+        int screenHeight;
+        int nrFrames;
+        double timeStep;
+        SDL_Window *screen;
+        SDL_GLContext glContext;
+        
+        GLuint frameBuffer;
+        GLuint colourBuffer;
+        GLuint depthBuffer;
+        
+        int frame;
+        Uint64 frameStart;
+        std::vector<GLuint> timerQueries;
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+        tiny::draw::FrameProfiler *profiler;
+};
+
+}
+
+}
+
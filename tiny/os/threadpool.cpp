@@ -0,0 +1,169 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <exception>
+
+#include <tiny/os/threadpool.h>
+
+using namespace tiny::os;
+
+ThreadJob::ThreadJob()
+{
+
+}
+
+ThreadJob::~ThreadJob()
+{
+
+}
+
+ThreadPool::ThreadPool(const int &nrThreads) :
+    threads(),
+    mutex(0),
+    jobsAvailable(0),
+    jobsFinished(0),
+    jobs(0),
+    nextJob(0),
+    nrUnfinishedJobs(0),
+    stopping(false)
+{
+    //The calling thread also executes jobs, so we need one worker less than the number of threads.
+    const int nrWorkers = (nrThreads > 0 ? nrThreads : SDL_GetCPUCount()) - 1;
+    
+    mutex = SDL_CreateMutex();
+    jobsAvailable = SDL_CreateCond();
+    jobsFinished = SDL_CreateCond();
+    
+    if (!mutex || !jobsAvailable || !jobsFinished)
+    {
+        std::cerr << "Unable to create thread pool synchronisation primitives: " << SDL_GetError() << "!" << std::endl;
+        throw std::exception();
+    }
+    
+    for (int i = 0; i < nrWorkers; ++i)
+    {
+        SDL_Thread *thread = SDL_CreateThread(&ThreadPool::workerMain, "tiny worker", this);
+        
+        if (!thread)
+        {
+            std::cerr << "Warning: Unable to create worker thread: " << SDL_GetError() << "!" << std::endl;
+            break;
+        }
+        
+        threads.push_back(thread);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    SDL_LockMutex(mutex);
+    stopping = true;
+    SDL_CondBroadcast(jobsAvailable);
+    SDL_UnlockMutex(mutex);
+    
+    for (std::vector<SDL_Thread *>::iterator i = threads.begin(); i != threads.end(); ++i)
+    {
+        SDL_WaitThread(*i, 0);
+    }
+    
+    SDL_DestroyCond(jobsFinished);
+    SDL_DestroyCond(jobsAvailable);
+    SDL_DestroyMutex(mutex);
+}
+
+int ThreadPool::getNrThreads() const
+{
+    return threads.size() + 1;
+}
+
+void ThreadPool::run(const std::vector<ThreadJob *> &a_jobs)
+{
+    if (a_jobs.empty())
+    {
+        return;
+    }
+    
+    SDL_LockMutex(mutex);
+    jobs = &a_jobs;
+    nextJob = 0;
+    nrUnfinishedJobs = a_jobs.size();
+    SDL_CondBroadcast(jobsAvailable);
+    SDL_UnlockMutex(mutex);
+    
+    //Help out with the work ourselves.
+    runJobs();
+    
+    SDL_LockMutex(mutex);
+    
+    while (nrUnfinishedJobs > 0)
+    {
+        SDL_CondWait(jobsFinished, mutex);
+    }
+    
+    jobs = 0;
+    SDL_UnlockMutex(mutex);
+}
+
+void ThreadPool::runJobs()
+{
+    SDL_LockMutex(mutex);
+    
+    while (jobs && nextJob < jobs->size())
+    {
+        ThreadJob *job = (*jobs)[nextJob++];
+        
+        SDL_UnlockMutex(mutex);
+        job->run();
+        SDL_LockMutex(mutex);
+        
+        if (--nrUnfinishedJobs == 0)
+        {
+            SDL_CondSignal(jobsFinished);
+        }
+    }
+    
+    SDL_UnlockMutex(mutex);
+}
+
+int ThreadPool::workerMain(void *data)
+{
+    ThreadPool *pool = static_cast<ThreadPool *>(data);
+    
+    while (true)
+    {
+        SDL_LockMutex(pool->mutex);
+        
+        while (!pool->stopping && !(pool->jobs && pool->nextJob < pool->jobs->size()))
+        {
+            SDL_CondWait(pool->jobsAvailable, pool->mutex);
+        }
+        
+        const bool stop = pool->stopping;
+        
+        SDL_UnlockMutex(pool->mutex);
+        
+        if (stop)
+        {
+            break;
+        }
+        
+        pool->runJobs();
+    }
+    
+    return 0;
+}
+
@@ -0,0 +1,102 @@
+/*
+Copyright 2012, Bas Fagginger Auer.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <SDL.h>
+
+namespace tiny
+{
+
+namespace os
+{
+
+/** A unit of work that can be executed by a ThreadPool. */
+class ThreadJob
+{
+    public:
+        ThreadJob();
+        virtual ~ThreadJob();
+
+        virtual void run() = 0;
+};
+
+/** A fixed-size pool of worker threads.
+  * Calling run() hands out a list of jobs to the workers and the calling thread, and only returns once all of them have been completed.
+  * The pool is not re-entrant: run() should not be called from inside a job.
+  */
+class ThreadPool
+{
+    public:
+        ThreadPool(const int & = 0);
+        ~ThreadPool();
+
+        int getNrThreads() const;
+        void run(const std::vector<ThreadJob *> &);
+
+        /** Split [0, n) into chunks of at most chunkSize elements and call f(first, last) for each chunk in parallel. */
+        template <typename Functor>
+        void parallelFor(const int &n, const int &chunkSize, Functor &f)
+        {
+            std::vector<RangeJob<Functor> > rangeJobs;
+            std::vector<ThreadJob *> jobPointers;
+
+            for (int i = 0; i < n; i += chunkSize)
+            {
+                rangeJobs.push_back(RangeJob<Functor>(f, i, std::min(n, i + chunkSize)));
+            }
+
+            for (typename std::vector<RangeJob<Functor> >::iterator i = rangeJobs.begin(); i != rangeJobs.end(); ++i)
+            {
+                jobPointers.push_back(&*i);
+            }
+
+            run(jobPointers);
+        }
+
+    private:
+        template <typename Functor>
+        class RangeJob : public ThreadJob
+        {
+            public:
+                RangeJob(Functor &a_f, const int &a_first, const int &a_last) : ThreadJob(), f(&a_f), first(a_first), last(a_last) {}
+                void run() {(*f)(first, last);}
+
+            private:
+                Functor *f;
+                int first, last;
+        };
+
+        static int workerMain(void *);
+        void runJobs();
+
+        std::vector<SDL_Thread *> threads;
+        SDL_mutex *mutex;
+        SDL_cond *jobsAvailable;
+        SDL_cond *jobsFinished;
+        const std::vector<ThreadJob *> *jobs;
+        size_t nextJob;
+        size_t nrUnfinishedJobs;
+        bool stopping;
+};
+
+}
+
+}
+